@@ -128,6 +128,26 @@ function boostio.measureText(text, size) end
 ---@return table rgb Table with r, g, b fields (0.0-1.0)
 function boostio.hexToRgb(hex) end
 
+---Resolve a color once into a handle for draw lists
+---@param hex_or_r string|number Hex color string, or red component (0.0-1.0)
+---@param g_or_a number? Green component, or alpha when a hex string is given (default: 1.0)
+---@param b number? Blue component (0.0-1.0)
+---@param a number? Alpha component (0.0-1.0, default: 1.0)
+---@return integer color Packed RGBA color handle
+function boostio.color(hex_or_r, g_or_a, b, a) end
+
+---Create a retained draw list
+---Methods take a color handle from boostio.color as their last argument:
+---rect(x, y, w, h, color), strokeRect(x, y, w, h, color),
+---roundedRect(x, y, w, h, radius, color), strokeRoundedRect(x, y, w, h, radius, color),
+---line(x1, y1, x2, y2, color), text(text, x, y, size, color), clear(), count()
+---@return userdata list Empty draw list
+function boostio.newDrawList() end
+
+---Draw every item of a draw list in order
+---@param list userdata Draw list created with boostio.newDrawList
+function boostio.drawList(list) end
+
 ---Check if a point is inside a rectangle
 ---@param px number Point X coordinate
 ---@param py number Point Y coordinate
@@ -147,6 +167,54 @@ function boostio.getWindowSize() end
 ---@return number fps Current FPS
 function boostio.getFps() end
 
+---@class PluginStats
+---@field name string Plugin name
+---@field lastMs number Time spent in the plugin's callbacks last frame
+---@field avgMs number Average callback time per frame over the last 120 frames
+---@field maxMs number Worst frame over the last 120 frames
+---@field allocKb number Average KiB allocated per frame by the plugin's callbacks
+---@field gcKb number Average KiB freed per frame while the plugin's callbacks ran
+
+---Get per-plugin timing and memory statistics, in plugin priority order
+---@return PluginStats[] stats One entry per loaded plugin
+function boostio.getPluginStats() end
+
+---@class GcStats
+---@field mode string "generational" or "incremental"
+---@field heapKb number Current Lua heap size in KiB
+---@field peakKb number Largest Lua heap size seen, in KiB
+---@field poolKb number KiB reserved by the small-object pool arenas
+---@field allocations number Total allocations and growing reallocations
+---@field idleSteps number GC steps run in leftover frame time
+---@field idleCycles number Collections completed in leftover frame time
+---@field lastPauseMs number Duration of the most recent idle collection
+---@field maxPauseMs number Longest idle collection so far
+---@field totalPauseMs number Total time spent collecting in idle time
+
+---Subscribe to a state change event. Events are dispatched once before and once after the
+---plugin update callbacks, only when the state actually changed:
+--- - "notes_changed" (ids): ids of added, updated or removed notes, or nil when everything changed
+--- - "selection_changed" (count): number of selected notes
+--- - "playhead_moved" (ms): new playhead position
+--- - "transport_changed" (playing, bpm)
+--- - "viewport_changed" ()
+--- - "voices_changed" (): voice hidden, solo or mute flags changed
+--- - "file_loaded" (path)
+---@param event string Event name
+---@param handler function Called with the event's arguments
+---@return number handle Subscription handle for boostio.unsubscribe
+function boostio.subscribe(event, handler) end
+
+---Remove a subscription created by boostio.subscribe
+---@param event string Event name
+---@param handle number Handle returned by boostio.subscribe
+---@return boolean removed True if the subscription existed
+function boostio.unsubscribe(event, handle) end
+
+---Get Lua garbage collector statistics
+---@return GcStats stats
+function boostio.getGcStats() end
+
 ---Get the current mouse position
 ---@return number x Mouse X position in pixels
 ---@return number y Mouse Y position in pixels
@@ -213,24 +281,78 @@ function boostio.quit() end
 
 ---Save the current project in all formats (.json, .c, .wav)
 ---If a file was previously loaded, saves to that location
----If filepath is provided, saves to that location and sets it as current
+---If filepath is provided, saves to that location and sets it as current once the save starts
 ---Automatically generates .json, .c, and .wav files from the base path
+---The notes are snapshotted and written on a background thread; the .json
+---file is written to a temporary file and renamed over the original
 ---@param filepath string? Optional filepath (default: current file or "song.json")
----@return boolean success True if all formats saved successfully
-function boostio.save(filepath) end
+---@param on_complete fun(success: boolean, path: string)? Called once all formats are written
+---@return boolean started True if the save was started
+---@return string? reason "busy" if a save is already in progress, "error" if it could not start
+function boostio.save(filepath, on_complete) end
 
 ---Export only the C code format (for individual export)
+---The compact format emits a deduplicated spec table, a packed event array and a small decoder
 ---@param filepath string? Optional filepath (default: "song.c")
+---@param compact boolean? Use the compact table-driven format (default: false)
 ---@return boolean success True if export succeeded
-function boostio.saveC(filepath) end
+function boostio.saveC(filepath, compact) end
 
 ---Export only the WAV audio format (for individual export)
 ---@param filepath string? Optional filepath (default: "song.wav")
 ---@return boolean success True if export succeeded
 function boostio.saveWav(filepath) end
 
----Load a project from JSON file
----Sets the loaded file as the current file for future saves
+---Save the current project in the compact binary song format (.bsong)
+---Binary songs are memory-mapped on load and keep note ids and instruments
+---@param filepath string? Optional filepath (default: current file with .bsong extension)
+---@return boolean success True if save succeeded
+function boostio.saveBinary(filepath) end
+
+---Export the current project as a Standard MIDI File (type 1)
+---Each voice becomes its own track; waveform changes are written as text and program-change events
+---NES noise notes are written on the General MIDI drum channel
+---@param filepath string? Optional filepath (default: current file with .mid extension)
+---@return boolean success True if export succeeded
+function boostio.saveMidi(filepath) end
+
+---Convert a song between the JSON and binary formats
+---The direction is detected from the input file contents
+---@param input_path string Source song file (.json or .bsong)
+---@param output_path string Destination file
+---@return boolean success True if conversion succeeded
+function boostio.convertSong(input_path, output_path) end
+
+---@class SongLibraryEntry
+---@field path string Full path to the song file
+---@field name string File name without directory
+---@field bpm number Song tempo
+---@field lengthMs number End time of the last note in milliseconds
+---@field noteCount number Number of notes in the song
+---@field voices number[] Voice indices used by the song
+---@field thumbnail number[] Note density over time, 32 buckets scaled 0-255
+
+---@class SongLibraryFilter
+---@field name string? Case-insensitive substring of the file name
+---@field minBpm number? Minimum tempo
+---@field maxBpm number? Maximum tempo
+---@field voice number? Only songs that use this voice
+
+---Query the song library index of the data directory
+---Metadata comes from a cache keyed by path, mtime and size, so no songs are parsed
+---@param filter SongLibraryFilter? Optional filter
+---@return SongLibraryEntry[] entries Matching songs sorted by path
+---@return boolean scanning True while a background rescan is still running
+function boostio.getSongLibrary(filter) end
+
+---Start a background rescan of the data directory
+---Only new or modified song files are parsed
+---@return boolean started False if a scan is already running
+function boostio.rescanSongLibrary() end
+
+---Load a project from a JSON, binary song or Standard MIDI (type 0/1) file
+---MIDI channels are packed onto the 8 voices without overlaps where possible; channel 10 uses NES noise
+---Sets the loaded file as the current file for future saves (saving writes .json next to it)
 ---@param filepath string? Optional filepath (default: "song.json")
 ---@return boolean success True if load succeeded
 function boostio.load(filepath) end
@@ -241,6 +363,13 @@ function boostio.undo() end
 ---Redo the last undone action
 function boostio.redo() end
 
+---Start an edit transaction; edits until commitEdit become one undo step,
+---and repeated edits to the same notes are merged
+function boostio.beginEdit() end
+
+---Commit the current edit transaction to the undo history
+function boostio.commitEdit() end
+
 ---Toggle play/pause
 function boostio.togglePlay() end
 
@@ -289,9 +418,70 @@ function boostio.getScaleInfo() end
 function boostio.toggleFold() end
 
 ---Get comprehensive app state information
----@return table state Table with fields: bpm, selected_voice, waveform, note_count, is_playing, playhead_ms, snap_enabled, snap_ms, selected_scale, selected_root, voice_hidden, voice_solo, voice_muted, viewport, notes, fold_mode, show_scale_highlights
+---The same table is returned on every call and refreshed in place; treat it as read-only.
+---`version` increases whenever any field changes. `notes` is a live view of the note store:
+---index it with 1..#notes to get note views whose fields read the current note.
+---@return table state Table with fields: version, bpm, selected_voice, waveform, note_count, is_playing, playhead_ms, snap_enabled, snap_ms, selected_scale, selected_root, voice_hidden, voice_solo, voice_muted, viewport, notes, fold_mode, show_scale_highlights
 function boostio.getAppState() end
 
+---Get a live view of a single note
+---@param note_id integer ID of the note
+---@return userdata|nil note Note view with the same fields as getAppState().notes entries, or nil
+function boostio.getNote(note_id) end
+
+---@class VoiceConflict
+---@field voice integer Voice index (0-7)
+---@field start_ms integer Start of the overlapping span
+---@field end_ms integer End of the overlapping span
+---@field note_count integer Number of notes in the span
+
+---Get every span where notes on the same voice overlap, sorted by voice then time.
+---The table is cached and shared between calls until the notes change; treat it as read-only.
+---@return VoiceConflict[] conflicts
+function boostio.getVoiceConflicts() end
+
+---@class AutoAssignOptions
+---@field selectedOnly? boolean Only move selected notes when there is a selection (default false)
+---@field locked? integer[] Note IDs that must keep their voice
+---@field voices? integer[] Voices notes may be moved to (default all 0-7)
+---@field waveforms? table<string, integer[]> Voices allowed per waveform name ("sine", "nes_noise", ...)
+
+---@class UnsolvedSpan
+---@field start_ms integer Start of the span
+---@field end_ms integer End of the span
+---@field note_count integer Notes in the span that could not be given a free voice
+
+---@class AutoAssignResult
+---@field changed integer Number of notes moved to another voice
+---@field voicesUsed integer Number of voices holding notes afterwards
+---@field unsolved UnsolvedSpan[] Spans that need more voices than the constraints allow
+
+---Reassign voices so notes on the same voice do not overlap, using as few voices as possible.
+---Notes that cannot be placed keep their voice and are reported in unsolved. Undoes as one step.
+---@param options? AutoAssignOptions
+---@return AutoAssignResult result
+function boostio.autoAssignVoices(options) end
+
+---Get the notes overlapping a time span, optionally limited to a key range
+---@param start_ms integer Start of the span in milliseconds (inclusive)
+---@param end_ms integer End of the span in milliseconds (exclusive)
+---@param min_key integer|nil Lowest piano key to include (default 0)
+---@param max_key integer|nil Highest piano key to include (default 127)
+---@param voice_mask integer|nil Bit mask of voices to include, bit 0 is voice 0 (default 0xFF)
+---@return table notes Array of note tables with the same fields as getAppState().notes
+function boostio.getNotesInRange(start_ms, end_ms, min_key, max_key, voice_mask) end
+
+---Iterate the notes overlapping a time span without building tables
+---Notes of each voice are visited in start time order, one voice after another.
+---Usage: for _, note in boostio.notesInRange(0, 4000) do ... end
+---@param start_ms integer Start of the span in milliseconds (inclusive)
+---@param end_ms integer End of the span in milliseconds (exclusive)
+---@param min_key integer|nil Lowest piano key to include (default 0)
+---@param max_key integer|nil Highest piano key to include (default 127)
+---@param voice_mask integer|nil Bit mask of voices to include, bit 0 is voice 0 (default 0xFF)
+---@return function iterator, userdata state, integer position
+function boostio.notesInRange(start_ms, end_ms, min_key, max_key, voice_mask) end
+
 ---Set whether a voice is hidden (not displayed visually)
 ---@param voice integer Voice index (0-7)
 ---@param hidden boolean Whether the voice should be hidden
@@ -376,6 +566,22 @@ function boostio.resizeNote(note_id, delta_duration_ms, from_left) end
 ---@param note_id integer ID of the note to delete
 function boostio.deleteNote(note_id) end
 
+---Move several notes at once as a single undoable edit
+---@param note_ids integer[] IDs of the notes to move
+---@param delta_ms integer|integer[] Time delta, or one delta per note
+---@param delta_piano_key integer|integer[] Pitch delta, or one delta per note
+function boostio.moveNotes(note_ids, delta_ms, delta_piano_key) end
+
+---Resize several notes at once as a single undoable edit
+---@param note_ids integer[] IDs of the notes to resize
+---@param delta_duration_ms integer|integer[] Duration delta, or one delta per note
+---@param from_left boolean True to resize from left edge, false for right edge
+function boostio.resizeNotes(note_ids, delta_duration_ms, from_left) end
+
+---Delete several notes at once as a single undoable edit
+---@param note_ids integer[] IDs of the notes to delete
+function boostio.deleteNotes(note_ids) end
+
 ---Play a preview note using the selected instrument
 ---@param piano_key integer Piano key to preview (0-127)
 function boostio.playPreviewNote(piano_key) end
@@ -407,6 +613,11 @@ function boostio.setNoteVoice(note_id, voice) end
 ---@param instrument_index integer Instrument index (0-based)
 function boostio.setNoteInstrument(note_id, instrument_index) end
 
+---Set the instrument parameters of several notes as a single undoable edit
+---@param note_ids integer[] IDs of the notes to modify
+---@param instrument_index integer Instrument index (0-based)
+function boostio.setNotesInstrument(note_ids, instrument_index) end
+
 ---Check if a key is currently pressed down
 ---@param key string Key name (e.g., "ctrl", "shift", "alt", "a", "space")
 ---@return boolean is_down True if the key is currently pressed
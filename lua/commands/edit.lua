@@ -1,26 +1,34 @@
 boostio.registerCommand("undo", function()
 	boostio.undo()
-	if voice_validation then
-		voice_validation.invalidate()
-	end
 end)
 
 boostio.registerCommand("redo", function()
 	boostio.redo()
-	if voice_validation then
-		voice_validation.invalidate()
-	end
 end)
 
 boostio.registerCommand("delete_selected", function()
 	local selection = boostio.getSelection()
 	if #selection > 0 then
-		for _, note_id in ipairs(selection) do
-			boostio.deleteNote(note_id)
-		end
+		boostio.deleteNotes(selection)
 		boostio.clearSelection()
-		if voice_validation then
-			voice_validation.invalidate()
-		end
+	end
+end)
+
+boostio.registerCommand("auto_assign_voices", function()
+	local settings = config.voices and config.voices.auto_assign or {}
+	local result = boostio.autoAssignVoices({
+		selectedOnly = true,
+		voices = settings.voices,
+		waveforms = settings.waveforms,
+	})
+
+	if not toast then
+		return
+	end
+
+	if #result.unsolved > 0 then
+		toast.warning(#result.unsolved .. " span(s) need more voices than allowed", 3000)
+	else
+		toast.info("Moved " .. result.changed .. " note(s), " .. result.voicesUsed .. " voice(s) in use")
 	end
 end)
@@ -3,12 +3,21 @@ boostio.registerCommand("quit", function()
 end)
 
 boostio.registerCommand("save", function()
-	local success = boostio.save()
-	if toast then
-		if success then
-			toast.info("Saved successfully")
+	local started, reason = boostio.save(nil, function(success)
+		if toast then
+			if success then
+				toast.info("Saved successfully")
+			else
+				toast.error("Save failed")
+			end
+		end
+	end)
+
+	if not started and toast then
+		if reason == "busy" then
+			toast.warning("Save already in progress")
 		else
-			toast.error("Save failed")
+			toast.error("Save failed to start")
 		end
 	end
 end)
@@ -24,9 +24,26 @@ config = {
 		follow_playhead = true,
 	},
 
+	history = {
+		undo_budget_kb = 256,
+	},
+
+	voices = {
+		-- Ctrl+Shift+V reassigns voices so notes on the same voice never overlap.
+		-- Only selected notes move when there is a selection. Voices can be
+		-- limited overall or per waveform (sine, square, triangle, sawtooth, nes_noise).
+		auto_assign = {
+			-- voices = { 0, 1, 2, 3, 4, 5, 6, 7 },
+			-- waveforms = { nes_noise = { 7 } },
+		},
+	},
+
 	theme = theme,
 
 	plugins = {
+		-- Plugins update and render in ascending priority (higher draws on top);
+		-- key events go to the highest priority first. An optional budget_ms caps
+		-- a plugin's per-frame update+render time; overruns skip its next updates.
 		load_list = {
 			{
 				name = "piano_roll",
@@ -57,6 +74,12 @@ config = {
 				enabled = true,
 				priority = 210,
 			},
+			{
+				-- Press F3 to show per-plugin frame time and allocation stats
+				name = "plugin_profiler",
+				enabled = true,
+				priority = 220,
+			},
 			{
 				name = "statusline",
 				enabled = true,
@@ -81,6 +104,7 @@ config = {
 				name = "voice_validation",
 				enabled = true,
 				priority = 55,
+				budget_ms = 2.0,
 			},
 			{
 				name = "splash_screen",
@@ -22,6 +22,8 @@ boostio.registerKeybinding("y", "redo", { ctrl = true })
 boostio.registerKeybinding("delete", "delete_selected")
 boostio.registerKeybinding("backspace", "delete_selected")
 
+boostio.registerKeybinding("v", "auto_assign_voices", { ctrl = true, shift = true })
+
 boostio.registerKeybinding("space", "toggle_play")
 boostio.registerKeybinding("escape", "stop")
 
@@ -85,9 +85,7 @@ function instrument_selector.render()
 
 				local selection = boostio.getSelection()
 				if selection and #selection > 0 then
-					for _, note_id in ipairs(selection) do
-						boostio.setNoteInstrument(note_id, i)
-					end
+					boostio.setNotesInstrument(selection, i)
 
 					if toast then
 						local inst = boostio.getInstrument(i)
@@ -54,6 +54,7 @@ function piano_roll.render()
 	local state = boostio.getAppState()
 	local theme = config.theme
 
+	state.preview_notes = nil
 	update(state)
 
 	rendering.render_grid(state, theme, state_module.options, utils)
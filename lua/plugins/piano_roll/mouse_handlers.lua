@@ -157,26 +157,24 @@ local function create_copied_notes(mouse_state, state)
 		local initial_duration = mouse_state.drag_data.initial_durations[note_id]
 		local initial_piano_key = mouse_state.drag_data.initial_piano_keys[note_id]
 
-		for _, note in ipairs(state.notes) do
-			if note.id == note_id then
-				local params = {
-					voice = note.voice,
-					waveform = note.waveform,
-					duty_cycle = note.duty_cycle,
-					decay = note.decay,
-					amplitude_dbfs = note.amplitude_dbfs,
-					nes_noise_period = note.nes_noise_period,
-					nes_noise_mode_flag = note.nes_noise_mode_flag,
-				}
-				local new_note_id = boostio.addNote(note.ms, note.piano_key, note.duration_ms, params)
-				if new_note_id then
-					table.insert(copied_ids, new_note_id)
-					table.insert(original_ids, note_id)
-					new_positions[new_note_id] = initial_ms
-					new_durations[new_note_id] = initial_duration
-					new_piano_keys[new_note_id] = initial_piano_key
-				end
-				break
+		local note = boostio.getNote(note_id)
+		if note then
+			local params = {
+				voice = note.voice,
+				waveform = note.waveform,
+				duty_cycle = note.duty_cycle,
+				decay = note.decay,
+				amplitude_dbfs = note.amplitude_dbfs,
+				nes_noise_period = note.nes_noise_period,
+				nes_noise_mode_flag = note.nes_noise_mode_flag,
+			}
+			local new_note_id = boostio.addNote(note.ms, note.piano_key, note.duration_ms, params)
+			if new_note_id then
+				table.insert(copied_ids, new_note_id)
+				table.insert(original_ids, note_id)
+				new_positions[new_note_id] = initial_ms
+				new_durations[new_note_id] = initial_duration
+				new_piano_keys[new_note_id] = initial_piano_key
 			end
 		end
 	end
@@ -208,6 +206,10 @@ local function start_copy_drag_if_needed(mouse_state, state, distance, options)
 
 	mouse_state.drag_started = true
 
+	if mouse_state.drag_mode ~= "box_select" then
+		boostio.beginEdit()
+	end
+
 	if mouse_state.drag_mode == "copy" then
 		create_copied_notes(mouse_state, state)
 	end
@@ -298,9 +300,10 @@ local function handle_move_or_copy_drag(x, y, mouse_state, state, note_ops, util
 
 	for note_id, initial_ms in pairs(mouse_state.drag_data.initial_positions) do
 		local initial_piano_key = mouse_state.drag_data.initial_piano_keys[note_id]
-		local note = note_ops.find_note_by_id(state, note_id)
+		local note = note_ops.copy_note_by_id(state, note_id)
 		if note then
 			update_note_position(note, initial_ms, initial_piano_key, delta_ms, delta_piano_key, state, utils, options, mouse_state)
+			note_ops.set_preview_note(state, note)
 		end
 	end
 end
@@ -323,10 +326,11 @@ local function handle_resize_left_drag(x, mouse_state, state, note_ops, utils, o
 			new_duration = options.min_note_duration_ms
 		end
 
-		local note = note_ops.find_note_by_id(state, note_id)
+		local note = note_ops.copy_note_by_id(state, note_id)
 		if note then
 			note.ms = math.max(0, initial_ms + delta_ms)
 			note.duration_ms = math.floor(new_duration)
+			note_ops.set_preview_note(state, note)
 		end
 	end
 end
@@ -350,9 +354,10 @@ local function handle_resize_right_drag(x, mouse_state, state, note_ops, utils,
 			new_duration = options.min_note_duration_ms
 		end
 
-		local note = note_ops.find_note_by_id(state, note_id)
+		local note = note_ops.copy_note_by_id(state, note_id)
 		if note then
 			note.duration_ms = math.floor(new_duration)
+			note_ops.set_preview_note(state, note)
 		end
 	end
 end
@@ -375,7 +380,7 @@ local function finalize_box_select(mouse_state, state, note_ops, utils, options)
 		boostio.clearSelection()
 	end
 
-	for _, note in ipairs(state.notes) do
+	for _, note in ipairs(utils.get_notes_in_rect(state, options, min_x, min_y, max_x, max_y)) do
 		local rect = utils.get_note_rect(state.viewport, note, state.fold_mode, state.selected_scale,
 			state.selected_root, options)
 
@@ -424,36 +429,36 @@ function mouse_handlers.handle_mouse_move(x, y, state, mouse_state, utils, note_
 end
 
 local function finalize_move_or_copy(mouse_state, state, note_ops)
+	local note_ids = {}
+	local deltas_ms = {}
+	local deltas_piano_key = {}
+
 	for note_id, initial_ms in pairs(mouse_state.drag_data.initial_positions) do
 		local initial_piano_key = mouse_state.drag_data.initial_piano_keys[note_id]
-		local note = note_ops.find_note_by_id(state, note_id)
+		local note = note_ops.find_dragged_note(state, note_id)
 		if note then
-			local delta_ms = math.floor(note.ms - initial_ms)
-			local delta_piano_key = math.floor(note.piano_key - initial_piano_key)
-			boostio.moveNote(note_id, delta_ms, delta_piano_key)
+			table.insert(note_ids, note_id)
+			table.insert(deltas_ms, math.floor(note.ms - initial_ms))
+			table.insert(deltas_piano_key, math.floor(note.piano_key - initial_piano_key))
 		end
 	end
-end
 
-local function finalize_resize_left(mouse_state, state, note_ops)
-	for note_id, initial_ms in pairs(mouse_state.drag_data.initial_positions) do
-		local initial_duration = mouse_state.drag_data.initial_durations[note_id]
-		local note = note_ops.find_note_by_id(state, note_id)
-		if note then
-			local delta_duration = math.floor(note.duration_ms - initial_duration)
-			boostio.resizeNote(note_id, delta_duration, true)
-		end
-	end
+	boostio.moveNotes(note_ids, deltas_ms, deltas_piano_key)
 end
 
-local function finalize_resize_right(mouse_state, state, note_ops)
+local function finalize_resize(mouse_state, state, note_ops, from_left)
+	local note_ids = {}
+	local deltas_duration = {}
+
 	for note_id, initial_duration in pairs(mouse_state.drag_data.initial_durations) do
-		local note = note_ops.find_note_by_id(state, note_id)
+		local note = note_ops.find_dragged_note(state, note_id)
 		if note then
-			local delta_duration = math.floor(note.duration_ms - initial_duration)
-			boostio.resizeNote(note_id, delta_duration, false)
+			table.insert(note_ids, note_id)
+			table.insert(deltas_duration, math.floor(note.duration_ms - initial_duration))
 		end
 	end
+
+	boostio.resizeNotes(note_ids, deltas_duration, from_left)
 end
 
 local function finalize_drag(mouse_state, state, note_ops, utils, options)
@@ -469,10 +474,12 @@ local function finalize_drag(mouse_state, state, note_ops, utils, options)
 	if mouse_state.drag_mode == "move" or mouse_state.drag_mode == "copy" then
 		finalize_move_or_copy(mouse_state, state, note_ops)
 	elseif mouse_state.drag_mode == "resize_left" then
-		finalize_resize_left(mouse_state, state, note_ops)
+		finalize_resize(mouse_state, state, note_ops, true)
 	elseif mouse_state.drag_mode == "resize_right" then
-		finalize_resize_right(mouse_state, state, note_ops)
+		finalize_resize(mouse_state, state, note_ops, false)
 	end
+
+	boostio.commitEdit()
 end
 
 local function handle_double_click(note_id, mouse_state)
@@ -599,10 +606,6 @@ function mouse_handlers.handle_mouse_up(x, y, button, state, mouse_state, utils,
 		handle_click(x, y, vp, state, mouse_state, note_ops, utils, ctrl_held, shift_held, options)
 	end
 
-	if voice_validation then
-		voice_validation.invalidate()
-	end
-
 	state_module.reset_mouse_state(mouse_state)
 end
 
@@ -1,12 +1,42 @@
 local note_operations = {}
 
 function note_operations.find_note_by_id(state, note_id)
-	for _, note in ipairs(state.notes) do
-		if note.id == note_id then
-			return note
-		end
+	return boostio.getNote(note_id)
+end
+
+function note_operations.copy_note_by_id(state, note_id)
+	local note = boostio.getNote(note_id)
+	if not note then
+		return nil
+	end
+
+	return {
+		id = note.id,
+		ms = note.ms,
+		duration_ms = note.duration_ms,
+		voice = note.voice,
+		piano_key = note.piano_key,
+		waveform = note.waveform,
+		duty_cycle = note.duty_cycle,
+		decay = note.decay,
+		amplitude_dbfs = note.amplitude_dbfs,
+		nes_noise_period = note.nes_noise_period,
+		nes_noise_mode_flag = note.nes_noise_mode_flag,
+		nes_noise_lfsr_init = note.nes_noise_lfsr_init,
+		restart_phase = note.restart_phase,
+	}
+end
+
+function note_operations.set_preview_note(state, note)
+	state.preview_notes = state.preview_notes or {}
+	state.preview_notes[note.id] = note
+end
+
+function note_operations.find_dragged_note(state, note_id)
+	if state.preview_notes and state.preview_notes[note_id] then
+		return state.preview_notes[note_id]
 	end
-	return nil
+	return note_operations.find_note_by_id(state, note_id)
 end
 
 function note_operations.for_each_selected_note(state, callback)
@@ -35,8 +65,9 @@ function note_operations.is_voice_visible(voice)
 end
 
 function note_operations.find_note_at_position(x, y, state, utils, options)
-	for i = #state.notes, 1, -1 do
-		local note = state.notes[i]
+	local notes = utils.get_visible_notes(state, options)
+	for i = #notes, 1, -1 do
+		local note = notes[i]
 		local rect = utils.get_note_rect(state.viewport, note, state.fold_mode, state.selected_scale,
 			state.selected_root, options)
 
@@ -1,8 +1,64 @@
 local rendering = {}
 
-local function draw_background(vp, theme)
-	local bg = boostio.hexToRgb(theme.grid_background)
-	boostio.drawRectangle(vp.grid_x, vp.grid_y, vp.grid_width, vp.grid_height, bg.r, bg.g, bg.b, 1.0)
+local palette = nil
+local palette_theme = nil
+local grid_list = nil
+local grid_version = nil
+local key_list = nil
+local note_list = nil
+
+local function voice_color_variants(hex)
+	local color = boostio.hexToRgb(hex)
+	return {
+		normal = boostio.color(color.r, color.g, color.b, 1.0),
+		selected = boostio.color(
+			math.min(1.0, color.r * 1.3),
+			math.min(1.0, color.g * 1.3),
+			math.min(1.0, color.b * 1.3),
+			1.0
+		),
+		inaudible = boostio.color(color.r * 0.3, color.g * 0.3, color.b * 0.3, 0.5),
+	}
+end
+
+local function get_palette(theme)
+	if palette_theme == theme then
+		return palette
+	end
+
+	palette = {
+		grid_background = boostio.color(theme.grid_background),
+		scale_root_grid = boostio.color(theme.scale_root_grid, theme.scale_root_grid_alpha),
+		scale_note_grid = boostio.color(theme.scale_note_grid, theme.scale_note_grid_alpha),
+		grid_line = boostio.color(theme.grid_line),
+		grid_line_bar = boostio.color(theme.grid_line, 0.5),
+		grid_line_beat = boostio.color(theme.grid_line, 0.78),
+		grid_line_subdivision = boostio.color(theme.grid_line, 0.23),
+		grid_beat_line = boostio.color(theme.grid_beat_line),
+		background = boostio.color(theme.background),
+		piano_key_black = boostio.color(theme.piano_key_black),
+		piano_key_white = boostio.color(theme.piano_key_white),
+		piano_key_separator = boostio.color(theme.piano_key_separator),
+		piano_key_black_text = boostio.color(theme.piano_key_black_text),
+		piano_key_white_text = boostio.color(theme.piano_key_white_text),
+		scale_root_piano = boostio.color(theme.scale_root_piano),
+		scale_note_piano = boostio.color(theme.scale_note_piano),
+		scale_root_piano_overlay = boostio.color(theme.scale_root_piano, 0.7),
+		scale_note_piano_overlay = boostio.color(theme.scale_note_piano, 0.55),
+		selection_outline = boostio.color(1.0, 1.0, 1.0, 1.0),
+		voices = {},
+	}
+	for i = 1, 8 do
+		palette.voices[i] = voice_color_variants(theme.voice_colors[i])
+	end
+
+	palette_theme = theme
+	grid_version = nil
+	return palette
+end
+
+local function draw_background(list, vp, colors)
+	list:rect(vp.grid_x, vp.grid_y, vp.grid_width, vp.grid_height, colors.grid_background)
 end
 
 local function get_visible_key_range(vp, options)
@@ -20,14 +76,13 @@ local function get_visible_key_range(vp, options)
 	return start_key, end_key
 end
 
-local function draw_scale_highlight(vp, y, height, key, state, theme)
+local function draw_scale_highlight(list, vp, y, height, key, state, colors)
 	if not state.show_scale_highlights then
 		return
 	end
 
 	if boostio.isRootNote(key, state.selected_root) then
-		local color = boostio.hexToRgb(theme.scale_root_grid)
-		boostio.drawRectangle(vp.grid_x, y, vp.grid_width, height, color.r, color.g, color.b, theme.scale_root_grid_alpha)
+		list:rect(vp.grid_x, y, vp.grid_width, height, colors.scale_root_grid)
 		return
 	end
 
@@ -37,19 +92,17 @@ local function draw_scale_highlight(vp, y, height, key, state, theme)
 
 	local success, in_scale = pcall(boostio.isNoteInScale, key, state.selected_scale, state.selected_root)
 	if success and in_scale then
-		local color = boostio.hexToRgb(theme.scale_note_grid)
-		boostio.drawRectangle(vp.grid_x, y, vp.grid_width, height, color.r, color.g, color.b, theme.scale_note_grid_alpha)
+		list:rect(vp.grid_x, y, vp.grid_width, height, colors.scale_note_grid)
 	end
 end
 
-local function draw_folded_grid_row(vp, row_y, key, state, theme)
-	draw_scale_highlight(vp, row_y, vp.piano_key_height, key, state, theme)
+local function draw_folded_grid_row(list, vp, row_y, key, state, colors)
+	draw_scale_highlight(list, vp, row_y, vp.piano_key_height, key, state, colors)
 
-	local line_color = boostio.hexToRgb(theme.grid_line)
-	boostio.drawLine(vp.grid_x, row_y, vp.grid_x + vp.grid_width, row_y, line_color.r, line_color.g, line_color.b, 1.0)
+	list:line(vp.grid_x, row_y, vp.grid_x + vp.grid_width, row_y, colors.grid_line)
 end
 
-local function draw_folded_grid(vp, state, theme, options)
+local function draw_folded_grid(list, vp, state, colors, options)
 	if not boostio or not boostio.isNoteInScale then
 		return
 	end
@@ -65,7 +118,7 @@ local function draw_folded_grid(vp, state, theme, options)
 					break
 				end
 
-				draw_folded_grid_row(vp, row_y, key, state, theme)
+				draw_folded_grid_row(list, vp, row_y, key, state, colors)
 				row_y = row_y + vp.piano_key_height
 			end
 			current_row = current_row + 1
@@ -73,32 +126,26 @@ local function draw_folded_grid(vp, state, theme, options)
 	end
 end
 
-local function draw_black_key_background(vp, y, theme, utils)
-	local color = boostio.hexToRgb(theme.piano_key_black)
-	boostio.drawRectangle(vp.grid_x, y, vp.grid_width, vp.piano_key_height, color.r, color.g, color.b, 1.0)
-end
-
-local function draw_unfolded_grid_row(vp, key, y, state, theme, utils)
+local function draw_unfolded_grid_row(list, vp, key, y, state, colors, utils)
 	if utils.is_black_key(key) then
-		draw_black_key_background(vp, y, theme, utils)
+		list:rect(vp.grid_x, y, vp.grid_width, vp.piano_key_height, colors.piano_key_black)
 	end
 
-	draw_scale_highlight(vp, y, vp.piano_key_height, key, state, theme)
+	draw_scale_highlight(list, vp, y, vp.piano_key_height, key, state, colors)
 
-	local line_color = boostio.hexToRgb(theme.grid_line)
-	boostio.drawLine(vp.grid_x, y, vp.grid_x + vp.grid_width, y, line_color.r, line_color.g, line_color.b, 1.0)
+	list:line(vp.grid_x, y, vp.grid_x + vp.grid_width, y, colors.grid_line)
 end
 
-local function draw_unfolded_grid(vp, state, theme, options, utils)
+local function draw_unfolded_grid(list, vp, state, colors, options, utils)
 	local start_key, end_key = get_visible_key_range(vp, options)
 
 	for key = start_key, end_key do
 		local y = boostio.pianoKeyToY(key)
-		draw_unfolded_grid_row(vp, key, y, state, theme, utils)
+		draw_unfolded_grid_row(list, vp, key, y, state, colors, utils)
 	end
 end
 
-local function draw_grid_lines(vp, state, theme)
+local function draw_grid_lines(list, vp, state, colors)
 	local ms_per_beat = 60000.0 / state.bpm
 	local ms_per_bar = ms_per_beat * 4.0
 
@@ -106,28 +153,26 @@ local function draw_grid_lines(vp, state, theme)
 	local end_ms = start_ms + (vp.grid_width / vp.pixels_per_ms)
 
 	if state.snap_enabled then
-		draw_snap_grid_lines(vp, state, theme, ms_per_beat, ms_per_bar, start_ms, end_ms)
+		draw_snap_grid_lines(list, vp, state, colors, ms_per_beat, ms_per_bar, start_ms, end_ms)
 		return
 	end
 
-	draw_bar_lines(vp, theme, ms_per_bar, start_ms, end_ms)
+	draw_bar_lines(list, vp, colors, ms_per_bar, start_ms, end_ms)
 end
 
-local function draw_bar_rectangle_if_even(x, vp, bar, theme, ms_per_bar)
+local function draw_bar_rectangle_if_even(list, x, vp, bar, colors, ms_per_bar)
 	if bar % 2 ~= 0 then
 		return
 	end
 
-	local color = boostio.hexToRgb(theme.grid_line)
-	boostio.drawRectangle(x, vp.grid_y, ms_per_bar * vp.pixels_per_ms, vp.grid_height, color.r, color.g, color.b, 0.5)
+	list:rect(x, vp.grid_y, ms_per_bar * vp.pixels_per_ms, vp.grid_height, colors.grid_line_bar)
 end
 
-local function draw_bar_line(x, vp, theme)
-	local beat_color = boostio.hexToRgb(theme.grid_beat_line)
-	boostio.drawLine(x, vp.grid_y, x, vp.grid_y + vp.grid_height, beat_color.r, beat_color.g, beat_color.b, 1.0)
+local function draw_bar_line(list, x, vp, colors)
+	list:line(x, vp.grid_y, x, vp.grid_y + vp.grid_height, colors.grid_beat_line)
 end
 
-function draw_bar_lines(vp, theme, ms_per_bar, start_ms, end_ms)
+function draw_bar_lines(list, vp, colors, ms_per_bar, start_ms, end_ms)
 	local first_bar = math.floor(start_ms / ms_per_bar)
 	local last_bar = math.floor(end_ms / ms_per_bar) + 1
 
@@ -136,29 +181,28 @@ function draw_bar_lines(vp, theme, ms_per_bar, start_ms, end_ms)
 		local x = boostio.msToX(bar_ms_float)
 
 		if x >= vp.grid_x and x <= vp.grid_x + vp.grid_width then
-			draw_bar_rectangle_if_even(x, vp, bar, theme, ms_per_bar)
-			draw_bar_line(x, vp, theme)
+			draw_bar_rectangle_if_even(list, x, vp, bar, colors, ms_per_bar)
+			draw_bar_line(list, x, vp, colors)
 		end
 	end
 end
 
-local function draw_snap_grid_line(x, vp, theme, is_bar, is_beat, bar, ms_per_bar)
+local function draw_snap_grid_line(list, x, vp, colors, is_bar, is_beat, bar, ms_per_bar)
 	if is_bar then
-		draw_bar_rectangle_if_even(x, vp, bar, theme, ms_per_bar)
-		draw_bar_line(x, vp, theme)
+		draw_bar_rectangle_if_even(list, x, vp, bar, colors, ms_per_bar)
+		draw_bar_line(list, x, vp, colors)
 		return
 	end
 
-	local color = boostio.hexToRgb(theme.grid_line)
 	if is_beat then
-		boostio.drawLine(x, vp.grid_y, x, vp.grid_y + vp.grid_height, color.r, color.g, color.b, 0.78)
+		list:line(x, vp.grid_y, x, vp.grid_y + vp.grid_height, colors.grid_line_beat)
 		return
 	end
 
-	boostio.drawLine(x, vp.grid_y, x, vp.grid_y + vp.grid_height, color.r, color.g, color.b, 0.23)
+	list:line(x, vp.grid_y, x, vp.grid_y + vp.grid_height, colors.grid_line_subdivision)
 end
 
-function draw_snap_grid_lines(vp, state, theme, ms_per_beat, ms_per_bar, start_ms, end_ms)
+function draw_snap_grid_lines(list, vp, state, colors, ms_per_beat, ms_per_bar, start_ms, end_ms)
 	local ms_per_32nd = ms_per_beat / 8.0
 	local first_32nd = math.floor(start_ms / ms_per_32nd)
 	local last_32nd = math.floor(end_ms / ms_per_32nd) + 1
@@ -172,70 +216,66 @@ function draw_snap_grid_lines(vp, state, theme, ms_per_beat, ms_per_bar, start_m
 			local is_bar = is_beat and ((math.floor(note_32nd / 8) % 4) == 0)
 			local bar = math.floor(note_32nd / 32)
 
-			draw_snap_grid_line(x, vp, theme, is_bar, is_beat, bar, ms_per_bar)
+			draw_snap_grid_line(list, x, vp, colors, is_bar, is_beat, bar, ms_per_bar)
 		end
 	end
 end
 
 function rendering.render_grid(state, theme, options, utils)
-	local vp = state.viewport
+	local colors = get_palette(theme)
+	grid_list = grid_list or boostio.newDrawList()
 
-	draw_background(vp, theme)
+	if grid_version ~= state.version then
+		local vp = state.viewport
+		grid_list:clear()
 
-	if state.fold_mode then
-		draw_folded_grid(vp, state, theme, options)
-	else
-		draw_unfolded_grid(vp, state, theme, options, utils)
-	end
+		draw_background(grid_list, vp, colors)
 
-	draw_grid_lines(vp, state, theme)
-end
+		if state.fold_mode then
+			draw_folded_grid(grid_list, vp, state, colors, options)
+		else
+			draw_unfolded_grid(grid_list, vp, state, colors, options, utils)
+		end
 
-local function draw_piano_key_background(y, piano_width, vp, theme)
-	local bg = boostio.hexToRgb(theme.background)
-	boostio.drawRectangle(0, vp.grid_y, piano_width, vp.grid_height, bg.r, bg.g, bg.b, 1.0)
-end
+		draw_grid_lines(grid_list, vp, state, colors)
+		grid_version = state.version
+	end
 
-local function draw_piano_key_rect(y, piano_width, vp, color)
-	boostio.drawRectangle(5, y + 1, piano_width - 10, vp.piano_key_height - 2, color.r, color.g, color.b, 1.0)
+	boostio.drawList(grid_list)
 end
 
-local function draw_piano_key_rect_with_alpha(y, piano_width, vp, color, alpha)
-	boostio.drawRectangle(5, y + 1, piano_width - 10, vp.piano_key_height - 2, color.r, color.g, color.b, alpha)
+local function draw_piano_key_rect(list, y, piano_width, vp, color)
+	list:rect(5, y + 1, piano_width - 10, vp.piano_key_height - 2, color)
 end
 
-local function draw_piano_key_separator(y, piano_width, theme)
-	local sep_color = boostio.hexToRgb(theme.piano_key_separator)
-	boostio.drawLine(0, y, piano_width, y, sep_color.r, sep_color.g, sep_color.b, 1.0)
+local function draw_piano_key_separator(list, y, piano_width, colors)
+	list:line(0, y, piano_width, y, colors.piano_key_separator)
 end
 
-local function draw_piano_key_text(key, y, vp, theme, utils)
+local function draw_piano_key_text(list, key, y, vp, colors, utils)
 	if vp.piano_key_height < 15.0 then
 		return
 	end
 
 	local note_name = utils.get_note_name(key)
-	local text_color_key = utils.is_black_key(key) and "piano_key_black_text" or "piano_key_white_text"
-	local text_color = boostio.hexToRgb(theme[text_color_key])
-	boostio.drawText(note_name, 10, y + vp.piano_key_height / 2.0 + 4.0, 12, text_color.r, text_color.g, text_color.b, 1.0)
+	local text_color = utils.is_black_key(key) and colors.piano_key_black_text or colors.piano_key_white_text
+	list:text(note_name, 10, y + vp.piano_key_height / 2.0 + 4.0, 12, text_color)
 end
 
-local function draw_folded_piano_key(row_y, key, piano_width, vp, state, theme, utils)
+local function draw_folded_piano_key(list, row_y, key, piano_width, vp, state, colors, utils)
 	if state.show_scale_highlights then
 		local is_root = boostio.isRootNote(key, state.selected_root)
-		local color_key = is_root and "scale_root_piano" or "scale_note_piano"
-		local color = boostio.hexToRgb(theme[color_key])
-		draw_piano_key_rect(row_y, piano_width, vp, color)
+		local color = is_root and colors.scale_root_piano or colors.scale_note_piano
+		draw_piano_key_rect(list, row_y, piano_width, vp, color)
 	else
-		local color = boostio.hexToRgb(theme.piano_key_white)
-		draw_piano_key_rect(row_y, piano_width, vp, color)
+		draw_piano_key_rect(list, row_y, piano_width, vp, colors.piano_key_white)
 	end
 
-	draw_piano_key_separator(row_y, piano_width, theme)
-	draw_piano_key_text(key, row_y, vp, theme, utils)
+	draw_piano_key_separator(list, row_y, piano_width, colors)
+	draw_piano_key_text(list, key, row_y, vp, colors, utils)
 end
 
-local function draw_folded_piano_keys(vp, state, theme, options, utils)
+local function draw_folded_piano_keys(list, vp, state, colors, options, utils)
 	if not boostio or not boostio.isNoteInScale then
 		return
 	end
@@ -252,7 +292,7 @@ local function draw_folded_piano_keys(vp, state, theme, options, utils)
 					break
 				end
 
-				draw_folded_piano_key(row_y, key, piano_width, vp, state, theme, utils)
+				draw_folded_piano_key(list, row_y, key, piano_width, vp, state, colors, utils)
 				row_y = row_y + vp.piano_key_height
 			end
 			current_row = current_row + 1
@@ -260,14 +300,13 @@ local function draw_folded_piano_keys(vp, state, theme, options, utils)
 	end
 end
 
-local function draw_scale_overlay(y, piano_width, vp, key, state, theme)
+local function draw_scale_overlay(list, y, piano_width, vp, key, state, colors)
 	if not state.show_scale_highlights then
 		return
 	end
 
 	if boostio.isRootNote(key, state.selected_root) then
-		local color = boostio.hexToRgb(theme.scale_root_piano)
-		draw_piano_key_rect_with_alpha(y, piano_width, vp, color, 0.7)
+		draw_piano_key_rect(list, y, piano_width, vp, colors.scale_root_piano_overlay)
 		return
 	end
 
@@ -277,47 +316,49 @@ local function draw_scale_overlay(y, piano_width, vp, key, state, theme)
 
 	local success, in_scale = pcall(boostio.isNoteInScale, key, state.selected_scale, state.selected_root)
 	if success and in_scale then
-		local color = boostio.hexToRgb(theme.scale_note_piano)
-		draw_piano_key_rect_with_alpha(y, piano_width, vp, color, 0.55)
+		draw_piano_key_rect(list, y, piano_width, vp, colors.scale_note_piano_overlay)
 	end
 end
 
-local function draw_unfolded_piano_key(y, key, piano_width, vp, state, theme, utils)
+local function draw_unfolded_piano_key(list, y, key, piano_width, vp, state, colors, utils)
 	local is_black = utils.is_black_key(key)
-	local color_key = is_black and "piano_key_black" or "piano_key_white"
-	local color = boostio.hexToRgb(theme[color_key])
-	draw_piano_key_rect(y, piano_width, vp, color)
+	local color = is_black and colors.piano_key_black or colors.piano_key_white
+	draw_piano_key_rect(list, y, piano_width, vp, color)
 
-	draw_scale_overlay(y, piano_width, vp, key, state, theme)
-	draw_piano_key_separator(y, piano_width, theme)
+	draw_scale_overlay(list, y, piano_width, vp, key, state, colors)
+	draw_piano_key_separator(list, y, piano_width, colors)
 
 	if not is_black then
-		draw_piano_key_text(key, y, vp, theme, utils)
+		draw_piano_key_text(list, key, y, vp, colors, utils)
 	end
 end
 
-local function draw_unfolded_piano_keys(vp, state, theme, options, utils)
+local function draw_unfolded_piano_keys(list, vp, state, colors, options, utils)
 	local piano_width = vp.grid_x
 	local start_key, end_key = get_visible_key_range(vp, options)
 
 	for key = start_key, end_key do
 		local y = boostio.pianoKeyToY(key)
-		draw_unfolded_piano_key(y, key, piano_width, vp, state, theme, utils)
+		draw_unfolded_piano_key(list, y, key, piano_width, vp, state, colors, utils)
 	end
 end
 
 function rendering.render_piano_keys(state, theme, options, utils)
+	local colors = get_palette(theme)
 	local vp = state.viewport
 	local piano_width = vp.grid_x
 
-	draw_piano_key_background(vp.grid_y, piano_width, vp, theme)
+	key_list = key_list or boostio.newDrawList()
+	key_list:clear()
+	key_list:rect(0, vp.grid_y, piano_width, vp.grid_height, colors.background)
 
 	if state.fold_mode then
-		draw_folded_piano_keys(vp, state, theme, options, utils)
-		return
+		draw_folded_piano_keys(key_list, vp, state, colors, options, utils)
+	else
+		draw_unfolded_piano_keys(key_list, vp, state, colors, options, utils)
 	end
 
-	draw_unfolded_piano_keys(vp, state, theme, options, utils)
+	boostio.drawList(key_list)
 end
 
 local function check_if_has_solo(state)
@@ -336,24 +377,16 @@ local function is_note_audible(voice, state, has_solo)
 	return not state.voice_muted[voice + 1]
 end
 
-local function calculate_note_color(voice_color, is_audible, is_selected)
-	local note_color = { r = voice_color.r, g = voice_color.g, b = voice_color.b, a = 1.0 }
-
+local function calculate_note_color(voice_colors, is_audible, is_selected)
 	if not is_audible then
-		note_color.r = note_color.r * 0.3
-		note_color.g = note_color.g * 0.3
-		note_color.b = note_color.b * 0.3
-		note_color.a = 0.5
-		return note_color
+		return voice_colors.inaudible
 	end
 
 	if is_selected then
-		note_color.r = math.min(1.0, note_color.r * 1.3)
-		note_color.g = math.min(1.0, note_color.g * 1.3)
-		note_color.b = math.min(1.0, note_color.b * 1.3)
+		return voice_colors.selected
 	end
 
-	return note_color
+	return voice_colors.normal
 end
 
 local function is_note_visible(rect, vp)
@@ -366,19 +399,23 @@ local function is_note_visible(rect, vp)
 	return true
 end
 
-local function draw_note(rect, note_color, is_selected)
-	boostio.drawRoundedRectangle(rect.x, rect.y, rect.width, rect.height, 3, note_color.r, note_color.g, note_color.b, note_color.a)
+local function draw_note(list, rect, note_color, is_selected, outline_color)
+	list:roundedRect(rect.x, rect.y, rect.width, rect.height, 3, note_color)
 
 	if is_selected then
-		boostio.strokeRoundedRectangle(rect.x, rect.y, rect.width, rect.height, 3, 1.0, 1.0, 1.0, 1.0)
+		list:strokeRoundedRect(rect.x, rect.y, rect.width, rect.height, 3, outline_color)
 	end
 end
 
 function rendering.render_notes(state, theme, options, utils)
+	local colors = get_palette(theme)
 	local vp = state.viewport
 	local has_solo = check_if_has_solo(state)
 
-	for _, note in ipairs(state.notes) do
+	note_list = note_list or boostio.newDrawList()
+	note_list:clear()
+
+	for _, note in ipairs(utils.get_visible_notes(state, options)) do
 		local voice = note.voice % 8
 
 		if not state.voice_hidden[voice + 1] then
@@ -386,14 +423,15 @@ function rendering.render_notes(state, theme, options, utils)
 			local rect = utils.get_note_rect(vp, note, state.fold_mode, state.selected_scale, state.selected_root, options)
 
 			if is_note_visible(rect, vp) then
-				local voice_color = boostio.hexToRgb(theme.voice_colors[voice + 1])
 				local is_selected = boostio.isNoteSelected(note.id)
-				local note_color = calculate_note_color(voice_color, is_audible, is_selected)
+				local note_color = calculate_note_color(colors.voices[voice + 1], is_audible, is_selected)
 
-				draw_note(rect, note_color, is_selected)
+				draw_note(note_list, rect, note_color, is_selected, colors.selection_outline)
 			end
 		end
 	end
+
+	boostio.drawList(note_list)
 end
 
 function rendering.render_selection_box(mouse_state)
@@ -73,6 +73,41 @@ function utils.get_note_rect(vp, note, fold_mode, scale, root, options)
 	return { x = x, y = y, width = width, height = height }
 end
 
+function utils.get_notes_in_rect(state, options, min_x, min_y, max_x, max_y)
+	local vp = state.viewport
+	local start_ms = math.max(0, math.floor(vp.time_offset + (min_x - vp.grid_x) / vp.pixels_per_ms))
+	local end_ms = math.floor(vp.time_offset + (max_x - vp.grid_x) / vp.pixels_per_ms) + 1
+
+	local min_key = 0
+	local max_key = 127
+	if not state.fold_mode then
+		local top_row = vp.note_offset + math.floor((min_y - vp.grid_y) / vp.piano_key_height)
+		local bottom_row = vp.note_offset + math.floor((max_y - vp.grid_y) / vp.piano_key_height)
+		min_key = options.piano_key_max - bottom_row - 1
+		max_key = options.piano_key_max - top_row + 1
+	end
+
+	local previews = state.preview_notes
+	local notes = {}
+	for _, note in boostio.notesInRange(start_ms, end_ms, min_key, max_key) do
+		if not previews or not previews[note.id] then
+			notes[#notes + 1] = note
+		end
+	end
+	if previews then
+		for _, note in pairs(previews) do
+			notes[#notes + 1] = note
+		end
+	end
+	return notes
+end
+
+function utils.get_visible_notes(state, options)
+	local vp = state.viewport
+	return utils.get_notes_in_rect(state, options, vp.grid_x, vp.grid_y, vp.grid_x + vp.grid_width,
+		vp.grid_y + vp.grid_height)
+end
+
 function utils.point_in_rect(px, py, rect)
 	return px >= rect.x and px <= rect.x + rect.width and py >= rect.y and py <= rect.y + rect.height
 end
@@ -0,0 +1,106 @@
+local plugin_profiler = {}
+
+local profiler_config = {
+	visible = false,
+	toggle_key = "f3",
+	max_rows = 6,
+	refresh_frames = 15,
+	font_size = 12,
+	row_height = 16,
+	width = 360,
+	margin = 20,
+}
+
+local rows = {}
+local gc_stats = nil
+local allocs_per_frame = 0
+local frames_until_refresh = 0
+
+local function refresh_rows()
+	local previous = gc_stats
+	gc_stats = boostio.getGcStats()
+	if previous then
+		allocs_per_frame = (gc_stats.allocations - previous.allocations) / profiler_config.refresh_frames
+	end
+	rows = boostio.getPluginStats()
+	table.sort(rows, function(a, b)
+		return a.avgMs > b.avgMs
+	end)
+end
+
+function plugin_profiler.init(options)
+	if options then
+		for key, value in pairs(options) do
+			profiler_config[key] = value
+		end
+	end
+end
+
+function plugin_profiler.on_key_down(key, shift, ctrl, alt)
+	if key ~= profiler_config.toggle_key or shift or ctrl or alt then
+		return false
+	end
+
+	profiler_config.visible = not profiler_config.visible
+	frames_until_refresh = 0
+	gc_stats = nil
+	allocs_per_frame = 0
+	return true
+end
+
+function plugin_profiler.render()
+	if not profiler_config.visible then
+		return
+	end
+
+	if frames_until_refresh <= 0 then
+		refresh_rows()
+		frames_until_refresh = profiler_config.refresh_frames
+	end
+	frames_until_refresh = frames_until_refresh - 1
+
+	local row_count = math.min(#rows, profiler_config.max_rows)
+	local row_height = profiler_config.row_height
+	local font_size = profiler_config.font_size
+	local width = profiler_config.width
+	local height = (row_count + 3) * row_height + 10
+	local window_width = boostio.getWindowSize()
+	local x = window_width - width - profiler_config.margin
+	local y = profiler_config.margin + 30
+
+	boostio.drawRoundedRectangle(x, y, width, height, 6, 0.08, 0.08, 0.1, 0.85)
+
+	local text_y = y + row_height
+	boostio.drawText("plugin", x + 10, text_y, font_size, 0.6, 0.6, 0.65, 1.0)
+	boostio.drawText("avg/max ms   alloc/gc KiB", x + 150, text_y, font_size, 0.6, 0.6, 0.65, 1.0)
+
+	for i = 1, row_count do
+		local row = rows[i]
+		text_y = text_y + row_height
+
+		local heat = math.min(row.maxMs / 4.0, 1.0)
+		local stats = string.format("%5.2f/%5.2f   %6.1f/%6.1f", row.avgMs, row.maxMs, row.allocKb, row.gcKb)
+		boostio.drawText(row.name, x + 10, text_y, font_size, 0.9, 0.9 - heat * 0.5, 0.9 - heat * 0.6, 1.0)
+		boostio.drawText(stats, x + 150, text_y, font_size, 0.9, 0.9, 0.9, 1.0)
+	end
+
+	if gc_stats then
+		local gc_text = string.format(
+			"gc %s  heap %.0f KiB  idle pause %.2f/%.2f ms",
+			gc_stats.mode,
+			gc_stats.heapKb,
+			gc_stats.lastPauseMs,
+			gc_stats.maxPauseMs
+		)
+		local pool_text = string.format(
+			"peak %.0f KiB  pool %.0f KiB  %.0f allocs/frame",
+			gc_stats.peakKb,
+			gc_stats.poolKb,
+			allocs_per_frame
+		)
+		boostio.drawText(gc_text, x + 10, text_y + row_height, font_size, 0.6, 0.6, 0.65, 1.0)
+		boostio.drawText(pool_text, x + 10, text_y + row_height * 2, font_size, 0.6, 0.6, 0.65, 1.0)
+	end
+end
+
+return plugin_profiler
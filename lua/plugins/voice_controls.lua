@@ -50,10 +50,6 @@ local function toggle_all_other_voices(clicked_voice)
 		end
 	end
 
-	if voice_validation then
-		voice_validation.invalidate()
-	end
-
 	if toast then
 		if hide_others then
 			toast.info("Hidden all other voices")
@@ -108,9 +104,6 @@ local function toggle_single_voice(voice, row, row_type, voice_state)
 
 	if row == 0 then
 		boostio.setVoiceHidden(voice, new_value)
-		if voice_validation then
-			voice_validation.invalidate()
-		end
 	elseif row == 1 then
 		boostio.setVoiceSolo(voice, new_value)
 	elseif row == 2 then
@@ -193,10 +186,6 @@ function voice_controls.on_key_down(key, shift, ctrl, alt)
 				pcall(boostio.setNoteVoice, note_id, voice)
 			end
 
-			if voice_validation then
-				voice_validation.invalidate()
-			end
-
 			if toast and toast.info then
 				pcall(toast.info, "Set " .. #selection .. " note(s) to voice " .. (voice + 1))
 			end
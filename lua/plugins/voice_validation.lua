@@ -6,78 +6,13 @@ local validation_errors = {}
 local hover_error = nil
 local needs_validation = true
 
-local function is_voice_visible(voice)
-	if voice_controls and voice_controls.isVoiceVisible then
-		return voice_controls.isVoiceVisible(voice)
-	end
-	return true
-end
-
-local function detect_voice_overlaps(notes)
-	if #notes == 0 then
-		return {}
-	end
-
+local function detect_voice_overlaps()
 	local errors = {}
+	local voice_hidden = boostio.getAppState().voice_hidden
 
-	local notes_by_voice = {}
-	for i = 1, 8 do
-		notes_by_voice[i] = {}
-	end
-
-	for _, note in ipairs(notes) do
-		local voice = note.voice % 8
-		if is_voice_visible(voice) then
-			table.insert(notes_by_voice[voice + 1], note)
-		end
-	end
-
-	for voice = 1, 8 do
-		local voice_notes = notes_by_voice[voice]
-		local voice_note_count = #voice_notes
-
-		if voice_note_count > 1 then
-			table.sort(voice_notes, function(a, b)
-				return a.ms < b.ms
-			end)
-
-			local processed = {}
-			for i = 1, voice_note_count do
-				if not processed[i] then
-					local note = voice_notes[i]
-					local note_end = note.ms + note.duration_ms
-					local conflict_notes = { note.id }
-					local conflict_indices = { i }
-					local conflict_end = note_end
-
-					for j = i + 1, voice_note_count do
-						local check_note = voice_notes[j]
-						local check_end = check_note.ms + check_note.duration_ms
-
-						if check_note.ms < conflict_end then
-							table.insert(conflict_notes, check_note.id)
-							table.insert(conflict_indices, j)
-							conflict_end = math.max(conflict_end, check_end)
-						else
-							break
-						end
-					end
-
-					if #conflict_notes > 1 then
-						for _, idx in ipairs(conflict_indices) do
-							processed[idx] = true
-						end
-
-						local error_data = {
-							voice = voice - 1,
-							start_ms = note.ms,
-							end_ms = conflict_end,
-							note_ids = conflict_notes,
-						}
-						table.insert(errors, error_data)
-					end
-				end
-			end
+	for _, conflict in ipairs(boostio.getVoiceConflicts()) do
+		if not voice_hidden[conflict.voice + 1] then
+			table.insert(errors, conflict)
 		end
 	end
 
@@ -218,13 +153,17 @@ function voice_validation.invalidate()
 	needs_validation = true
 end
 
+function voice_validation.init()
+	boostio.subscribe("notes_changed", voice_validation.invalidate)
+	boostio.subscribe("voices_changed", voice_validation.invalidate)
+end
+
 function voice_validation.update()
 	if not needs_validation then
 		return
 	end
 
-	local state = boostio.getAppState()
-	validation_errors = detect_voice_overlaps(state.notes)
+	validation_errors = detect_voice_overlaps()
 	needs_validation = false
 end
 
@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 bool app_controller_init(
 	struct app_controller *controller,
@@ -26,6 +27,7 @@ bool app_controller_init(
 	controller->running = true;
 
 	app_state_init(&controller->state);
+	memset(&controller->journal, 0, sizeof(controller->journal));
 
 	struct window *window = graphics_get_window(graphics);
 	controller->input_handler = input_handler_create(window);
@@ -44,7 +46,25 @@ void app_controller_deinit(struct app_controller *controller)
 	}
 
 	lua_service_deinit(&controller->lua_service);
+	edit_journal_close(&controller->journal);
+	controller->state.history.journal = NULL;
 	input_handler_destroy(controller->input_handler);
+	app_state_deinit(&controller->state);
+}
+
+bool app_controller_open_journal(struct app_controller *controller, const char *song_path)
+{
+	if (controller == NULL || song_path == NULL) {
+		return false;
+	}
+
+	if (!edit_journal_open(&controller->journal, &controller->state, controller->audio, song_path)) {
+		fprintf(stderr, "Warning: Edits to %s will not be journaled\n", song_path);
+		return false;
+	}
+
+	controller->state.history.journal = &controller->journal;
+	return true;
 }
 
 bool app_controller_init_lua(struct app_controller *controller, const char *config_path)
@@ -113,6 +133,8 @@ void app_controller_update(struct app_controller *controller, float delta_time)
 		controller->running = false;
 	}
 
+	edit_journal_update(&controller->journal);
+
 	struct window *window = graphics_get_window(controller->graphics);
 	int current_width, current_height;
 	window_get_size(window, &current_width, &current_height);
@@ -202,6 +224,15 @@ void app_controller_render(struct app_controller *controller)
 	lua_service_call_render_callbacks(&controller->lua_service);
 }
 
+void app_controller_idle(struct app_controller *controller, double idle_time)
+{
+	if (controller == NULL) {
+		return;
+	}
+
+	lua_service_collect_garbage(&controller->lua_service, idle_time * 1000.0);
+}
+
 bool app_controller_is_running(const struct app_controller *controller)
 {
 	if (controller == NULL) {
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 
 #include "app_state.h"
+#include "edit_journal.h"
 #include "lua_service.h"
 
 struct graphics;
@@ -13,6 +14,7 @@ struct input_handler;
 
 struct app_controller {
 	struct app_state state;
+	struct edit_journal journal;
 	struct lua_service lua_service;
 	struct graphics *graphics;
 	struct audio *audio;
@@ -32,10 +34,14 @@ void app_controller_deinit(struct app_controller *controller);
 
 bool app_controller_init_lua(struct app_controller *controller, const char *config_path);
 
+bool app_controller_open_journal(struct app_controller *controller, const char *song_path);
+
 void app_controller_update(struct app_controller *controller, float delta_time);
 
 void app_controller_render(struct app_controller *controller);
 
+void app_controller_idle(struct app_controller *controller, double idle_time);
+
 bool app_controller_is_running(const struct app_controller *controller);
 
 void app_controller_stop(struct app_controller *controller);
@@ -1,6 +1,9 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "app_state.h"
+#include "audio.h"
 #include "sequencer.h"
 
 void app_state_init(struct app_state *state)
@@ -12,6 +15,8 @@ void app_state_init(struct app_state *state)
 	memset(state, 0, sizeof(struct app_state));
 
 	command_history_init(&state->history);
+	note_store_init(&state->notes);
+	id_map_init(&state->selection.index);
 
 	state->window_width = 800;
 	state->window_height = 600;
@@ -35,8 +40,6 @@ void app_state_init(struct app_state *state)
 	state->viewport.grid_width = 680.0f;
 	state->viewport.grid_height = 480.0f;
 
-	state->note_count = 0;
-	state->selection.count = 0;
 	state->next_note_id = 1;
 
 	state->instrument_count = 6;
@@ -115,6 +118,19 @@ void app_state_init(struct app_state *state)
 	state->instruments[5].nes_noise_lfsr = 1;
 }
 
+void app_state_deinit(struct app_state *state)
+{
+	if (state == NULL) {
+		return;
+	}
+
+	command_history_free(&state->history);
+	note_store_free(&state->notes);
+	free(state->selection.selected_ids);
+	id_map_free(&state->selection.index);
+	memset(&state->selection, 0, sizeof(state->selection));
+}
+
 void app_state_update_dimensions(struct app_state *state, int width, int height)
 {
 	if (state == NULL) {
@@ -275,85 +291,172 @@ void app_state_zoom_vertical_at_mouse(struct app_state *state, float factor, flo
 	}
 }
 
-void app_state_sync_notes_from_sequencer(struct app_state *state, const struct sequencer *sequencer)
+void app_state_clear_notes(struct app_state *state)
 {
-	if (state == NULL || sequencer == NULL) {
+	if (state == NULL) {
 		return;
 	}
 
-	state->note_count = 0;
+	note_store_clear(&state->notes);
+	app_state_clear_selection(state);
+	state->next_note_id = 1;
+	command_history_clear(&state->history);
+}
+
+bool app_state_select_note(struct app_state *state, uint32_t note_id)
+{
+	struct selection *selection = &state->selection;
+
+	if (id_map_get(&selection->index, note_id, NULL)) {
+		return false;
+	}
+
+	if (selection->count == selection->capacity) {
+		uint32_t capacity = selection->capacity > 0 ? selection->capacity * 2 : 64;
+		uint32_t *ids = realloc(selection->selected_ids, sizeof(uint32_t) * capacity);
+		if (ids == NULL) {
+			fprintf(stderr, "Failed to grow selection to %u notes\n", capacity);
+			return false;
+		}
+		selection->selected_ids = ids;
+		selection->capacity = capacity;
+	}
 
-	uint32_t count = sequencer->note_count;
-	if (count > UI_MAX_NOTES) {
-		count = UI_MAX_NOTES;
+	if (!id_map_put(&selection->index, note_id, selection->count)) {
+		return false;
 	}
 
-	for (uint32_t i = 0; i < count; i++) {
-		const struct note *seq_note = &sequencer->notes[i];
-		struct ui_note *ui_note = &state->notes[i];
+	selection->selected_ids[selection->count++] = note_id;
+	selection->version++;
+	return true;
+}
+
+bool app_state_deselect_note(struct app_state *state, uint32_t note_id)
+{
+	struct selection *selection = &state->selection;
 
-		ui_note->id = state->next_note_id++;
-		ui_note->ms = seq_note->time_ms;
-		ui_note->duration_ms = (uint16_t)seq_note->params.duration_ms;
-		ui_note->voice = seq_note->params.voice_index >= 0
-					 ? (uint8_t)seq_note->params.voice_index
-					 : 0;
-		ui_note->piano_key = seq_note->params.piano_key;
-		ui_note->frequency = seq_note->params.frequency;
-		ui_note->waveform = seq_note->params.waveform;
-		ui_note->duty_cycle = seq_note->params.duty_cycle;
-		ui_note->decay = seq_note->params.decay;
-		ui_note->amplitude_dbfs = seq_note->params.amplitude_dbfs;
-		ui_note->nes_noise_period = seq_note->params.nes_noise_period;
-		ui_note->nes_noise_mode_flag = seq_note->params.nes_noise_mode_flag;
-		ui_note->nes_noise_lfsr_init = seq_note->params.nes_noise_lfsr_init;
-		ui_note->restart_phase = seq_note->params.restart_phase;
+	uint32_t position;
+	if (!id_map_get(&selection->index, note_id, &position)) {
+		return false;
 	}
 
-	state->note_count = count;
+	id_map_remove(&selection->index, note_id);
+
+	uint32_t last = selection->count - 1;
+	if (position != last) {
+		selection->selected_ids[position] = selection->selected_ids[last];
+		id_map_put(&selection->index, selection->selected_ids[position], position);
+	}
+
+	selection->count--;
+	selection->version++;
+	return true;
+}
+
+bool app_state_is_note_selected(const struct app_state *state, uint32_t note_id)
+{
+	return id_map_get(&state->selection.index, note_id, NULL);
+}
+
+void app_state_clear_selection(struct app_state *state)
+{
+	if (state->selection.count > 0) {
+		state->selection.version++;
+	}
+	state->selection.count = 0;
+	id_map_clear(&state->selection.index);
+}
+
+void app_state_note_to_params(const struct ui_note *note, struct note_params *params)
+{
+	if (note == NULL || params == NULL) {
+		return;
+	}
+
+	*params = (struct note_params){
+		.frequency = note->frequency,
+		.duration_ms = (float)note->duration_ms,
+		.waveform = note->waveform,
+		.duty_cycle = note->duty_cycle,
+		.decay = note->decay,
+		.amplitude_dbfs = note->amplitude_dbfs,
+		.nes_noise_period = note->nes_noise_period,
+		.nes_noise_mode_flag = note->nes_noise_mode_flag,
+		.nes_noise_lfsr_init = note->nes_noise_lfsr_init,
+		.restart_phase = note->restart_phase,
+		.voice_index = note->voice,
+		.piano_key = note->piano_key
+	};
+}
+
+static void rebuild_sequencer(const struct app_state *state, struct sequencer *sequencer)
+{
+	sequencer_clear_notes(sequencer);
+	sequencer_reserve(sequencer, note_store_count(&state->notes));
+
+	for (uint32_t i = 0; i < note_store_count(&state->notes); i++) {
+		const struct ui_note *ui_note = note_store_at(&state->notes, i);
+
+		struct note_params params;
+		app_state_note_to_params(ui_note, &params);
+		sequencer_add_note(sequencer, ui_note->id, ui_note->ms, params);
+	}
+
+	sequencer_sort_notes(sequencer);
 }
 
 void app_state_sync_notes_to_sequencer(
-	const struct app_state *state, struct sequencer *sequencer, struct audio *audio
+	struct app_state *state, struct sequencer *sequencer, struct audio *audio
 )
 {
-	if (state == NULL || sequencer == NULL || audio == NULL) {
+	if (state == NULL || sequencer == NULL) {
 		return;
 	}
 
-	uint32_t playhead_ms = 0;
-	if (sequencer->sample_rate > 0) {
-		playhead_ms = (uint32_t)((sequencer->playhead_samples * 1000) / sequencer->sample_rate);
+	const struct note_change_set *set = &state->notes.changes;
+	if (!set->reset && set->count == 0) {
+		return;
 	}
 
-	sequencer_clear_notes(sequencer);
+	struct sequencer_key *removed = NULL;
+	struct note *added = NULL;
+	uint32_t removed_count = 0;
+	uint32_t added_count = 0;
+	bool rebuild = set->reset;
+
+	if (!rebuild) {
+		removed = malloc(sizeof(struct sequencer_key) * set->count);
+		added = malloc(sizeof(struct note) * set->count);
+		rebuild = removed == NULL || added == NULL;
+	}
 
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		const struct ui_note *ui_note = &state->notes[i];
-
-		struct note_params params = {
-			.frequency = ui_note->frequency,
-			.duration_ms = (float)ui_note->duration_ms,
-			.waveform = ui_note->waveform,
-			.duty_cycle = ui_note->duty_cycle,
-			.decay = ui_note->decay,
-			.amplitude_dbfs = ui_note->amplitude_dbfs,
-			.nes_noise_period = ui_note->nes_noise_period,
-			.nes_noise_mode_flag = ui_note->nes_noise_mode_flag,
-			.nes_noise_lfsr_init = ui_note->nes_noise_lfsr_init,
-			.restart_phase = ui_note->restart_phase,
-			.voice_index = ui_note->voice,
-			.piano_key = ui_note->piano_key
-		};
-
-		sequencer_add_note(sequencer, ui_note->ms, params);
-	}
-
-	for (uint32_t i = 0; i < sequencer->note_count; i++) {
-		if (sequencer->notes[i].time_ms < playhead_ms) {
-			sequencer->notes[i].triggered = true;
-		} else {
-			sequencer->notes[i].triggered = false;
+	for (uint32_t i = 0; !rebuild && i < set->count; i++) {
+		const struct note_change *change = &set->changes[i];
+		if (change->existed) {
+			removed[removed_count].id = change->id;
+			removed[removed_count].time_ms = change->old_ms;
+			removed_count++;
+		}
+
+		const struct ui_note *ui_note = note_store_find(&state->notes, change->id);
+		if (ui_note != NULL) {
+			struct note *note = &added[added_count++];
+			note->id = ui_note->id;
+			note->time_ms = ui_note->ms;
+			app_state_note_to_params(ui_note, &note->params);
 		}
 	}
+
+	audio_lock(audio);
+
+	if (rebuild ||
+	    !sequencer_apply_changes(sequencer, removed, removed_count, added, added_count)) {
+		rebuild_sequencer(state, sequencer);
+	}
+
+	audio_unlock(audio);
+
+	free(removed);
+	free(added);
+	note_store_clear_changes(&state->notes);
 }
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "command_history.h"
+#include "note_store.h"
 #include "scale.h"
 #include "synth.h"
 #include "theme.h"
@@ -12,8 +13,6 @@
 struct sequencer;
 struct audio;
 
-#define UI_MAX_NOTES 1024
-#define UI_MAX_SELECTION 256
 #define MAX_INSTRUMENTS 16
 
 struct instrument {
@@ -41,26 +40,12 @@ struct viewport {
 	float grid_height;
 };
 
-struct ui_note {
-	uint32_t id;
-	uint32_t ms;
-	uint16_t duration_ms;
-	uint8_t voice;
-	uint8_t piano_key;
-	float frequency;
-	enum waveform_type waveform;
-	uint8_t duty_cycle;
-	int16_t decay;
-	int8_t amplitude_dbfs;
-	uint8_t nes_noise_period;
-	bool nes_noise_mode_flag;
-	uint16_t nes_noise_lfsr_init;
-	bool restart_phase;
-};
-
 struct selection {
-	uint32_t selected_ids[UI_MAX_SELECTION];
+	uint32_t *selected_ids;
 	uint32_t count;
+	uint32_t capacity;
+	uint32_t version;
+	struct id_map index;
 };
 
 struct app_state {
@@ -97,18 +82,20 @@ struct app_state {
 	struct theme theme;
 
 	struct viewport viewport;
-	struct ui_note notes[UI_MAX_NOTES];
-	uint32_t note_count;
+	struct note_store notes;
 	struct selection selection;
 	uint32_t next_note_id;
 
 	struct command_history history;
 
 	char current_file_path[512];
+	uint32_t load_count;
 };
 
 void app_state_init(struct app_state *state);
 
+void app_state_deinit(struct app_state *state);
+
 void app_state_update_dimensions(struct app_state *state, int width, int height);
 
 void app_state_update_mouse(struct app_state *state, float x, float y);
@@ -127,12 +114,20 @@ void app_state_zoom_horizontal_at_mouse(struct app_state *state, float factor, f
 
 void app_state_zoom_vertical_at_mouse(struct app_state *state, float factor, float mouse_y);
 
-void app_state_sync_notes_from_sequencer(
-	struct app_state *state, const struct sequencer *sequencer
-);
+void app_state_clear_notes(struct app_state *state);
+
+bool app_state_select_note(struct app_state *state, uint32_t note_id);
+
+bool app_state_deselect_note(struct app_state *state, uint32_t note_id);
+
+bool app_state_is_note_selected(const struct app_state *state, uint32_t note_id);
+
+void app_state_clear_selection(struct app_state *state);
+
+void app_state_note_to_params(const struct ui_note *note, struct note_params *params);
 
 void app_state_sync_notes_to_sequencer(
-	const struct app_state *state, struct sequencer *sequencer, struct audio *audio
+	struct app_state *state, struct sequencer *sequencer, struct audio *audio
 );
 
 #endif
@@ -4,12 +4,152 @@
 #include "graphics.h"
 #include "input_types.h"
 #include "platform.h"
+#include "song_library.h"
 
+#include <SDL3/SDL.h>
 #include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define PLUGIN_MAX_SKIP_FRAMES 30
+
+static int ref_plugin_function(lua_State *L, int table_index, const char *field)
+{
+	lua_getfield(L, table_index, field);
+	if (lua_type(L, -1) != LUA_TFUNCTION) {
+		lua_pop(L, 1);
+		return LUA_NOREF;
+	}
+	return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+static void
+resolve_plugin(lua_State *L, struct lua_plugin *plugin, int entry_index, const char *name)
+{
+	lua_getfield(L, entry_index, "priority");
+	plugin->priority = (int)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	lua_getfield(L, entry_index, "budget_ms");
+	plugin->budget_ms = lua_tonumber(L, -1);
+	lua_pop(L, 1);
+
+	lua_getfield(L, entry_index, "options");
+	if (lua_type(L, -1) == LUA_TTABLE) {
+		plugin->options_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	} else {
+		lua_pop(L, 1);
+	}
+
+	lua_getglobal(L, name);
+	if (lua_type(L, -1) == LUA_TTABLE) {
+		int table_index = lua_gettop(L);
+		plugin->init_ref = ref_plugin_function(L, table_index, "init");
+		plugin->update_ref = ref_plugin_function(L, table_index, "update");
+		plugin->render_ref = ref_plugin_function(L, table_index, "render");
+		plugin->key_down_ref = ref_plugin_function(L, table_index, "on_key_down");
+	}
+	lua_pop(L, 1);
+}
+
+static void release_plugin(lua_State *L, struct lua_plugin *plugin)
+{
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->init_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->options_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->update_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->render_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->key_down_ref);
+	free(plugin->name);
+}
+
+static int compare_plugins(const void *a, const void *b)
+{
+	const struct lua_plugin *plugin_a = a;
+	const struct lua_plugin *plugin_b = b;
+
+	if (plugin_a->priority != plugin_b->priority) {
+		return plugin_a->priority < plugin_b->priority ? -1 : 1;
+	}
+	return plugin_a->order - plugin_b->order;
+}
+
+static void init_plugin(lua_State *L, struct lua_plugin *plugin)
+{
+	if (plugin->init_ref != LUA_NOREF) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, plugin->init_ref);
+		if (plugin->options_ref != LUA_NOREF) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, plugin->options_ref);
+		} else {
+			lua_pushnil(L);
+		}
+
+		if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+			fprintf(stderr,
+				"Failed to initialize plugin %s: %s\n",
+				plugin->name,
+				lua_tostring(L, -1));
+			lua_pop(L, 1);
+		}
+	}
+
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->init_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, plugin->options_ref);
+	plugin->init_ref = LUA_NOREF;
+	plugin->options_ref = LUA_NOREF;
+}
+
+static void call_plugin(struct lua_service *service, int index, int ref, const char *phase)
+{
+	if (ref == LUA_NOREF) {
+		return;
+	}
+
+	lua_State *L = service->runtime.L;
+	struct lua_plugin *plugin = &service->plugins[index];
+	struct lua_profiler_sample mark;
+	lua_profiler_begin(&service->runtime, &mark);
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+	if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+		fprintf(stderr,
+			"Lua %s error in %s: %s\n",
+			phase,
+			plugin->name,
+			lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+	plugin->frame_ticks += lua_profiler_end(&service->profiler, index, &service->runtime, &mark);
+}
+
+static void charge_plugin_frame(struct lua_plugin *plugin)
+{
+	uint64_t frequency = SDL_GetPerformanceFrequency();
+	plugin->last_frame_ms = (double)plugin->frame_ticks * 1000.0 / (double)frequency;
+	plugin->frame_ticks = 0;
+
+	if (plugin->budget_ms <= 0.0 || plugin->last_frame_ms <= plugin->budget_ms) {
+		return;
+	}
+
+	uint32_t skip = (uint32_t)(plugin->last_frame_ms / plugin->budget_ms);
+	plugin->skip_frames = skip < PLUGIN_MAX_SKIP_FRAMES ? skip : PLUGIN_MAX_SKIP_FRAMES;
+	plugin->overrun_count++;
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	if (plugin->last_warning == 0 || now - plugin->last_warning >= frequency) {
+		fprintf(stderr,
+			"Plugin %s took %.2f ms (budget %.2f ms), skipping %u updates "
+			"(%u overruns)\n",
+			plugin->name,
+			plugin->last_frame_ms,
+			plugin->budget_ms,
+			plugin->skip_frames,
+			plugin->overrun_count);
+		plugin->last_warning = now;
+	}
+}
+
 bool lua_service_init(
 	struct lua_service *service,
 	struct app_state *state,
@@ -23,9 +163,10 @@ bool lua_service_init(
 	}
 
 	service->initialized = false;
-	service->loaded_plugins = NULL;
+	service->plugins = NULL;
 	service->plugin_count = 0;
 	service->paths = paths;
+	lua_profiler_init(&service->profiler, 0);
 
 	if (!lua_runtime_init(&service->runtime)) {
 		fprintf(stderr, "Failed to initialize Lua runtime\n");
@@ -42,6 +183,10 @@ bool lua_service_init(
 	service->api_context.audio = audio;
 	service->api_context.command_registry = &service->command_registry;
 	service->api_context.app_state = state;
+	service->api_context.plugin_profiler = &service->profiler;
+	service->api_context.runtime = &service->runtime;
+	service->api_context.song_library =
+		paths != NULL ? song_library_create(paths->data_dir) : NULL;
 
 	lua_api_register_all(&service->runtime, &service->api_context);
 
@@ -55,13 +200,18 @@ void lua_service_deinit(struct lua_service *service)
 		return;
 	}
 
-	if (service->loaded_plugins != NULL) {
-		for (int i = 0; i < service->plugin_count; i++) {
-			free(service->loaded_plugins[i]);
-		}
-		free(service->loaded_plugins);
-		service->loaded_plugins = NULL;
+	for (int i = 0; i < service->plugin_count; i++) {
+		release_plugin(service->runtime.L, &service->plugins[i]);
 	}
+	free(service->plugins);
+	service->plugins = NULL;
+	service->plugin_count = 0;
+	lua_profiler_free(&service->profiler);
+
+	lua_api_shutdown(service->runtime.L);
+
+	song_library_destroy(service->api_context.song_library);
+	service->api_context.song_library = NULL;
 
 	lua_command_registry_deinit(&service->command_registry);
 	lua_runtime_deinit(&service->runtime);
@@ -179,8 +329,8 @@ bool lua_service_load_plugins(struct lua_service *service)
 
 	int list_length = lua_rawlen(L, -1);
 
-	service->loaded_plugins = malloc(sizeof(char *) * list_length);
-	if (service->loaded_plugins == NULL) {
+	service->plugins = calloc(list_length > 0 ? list_length : 1, sizeof(struct lua_plugin));
+	if (service->plugins == NULL) {
 		lua_pop(L, 3);
 		return false;
 	}
@@ -215,36 +365,16 @@ bool lua_service_load_plugins(struct lua_service *service)
 			);
 
 			if (lua_service_load_plugin(service, plugin_path)) {
-				service->loaded_plugins[service->plugin_count] =
-					strdup(plugin_name);
+				struct lua_plugin *plugin = &service->plugins[service->plugin_count];
+				plugin->name = strdup(plugin_name);
+				plugin->order = service->plugin_count;
+				plugin->init_ref = LUA_NOREF;
+				plugin->options_ref = LUA_NOREF;
+				plugin->update_ref = LUA_NOREF;
+				plugin->render_ref = LUA_NOREF;
+				plugin->key_down_ref = LUA_NOREF;
+				resolve_plugin(L, plugin, lua_absindex(L, -2), plugin_name);
 				service->plugin_count++;
-
-				lua_getglobal(L, plugin_name);
-				if (lua_type(L, -1) == LUA_TTABLE) {
-					lua_getfield(L, -1, "init");
-					if (lua_type(L, -1) == LUA_TFUNCTION) {
-						lua_getfield(L, -4, "options");
-						if (lua_type(L, -1) != LUA_TTABLE) {
-							lua_pop(L, 1);
-							lua_pushnil(L);
-						}
-
-						if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
-							fprintf(stderr,
-								"Failed to initialize plugin %s: "
-								"%s\n",
-								plugin_name,
-								lua_tostring(L, -1));
-							lua_pop(L, 2);
-						} else {
-							lua_pop(L, 1);
-						}
-					} else {
-						lua_pop(L, 2);
-					}
-				} else {
-					lua_pop(L, 1);
-				}
 			}
 		}
 
@@ -253,6 +383,17 @@ bool lua_service_load_plugins(struct lua_service *service)
 
 	lua_pop(L, 3);
 
+	qsort(service->plugins, service->plugin_count, sizeof(struct lua_plugin), compare_plugins);
+
+	if (!lua_profiler_init(&service->profiler, service->plugin_count)) {
+		fprintf(stderr, "Failed to allocate plugin profiler\n");
+	}
+
+	for (int i = 0; i < service->plugin_count; i++) {
+		lua_profiler_set_name(&service->profiler, i, service->plugins[i].name);
+		init_plugin(L, &service->plugins[i]);
+	}
+
 	printf("Loaded %d plugins from config\n", service->plugin_count);
 	return true;
 }
@@ -268,26 +409,18 @@ void lua_service_call_update_callbacks(struct lua_service *service)
 		return;
 	}
 
+	lua_api_update(L);
+
 	for (int i = 0; i < service->plugin_count; i++) {
-		const char *plugin_name = service->loaded_plugins[i];
-
-		lua_getglobal(L, plugin_name);
-		if (lua_type(L, -1) == LUA_TTABLE) {
-			lua_getfield(L, -1, "update");
-			if (lua_type(L, -1) == LUA_TFUNCTION) {
-				if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
-					fprintf(stderr,
-						"Lua update error in %s: %s\n",
-						plugin_name,
-						lua_tostring(L, -1));
-					lua_pop(L, 1);
-				}
-			} else {
-				lua_pop(L, 1);
-			}
+		struct lua_plugin *plugin = &service->plugins[i];
+		if (plugin->skip_frames > 0) {
+			plugin->skip_frames--;
+			continue;
 		}
-		lua_pop(L, 1);
+		call_plugin(service, i, plugin->update_ref, "update");
 	}
+
+	lua_api_dispatch_events(L);
 }
 
 void lua_service_call_render_callbacks(struct lua_service *service)
@@ -302,25 +435,21 @@ void lua_service_call_render_callbacks(struct lua_service *service)
 	}
 
 	for (int i = 0; i < service->plugin_count; i++) {
-		const char *plugin_name = service->loaded_plugins[i];
-
-		lua_getglobal(L, plugin_name);
-		if (lua_type(L, -1) == LUA_TTABLE) {
-			lua_getfield(L, -1, "render");
-			if (lua_type(L, -1) == LUA_TFUNCTION) {
-				if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
-					fprintf(stderr,
-						"Lua render error in %s: %s\n",
-						plugin_name,
-						lua_tostring(L, -1));
-					lua_pop(L, 1);
-				}
-			} else {
-				lua_pop(L, 1);
-			}
-		}
-		lua_pop(L, 1);
+		struct lua_plugin *plugin = &service->plugins[i];
+		call_plugin(service, i, plugin->render_ref, "render");
+		charge_plugin_frame(plugin);
+	}
+
+	lua_profiler_end_frame(&service->profiler);
+}
+
+void lua_service_collect_garbage(struct lua_service *service, double idle_ms)
+{
+	if (service == NULL || !service->initialized) {
+		return;
 	}
+
+	lua_runtime_collect_idle(&service->runtime, idle_ms);
 }
 
 bool lua_service_dispatch_key_event(struct lua_service *service, struct input_event_key_down *event)
@@ -339,34 +468,30 @@ bool lua_service_dispatch_key_event(struct lua_service *service, struct input_ev
 		return false;
 	}
 
-	for (int i = 0; i < service->plugin_count; i++) {
-		const char *plugin_name = service->loaded_plugins[i];
-
-		lua_getglobal(L, plugin_name);
-		if (lua_type(L, -1) != LUA_TTABLE) {
-			lua_pop(L, 1);
+	for (int i = service->plugin_count - 1; i >= 0; i--) {
+		const struct lua_plugin *plugin = &service->plugins[i];
+		if (plugin->key_down_ref == LUA_NOREF) {
 			continue;
 		}
 
-		lua_getfield(L, -1, "on_key_down");
-		if (lua_type(L, -1) != LUA_TFUNCTION) {
-			lua_pop(L, 2);
-			continue;
-		}
+		struct lua_profiler_sample mark;
+		lua_profiler_begin(&service->runtime, &mark);
 
+		lua_rawgeti(L, LUA_REGISTRYINDEX, plugin->key_down_ref);
 		lua_pushstring(L, key_name);
 		lua_pushboolean(L, event->shift);
 		lua_pushboolean(L, event->ctrl);
 		lua_pushboolean(L, event->alt);
 
 		int result = lua_pcall(L, 4, 1, 0);
+		lua_profiler_end(&service->profiler, i, &service->runtime, &mark);
 		if (result != LUA_OK) {
 			const char *error_msg = lua_tostring(L, -1);
 			fprintf(stderr,
 				"Lua key event error in %s: %s\n",
-				plugin_name,
+				plugin->name,
 				error_msg ? error_msg : "unknown error");
-			lua_pop(L, 2);
+			lua_pop(L, 1);
 			continue;
 		}
 
@@ -374,7 +499,7 @@ bool lua_service_dispatch_key_event(struct lua_service *service, struct input_ev
 		if (lua_isboolean(L, -1)) {
 			handled = lua_toboolean(L, -1);
 		}
-		lua_pop(L, 2);
+		lua_pop(L, 1);
 
 		if (handled) {
 			return true;
@@ -402,6 +527,13 @@ void lua_service_apply_config_to_state(struct lua_service *service, struct app_s
 	state->snap_enabled =
 		lua_runtime_get_config_bool(&service->runtime, "grid.snap_enabled", true);
 
+	int undo_budget_kb = lua_runtime_get_config_int(
+		&service->runtime, "history.undo_budget_kb", UNDO_HISTORY_DEFAULT_BUDGET / 1024
+	);
+	if (undo_budget_kb > 0) {
+		command_history_set_budget(&state->history, (size_t)undo_budget_kb * 1024);
+	}
+
 	printf("Applied config to state: %dx%d, BPM=%d\n", width, height, bpm);
 }
 
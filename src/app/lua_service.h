@@ -2,9 +2,11 @@
 #define BOOSTIO_LUA_SERVICE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "lua_api.h"
 #include "lua_command_registry.h"
+#include "lua_profiler.h"
 #include "lua_runtime.h"
 
 struct app_state;
@@ -12,13 +14,31 @@ struct command;
 struct input_event;
 struct platform_paths;
 
+struct lua_plugin {
+	char *name;
+	int priority;
+	int order;
+	int init_ref;
+	int options_ref;
+	int update_ref;
+	int render_ref;
+	int key_down_ref;
+	double budget_ms;
+	double last_frame_ms;
+	uint64_t frame_ticks;
+	uint64_t last_warning;
+	uint32_t skip_frames;
+	uint32_t overrun_count;
+};
+
 struct lua_service {
 	struct lua_runtime runtime;
 	struct lua_api_context api_context;
 	struct lua_command_registry command_registry;
 	bool initialized;
-	char **loaded_plugins;
+	struct lua_plugin *plugins;
 	int plugin_count;
+	struct lua_profiler profiler;
 	struct platform_paths *paths;
 };
 
@@ -42,6 +62,8 @@ void lua_service_call_update_callbacks(struct lua_service *service);
 
 void lua_service_call_render_callbacks(struct lua_service *service);
 
+void lua_service_collect_garbage(struct lua_service *service, double idle_ms);
+
 bool lua_service_dispatch_key_event(
 	struct lua_service *service, struct input_event_key_down *event
 );
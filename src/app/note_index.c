@@ -0,0 +1,279 @@
+#include "note_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NOTE_INDEX_MIN_CAPACITY 64
+
+static struct note_interval make_interval(
+	uint32_t id, uint32_t start_ms, uint32_t duration_ms, uint8_t piano_key, uint8_t waveform
+)
+{
+	struct note_interval interval = {0};
+	interval.start_ms = start_ms;
+	interval.end_ms = start_ms + (duration_ms > 0 ? duration_ms : 1);
+	interval.id = id;
+	interval.piano_key = piano_key;
+	interval.waveform = waveform;
+	return interval;
+}
+
+static bool interval_before(uint32_t start_ms, uint32_t id, const struct note_interval *interval)
+{
+	if (start_ms != interval->start_ms) {
+		return start_ms < interval->start_ms;
+	}
+	return id < interval->id;
+}
+
+static int compare_intervals(const void *a, const void *b)
+{
+	const struct note_interval *interval_a = a;
+	const struct note_interval *interval_b = b;
+	if (interval_a->start_ms != interval_b->start_ms) {
+		return interval_a->start_ms < interval_b->start_ms ? -1 : 1;
+	}
+	if (interval_a->id != interval_b->id) {
+		return interval_a->id < interval_b->id ? -1 : 1;
+	}
+	return 0;
+}
+
+static void update_max_end(struct voice_intervals *voice, uint32_t from)
+{
+	uint32_t max_end = from > 0 ? voice->entries[from - 1].max_end_ms : 0;
+	for (uint32_t i = from; i < voice->count; i++) {
+		if (voice->entries[i].end_ms > max_end) {
+			max_end = voice->entries[i].end_ms;
+		}
+		voice->entries[i].max_end_ms = max_end;
+	}
+}
+
+static bool voice_reserve(struct voice_intervals *voice, uint32_t capacity)
+{
+	if (capacity <= voice->capacity) {
+		return true;
+	}
+
+	uint32_t new_capacity = voice->capacity > 0 ? voice->capacity : NOTE_INDEX_MIN_CAPACITY;
+	while (new_capacity < capacity) {
+		new_capacity *= 2;
+	}
+
+	struct note_interval *entries =
+		realloc(voice->entries, sizeof(struct note_interval) * new_capacity);
+	if (!entries) {
+		fprintf(stderr, "Failed to grow note interval index to %u entries\n", new_capacity);
+		return false;
+	}
+
+	voice->entries = entries;
+	voice->capacity = new_capacity;
+	return true;
+}
+
+static uint32_t lower_bound(const struct voice_intervals *voice, uint32_t start_ms, uint32_t id)
+{
+	uint32_t low = 0;
+	uint32_t high = voice->count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (interval_before(start_ms, id, &voice->entries[mid]) ||
+		    (voice->entries[mid].start_ms == start_ms && voice->entries[mid].id == id)) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+static uint32_t first_ending_after(const struct voice_intervals *voice, uint32_t ms)
+{
+	uint32_t low = 0;
+	uint32_t high = voice->count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (voice->entries[mid].max_end_ms > ms) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+void note_index_init(struct note_index *index)
+{
+	memset(index, 0, sizeof(struct note_index));
+}
+
+void note_index_free(struct note_index *index)
+{
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		free(index->voices[i].entries);
+	}
+	memset(index, 0, sizeof(struct note_index));
+}
+
+void note_index_clear(struct note_index *index)
+{
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		index->voices[i].count = 0;
+	}
+	index->built = false;
+}
+
+bool note_index_push(
+	struct note_index *index,
+	uint32_t id,
+	uint32_t start_ms,
+	uint32_t duration_ms,
+	uint8_t voice,
+	uint8_t piano_key,
+	uint8_t waveform
+)
+{
+	struct voice_intervals *bucket = &index->voices[voice % NOTE_INDEX_VOICES];
+	if (!voice_reserve(bucket, bucket->count + 1)) {
+		return false;
+	}
+
+	bucket->entries[bucket->count++] =
+		make_interval(id, start_ms, duration_ms, piano_key, waveform);
+	return true;
+}
+
+void note_index_sort(struct note_index *index)
+{
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		struct voice_intervals *voice = &index->voices[i];
+
+		bool sorted = true;
+		for (uint32_t j = 1; j < voice->count && sorted; j++) {
+			sorted = compare_intervals(&voice->entries[j - 1], &voice->entries[j]) < 0;
+		}
+		if (!sorted) {
+			qsort(voice->entries,
+			      voice->count,
+			      sizeof(struct note_interval),
+			      compare_intervals);
+		}
+
+		update_max_end(voice, 0);
+	}
+
+	index->built = true;
+}
+
+void note_index_insert(
+	struct note_index *index,
+	uint32_t id,
+	uint32_t start_ms,
+	uint32_t duration_ms,
+	uint8_t voice,
+	uint8_t piano_key,
+	uint8_t waveform
+)
+{
+	if (!index->built) {
+		return;
+	}
+
+	struct voice_intervals *bucket = &index->voices[voice % NOTE_INDEX_VOICES];
+	if (!voice_reserve(bucket, bucket->count + 1)) {
+		note_index_clear(index);
+		return;
+	}
+
+	uint32_t position = lower_bound(bucket, start_ms, id);
+	memmove(&bucket->entries[position + 1],
+		&bucket->entries[position],
+		sizeof(struct note_interval) * (bucket->count - position));
+	bucket->entries[position] = make_interval(id, start_ms, duration_ms, piano_key, waveform);
+	bucket->count++;
+
+	update_max_end(bucket, position);
+}
+
+void note_index_remove(struct note_index *index, uint32_t id, uint32_t start_ms, uint8_t voice)
+{
+	if (!index->built) {
+		return;
+	}
+
+	struct voice_intervals *bucket = &index->voices[voice % NOTE_INDEX_VOICES];
+	uint32_t position = lower_bound(bucket, start_ms, id);
+	if (position >= bucket->count || bucket->entries[position].id != id) {
+		fprintf(stderr, "Note %u is missing from the interval index\n", id);
+		note_index_clear(index);
+		return;
+	}
+
+	bucket->count--;
+	memmove(&bucket->entries[position],
+		&bucket->entries[position + 1],
+		sizeof(struct note_interval) * (bucket->count - position));
+
+	update_max_end(bucket, position);
+}
+
+void note_index_set_waveform(
+	struct note_index *index, uint32_t id, uint32_t start_ms, uint8_t voice, uint8_t waveform
+)
+{
+	if (!index->built) {
+		return;
+	}
+
+	struct voice_intervals *bucket = &index->voices[voice % NOTE_INDEX_VOICES];
+	uint32_t position = lower_bound(bucket, start_ms, id);
+	if (position < bucket->count && bucket->entries[position].id == id) {
+		bucket->entries[position].waveform = waveform;
+	}
+}
+
+uint32_t note_index_first_ending_after(const struct voice_intervals *voice, uint32_t ms)
+{
+	return first_ending_after(voice, ms);
+}
+
+uint32_t note_index_query(
+	const struct note_index *index,
+	const struct note_range *range,
+	bool (*callback)(uint32_t id, void *user_data),
+	void *user_data
+)
+{
+	uint32_t matched = 0;
+
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		if (!(range->voice_mask & (1u << i))) {
+			continue;
+		}
+
+		const struct voice_intervals *voice = &index->voices[i];
+		uint32_t first = first_ending_after(voice, range->start_ms);
+		for (uint32_t j = first; j < voice->count; j++) {
+			const struct note_interval *interval = &voice->entries[j];
+			if (interval->start_ms >= range->end_ms) {
+				break;
+			}
+
+			if (interval->end_ms <= range->start_ms ||
+			    interval->piano_key < range->min_key ||
+			    interval->piano_key > range->max_key) {
+				continue;
+			}
+
+			matched++;
+			if (callback && !callback(interval->id, user_data)) {
+				return matched;
+			}
+		}
+	}
+
+	return matched;
+}
@@ -0,0 +1,76 @@
+#ifndef BOOSTIO_NOTE_INDEX_H
+#define BOOSTIO_NOTE_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NOTE_INDEX_VOICES 8
+#define NOTE_INDEX_ALL_VOICES 0xFF
+
+struct note_interval {
+	uint32_t start_ms;
+	uint32_t end_ms;
+	uint32_t max_end_ms;
+	uint32_t id;
+	uint8_t piano_key;
+	uint8_t waveform;
+};
+
+struct voice_intervals {
+	struct note_interval *entries;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+struct note_index {
+	struct voice_intervals voices[NOTE_INDEX_VOICES];
+	bool built;
+};
+
+struct note_range {
+	uint32_t start_ms;
+	uint32_t end_ms;
+	uint8_t min_key;
+	uint8_t max_key;
+	uint8_t voice_mask;
+};
+
+void note_index_init(struct note_index *index);
+void note_index_free(struct note_index *index);
+void note_index_clear(struct note_index *index);
+
+bool note_index_push(
+	struct note_index *index,
+	uint32_t id,
+	uint32_t start_ms,
+	uint32_t duration_ms,
+	uint8_t voice,
+	uint8_t piano_key,
+	uint8_t waveform
+);
+void note_index_sort(struct note_index *index);
+
+void note_index_insert(
+	struct note_index *index,
+	uint32_t id,
+	uint32_t start_ms,
+	uint32_t duration_ms,
+	uint8_t voice,
+	uint8_t piano_key,
+	uint8_t waveform
+);
+void note_index_remove(struct note_index *index, uint32_t id, uint32_t start_ms, uint8_t voice);
+void note_index_set_waveform(
+	struct note_index *index, uint32_t id, uint32_t start_ms, uint8_t voice, uint8_t waveform
+);
+
+uint32_t note_index_first_ending_after(const struct voice_intervals *voice, uint32_t ms);
+
+uint32_t note_index_query(
+	const struct note_index *index,
+	const struct note_range *range,
+	bool (*callback)(uint32_t id, void *user_data),
+	void *user_data
+);
+
+#endif
@@ -0,0 +1,720 @@
+#include "note_store.h"
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ID_MAP_EMPTY UINT32_MAX
+#define ID_MAP_MIN_CAPACITY 64
+#define NOTE_TABLE_MIN_CAPACITY 4
+#define NOTE_CHANGES_MIN 64
+#define NOTE_EVENTS_MAX 4096
+#define NOTE_STORE_REINDEX_DIVISOR 64
+#define NOTE_CHUNK_SHIFT 8
+#define NOTE_CHUNK_SIZE (1u << NOTE_CHUNK_SHIFT)
+#define NOTE_CHUNK_MASK (NOTE_CHUNK_SIZE - 1)
+
+struct note_chunk {
+	SDL_AtomicInt refs;
+	struct ui_note notes[NOTE_CHUNK_SIZE];
+};
+
+struct note_table {
+	SDL_AtomicInt refs;
+	uint32_t capacity;
+	uint32_t count;
+	struct note_chunk *chunks[];
+};
+
+static uint32_t hash_id(uint32_t id)
+{
+	id ^= id >> 16;
+	id *= 0x7feb352du;
+	id ^= id >> 15;
+	id *= 0x846ca68bu;
+	id ^= id >> 16;
+	return id;
+}
+
+static uint32_t id_map_find_slot(const struct id_map *map, uint32_t key)
+{
+	uint32_t mask = map->capacity - 1;
+	uint32_t slot = hash_id(key) & mask;
+
+	while (map->values[slot] != ID_MAP_EMPTY && map->keys[slot] != key) {
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+static bool id_map_resize(struct id_map *map, uint32_t capacity)
+{
+	uint32_t *keys = malloc(sizeof(uint32_t) * capacity);
+	uint32_t *values = malloc(sizeof(uint32_t) * capacity);
+	if (!keys || !values) {
+		fprintf(stderr, "Failed to grow note index to %u slots\n", capacity);
+		free(keys);
+		free(values);
+		return false;
+	}
+
+	memset(values, 0xFF, sizeof(uint32_t) * capacity);
+
+	uint32_t *old_keys = map->keys;
+	uint32_t *old_values = map->values;
+	uint32_t old_capacity = map->capacity;
+
+	map->keys = keys;
+	map->values = values;
+	map->capacity = capacity;
+
+	for (uint32_t i = 0; i < old_capacity; i++) {
+		if (old_values[i] != ID_MAP_EMPTY) {
+			uint32_t slot = id_map_find_slot(map, old_keys[i]);
+			map->keys[slot] = old_keys[i];
+			map->values[slot] = old_values[i];
+		}
+	}
+
+	free(old_keys);
+	free(old_values);
+	return true;
+}
+
+void id_map_init(struct id_map *map)
+{
+	memset(map, 0, sizeof(struct id_map));
+}
+
+void id_map_free(struct id_map *map)
+{
+	free(map->keys);
+	free(map->values);
+	memset(map, 0, sizeof(struct id_map));
+}
+
+void id_map_clear(struct id_map *map)
+{
+	if (map->values) {
+		memset(map->values, 0xFF, sizeof(uint32_t) * map->capacity);
+	}
+	map->count = 0;
+}
+
+bool id_map_get(const struct id_map *map, uint32_t key, uint32_t *value)
+{
+	if (map->count == 0) {
+		return false;
+	}
+
+	uint32_t slot = id_map_find_slot(map, key);
+	if (map->values[slot] == ID_MAP_EMPTY) {
+		return false;
+	}
+
+	if (value) {
+		*value = map->values[slot];
+	}
+	return true;
+}
+
+bool id_map_put(struct id_map *map, uint32_t key, uint32_t value)
+{
+	if (map->capacity > 0) {
+		uint32_t slot = id_map_find_slot(map, key);
+		if (map->values[slot] != ID_MAP_EMPTY) {
+			map->values[slot] = value;
+			return true;
+		}
+	}
+
+	if ((map->count + 1) * 2 > map->capacity) {
+		uint32_t capacity = map->capacity > 0 ? map->capacity * 2 : ID_MAP_MIN_CAPACITY;
+		if (!id_map_resize(map, capacity)) {
+			return false;
+		}
+	}
+
+	uint32_t slot = id_map_find_slot(map, key);
+	map->keys[slot] = key;
+	map->values[slot] = value;
+	map->count++;
+	return true;
+}
+
+bool id_map_remove(struct id_map *map, uint32_t key)
+{
+	if (map->count == 0) {
+		return false;
+	}
+
+	uint32_t mask = map->capacity - 1;
+	uint32_t hole = id_map_find_slot(map, key);
+	if (map->values[hole] == ID_MAP_EMPTY) {
+		return false;
+	}
+
+	uint32_t next = (hole + 1) & mask;
+	while (map->values[next] != ID_MAP_EMPTY) {
+		uint32_t home = hash_id(map->keys[next]) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			map->keys[hole] = map->keys[next];
+			map->values[hole] = map->values[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	map->values[hole] = ID_MAP_EMPTY;
+	map->count--;
+	return true;
+}
+
+static void record_event(struct note_store *store, uint32_t id)
+{
+	struct note_event_log *log = &store->events;
+	if (log->reset || (log->count > 0 && log->ids[log->count - 1] == id)) {
+		return;
+	}
+
+	if (log->count == log->capacity) {
+		uint32_t capacity = log->capacity > 0 ? log->capacity * 2 : NOTE_CHANGES_MIN;
+		uint32_t *ids = NULL;
+		if (capacity <= NOTE_EVENTS_MAX) {
+			ids = realloc(log->ids, sizeof(uint32_t) * capacity);
+		}
+		if (ids == NULL) {
+			log->reset = true;
+			return;
+		}
+		log->ids = ids;
+		log->capacity = capacity;
+	}
+
+	log->ids[log->count++] = id;
+}
+
+static void record_change(struct note_store *store, uint32_t id, bool existed, uint32_t old_ms)
+{
+	record_event(store, id);
+
+	struct note_change_set *set = &store->changes;
+	if (set->reset || id_map_get(&set->slots, id, NULL)) {
+		return;
+	}
+
+	if (set->count == set->capacity) {
+		uint32_t capacity = set->capacity > 0 ? set->capacity * 2 : NOTE_CHANGES_MIN;
+		struct note_change *changes =
+			realloc(set->changes, sizeof(struct note_change) * capacity);
+		if (!changes) {
+			set->reset = true;
+			return;
+		}
+		set->changes = changes;
+		set->capacity = capacity;
+	}
+
+	if (!id_map_put(&set->slots, id, set->count)) {
+		set->reset = true;
+		return;
+	}
+
+	set->changes[set->count++] = (struct note_change){id, old_ms, existed};
+}
+
+static void refresh_conflicts(struct note_store *store, const struct ui_note *note)
+{
+	if (!store->intervals.built) {
+		voice_conflicts_clear(&store->conflicts);
+		return;
+	}
+
+	uint32_t end_ms = note->ms + (note->duration_ms > 0 ? note->duration_ms : 1);
+	voice_conflicts_refresh(&store->conflicts, &store->intervals, note->voice, note->ms, end_ms);
+}
+
+static struct ui_note *note_slot(const struct note_table *table, uint32_t index)
+{
+	return &table->chunks[index >> NOTE_CHUNK_SHIFT]->notes[index & NOTE_CHUNK_MASK];
+}
+
+static void chunk_release(struct note_chunk *chunk)
+{
+	if (SDL_AddAtomicInt(&chunk->refs, -1) == 1) {
+		free(chunk);
+	}
+}
+
+static void table_release(struct note_table *table)
+{
+	if (table == NULL || SDL_AddAtomicInt(&table->refs, -1) != 1) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < table->count; i++) {
+		chunk_release(table->chunks[i]);
+	}
+	free(table);
+}
+
+static bool make_table_writable(struct note_store *store, uint32_t chunk_count)
+{
+	struct note_table *table = store->table;
+	bool shared = table != NULL && SDL_GetAtomicInt(&table->refs) > 1;
+	if (table != NULL && !shared && chunk_count <= table->capacity) {
+		return true;
+	}
+
+	uint32_t capacity = table != NULL ? table->capacity : NOTE_TABLE_MIN_CAPACITY;
+	while (capacity < chunk_count) {
+		capacity *= 2;
+	}
+
+	size_t size = sizeof(struct note_table) + sizeof(struct note_chunk *) * capacity;
+	if (table != NULL && !shared) {
+		struct note_table *grown = realloc(table, size);
+		if (!grown) {
+			fprintf(stderr, "Failed to grow note table to %u chunks\n", capacity);
+			return false;
+		}
+		grown->capacity = capacity;
+		store->table = grown;
+		return true;
+	}
+
+	struct note_table *copy = malloc(size);
+	if (!copy) {
+		fprintf(stderr, "Failed to copy note table of %u chunks\n", capacity);
+		return false;
+	}
+
+	SDL_SetAtomicInt(&copy->refs, 1);
+	copy->capacity = capacity;
+	copy->count = 0;
+
+	if (table != NULL) {
+		for (uint32_t i = 0; i < table->count; i++) {
+			SDL_AddAtomicInt(&table->chunks[i]->refs, 1);
+			copy->chunks[i] = table->chunks[i];
+		}
+		copy->count = table->count;
+		table_release(table);
+	}
+
+	store->table = copy;
+	return true;
+}
+
+static struct ui_note *writable_slot(struct note_store *store, uint32_t index)
+{
+	if (!make_table_writable(store, store->table->count)) {
+		return NULL;
+	}
+
+	struct note_chunk **chunk = &store->table->chunks[index >> NOTE_CHUNK_SHIFT];
+	if (SDL_GetAtomicInt(&(*chunk)->refs) > 1) {
+		struct note_chunk *copy = malloc(sizeof(struct note_chunk));
+		if (!copy) {
+			fprintf(stderr, "Failed to copy note chunk\n");
+			return NULL;
+		}
+
+		SDL_SetAtomicInt(&copy->refs, 1);
+		memcpy(copy->notes, (*chunk)->notes, sizeof(copy->notes));
+		chunk_release(*chunk);
+		*chunk = copy;
+	}
+
+	return &(*chunk)->notes[index & NOTE_CHUNK_MASK];
+}
+
+void note_store_init(struct note_store *store)
+{
+	memset(store, 0, sizeof(struct note_store));
+	id_map_init(&store->index);
+	note_index_init(&store->intervals);
+	voice_conflicts_init(&store->conflicts);
+	id_map_init(&store->changes.slots);
+	store->changes.reset = true;
+	store->events.reset = true;
+}
+
+void note_store_free(struct note_store *store)
+{
+	table_release(store->table);
+	id_map_free(&store->index);
+	note_index_free(&store->intervals);
+	voice_conflicts_free(&store->conflicts);
+	free(store->changes.changes);
+	id_map_free(&store->changes.slots);
+	free(store->events.ids);
+	memset(store, 0, sizeof(struct note_store));
+}
+
+void note_store_clear(struct note_store *store)
+{
+	if (store->table != NULL && SDL_GetAtomicInt(&store->table->refs) > 1) {
+		table_release(store->table);
+		store->table = NULL;
+	}
+
+	store->count = 0;
+	store->version++;
+	id_map_clear(&store->index);
+	note_index_clear(&store->intervals);
+	voice_conflicts_clear(&store->conflicts);
+	note_store_clear_changes(store);
+	store->changes.reset = true;
+	store->events.count = 0;
+	store->events.reset = true;
+}
+
+void note_store_clear_changes(struct note_store *store)
+{
+	struct note_change_set *set = &store->changes;
+	if (set->count * 4 < set->slots.capacity) {
+		for (uint32_t i = 0; i < set->count; i++) {
+			id_map_remove(&set->slots, set->changes[i].id);
+		}
+	} else {
+		id_map_clear(&set->slots);
+	}
+
+	set->count = 0;
+	set->reset = false;
+}
+
+void note_store_clear_events(struct note_store *store)
+{
+	store->events.count = 0;
+	store->events.reset = false;
+}
+
+bool note_store_reserve(struct note_store *store, uint32_t capacity)
+{
+	uint32_t chunk_count = (capacity + NOTE_CHUNK_MASK) >> NOTE_CHUNK_SHIFT;
+	if (store->table != NULL && chunk_count <= store->table->count) {
+		return true;
+	}
+
+	if (!make_table_writable(store, chunk_count)) {
+		return false;
+	}
+
+	struct note_table *table = store->table;
+	while (table->count < chunk_count) {
+		struct note_chunk *chunk = malloc(sizeof(struct note_chunk));
+		if (!chunk) {
+			fprintf(stderr, "Failed to grow note store to %u notes\n", capacity);
+			return false;
+		}
+
+		SDL_SetAtomicInt(&chunk->refs, 1);
+		table->chunks[table->count++] = chunk;
+	}
+
+	return true;
+}
+
+uint32_t note_store_count(const struct note_store *store)
+{
+	return store->count;
+}
+
+const struct ui_note *note_store_at(const struct note_store *store, uint32_t index)
+{
+	return index < store->count ? note_slot(store->table, index) : NULL;
+}
+
+const struct ui_note *note_store_find(const struct note_store *store, uint32_t id)
+{
+	uint32_t index;
+	if (!id_map_get(&store->index, id, &index)) {
+		return NULL;
+	}
+	return note_slot(store->table, index);
+}
+
+bool note_store_index_of(const struct note_store *store, uint32_t id, uint32_t *index)
+{
+	return id_map_get(&store->index, id, index);
+}
+
+struct ui_note *note_store_add(struct note_store *store, const struct ui_note *note)
+{
+	return note_store_insert_at(store, store->count, note);
+}
+
+struct ui_note *
+note_store_insert_at(struct note_store *store, uint32_t index, const struct ui_note *note)
+{
+	if (id_map_get(&store->index, note->id, NULL)) {
+		fprintf(stderr, "Note id %u is already in use\n", note->id);
+		return NULL;
+	}
+
+	if (index > store->count) {
+		index = store->count;
+	}
+
+	if (!note_store_reserve(store, store->count + 1)) {
+		return NULL;
+	}
+
+	struct ui_note *tail = writable_slot(store, store->count);
+	struct ui_note *slot = tail;
+	if (tail != NULL && index < store->count) {
+		slot = writable_slot(store, index);
+	}
+	if (!slot || !id_map_put(&store->index, note->id, index)) {
+		return NULL;
+	}
+
+	if (index < store->count) {
+		*tail = *slot;
+		id_map_put(&store->index, slot->id, store->count);
+	}
+
+	*slot = *note;
+	store->count++;
+	store->version++;
+
+	record_change(store, note->id, false, 0);
+
+	note_index_insert(
+		&store->intervals,
+		note->id,
+		note->ms,
+		note->duration_ms,
+		note->voice,
+		note->piano_key,
+		(uint8_t)note->waveform
+	);
+	refresh_conflicts(store, note);
+	return slot;
+}
+
+bool note_store_update(struct note_store *store, const struct ui_note *note)
+{
+	uint32_t position;
+	if (!id_map_get(&store->index, note->id, &position)) {
+		return false;
+	}
+
+	struct ui_note *current = writable_slot(store, position);
+	if (!current) {
+		return false;
+	}
+
+	record_change(store, current->id, true, current->ms);
+
+	if (current->ms != note->ms || current->duration_ms != note->duration_ms ||
+	    current->voice != note->voice || current->piano_key != note->piano_key) {
+		note_index_remove(&store->intervals, current->id, current->ms, current->voice);
+		note_index_insert(
+			&store->intervals,
+			note->id,
+			note->ms,
+			note->duration_ms,
+			note->voice,
+			note->piano_key,
+			(uint8_t)note->waveform
+		);
+		refresh_conflicts(store, current);
+		refresh_conflicts(store, note);
+	} else if (current->waveform != note->waveform) {
+		note_index_set_waveform(
+			&store->intervals, note->id, note->ms, note->voice, (uint8_t)note->waveform
+		);
+	}
+
+	*current = *note;
+	store->version++;
+	return true;
+}
+
+bool note_store_remove(
+	struct note_store *store, uint32_t id, struct ui_note *removed, uint32_t *index
+)
+{
+	uint32_t position;
+	if (!id_map_get(&store->index, id, &position)) {
+		return false;
+	}
+
+	uint32_t last = store->count - 1;
+	struct ui_note *slot = note_slot(store->table, position);
+	if (position != last) {
+		slot = writable_slot(store, position);
+		if (!slot) {
+			return false;
+		}
+	}
+
+	if (removed) {
+		*removed = *slot;
+	}
+	if (index) {
+		*index = position;
+	}
+
+	id_map_remove(&store->index, id);
+	record_change(store, id, true, slot->ms);
+	note_index_remove(&store->intervals, id, slot->ms, slot->voice);
+	refresh_conflicts(store, slot);
+
+	if (position != last) {
+		*slot = *note_slot(store->table, last);
+		id_map_put(&store->index, slot->id, position);
+	}
+
+	store->count--;
+	store->version++;
+	return true;
+}
+
+bool note_store_copy(struct note_store *dst, const struct note_store *src)
+{
+	note_store_clear(dst);
+	if (src->count == 0) {
+		return true;
+	}
+
+	table_release(dst->table);
+	SDL_AddAtomicInt(&src->table->refs, 1);
+	dst->table = src->table;
+	dst->count = src->count;
+
+	for (uint32_t i = 0; i < src->count; i++) {
+		const struct ui_note *note = note_slot(src->table, i);
+		if (!id_map_put(&dst->index, note->id, i)) {
+			note_store_clear(dst);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void note_store_snapshot(const struct note_store *store, struct note_snapshot *snapshot)
+{
+	snapshot->table = store->table;
+	snapshot->count = store->count;
+	if (snapshot->table != NULL) {
+		SDL_AddAtomicInt(&snapshot->table->refs, 1);
+	}
+}
+
+void note_snapshot_release(struct note_snapshot *snapshot)
+{
+	table_release(snapshot->table);
+	snapshot->table = NULL;
+	snapshot->count = 0;
+}
+
+uint32_t note_snapshot_count(const struct note_snapshot *snapshot)
+{
+	return snapshot->count;
+}
+
+const struct ui_note *note_snapshot_at(const struct note_snapshot *snapshot, uint32_t index)
+{
+	return index < snapshot->count ? note_slot(snapshot->table, index) : NULL;
+}
+
+struct range_visit {
+	const struct note_store *store;
+	bool (*callback)(const struct ui_note *note, void *user_data);
+	void *user_data;
+};
+
+static bool visit_interval(uint32_t id, void *user_data)
+{
+	struct range_visit *visit = user_data;
+	const struct ui_note *note = note_store_find(visit->store, id);
+	return note == NULL || visit->callback(note, visit->user_data);
+}
+
+static bool build_intervals(struct note_store *store)
+{
+	note_index_clear(&store->intervals);
+
+	for (uint32_t i = 0; i < store->count; i++) {
+		const struct ui_note *note = note_slot(store->table, i);
+		if (!note_index_push(
+			    &store->intervals,
+			    note->id,
+			    note->ms,
+			    note->duration_ms,
+			    note->voice,
+			    note->piano_key,
+			    (uint8_t)note->waveform
+		    )) {
+			note_index_clear(&store->intervals);
+			return false;
+		}
+	}
+
+	note_index_sort(&store->intervals);
+	return true;
+}
+
+void note_store_prepare_updates(struct note_store *store, uint32_t count)
+{
+	if (count > store->count / NOTE_STORE_REINDEX_DIVISOR) {
+		note_index_clear(&store->intervals);
+		voice_conflicts_clear(&store->conflicts);
+	}
+}
+
+const struct note_index *note_store_intervals(struct note_store *store)
+{
+	if (!store->intervals.built && !build_intervals(store)) {
+		return NULL;
+	}
+	return &store->intervals;
+}
+
+const struct voice_conflicts *note_store_conflicts(struct note_store *store)
+{
+	if (!store->conflicts.built) {
+		if (store->intervals.built || build_intervals(store)) {
+			voice_conflicts_rebuild(&store->conflicts, &store->intervals);
+		}
+	}
+	return &store->conflicts;
+}
+
+uint32_t note_store_query_range(
+	struct note_store *store,
+	const struct note_range *range,
+	bool (*callback)(const struct ui_note *note, void *user_data),
+	void *user_data
+)
+{
+	if (!store->intervals.built && !build_intervals(store)) {
+		uint32_t matched = 0;
+		for (uint32_t i = 0; i < store->count; i++) {
+			const struct ui_note *note = note_slot(store->table, i);
+			uint32_t duration_ms = note->duration_ms > 0 ? note->duration_ms : 1;
+			if (!(range->voice_mask & (1u << (note->voice % NOTE_INDEX_VOICES))) ||
+			    note->ms >= range->end_ms ||
+			    note->ms + duration_ms <= range->start_ms ||
+			    note->piano_key < range->min_key || note->piano_key > range->max_key) {
+				continue;
+			}
+
+			matched++;
+			if (callback && !callback(note, user_data)) {
+				break;
+			}
+		}
+		return matched;
+	}
+
+	struct range_visit visit = {store, callback, user_data};
+	return note_index_query(&store->intervals, range, callback ? visit_interval : NULL, &visit);
+}
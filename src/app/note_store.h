@@ -0,0 +1,119 @@
+#ifndef BOOSTIO_NOTE_STORE_H
+#define BOOSTIO_NOTE_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "note_index.h"
+#include "synth.h"
+#include "voice_conflicts.h"
+
+struct ui_note {
+	uint32_t id;
+	uint32_t ms;
+	uint16_t duration_ms;
+	uint8_t voice;
+	uint8_t piano_key;
+	float frequency;
+	enum waveform_type waveform;
+	uint8_t duty_cycle;
+	int16_t decay;
+	int8_t amplitude_dbfs;
+	uint8_t nes_noise_period;
+	bool nes_noise_mode_flag;
+	uint16_t nes_noise_lfsr_init;
+	bool restart_phase;
+};
+
+struct id_map {
+	uint32_t *keys;
+	uint32_t *values;
+	uint32_t capacity;
+	uint32_t count;
+};
+
+struct note_change {
+	uint32_t id;
+	uint32_t old_ms;
+	bool existed;
+};
+
+struct note_change_set {
+	struct note_change *changes;
+	uint32_t count;
+	uint32_t capacity;
+	struct id_map slots;
+	bool reset;
+};
+
+struct note_event_log {
+	uint32_t *ids;
+	uint32_t count;
+	uint32_t capacity;
+	bool reset;
+};
+
+struct note_table;
+
+struct note_snapshot {
+	struct note_table *table;
+	uint32_t count;
+};
+
+struct note_store {
+	struct note_table *table;
+	uint32_t count;
+	uint32_t version;
+	struct id_map index;
+	struct note_index intervals;
+	struct voice_conflicts conflicts;
+	struct note_change_set changes;
+	struct note_event_log events;
+};
+
+void id_map_init(struct id_map *map);
+void id_map_free(struct id_map *map);
+void id_map_clear(struct id_map *map);
+bool id_map_get(const struct id_map *map, uint32_t key, uint32_t *value);
+bool id_map_put(struct id_map *map, uint32_t key, uint32_t value);
+bool id_map_remove(struct id_map *map, uint32_t key);
+
+void note_store_init(struct note_store *store);
+void note_store_free(struct note_store *store);
+void note_store_clear(struct note_store *store);
+bool note_store_reserve(struct note_store *store, uint32_t capacity);
+
+uint32_t note_store_count(const struct note_store *store);
+const struct ui_note *note_store_at(const struct note_store *store, uint32_t index);
+const struct ui_note *note_store_find(const struct note_store *store, uint32_t id);
+bool note_store_index_of(const struct note_store *store, uint32_t id, uint32_t *index);
+
+struct ui_note *note_store_add(struct note_store *store, const struct ui_note *note);
+struct ui_note *
+note_store_insert_at(struct note_store *store, uint32_t index, const struct ui_note *note);
+bool note_store_update(struct note_store *store, const struct ui_note *note);
+bool note_store_remove(
+	struct note_store *store, uint32_t id, struct ui_note *removed, uint32_t *index
+);
+bool note_store_copy(struct note_store *dst, const struct note_store *src);
+void note_store_clear_changes(struct note_store *store);
+void note_store_clear_events(struct note_store *store);
+
+void note_store_snapshot(const struct note_store *store, struct note_snapshot *snapshot);
+void note_snapshot_release(struct note_snapshot *snapshot);
+uint32_t note_snapshot_count(const struct note_snapshot *snapshot);
+const struct ui_note *note_snapshot_at(const struct note_snapshot *snapshot, uint32_t index);
+
+void note_store_prepare_updates(struct note_store *store, uint32_t count);
+
+const struct note_index *note_store_intervals(struct note_store *store);
+const struct voice_conflicts *note_store_conflicts(struct note_store *store);
+
+uint32_t note_store_query_range(
+	struct note_store *store,
+	const struct note_range *range,
+	bool (*callback)(const struct ui_note *note, void *user_data),
+	void *user_data
+);
+
+#endif
@@ -0,0 +1,203 @@
+#include "voice_conflicts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VOICE_CONFLICTS_MIN_CAPACITY 16
+
+static bool list_reserve(struct voice_conflict_list *list, uint32_t capacity)
+{
+	if (capacity <= list->capacity) {
+		return true;
+	}
+
+	uint32_t new_capacity = list->capacity > 0 ? list->capacity : VOICE_CONFLICTS_MIN_CAPACITY;
+	while (new_capacity < capacity) {
+		new_capacity *= 2;
+	}
+
+	struct voice_conflict *items =
+		realloc(list->items, sizeof(struct voice_conflict) * new_capacity);
+	if (!items) {
+		fprintf(stderr, "Failed to grow voice conflict list to %u entries\n", new_capacity);
+		return false;
+	}
+
+	list->items = items;
+	list->capacity = new_capacity;
+	return true;
+}
+
+static uint32_t first_ending_after(const struct voice_conflict_list *list, uint32_t ms)
+{
+	uint32_t low = 0;
+	uint32_t high = list->count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (list->items[mid].end_ms > ms) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+static uint32_t cluster_start(const struct voice_intervals *bucket, uint32_t ms)
+{
+	uint32_t first = note_index_first_ending_after(bucket, ms);
+	while (first > 0 && first < bucket->count &&
+	       bucket->entries[first].start_ms < bucket->entries[first - 1].max_end_ms) {
+		first--;
+	}
+	return first;
+}
+
+static bool sweep(
+	struct voice_conflict_list *out,
+	const struct voice_intervals *bucket,
+	uint32_t first,
+	uint32_t end_ms,
+	uint32_t *swept_end_ms
+)
+{
+	out->count = 0;
+
+	uint32_t i = first;
+	while (i < bucket->count && bucket->entries[i].start_ms < end_ms) {
+		const struct note_interval *head = &bucket->entries[i];
+		uint32_t cluster_end = head->end_ms;
+		uint32_t j = i + 1;
+		while (j < bucket->count && bucket->entries[j].start_ms < cluster_end) {
+			if (bucket->entries[j].end_ms > cluster_end) {
+				cluster_end = bucket->entries[j].end_ms;
+			}
+			j++;
+		}
+
+		if (j - i > 1) {
+			if (!list_reserve(out, out->count + 1)) {
+				return false;
+			}
+			out->items[out->count++] =
+				(struct voice_conflict){head->start_ms, cluster_end, j - i};
+		}
+
+		if (cluster_end > *swept_end_ms) {
+			*swept_end_ms = cluster_end;
+		}
+		i = j;
+	}
+
+	return true;
+}
+
+void voice_conflicts_init(struct voice_conflicts *conflicts)
+{
+	memset(conflicts, 0, sizeof(struct voice_conflicts));
+}
+
+void voice_conflicts_free(struct voice_conflicts *conflicts)
+{
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		free(conflicts->voices[i].items);
+	}
+	free(conflicts->scratch.items);
+	memset(conflicts, 0, sizeof(struct voice_conflicts));
+}
+
+void voice_conflicts_clear(struct voice_conflicts *conflicts)
+{
+	if (!conflicts->built) {
+		return;
+	}
+
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		conflicts->voices[i].count = 0;
+	}
+	conflicts->built = false;
+	conflicts->version++;
+}
+
+bool voice_conflicts_rebuild(struct voice_conflicts *conflicts, const struct note_index *index)
+{
+	conflicts->built = false;
+	conflicts->version++;
+
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		struct voice_conflict_list *list = &conflicts->voices[i];
+		uint32_t swept_end_ms = 0;
+		if (!sweep(list, &index->voices[i], 0, UINT32_MAX, &swept_end_ms)) {
+			list->count = 0;
+			return false;
+		}
+	}
+
+	conflicts->built = true;
+	return true;
+}
+
+void voice_conflicts_refresh(
+	struct voice_conflicts *conflicts,
+	const struct note_index *index,
+	uint8_t voice,
+	uint32_t start_ms,
+	uint32_t end_ms
+)
+{
+	if (!conflicts->built) {
+		return;
+	}
+
+	const struct voice_intervals *bucket = &index->voices[voice % NOTE_INDEX_VOICES];
+	struct voice_conflict_list *list = &conflicts->voices[voice % NOTE_INDEX_VOICES];
+	struct voice_conflict_list *fresh = &conflicts->scratch;
+
+	uint32_t first = cluster_start(bucket, start_ms);
+	uint32_t low_ms = start_ms;
+	if (first < bucket->count && bucket->entries[first].start_ms < low_ms) {
+		low_ms = bucket->entries[first].start_ms;
+	}
+
+	uint32_t high_ms = end_ms;
+	if (!sweep(fresh, bucket, first, end_ms, &high_ms)) {
+		voice_conflicts_clear(conflicts);
+		return;
+	}
+
+	uint32_t remove_from = first_ending_after(list, low_ms);
+	uint32_t remove_to = remove_from;
+	while (remove_to < list->count && list->items[remove_to].start_ms < high_ms) {
+		remove_to++;
+	}
+
+	uint32_t removed = remove_to - remove_from;
+	if (removed == 0 && fresh->count == 0) {
+		return;
+	}
+
+	uint32_t count = list->count - removed + fresh->count;
+	if (!list_reserve(list, count)) {
+		voice_conflicts_clear(conflicts);
+		return;
+	}
+
+	memmove(&list->items[remove_from + fresh->count],
+		&list->items[remove_to],
+		sizeof(struct voice_conflict) * (list->count - remove_to));
+	memcpy(&list->items[remove_from],
+		fresh->items,
+		sizeof(struct voice_conflict) * fresh->count);
+	list->count = count;
+	conflicts->version++;
+}
+
+uint32_t voice_conflicts_count(const struct voice_conflicts *conflicts)
+{
+	uint32_t count = 0;
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		count += conflicts->voices[i].count;
+	}
+	return count;
+}
@@ -0,0 +1,43 @@
+#ifndef BOOSTIO_VOICE_CONFLICTS_H
+#define BOOSTIO_VOICE_CONFLICTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "note_index.h"
+
+struct voice_conflict {
+	uint32_t start_ms;
+	uint32_t end_ms;
+	uint32_t note_count;
+};
+
+struct voice_conflict_list {
+	struct voice_conflict *items;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+struct voice_conflicts {
+	struct voice_conflict_list voices[NOTE_INDEX_VOICES];
+	struct voice_conflict_list scratch;
+	uint32_t version;
+	bool built;
+};
+
+void voice_conflicts_init(struct voice_conflicts *conflicts);
+void voice_conflicts_free(struct voice_conflicts *conflicts);
+void voice_conflicts_clear(struct voice_conflicts *conflicts);
+
+bool voice_conflicts_rebuild(struct voice_conflicts *conflicts, const struct note_index *index);
+void voice_conflicts_refresh(
+	struct voice_conflicts *conflicts,
+	const struct note_index *index,
+	uint8_t voice,
+	uint32_t start_ms,
+	uint32_t end_ms
+);
+
+uint32_t voice_conflicts_count(const struct voice_conflicts *conflicts);
+
+#endif
@@ -0,0 +1,270 @@
+#include "voice_solver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VOICE_SOLVER_MIN_CAPACITY 64
+
+struct voice_solver_slot {
+	uint8_t allowed;
+	bool locked;
+};
+
+struct voice_sweep {
+	const struct note_index *index;
+	const struct voice_solver_slot *slots[NOTE_INDEX_VOICES];
+	uint32_t heads[NOTE_INDEX_VOICES];
+	uint32_t pins[NOTE_INDEX_VOICES];
+	uint32_t busy_until[NOTE_INDEX_VOICES];
+	uint8_t used;
+};
+
+static bool reserve(void **items, uint32_t *capacity, uint32_t count, size_t item_size)
+{
+	if (count <= *capacity) {
+		return true;
+	}
+
+	uint32_t new_capacity = *capacity > 0 ? *capacity : VOICE_SOLVER_MIN_CAPACITY;
+	while (new_capacity < count) {
+		new_capacity *= 2;
+	}
+
+	void *grown = realloc(*items, item_size * new_capacity);
+	if (!grown) {
+		fprintf(stderr, "Failed to grow voice solver buffer to %u entries\n", new_capacity);
+		return false;
+	}
+
+	*items = grown;
+	*capacity = new_capacity;
+	return true;
+}
+
+static void classify(
+	struct voice_solver_slot *slot,
+	const struct voice_solver_options *options,
+	const struct note_interval *interval
+)
+{
+	slot->allowed = options->voice_mask;
+	if (interval->waveform < VOICE_SOLVER_WAVEFORMS) {
+		slot->allowed &= options->waveform_voices[interval->waveform];
+	}
+
+	slot->locked =
+		(options->movable != NULL && !id_map_get(options->movable, interval->id, NULL)) ||
+		(options->locked != NULL && id_map_get(options->locked, interval->id, NULL));
+}
+
+static uint32_t next_locked_start(struct voice_sweep *sweep, int voice, uint32_t start_ms)
+{
+	const struct voice_intervals *bucket = &sweep->index->voices[voice];
+	const struct voice_solver_slot *slots = sweep->slots[voice];
+	uint32_t *pin = &sweep->pins[voice];
+
+	while (*pin < bucket->count &&
+	       (!slots[*pin].locked || bucket->entries[*pin].start_ms < start_ms)) {
+		(*pin)++;
+	}
+	return *pin < bucket->count ? bucket->entries[*pin].start_ms : UINT32_MAX;
+}
+
+static int next_interval(const struct voice_sweep *sweep)
+{
+	const struct note_interval *next = NULL;
+	int next_voice = -1;
+
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		const struct voice_intervals *bucket = &sweep->index->voices[i];
+		if (sweep->heads[i] >= bucket->count) {
+			continue;
+		}
+
+		const struct note_interval *interval = &bucket->entries[sweep->heads[i]];
+		if (next == NULL || interval->start_ms < next->start_ms ||
+		    (interval->start_ms == next->start_ms && interval->id < next->id)) {
+			next = interval;
+			next_voice = i;
+		}
+	}
+
+	return next_voice;
+}
+
+static int pick_voice(
+	struct voice_sweep *sweep,
+	const struct note_interval *interval,
+	uint8_t allowed,
+	int current
+)
+{
+	uint8_t free_mask = 0;
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		if ((allowed & (1u << i)) && sweep->busy_until[i] <= interval->start_ms &&
+		    next_locked_start(sweep, i, interval->start_ms) >= interval->end_ms) {
+			free_mask |= (uint8_t)(1u << i);
+		}
+	}
+
+	uint8_t preferred = free_mask & sweep->used;
+	if (preferred == 0) {
+		preferred = free_mask;
+	}
+	if (preferred & (1u << current)) {
+		return current;
+	}
+
+	int best = -1;
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		if ((preferred & (1u << i)) &&
+		    (best < 0 || sweep->busy_until[i] > sweep->busy_until[best])) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+static bool add_unsolved(struct voice_solver *solver, const struct note_interval *interval)
+{
+	if (solver->unsolved_count > 0) {
+		struct voice_solver_span *last = &solver->unsolved[solver->unsolved_count - 1];
+		if (last->end_ms > interval->start_ms) {
+			if (interval->end_ms > last->end_ms) {
+				last->end_ms = interval->end_ms;
+			}
+			last->note_count++;
+			return true;
+		}
+	}
+
+	if (!reserve((void **)&solver->unsolved,
+		     &solver->unsolved_capacity,
+		     solver->unsolved_count + 1,
+		     sizeof(struct voice_solver_span))) {
+		return false;
+	}
+
+	solver->unsolved[solver->unsolved_count++] =
+		(struct voice_solver_span){interval->start_ms, interval->end_ms, 1};
+	return true;
+}
+
+static bool add_change(struct voice_solver *solver, uint32_t id, int old_voice, int voice)
+{
+	if (!reserve((void **)&solver->changes,
+		     &solver->change_capacity,
+		     solver->change_count + 1,
+		     sizeof(struct voice_solver_change))) {
+		return false;
+	}
+
+	solver->changes[solver->change_count++] =
+		(struct voice_solver_change){id, (uint8_t)old_voice, (uint8_t)voice};
+	return true;
+}
+
+void voice_solver_init(struct voice_solver *solver)
+{
+	memset(solver, 0, sizeof(struct voice_solver));
+}
+
+void voice_solver_free(struct voice_solver *solver)
+{
+	free(solver->slots);
+	free(solver->changes);
+	free(solver->unsolved);
+	memset(solver, 0, sizeof(struct voice_solver));
+}
+
+void voice_solver_options_init(struct voice_solver_options *options)
+{
+	memset(options, 0, sizeof(struct voice_solver_options));
+	options->voice_mask = NOTE_INDEX_ALL_VOICES;
+	memset(options->waveform_voices, NOTE_INDEX_ALL_VOICES, sizeof(options->waveform_voices));
+}
+
+bool voice_solver_run(
+	struct voice_solver *solver,
+	struct note_store *store,
+	const struct voice_solver_options *options
+)
+{
+	solver->change_count = 0;
+	solver->unsolved_count = 0;
+	solver->voices_used = 0;
+
+	const struct note_index *index = note_store_intervals(store);
+	if (index == NULL) {
+		return false;
+	}
+
+	uint32_t total = 0;
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		total += index->voices[i].count;
+	}
+	if (!reserve((void **)&solver->slots,
+		     &solver->slot_capacity,
+		     total,
+		     sizeof(struct voice_solver_slot))) {
+		return false;
+	}
+
+	struct voice_sweep sweep;
+	memset(&sweep, 0, sizeof(sweep));
+	sweep.index = index;
+
+	struct voice_solver_slot *slots = solver->slots;
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		const struct voice_intervals *bucket = &index->voices[i];
+		for (uint32_t j = 0; j < bucket->count; j++) {
+			classify(&slots[j], options, &bucket->entries[j]);
+			if (slots[j].locked) {
+				sweep.used |= (uint8_t)(1u << i);
+			}
+		}
+		sweep.slots[i] = slots;
+		slots += bucket->count;
+	}
+
+	int voice;
+	while ((voice = next_interval(&sweep)) >= 0) {
+		uint32_t position = sweep.heads[voice]++;
+		const struct note_interval *interval = &index->voices[voice].entries[position];
+		const struct voice_solver_slot *slot = &sweep.slots[voice][position];
+
+		int target = voice;
+		if (slot->locked) {
+			if (sweep.busy_until[voice] > interval->start_ms &&
+			    !add_unsolved(solver, interval)) {
+				return false;
+			}
+		} else {
+			target = pick_voice(&sweep, interval, slot->allowed, voice);
+			if (target < 0) {
+				target = voice;
+				if (!add_unsolved(solver, interval)) {
+					return false;
+				}
+			}
+		}
+
+		if (target != voice && !add_change(solver, interval->id, voice, target)) {
+			return false;
+		}
+
+		if (interval->end_ms > sweep.busy_until[target]) {
+			sweep.busy_until[target] = interval->end_ms;
+		}
+		sweep.used |= (uint8_t)(1u << target);
+	}
+
+	for (int i = 0; i < NOTE_INDEX_VOICES; i++) {
+		if (sweep.used & (1u << i)) {
+			solver->voices_used++;
+		}
+	}
+
+	return true;
+}
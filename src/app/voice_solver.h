@@ -0,0 +1,54 @@
+#ifndef BOOSTIO_VOICE_SOLVER_H
+#define BOOSTIO_VOICE_SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "note_store.h"
+
+#define VOICE_SOLVER_WAVEFORMS 5
+
+struct voice_solver_options {
+	uint8_t voice_mask;
+	uint8_t waveform_voices[VOICE_SOLVER_WAVEFORMS];
+	const struct id_map *movable;
+	const struct id_map *locked;
+};
+
+struct voice_solver_change {
+	uint32_t id;
+	uint8_t old_voice;
+	uint8_t new_voice;
+};
+
+struct voice_solver_span {
+	uint32_t start_ms;
+	uint32_t end_ms;
+	uint32_t note_count;
+};
+
+struct voice_solver_slot;
+
+struct voice_solver {
+	struct voice_solver_slot *slots;
+	uint32_t slot_capacity;
+	struct voice_solver_change *changes;
+	uint32_t change_count;
+	uint32_t change_capacity;
+	struct voice_solver_span *unsolved;
+	uint32_t unsolved_count;
+	uint32_t unsolved_capacity;
+	uint8_t voices_used;
+};
+
+void voice_solver_init(struct voice_solver *solver);
+void voice_solver_free(struct voice_solver *solver);
+void voice_solver_options_init(struct voice_solver_options *options);
+
+bool voice_solver_run(
+	struct voice_solver *solver,
+	struct note_store *store,
+	const struct voice_solver_options *options
+);
+
+#endif
@@ -125,6 +125,7 @@ void audio_destroy(struct audio *audio)
 		SDL_CloseAudioDevice(audio->device_id);
 	}
 
+	sequencer_free(&audio->sequencer);
 	free(audio);
 }
 
@@ -166,6 +167,24 @@ void audio_update(struct audio *audio, const bool *voice_solo, const bool *voice
 	}
 }
 
+void audio_lock(struct audio *audio)
+{
+	if (!audio || !audio->stream) {
+		return;
+	}
+
+	SDL_LockAudioStream(audio->stream);
+}
+
+void audio_unlock(struct audio *audio)
+{
+	if (!audio || !audio->stream) {
+		return;
+	}
+
+	SDL_UnlockAudioStream(audio->stream);
+}
+
 struct synth *audio_get_synth(struct audio *audio)
 {
 	if (!audio) {
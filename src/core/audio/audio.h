@@ -18,6 +18,9 @@ void audio_stop(struct audio *audio);
 
 void audio_update(struct audio *audio, const bool *voice_solo, const bool *voice_muted);
 
+void audio_lock(struct audio *audio);
+void audio_unlock(struct audio *audio);
+
 struct synth *audio_get_synth(struct audio *audio);
 struct sequencer *audio_get_sequencer(struct audio *audio);
 
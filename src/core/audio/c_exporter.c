@@ -161,6 +161,47 @@ static const char *get_duty_cycle_macro(uint8_t duty)
 	}
 }
 
+static int16_t export_decay(const struct note_params *params)
+{
+	int16_t scaled_decay = params->decay;
+	if (params->waveform == WAVEFORM_NES_NOISE && params->decay != 0) {
+		scaled_decay = (int16_t)(params->decay / 1000);
+		if (scaled_decay == 0 && params->decay != 0) {
+			scaled_decay = params->decay > 0 ? 1 : -1;
+		}
+	}
+	return scaled_decay;
+}
+
+static int8_t export_amplitude(const struct note_params *params)
+{
+	int8_t amplitude = params->amplitude_dbfs;
+	if (params->waveform == WAVEFORM_NES_NOISE) {
+		amplitude = -42;
+	}
+	return amplitude > 0 ? 0 : amplitude;
+}
+
+static void write_frequency(FILE *file, float frequency)
+{
+	const char *note_macro = get_note_macro(frequency);
+	if (note_macro) {
+		fputs(note_macro, file);
+	} else {
+		fprintf(file, "%d", (int)frequency);
+	}
+}
+
+static void write_duty_cycle(FILE *file, uint8_t duty)
+{
+	const char *duty_macro = get_duty_cycle_macro(duty);
+	if (duty_macro) {
+		fputs(duty_macro, file);
+	} else {
+		fprintf(file, "%u", duty);
+	}
+}
+
 static uint32_t calculate_song_length_ms(const struct sequencer *sequencer)
 {
 	uint32_t max_end_time = 0;
@@ -250,24 +291,11 @@ bool c_exporter_export_to_file(const struct sequencer *sequencer, const char *fi
 
 		fprintf(file, "\t\t\t.duration_ms = %d,\n", (int)params->duration_ms);
 
-		int16_t scaled_decay = params->decay;
-		if (params->waveform == WAVEFORM_NES_NOISE && params->decay != 0) {
-			scaled_decay = (int16_t)(params->decay / 1000);
-			if (scaled_decay == 0 && params->decay != 0) {
-				scaled_decay = params->decay > 0 ? 1 : -1;
-			}
-		}
-		fprintf(file, "\t\t\t.decay = %d,\n", scaled_decay);
+		fprintf(file, "\t\t\t.decay = %d,\n", export_decay(params));
 
 		fprintf(file, "\t\t\t.phase = 0,\n");
 
-		int8_t amplitude = params->amplitude_dbfs;
-		if (params->waveform == WAVEFORM_NES_NOISE) {
-			amplitude = -42;
-		}
-		amplitude = amplitude > 0 ? 0 : amplitude;
-
-		fprintf(file, "\t\t\t.amplitude_dBFS = %d,\n", amplitude);
+		fprintf(file, "\t\t\t.amplitude_dBFS = %d,\n", export_amplitude(params));
 		fprintf(file, "\t\t\t.restart = %s,\n", params->restart_phase ? "true" : "false");
 		fprintf(file, "\t\t\t.type = %s,\n", waveform_to_audio_out_type(params->waveform));
 
@@ -318,3 +346,320 @@ bool c_exporter_export_to_file(const struct sequencer *sequencer, const char *fi
 	printf("Exported %u notes to C file: %s\n", sequencer->note_count, filepath);
 	return true;
 }
+
+struct compact_spec {
+	float frequency;
+	int32_t duration_ms;
+	int16_t decay;
+	int8_t amplitude_dbfs;
+	uint8_t waveform;
+	uint8_t duty_cycle;
+	uint8_t flags;
+	uint16_t nes_noise_lfsr;
+};
+
+struct compact_event {
+	uint32_t time_ms;
+	uint32_t spec_index;
+	uint8_t voice;
+};
+
+struct spec_table {
+	struct compact_spec *specs;
+	uint32_t count;
+	uint32_t *slots;
+	uint32_t slot_mask;
+};
+
+static void make_compact_spec(const struct note_params *params, struct compact_spec *spec)
+{
+	memset(spec, 0, sizeof(*spec));
+
+	const char *note_macro = get_note_macro(params->frequency);
+	spec->frequency = note_macro ? (float)(int)(params->frequency + 0.5f)
+				     : (float)(int)params->frequency;
+	spec->duration_ms = (int32_t)params->duration_ms;
+	spec->decay = export_decay(params);
+	spec->amplitude_dbfs = export_amplitude(params);
+	spec->waveform = (uint8_t)params->waveform;
+	spec->flags = params->restart_phase ? 0x01 : 0;
+
+	if (params->waveform == WAVEFORM_SQUARE) {
+		spec->duty_cycle = params->duty_cycle;
+	} else if (params->waveform == WAVEFORM_NES_NOISE) {
+		spec->nes_noise_lfsr = params->nes_noise_lfsr_init;
+		spec->flags |= params->nes_noise_mode_flag ? 0x02 : 0;
+	}
+}
+
+static uint32_t hash_compact_spec(const struct compact_spec *spec)
+{
+	const uint8_t *bytes = (const uint8_t *)spec;
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(*spec); i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t spec_table_intern(struct spec_table *table, const struct compact_spec *spec)
+{
+	uint32_t slot = hash_compact_spec(spec) & table->slot_mask;
+
+	while (table->slots[slot] != UINT32_MAX) {
+		uint32_t index = table->slots[slot];
+		if (memcmp(&table->specs[index], spec, sizeof(*spec)) == 0) {
+			return index;
+		}
+		slot = (slot + 1) & table->slot_mask;
+	}
+
+	table->specs[table->count] = *spec;
+	table->slots[slot] = table->count;
+	return table->count++;
+}
+
+static int compare_compact_events(const void *a, const void *b)
+{
+	const struct compact_event *event_a = a;
+	const struct compact_event *event_b = b;
+
+	if (event_a->time_ms != event_b->time_ms) {
+		return event_a->time_ms < event_b->time_ms ? -1 : 1;
+	}
+	if (event_a->voice != event_b->voice) {
+		return event_a->voice < event_b->voice ? -1 : 1;
+	}
+	if (event_a->spec_index != event_b->spec_index) {
+		return event_a->spec_index < event_b->spec_index ? -1 : 1;
+	}
+	return 0;
+}
+
+static void write_compact_decoder(FILE *file)
+{
+	fputs("#ifndef BOOSTIO_COMPACT_SONG\n"
+	      "#define BOOSTIO_COMPACT_SONG\n\n"
+	      "#define BOOSTIO_SPEC_RESTART 0x01\n"
+	      "#define BOOSTIO_SPEC_NOISE_MODE 0x02\n\n"
+	      "struct boostio_spec {\n"
+	      "\tuint16_t frequency_hz;\n"
+	      "\tuint16_t duration_ms;\n"
+	      "\tint16_t decay;\n"
+	      "\tuint16_t param;\n"
+	      "\tint8_t amplitude_dBFS;\n"
+	      "\tuint8_t type;\n"
+	      "\tuint8_t flags;\n"
+	      "};\n\n"
+	      "struct boostio_event {\n"
+	      "\tuint16_t delta_ms;\n"
+	      "\tuint16_t spec;\n"
+	      "\tuint8_t v;\n"
+	      "};\n\n"
+	      "struct boostio_song {\n"
+	      "\tconst struct boostio_spec *specs;\n"
+	      "\tconst struct boostio_event *events;\n"
+	      "\tuint32_t length;\n"
+	      "\tuint32_t length_ms;\n"
+	      "};\n\n"
+	      "// Decode events in order; *ms carries the running time between calls.\n"
+	      "static inline void boostio_song_decode(const struct boostio_song *song, uint32_t index,\n"
+	      "\t\t\t\t       uint32_t *ms, struct audio_out_note *note)\n"
+	      "{\n"
+	      "\tconst struct boostio_event *event = &song->events[index];\n"
+	      "\tconst struct boostio_spec *spec = &song->specs[event->spec];\n\n"
+	      "\t*ms += event->delta_ms;\n"
+	      "\t*note = (struct audio_out_note){\n"
+	      "\t\t.v = event->v,\n"
+	      "\t\t.ms = *ms,\n"
+	      "\t\t.spec = {\n"
+	      "\t\t\t.frequency_hz = spec->frequency_hz,\n"
+	      "\t\t\t.duration_ms = spec->duration_ms,\n"
+	      "\t\t\t.decay = spec->decay,\n"
+	      "\t\t\t.amplitude_dBFS = spec->amplitude_dBFS,\n"
+	      "\t\t\t.restart = (spec->flags & BOOSTIO_SPEC_RESTART) != 0,\n"
+	      "\t\t\t.type = spec->type,\n"
+	      "\t\t}\n"
+	      "\t};\n\n"
+	      "\tif (spec->type == AUDIO_OUT_TYPE_SQUARE) {\n"
+	      "\t\tnote->spec.square.duty_cycle = (uint8_t)spec->param;\n"
+	      "\t} else if (spec->type == AUDIO_OUT_TYPE_NES_NOISE) {\n"
+	      "\t\tnote->spec.nes_noise.lfsr_val = spec->param;\n"
+	      "\t\tnote->spec.nes_noise.mode_flag = (spec->flags & BOOSTIO_SPEC_NOISE_MODE) != 0;\n"
+	      "\t}\n"
+	      "}\n\n"
+	      "#endif\n\n",
+	      file);
+}
+
+static void write_compact_spec(FILE *file, const struct compact_spec *spec)
+{
+	fputs("\t{", file);
+	write_frequency(file, spec->frequency);
+	fprintf(file, ", %d, %d, ", spec->duration_ms, spec->decay);
+
+	if (spec->waveform == WAVEFORM_SQUARE) {
+		write_duty_cycle(file, spec->duty_cycle);
+	} else if (spec->waveform == WAVEFORM_NES_NOISE) {
+		fprintf(file, "0x%04X", spec->nes_noise_lfsr);
+	} else {
+		fputc('0', file);
+	}
+
+	fprintf(file,
+		", %d, %s, %u},\n",
+		spec->amplitude_dbfs,
+		waveform_to_audio_out_type((enum waveform_type)spec->waveform),
+		spec->flags);
+}
+
+bool c_exporter_export_compact_to_file(const struct sequencer *sequencer, const char *filepath)
+{
+	if (!sequencer || !filepath) {
+		fprintf(stderr, "Invalid parameters for C export\n");
+		return false;
+	}
+
+	uint32_t note_count = sequencer->note_count;
+	uint32_t slot_count = 16;
+	while (slot_count < note_count * 2) {
+		slot_count <<= 1;
+	}
+
+	struct spec_table table = {
+		.specs = malloc(sizeof(struct compact_spec) * (note_count > 0 ? note_count : 1)),
+		.slots = malloc(sizeof(uint32_t) * slot_count),
+		.slot_mask = slot_count - 1,
+	};
+	struct compact_event *events =
+		malloc(sizeof(struct compact_event) * (note_count > 0 ? note_count : 1));
+
+	if (!table.specs || !table.slots || !events) {
+		fprintf(stderr, "Failed to allocate compact C export tables\n");
+		free(table.specs);
+		free(table.slots);
+		free(events);
+		return false;
+	}
+
+	memset(table.slots, 0xFF, sizeof(uint32_t) * slot_count);
+
+	bool fits = true;
+	for (uint32_t i = 0; i < note_count; i++) {
+		const struct note *note = &sequencer->notes[i];
+		struct compact_spec spec;
+		make_compact_spec(&note->params, &spec);
+
+		if (spec.duration_ms < 0 || spec.duration_ms > UINT16_MAX) {
+			fits = false;
+		}
+
+		events[i] = (struct compact_event){
+			.time_ms = note->time_ms,
+			.spec_index = spec_table_intern(&table, &spec),
+			.voice = (uint8_t)note->params.voice_index,
+		};
+	}
+
+	qsort(events, note_count, sizeof(struct compact_event), compare_compact_events);
+
+	for (uint32_t i = 1; i < note_count; i++) {
+		if (events[i].time_ms - events[i - 1].time_ms > UINT16_MAX) {
+			fits = false;
+		}
+	}
+	if (note_count > 0 && events[0].time_ms > UINT16_MAX) {
+		fits = false;
+	}
+
+	if (!fits || table.count > UINT16_MAX) {
+		fprintf(stderr,
+			"Song does not fit the compact C format (gaps and durations must be under "
+			"%ums): %s\n",
+			UINT16_MAX,
+			filepath);
+		free(table.specs);
+		free(table.slots);
+		free(events);
+		return false;
+	}
+
+	char section_name[128];
+	extract_section_name(filepath, section_name, sizeof(section_name));
+
+	FILE *file = fopen(filepath, "w");
+	if (!file) {
+		fprintf(stderr, "Failed to open file for C export: %s\n", filepath);
+		free(table.specs);
+		free(table.slots);
+		free(events);
+		return false;
+	}
+
+	uint32_t length_ms = calculate_song_length_ms(sequencer);
+
+	fprintf(file, "// Auto-generated by boostio (compact format)\n");
+	fprintf(file, "// Total notes: %u\n", note_count);
+	fprintf(file, "// Unique specs: %u\n", table.count);
+	fprintf(file, "// Duration: %ums\n\n", length_ms);
+
+	fprintf(file, "#include \"music.h\"\n");
+	fprintf(file, "#include \"audio.h\"\n\n");
+
+	write_compact_decoder(file);
+
+	fprintf(file, "static const struct boostio_spec %s_SPECS[] = {\n", section_name);
+	for (uint32_t i = 0; i < table.count; i++) {
+		write_compact_spec(file, &table.specs[i]);
+	}
+	if (table.count == 0) {
+		fprintf(file, "\t{0},\n");
+	}
+	fprintf(file, "};\n\n");
+
+	fprintf(file, "static const struct boostio_event %s_EVENTS[] = {", section_name);
+	uint32_t previous_ms = 0;
+	for (uint32_t i = 0; i < note_count; i++) {
+		fputs(i % 8 == 0 ? "\n\t" : " ", file);
+		fprintf(file,
+			"{%u, %u, %u},",
+			events[i].time_ms - previous_ms,
+			events[i].spec_index,
+			events[i].voice);
+		previous_ms = events[i].time_ms;
+	}
+	if (note_count == 0) {
+		fprintf(file, "\n\t{0},");
+	}
+	fprintf(file, "\n};\n\n");
+
+	fprintf(file, "static const struct boostio_song %s = {\n", section_name);
+	fprintf(file, "\t.specs = %s_SPECS,\n", section_name);
+	fprintf(file, "\t.events = %s_EVENTS,\n", section_name);
+	fprintf(file, "\t.length = %u,\n", note_count);
+	fprintf(file, "\t.length_ms = %u,\n", length_ms);
+	fprintf(file, "};\n");
+
+	bool success = !ferror(file);
+	if (fclose(file) != 0) {
+		success = false;
+	}
+
+	free(table.specs);
+	free(table.slots);
+	free(events);
+
+	if (!success) {
+		fprintf(stderr, "Failed to write compact C file: %s\n", filepath);
+		return false;
+	}
+
+	printf("Exported %u notes (%u unique specs) to compact C file: %s\n",
+	       note_count,
+	       table.count,
+	       filepath);
+	return true;
+}
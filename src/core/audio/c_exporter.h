@@ -8,4 +8,6 @@ struct sequencer;
 
 bool c_exporter_export_to_file(const struct sequencer *sequencer, const char *filepath);
 
+bool c_exporter_export_compact_to_file(const struct sequencer *sequencer, const char *filepath);
+
 #endif
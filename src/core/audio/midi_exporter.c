@@ -0,0 +1,365 @@
+#include "midi_exporter.h"
+#include "app_state.h"
+#include "midi_importer.h"
+#include "synth.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIDI_EXPORTER_BUFFER_SIZE (64 * 1024)
+#define MIDI_EXPORTER_REFERENCE_DBFS (-6)
+
+struct midi_event {
+	uint32_t tick;
+	uint32_t note_index;
+	uint8_t voice;
+	uint8_t is_note_on;
+};
+
+struct midi_writer {
+	FILE *file;
+	uint32_t track_length;
+	uint32_t last_tick;
+	uint8_t running_status;
+	bool failed;
+};
+
+static const char *waveform_name(enum waveform_type waveform)
+{
+	switch (waveform) {
+	case WAVEFORM_SINE:
+		return "sine";
+	case WAVEFORM_SQUARE:
+		return "square";
+	case WAVEFORM_TRIANGLE:
+		return "triangle";
+	case WAVEFORM_SAWTOOTH:
+		return "sawtooth";
+	case WAVEFORM_NES_NOISE:
+		return "nes_noise";
+	default:
+		return "sine";
+	}
+}
+
+static uint8_t waveform_program(enum waveform_type waveform)
+{
+	switch (waveform) {
+	case WAVEFORM_SQUARE:
+		return 80;
+	case WAVEFORM_SAWTOOTH:
+		return 48;
+	case WAVEFORM_TRIANGLE:
+		return 33;
+	case WAVEFORM_SINE:
+	default:
+		return 79;
+	}
+}
+
+static uint8_t note_channel(const struct ui_note *note)
+{
+	if (note->waveform == WAVEFORM_NES_NOISE) {
+		return MIDI_IMPORTER_DRUM_CHANNEL;
+	}
+
+	uint8_t channel = note->voice % 15;
+	return channel >= MIDI_IMPORTER_DRUM_CHANNEL ? channel + 1 : channel;
+}
+
+static void write_bytes(struct midi_writer *writer, const void *data, size_t size)
+{
+	if (fwrite(data, 1, size, writer->file) != size) {
+		writer->failed = true;
+	}
+	writer->track_length += (uint32_t)size;
+}
+
+static void write_byte(struct midi_writer *writer, uint8_t value)
+{
+	if (putc(value, writer->file) == EOF) {
+		writer->failed = true;
+	}
+	writer->track_length++;
+}
+
+static void write_u32_be(struct midi_writer *writer, uint32_t value)
+{
+	uint8_t bytes[4] = {
+		(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value
+	};
+	write_bytes(writer, bytes, sizeof(bytes));
+}
+
+static void write_variable_length(struct midi_writer *writer, uint32_t value)
+{
+	uint8_t bytes[5];
+	int count = 0;
+
+	bytes[4 - count++] = value & 0x7F;
+	value >>= 7;
+	while (value > 0 && count < 5) {
+		bytes[4 - count++] = (uint8_t)((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	write_bytes(writer, bytes + 5 - count, (size_t)count);
+}
+
+static void write_delta(struct midi_writer *writer, uint32_t tick)
+{
+	write_variable_length(writer, tick - writer->last_tick);
+	writer->last_tick = tick;
+}
+
+static void write_meta(
+	struct midi_writer *writer, uint32_t tick, uint8_t type, const void *data, uint32_t length
+)
+{
+	write_delta(writer, tick);
+	write_byte(writer, 0xFF);
+	write_byte(writer, type);
+	write_variable_length(writer, length);
+	write_bytes(writer, data, length);
+	writer->running_status = 0;
+}
+
+static void write_channel_event(
+	struct midi_writer *writer, uint32_t tick, uint8_t status, uint8_t data1, int data2
+)
+{
+	write_delta(writer, tick);
+	if (status != writer->running_status) {
+		write_byte(writer, status);
+		writer->running_status = status;
+	}
+	write_byte(writer, data1);
+	if (data2 >= 0) {
+		write_byte(writer, (uint8_t)data2);
+	}
+}
+
+static long begin_track(struct midi_writer *writer)
+{
+	fwrite("MTrk\0\0\0\0", 1, 8, writer->file);
+	long length_offset = ftell(writer->file) - 4;
+
+	writer->track_length = 0;
+	writer->last_tick = 0;
+	writer->running_status = 0;
+	return length_offset;
+}
+
+static void end_track(struct midi_writer *writer, long length_offset)
+{
+	write_meta(writer, writer->last_tick, 0x2F, NULL, 0);
+
+	long end_offset = ftell(writer->file);
+	uint32_t length = writer->track_length;
+	uint8_t bytes[4] = {
+		(uint8_t)(length >> 24), (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length
+	};
+
+	if (length_offset < 0 || fseek(writer->file, length_offset, SEEK_SET) != 0 ||
+	    fwrite(bytes, 1, 4, writer->file) != 4 || fseek(writer->file, end_offset, SEEK_SET) != 0) {
+		writer->failed = true;
+	}
+}
+
+static uint32_t ms_to_ticks(uint32_t ms, uint32_t bpm)
+{
+	return (uint32_t)(((uint64_t)ms * bpm * MIDI_EXPORTER_TICKS_PER_QUARTER + 30000) / 60000);
+}
+
+static uint8_t note_velocity(const struct ui_note *note)
+{
+	double velocity =
+		127.0 * pow(10.0, (note->amplitude_dbfs - MIDI_EXPORTER_REFERENCE_DBFS) / 20.0);
+	long rounded = lround(velocity);
+	if (rounded < 1) {
+		return 1;
+	}
+	return rounded > 127 ? 127 : (uint8_t)rounded;
+}
+
+static int compare_events(const void *a, const void *b)
+{
+	const struct midi_event *event_a = a;
+	const struct midi_event *event_b = b;
+	if (event_a->voice != event_b->voice) {
+		return event_a->voice < event_b->voice ? -1 : 1;
+	}
+	if (event_a->tick != event_b->tick) {
+		return event_a->tick < event_b->tick ? -1 : 1;
+	}
+	if (event_a->is_note_on != event_b->is_note_on) {
+		return event_a->is_note_on < event_b->is_note_on ? -1 : 1;
+	}
+	return event_a->note_index < event_b->note_index ? -1 : 1;
+}
+
+static void write_tempo_track(struct midi_writer *writer, const struct app_state *state)
+{
+	long length_offset = begin_track(writer);
+
+	const char *name = "boostio";
+	write_meta(writer, 0, 0x03, name, (uint32_t)strlen(name));
+
+	uint8_t time_signature[4] = {4, 2, 24, 8};
+	write_meta(writer, 0, 0x58, time_signature, sizeof(time_signature));
+
+	uint32_t bpm = state->bpm > 0 ? state->bpm : 120;
+	uint32_t tempo = 60000000u / bpm;
+	uint8_t tempo_bytes[3] = {(uint8_t)(tempo >> 16), (uint8_t)(tempo >> 8), (uint8_t)tempo};
+	write_meta(writer, 0, 0x51, tempo_bytes, sizeof(tempo_bytes));
+
+	end_track(writer, length_offset);
+}
+
+static void write_voice_track(
+	struct midi_writer *writer,
+	const struct app_state *state,
+	const struct midi_event *events,
+	uint32_t event_count
+)
+{
+	uint8_t voice = events[0].voice;
+	long length_offset = begin_track(writer);
+
+	char text[96];
+	int length = snprintf(text, sizeof(text), "Voice %u", voice);
+	write_meta(writer, 0, 0x03, text, (uint32_t)length);
+
+	int current_waveform = -1;
+	uint8_t current_duty = 0;
+
+	for (uint32_t i = 0; i < event_count; i++) {
+		const struct midi_event *event = &events[i];
+		const struct ui_note *note = note_store_at(&state->notes, event->note_index);
+		uint8_t channel = note_channel(note);
+
+		if (!event->is_note_on) {
+			write_channel_event(writer, event->tick, 0x90 | channel, note->piano_key & 0x7F, 0);
+			continue;
+		}
+
+		if ((int)note->waveform != current_waveform || note->duty_cycle != current_duty) {
+			current_waveform = (int)note->waveform;
+			current_duty = note->duty_cycle;
+
+			length = snprintf(
+				text,
+				sizeof(text),
+				"waveform=%s duty=%u decay=%d",
+				waveform_name(note->waveform),
+				note->duty_cycle,
+				note->decay
+			);
+			write_meta(writer, event->tick, 0x01, text, (uint32_t)length);
+			if (channel != MIDI_IMPORTER_DRUM_CHANNEL) {
+				write_channel_event(
+					writer,
+					event->tick,
+					0xC0 | channel,
+					waveform_program(note->waveform),
+					-1
+				);
+			}
+		}
+
+		write_channel_event(
+			writer, event->tick, 0x90 | channel, note->piano_key & 0x7F, note_velocity(note)
+		);
+	}
+
+	end_track(writer, length_offset);
+}
+
+bool midi_exporter_export_to_file(const struct app_state *state, const char *filepath)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for MIDI export\n");
+		return false;
+	}
+
+	uint32_t bpm = state->bpm > 0 ? state->bpm : 120;
+	uint32_t note_count = note_store_count(&state->notes);
+	uint32_t event_count = note_count * 2;
+	struct midi_event *events =
+		malloc(sizeof(struct midi_event) * (event_count > 0 ? event_count : 1));
+	if (!events) {
+		fprintf(stderr, "Failed to allocate MIDI events\n");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < note_count; i++) {
+		const struct ui_note *note = note_store_at(&state->notes, i);
+		uint32_t start_tick = ms_to_ticks(note->ms, bpm);
+		uint32_t end_tick = ms_to_ticks(note->ms + note->duration_ms, bpm);
+		if (end_tick <= start_tick) {
+			end_tick = start_tick + 1;
+		}
+
+		events[i * 2] = (struct midi_event){start_tick, i, note->voice, 1};
+		events[i * 2 + 1] = (struct midi_event){end_tick, i, note->voice, 0};
+	}
+
+	qsort(events, event_count, sizeof(struct midi_event), compare_events);
+
+	uint16_t voice_track_count = 0;
+	for (uint32_t i = 0; i < event_count; i++) {
+		if (i == 0 || events[i].voice != events[i - 1].voice) {
+			voice_track_count++;
+		}
+	}
+
+	FILE *file = fopen(filepath, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open file for writing: %s\n", filepath);
+		free(events);
+		return false;
+	}
+
+	setvbuf(file, NULL, _IOFBF, MIDI_EXPORTER_BUFFER_SIZE);
+
+	struct midi_writer writer = {.file = file};
+
+	write_bytes(&writer, "MThd", 4);
+	write_u32_be(&writer, 6);
+	uint8_t header[6] = {
+		0,
+		1,
+		(uint8_t)((voice_track_count + 1) >> 8),
+		(uint8_t)(voice_track_count + 1),
+		(uint8_t)(MIDI_EXPORTER_TICKS_PER_QUARTER >> 8),
+		(uint8_t)(MIDI_EXPORTER_TICKS_PER_QUARTER & 0xFF)
+	};
+	write_bytes(&writer, header, sizeof(header));
+
+	write_tempo_track(&writer, state);
+
+	uint32_t track_start = 0;
+	for (uint32_t i = 1; i <= event_count; i++) {
+		if (i == event_count || events[i].voice != events[track_start].voice) {
+			write_voice_track(&writer, state, events + track_start, i - track_start);
+			track_start = i;
+		}
+	}
+
+	free(events);
+
+	bool success = !writer.failed && !ferror(file);
+	if (fclose(file) != 0) {
+		success = false;
+	}
+
+	if (!success) {
+		fprintf(stderr, "Failed to write complete MIDI file: %s\n", filepath);
+		return false;
+	}
+
+	printf("Exported %u notes in %u tracks to %s\n", note_count, voice_track_count, filepath);
+	return true;
+}
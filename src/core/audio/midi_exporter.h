@@ -0,0 +1,13 @@
+#ifndef MIDI_EXPORTER_H
+#define MIDI_EXPORTER_H
+
+#include <stdbool.h>
+
+struct app_state;
+
+#define MIDI_EXPORTER_EXTENSION ".mid"
+#define MIDI_EXPORTER_TICKS_PER_QUARTER 480
+
+bool midi_exporter_export_to_file(const struct app_state *state, const char *filepath);
+
+#endif
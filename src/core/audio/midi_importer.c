@@ -0,0 +1,680 @@
+#include "midi_importer.h"
+#include "app_state.h"
+#include "audio.h"
+#include "platform.h"
+#include "sequencer.h"
+#include "synth.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIDI_DEFAULT_TEMPO_US 500000
+#define MIDI_CHANNEL_COUNT 16
+#define MIDI_MIN_DURATION_MS 10
+#define MIDI_MAX_DURATION_MS 65535
+
+struct midi_raw_note {
+	uint32_t start_tick;
+	uint32_t end_tick;
+	uint8_t channel;
+	uint8_t key;
+	uint8_t velocity;
+	uint8_t program;
+};
+
+struct midi_tempo {
+	uint32_t tick;
+	uint32_t us_per_quarter;
+	double start_ms;
+};
+
+struct midi_import {
+	const char *filepath;
+	uint16_t division;
+	struct midi_raw_note *notes;
+	uint32_t note_count;
+	uint32_t note_capacity;
+	struct midi_tempo *tempos;
+	uint32_t tempo_count;
+	uint32_t tempo_capacity;
+	uint32_t *track_starts;
+	uint32_t track_count;
+};
+
+struct midi_track_reader {
+	const uint8_t *cursor;
+	const uint8_t *end;
+	uint32_t tick;
+	uint8_t running_status;
+	int32_t open_notes[MIDI_CHANNEL_COUNT][128];
+	uint8_t programs[MIDI_CHANNEL_COUNT];
+};
+
+static uint32_t get_u32_be(const uint8_t *data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) |
+	       (uint32_t)data[3];
+}
+
+static uint16_t get_u16_be(const uint8_t *data)
+{
+	return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static bool read_variable_length(struct midi_track_reader *reader, uint32_t *value)
+{
+	uint32_t result = 0;
+	for (int i = 0; i < 4; i++) {
+		if (reader->cursor >= reader->end) {
+			return false;
+		}
+		uint8_t byte = *reader->cursor++;
+		result = (result << 7) | (byte & 0x7F);
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool push_tempo(struct midi_import *import, uint32_t tick, uint32_t us_per_quarter)
+{
+	if (import->tempo_count >= import->tempo_capacity) {
+		uint32_t capacity = import->tempo_capacity > 0 ? import->tempo_capacity * 2 : 16;
+		struct midi_tempo *tempos = realloc(import->tempos, sizeof(struct midi_tempo) * capacity);
+		if (tempos == NULL) {
+			return false;
+		}
+		import->tempos = tempos;
+		import->tempo_capacity = capacity;
+	}
+
+	import->tempos[import->tempo_count++] = (struct midi_tempo){
+		.tick = tick,
+		.us_per_quarter = us_per_quarter,
+		.start_ms = 0.0,
+	};
+	return true;
+}
+
+static bool open_note(
+	struct midi_import *import,
+	struct midi_track_reader *reader,
+	uint8_t channel,
+	uint8_t key,
+	uint8_t velocity
+)
+{
+	if (import->note_count >= import->note_capacity) {
+		uint32_t capacity = import->note_capacity > 0 ? import->note_capacity * 2 : 1024;
+		struct midi_raw_note *notes =
+			realloc(import->notes, sizeof(struct midi_raw_note) * capacity);
+		if (notes == NULL) {
+			return false;
+		}
+		import->notes = notes;
+		import->note_capacity = capacity;
+	}
+
+	reader->open_notes[channel][key] = (int32_t)import->note_count;
+	import->notes[import->note_count++] = (struct midi_raw_note){
+		.start_tick = reader->tick,
+		.end_tick = reader->tick,
+		.channel = channel,
+		.key = key,
+		.velocity = velocity,
+		.program = reader->programs[channel],
+	};
+	return true;
+}
+
+static void close_note(
+	struct midi_import *import, struct midi_track_reader *reader, uint8_t channel, uint8_t key
+)
+{
+	int32_t index = reader->open_notes[channel][key];
+	if (index < 0) {
+		return;
+	}
+
+	import->notes[index].end_tick = reader->tick;
+	reader->open_notes[channel][key] = -1;
+}
+
+static void close_all_notes(struct midi_import *import, struct midi_track_reader *reader)
+{
+	for (int channel = 0; channel < MIDI_CHANNEL_COUNT; channel++) {
+		for (int key = 0; key < 128; key++) {
+			close_note(import, reader, (uint8_t)channel, (uint8_t)key);
+		}
+	}
+}
+
+static bool read_track(struct midi_import *import, const uint8_t *data, uint32_t size)
+{
+	struct midi_track_reader reader;
+	reader.cursor = data;
+	reader.end = data + size;
+	reader.tick = 0;
+	reader.running_status = 0;
+	memset(reader.open_notes, 0xFF, sizeof(reader.open_notes));
+	memset(reader.programs, 0, sizeof(reader.programs));
+
+	while (reader.cursor < reader.end) {
+		uint32_t delta;
+		if (!read_variable_length(&reader, &delta)) {
+			fprintf(stderr, "MIDI parse error in %s: bad delta time\n", import->filepath);
+			return false;
+		}
+		reader.tick += delta;
+
+		if (reader.cursor >= reader.end) {
+			break;
+		}
+
+		uint8_t status = *reader.cursor;
+		if (status & 0x80) {
+			reader.cursor++;
+		} else if (reader.running_status != 0) {
+			status = reader.running_status;
+		} else {
+			fprintf(stderr, "MIDI parse error in %s: data byte without status\n", import->filepath);
+			return false;
+		}
+
+		if (status == 0xFF) {
+			if (reader.cursor >= reader.end) {
+				break;
+			}
+			uint8_t type = *reader.cursor++;
+			uint32_t length;
+			if (!read_variable_length(&reader, &length) ||
+			    length > (uint32_t)(reader.end - reader.cursor)) {
+				fprintf(stderr, "MIDI parse error in %s: truncated meta event\n", import->filepath);
+				return false;
+			}
+
+			if (type == 0x51 && length == 3) {
+				uint32_t tempo = ((uint32_t)reader.cursor[0] << 16) |
+						 ((uint32_t)reader.cursor[1] << 8) | reader.cursor[2];
+				if (tempo > 0 && !push_tempo(import, reader.tick, tempo)) {
+					return false;
+				}
+			}
+
+			reader.cursor += length;
+			if (type == 0x2F) {
+				break;
+			}
+			continue;
+		}
+
+		if (status == 0xF0 || status == 0xF7) {
+			uint32_t length;
+			if (!read_variable_length(&reader, &length) ||
+			    length > (uint32_t)(reader.end - reader.cursor)) {
+				fprintf(stderr, "MIDI parse error in %s: truncated sysex\n", import->filepath);
+				return false;
+			}
+			reader.cursor += length;
+			reader.running_status = 0;
+			continue;
+		}
+
+		if (status >= 0xF0) {
+			continue;
+		}
+
+		reader.running_status = status;
+
+		uint8_t kind = status & 0xF0;
+		uint8_t channel = status & 0x0F;
+		int data_length = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+		if (reader.end - reader.cursor < data_length) {
+			fprintf(stderr, "MIDI parse error in %s: truncated event\n", import->filepath);
+			return false;
+		}
+
+		uint8_t data1 = reader.cursor[0] & 0x7F;
+		uint8_t data2 = data_length > 1 ? reader.cursor[1] & 0x7F : 0;
+		reader.cursor += data_length;
+
+		switch (kind) {
+		case 0x90:
+			if (data2 > 0) {
+				close_note(import, &reader, channel, data1);
+				if (!open_note(import, &reader, channel, data1, data2)) {
+					fprintf(stderr, "Failed to allocate MIDI notes\n");
+					return false;
+				}
+				break;
+			}
+			close_note(import, &reader, channel, data1);
+			break;
+		case 0x80:
+			close_note(import, &reader, channel, data1);
+			break;
+		case 0xC0:
+			reader.programs[channel] = data1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	close_all_notes(import, &reader);
+	return true;
+}
+
+static int compare_tempos(const void *a, const void *b)
+{
+	const struct midi_tempo *tempo_a = a;
+	const struct midi_tempo *tempo_b = b;
+	if (tempo_a->tick != tempo_b->tick) {
+		return tempo_a->tick < tempo_b->tick ? -1 : 1;
+	}
+	return 0;
+}
+
+static int compare_notes(const void *a, const void *b)
+{
+	const struct midi_raw_note *note_a = a;
+	const struct midi_raw_note *note_b = b;
+	if (note_a->start_tick != note_b->start_tick) {
+		return note_a->start_tick < note_b->start_tick ? -1 : 1;
+	}
+	if (note_a->channel != note_b->channel) {
+		return note_a->channel < note_b->channel ? -1 : 1;
+	}
+	return (int)note_b->key - (int)note_a->key;
+}
+
+static bool build_tempo_map(struct midi_import *import)
+{
+	qsort(import->tempos, import->tempo_count, sizeof(struct midi_tempo), compare_tempos);
+
+	if (import->tempo_count == 0 || import->tempos[0].tick > 0) {
+		if (!push_tempo(import, 0, MIDI_DEFAULT_TEMPO_US)) {
+			fprintf(stderr, "Failed to allocate MIDI tempo map\n");
+			return false;
+		}
+		struct midi_tempo initial = import->tempos[import->tempo_count - 1];
+		memmove(&import->tempos[1],
+			&import->tempos[0],
+			sizeof(struct midi_tempo) * (import->tempo_count - 1));
+		import->tempos[0] = initial;
+	}
+
+	double ms = 0.0;
+	for (uint32_t i = 0; i < import->tempo_count; i++) {
+		if (i > 0) {
+			const struct midi_tempo *previous = &import->tempos[i - 1];
+			ms += (double)(import->tempos[i].tick - previous->tick) *
+			      previous->us_per_quarter / (1000.0 * import->division);
+		}
+		import->tempos[i].start_ms = ms;
+	}
+
+	return true;
+}
+
+static double ticks_to_ms(const struct midi_import *import, uint32_t tick)
+{
+	if (import->division & 0x8000) {
+		int frames_per_second = -(int8_t)(import->division >> 8);
+		int ticks_per_frame = import->division & 0xFF;
+		return (double)tick * 1000.0 / (frames_per_second * ticks_per_frame);
+	}
+
+	uint32_t low = 0;
+	uint32_t high = import->tempo_count;
+	while (high - low > 1) {
+		uint32_t mid = (low + high) / 2;
+		if (import->tempos[mid].tick <= tick) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+
+	const struct midi_tempo *tempo = &import->tempos[low];
+	return tempo->start_ms + (double)(tick - tempo->tick) * tempo->us_per_quarter /
+					 (1000.0 * import->division);
+}
+
+static uint8_t instrument_for_note(const struct midi_raw_note *note)
+{
+	if (note->channel == MIDI_IMPORTER_DRUM_CHANNEL) {
+		return 4;
+	}
+
+	uint8_t family = note->program / 8;
+	switch (family) {
+	case 4:
+		return 1;
+	case 5:
+	case 6:
+		return 2;
+	case 9:
+		return 3;
+	default:
+		return 0;
+	}
+}
+
+static uint8_t assign_voice(
+	uint32_t start_ms,
+	uint8_t channel,
+	uint32_t voice_end_ms[MIDI_IMPORTER_MAX_VOICES],
+	int16_t voice_channel[MIDI_IMPORTER_MAX_VOICES],
+	uint32_t *overlaps
+)
+{
+	int unowned_voice = -1;
+	int free_voice = -1;
+	int earliest_voice = 0;
+
+	for (int voice = 0; voice < MIDI_IMPORTER_MAX_VOICES; voice++) {
+		if (voice_end_ms[voice] <= start_ms) {
+			if (voice_channel[voice] == channel) {
+				return (uint8_t)voice;
+			}
+			if (voice_channel[voice] < 0 && unowned_voice < 0) {
+				unowned_voice = voice;
+			}
+			if (free_voice < 0) {
+				free_voice = voice;
+			}
+		}
+		if (voice_end_ms[voice] < voice_end_ms[earliest_voice]) {
+			earliest_voice = voice;
+		}
+	}
+
+	if (unowned_voice >= 0) {
+		return (uint8_t)unowned_voice;
+	}
+	if (free_voice >= 0) {
+		return (uint8_t)free_voice;
+	}
+
+	(*overlaps)++;
+	return (uint8_t)earliest_voice;
+}
+
+static void merge_runs(
+	const struct midi_raw_note *left,
+	uint32_t left_count,
+	const struct midi_raw_note *right,
+	uint32_t right_count,
+	struct midi_raw_note *out
+)
+{
+	uint32_t i = 0;
+	uint32_t j = 0;
+	while (i < left_count && j < right_count) {
+		if (compare_notes(&right[j], &left[i]) < 0) {
+			*out++ = right[j++];
+		} else {
+			*out++ = left[i++];
+		}
+	}
+	memcpy(out, left + i, sizeof(struct midi_raw_note) * (left_count - i));
+	memcpy(out + (left_count - i), right + j, sizeof(struct midi_raw_note) * (right_count - j));
+}
+
+static bool sort_notes(struct midi_import *import)
+{
+	if (import->track_count <= 1) {
+		return true;
+	}
+
+	struct midi_raw_note *buffer = malloc(sizeof(struct midi_raw_note) * import->note_count);
+	if (buffer == NULL) {
+		fprintf(stderr, "Failed to allocate MIDI merge buffer\n");
+		return false;
+	}
+
+	struct midi_raw_note *source = import->notes;
+	struct midi_raw_note *target = buffer;
+	uint32_t *starts = import->track_starts;
+	uint32_t run_count = import->track_count;
+	starts[run_count] = import->note_count;
+
+	while (run_count > 1) {
+		uint32_t merged = 0;
+		for (uint32_t i = 0; i < run_count; i += 2) {
+			uint32_t begin = starts[i];
+			uint32_t middle = starts[i + 1];
+			uint32_t end = i + 2 <= run_count ? starts[i + 2] : middle;
+			merge_runs(
+				source + begin,
+				middle - begin,
+				source + middle,
+				end - middle,
+				target + begin
+			);
+			starts[merged++] = begin;
+		}
+		starts[merged] = import->note_count;
+		run_count = merged;
+
+		struct midi_raw_note *swap = source;
+		source = target;
+		target = swap;
+	}
+
+	import->notes = source;
+	free(target);
+	return true;
+}
+
+static bool emit_notes(struct midi_import *import, struct app_state *state)
+{
+	uint32_t voice_end_ms[MIDI_IMPORTER_MAX_VOICES] = {0};
+	int16_t voice_channel[MIDI_IMPORTER_MAX_VOICES];
+	for (int i = 0; i < MIDI_IMPORTER_MAX_VOICES; i++) {
+		voice_channel[i] = -1;
+	}
+
+	uint32_t overlaps = 0;
+
+	if (!note_store_reserve(&state->notes, import->note_count)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < import->note_count; i++) {
+		const struct midi_raw_note *raw = &import->notes[i];
+		if (raw->end_tick <= raw->start_tick) {
+			continue;
+		}
+
+		double start_ms = ticks_to_ms(import, raw->start_tick);
+		double end_ms = ticks_to_ms(import, raw->end_tick);
+		uint32_t duration_ms = (uint32_t)lround(end_ms - start_ms);
+		if (duration_ms < MIDI_MIN_DURATION_MS) {
+			duration_ms = MIDI_MIN_DURATION_MS;
+		}
+		if (duration_ms > MIDI_MAX_DURATION_MS) {
+			duration_ms = MIDI_MAX_DURATION_MS;
+		}
+
+		struct ui_note note = {0};
+		note.id = state->next_note_id++;
+		note.ms = (uint32_t)lround(start_ms);
+		note.duration_ms = (uint16_t)duration_ms;
+		note.voice =
+			assign_voice(note.ms, raw->channel, voice_end_ms, voice_channel, &overlaps);
+		voice_end_ms[note.voice] = note.ms + duration_ms;
+		voice_channel[note.voice] = raw->channel;
+
+		uint8_t instrument_index = instrument_for_note(raw);
+		if (instrument_index >= state->instrument_count) {
+			instrument_index = 0;
+		}
+		const struct instrument *instrument = &state->instruments[instrument_index];
+
+		double velocity_db = 20.0 * log10((double)raw->velocity / 127.0);
+		int amplitude = instrument->amplitude_dbfs + (int)lround(velocity_db);
+		if (amplitude < -60) {
+			amplitude = -60;
+		}
+
+		note.piano_key = raw->key;
+		note.frequency = note_to_frequency(raw->key);
+		note.waveform = instrument->waveform;
+		note.duty_cycle = instrument->duty_cycle;
+		note.decay = instrument->decay;
+		note.amplitude_dbfs = (int8_t)amplitude;
+		note.nes_noise_period = (uint8_t)(15 - raw->key % 16);
+		note.nes_noise_mode_flag = instrument->nes_noise_mode_flag;
+		note.nes_noise_lfsr_init = instrument->nes_noise_lfsr;
+		note.restart_phase = true;
+
+		if (!note_store_add(&state->notes, &note)) {
+			return false;
+		}
+	}
+
+	if (overlaps > 0) {
+		fprintf(stderr,
+			"%u MIDI notes overlap because more than %d were sounding at once\n",
+			overlaps,
+			MIDI_IMPORTER_MAX_VOICES);
+	}
+
+	return true;
+}
+
+static bool parse_midi(struct midi_import *import, const uint8_t *data, size_t size)
+{
+	if (size < 14 || memcmp(data, "MThd", 4) != 0) {
+		fprintf(stderr, "Not a MIDI file: %s\n", import->filepath);
+		return false;
+	}
+
+	uint32_t header_length = get_u32_be(data + 4);
+	if (header_length < 6 || header_length > size - 8) {
+		fprintf(stderr, "MIDI parse error in %s: bad header\n", import->filepath);
+		return false;
+	}
+
+	uint16_t format = get_u16_be(data + 8);
+	uint16_t track_count = get_u16_be(data + 10);
+	import->division = get_u16_be(data + 12);
+
+	if (format > 1) {
+		fprintf(stderr, "Unsupported MIDI format %u in %s\n", format, import->filepath);
+		return false;
+	}
+	if (import->division == 0) {
+		fprintf(stderr, "MIDI parse error in %s: zero time division\n", import->filepath);
+		return false;
+	}
+
+	import->track_starts = malloc(sizeof(uint32_t) * ((size_t)track_count + 1));
+	if (import->track_starts == NULL) {
+		fprintf(stderr, "Failed to allocate MIDI track table\n");
+		return false;
+	}
+
+	size_t offset = 8 + header_length;
+	uint16_t tracks_read = 0;
+
+	while (offset + 8 <= size && tracks_read < track_count) {
+		uint32_t chunk_length = get_u32_be(data + offset + 4);
+		const uint8_t *chunk = data + offset + 8;
+		if (chunk_length > size - offset - 8) {
+			fprintf(stderr, "MIDI parse error in %s: truncated chunk\n", import->filepath);
+			return false;
+		}
+
+		if (memcmp(data + offset, "MTrk", 4) == 0) {
+			import->track_starts[tracks_read] = import->note_count;
+			if (!read_track(import, chunk, chunk_length)) {
+				return false;
+			}
+			tracks_read++;
+			import->track_count = tracks_read;
+		}
+
+		offset += 8 + (size_t)chunk_length;
+	}
+
+	return build_tempo_map(import) && sort_notes(import);
+}
+
+bool midi_importer_is_midi_file(const char *filepath)
+{
+	if (!filepath) {
+		return false;
+	}
+
+	FILE *file = fopen(filepath, "rb");
+	if (!file) {
+		return false;
+	}
+
+	char magic[4];
+	size_t read_length = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+
+	return read_length == sizeof(magic) && memcmp(magic, "MThd", 4) == 0;
+}
+
+bool midi_importer_load_into_state(struct app_state *state, const char *filepath)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for MIDI import\n");
+		return false;
+	}
+
+	struct platform_mapped_file mapped;
+	if (!platform_map_file(filepath, &mapped)) {
+		fprintf(stderr, "Failed to open file: %s\n", filepath);
+		return false;
+	}
+
+	struct midi_import import;
+	memset(&import, 0, sizeof(import));
+	import.filepath = filepath;
+
+	bool success = parse_midi(&import, mapped.data, mapped.size);
+	platform_unmap_file(&mapped);
+
+	if (success) {
+		app_state_clear_notes(state);
+		state->bpm = (uint32_t)lround(60000000.0 / import.tempos[0].us_per_quarter);
+		success = emit_notes(&import, state);
+	}
+	if (success) {
+		printf("Imported %u notes from %s\n", note_store_count(&state->notes), filepath);
+	}
+
+	free(import.notes);
+	free(import.tempos);
+	free(import.track_starts);
+	return success;
+}
+
+bool midi_importer_load_from_file(struct audio *audio, struct app_state *state, const char *filepath)
+{
+	if (!audio || !state) {
+		fprintf(stderr, "Invalid parameters for MIDI import\n");
+		return false;
+	}
+
+	if (!midi_importer_load_into_state(state, filepath)) {
+		return false;
+	}
+
+	struct sequencer *sequencer = audio_get_sequencer(audio);
+	sequencer_stop(sequencer);
+	sequencer_set_bpm(sequencer, state->bpm);
+	app_state_sync_notes_to_sequencer(state, sequencer, audio);
+
+	return true;
+}
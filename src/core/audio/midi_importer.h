@@ -0,0 +1,19 @@
+#ifndef MIDI_IMPORTER_H
+#define MIDI_IMPORTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct audio;
+struct app_state;
+
+#define MIDI_IMPORTER_MAX_VOICES 8
+#define MIDI_IMPORTER_DRUM_CHANNEL 9
+
+bool midi_importer_is_midi_file(const char *filepath);
+
+bool midi_importer_load_into_state(struct app_state *state, const char *filepath);
+
+bool midi_importer_load_from_file(struct audio *audio, struct app_state *state, const char *filepath);
+
+#endif
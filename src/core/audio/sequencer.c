@@ -1,7 +1,11 @@
 #include "sequencer.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#define SEQUENCER_SMALL_CHANGE_SET 32
+
 void sequencer_init(struct sequencer *sequencer)
 {
 	memset(sequencer, 0, sizeof(struct sequencer));
@@ -9,23 +13,293 @@ void sequencer_init(struct sequencer *sequencer)
 	sequencer->playing = false;
 }
 
-void sequencer_add_note(struct sequencer *sequencer, uint32_t time_ms, struct note_params params)
+void sequencer_free(struct sequencer *sequencer)
 {
-	if (sequencer->note_count >= SEQUENCER_MAX_NOTES) {
-		return;
+	free(sequencer->notes);
+	sequencer->notes = NULL;
+	sequencer->note_count = 0;
+	sequencer->note_capacity = 0;
+	sequencer->next_note = 0;
+}
+
+bool sequencer_reserve(struct sequencer *sequencer, uint32_t capacity)
+{
+	if (capacity <= sequencer->note_capacity) {
+		return true;
+	}
+
+	uint32_t new_capacity = sequencer->note_capacity > 0 ? sequencer->note_capacity : 256;
+	while (new_capacity < capacity) {
+		new_capacity *= 2;
+	}
+
+	struct note *notes = realloc(sequencer->notes, sizeof(struct note) * new_capacity);
+	if (!notes) {
+		fprintf(stderr, "Failed to grow sequencer to %u notes\n", new_capacity);
+		return false;
+	}
+
+	sequencer->notes = notes;
+	sequencer->note_capacity = new_capacity;
+	return true;
+}
+
+static int compare_keys(uint32_t time_a, uint32_t id_a, uint32_t time_b, uint32_t id_b)
+{
+	if (time_a != time_b) {
+		return time_a < time_b ? -1 : 1;
+	}
+	if (id_a != id_b) {
+		return id_a < id_b ? -1 : 1;
+	}
+	return 0;
+}
+
+static int compare_notes(const void *a, const void *b)
+{
+	const struct note *note_a = a;
+	const struct note *note_b = b;
+	return compare_keys(note_a->time_ms, note_a->id, note_b->time_ms, note_b->id);
+}
+
+static int compare_sequencer_keys(const void *a, const void *b)
+{
+	const struct sequencer_key *key_a = a;
+	const struct sequencer_key *key_b = b;
+	return compare_keys(key_a->time_ms, key_a->id, key_b->time_ms, key_b->id);
+}
+
+static int compare_key_to_note(const struct sequencer_key *key, const struct note *note)
+{
+	return compare_keys(key->time_ms, key->id, note->time_ms, note->id);
+}
+
+static uint32_t find_position(const struct sequencer *sequencer, uint32_t time_ms, uint32_t id)
+{
+	uint32_t low = 0;
+	uint32_t high = sequencer->note_count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		const struct note *note = &sequencer->notes[mid];
+		if (compare_keys(note->time_ms, note->id, time_ms, id) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static uint32_t first_note_at(const struct sequencer *sequencer, uint32_t time_ms)
+{
+	uint32_t low = 0;
+	uint32_t high = sequencer->note_count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (sequencer->notes[mid].time_ms < time_ms) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static uint32_t playhead_to_ms(const struct sequencer *sequencer)
+{
+	if (sequencer->sample_rate == 0) {
+		return 0;
+	}
+	return (uint32_t)((sequencer->playhead_samples * 1000) / sequencer->sample_rate);
+}
+
+bool sequencer_add_note(
+	struct sequencer *sequencer, uint32_t id, uint32_t time_ms, struct note_params params
+)
+{
+	if (!sequencer_reserve(sequencer, sequencer->note_count + 1)) {
+		return false;
 	}
 
 	struct note *note = &sequencer->notes[sequencer->note_count];
+	note->id = id;
 	note->time_ms = time_ms;
 	note->params = params;
-	note->triggered = false;
 
 	sequencer->note_count++;
+	return true;
+}
+
+void sequencer_sort_notes(struct sequencer *sequencer)
+{
+	bool sorted = true;
+	for (uint32_t i = 1; i < sequencer->note_count && sorted; i++) {
+		sorted = compare_notes(&sequencer->notes[i - 1], &sequencer->notes[i]) < 0;
+	}
+
+	if (!sorted) {
+		qsort(sequencer->notes, sequencer->note_count, sizeof(struct note), compare_notes);
+	}
+
+	sequencer->next_note = first_note_at(sequencer, playhead_to_ms(sequencer));
+}
+
+static bool insert_note(struct sequencer *sequencer, const struct note *note)
+{
+	if (!sequencer_reserve(sequencer, sequencer->note_count + 1)) {
+		return false;
+	}
+
+	uint32_t position = find_position(sequencer, note->time_ms, note->id);
+	memmove(&sequencer->notes[position + 1],
+		&sequencer->notes[position],
+		sizeof(struct note) * (sequencer->note_count - position));
+
+	sequencer->notes[position] = *note;
+	sequencer->note_count++;
+
+	bool behind_cursor = position < sequencer->next_note;
+	bool behind_playhead = position == sequencer->next_note &&
+			       note->time_ms < playhead_to_ms(sequencer);
+	if (behind_cursor || behind_playhead) {
+		sequencer->next_note++;
+	}
+	return true;
+}
+
+static bool remove_note(struct sequencer *sequencer, const struct sequencer_key *key)
+{
+	uint32_t position = find_position(sequencer, key->time_ms, key->id);
+	if (position >= sequencer->note_count ||
+	    compare_key_to_note(key, &sequencer->notes[position]) != 0) {
+		return false;
+	}
+
+	sequencer->note_count--;
+	memmove(&sequencer->notes[position],
+		&sequencer->notes[position + 1],
+		sizeof(struct note) * (sequencer->note_count - position));
+
+	if (position < sequencer->next_note) {
+		sequencer->next_note--;
+	}
+	return true;
+}
+
+static bool
+remove_sorted(struct sequencer *sequencer, struct sequencer_key *removed, uint32_t count)
+{
+	qsort(removed, count, sizeof(struct sequencer_key), compare_sequencer_keys);
+
+	uint32_t write = 0;
+	uint32_t next = 0;
+	uint32_t next_note = sequencer->next_note;
+
+	for (uint32_t read = 0; read < sequencer->note_count; read++) {
+		const struct note *note = &sequencer->notes[read];
+		while (next < count && compare_key_to_note(&removed[next], note) < 0) {
+			next++;
+		}
+
+		if (next < count && compare_key_to_note(&removed[next], note) == 0) {
+			if (read < sequencer->next_note) {
+				next_note--;
+			}
+			next++;
+			continue;
+		}
+
+		sequencer->notes[write++] = *note;
+	}
+
+	bool complete = sequencer->note_count - write == count;
+	sequencer->note_count = write;
+	sequencer->next_note = next_note;
+	return complete;
+}
+
+static bool merge_sorted(struct sequencer *sequencer, struct note *added, uint32_t count)
+{
+	if (!sequencer_reserve(sequencer, sequencer->note_count + count)) {
+		return false;
+	}
+
+	qsort(added, count, sizeof(struct note), compare_notes);
+
+	const struct note *last_played =
+		sequencer->next_note > 0 ? &sequencer->notes[sequencer->next_note - 1] : NULL;
+	const struct note *next_unplayed = sequencer->next_note < sequencer->note_count
+						   ? &sequencer->notes[sequencer->next_note]
+						   : NULL;
+	uint32_t playhead_ms = playhead_to_ms(sequencer);
+
+	uint32_t added_before_cursor = 0;
+	while (added_before_cursor < count) {
+		const struct note *note = &added[added_before_cursor];
+		if (next_unplayed != NULL && compare_notes(note, next_unplayed) > 0) {
+			break;
+		}
+		bool behind_cursor = last_played != NULL && compare_notes(note, last_played) < 0;
+		if (!behind_cursor && note->time_ms >= playhead_ms) {
+			break;
+		}
+		added_before_cursor++;
+	}
+
+	uint32_t old_index = sequencer->note_count;
+	uint32_t added_index = count;
+	uint32_t write = sequencer->note_count + count;
+	while (added_index > 0) {
+		if (old_index > 0 &&
+		    compare_notes(&sequencer->notes[old_index - 1], &added[added_index - 1]) > 0) {
+			sequencer->notes[--write] = sequencer->notes[--old_index];
+		} else {
+			sequencer->notes[--write] = added[--added_index];
+		}
+	}
+
+	sequencer->note_count += count;
+	sequencer->next_note += added_before_cursor;
+	return true;
+}
+
+bool sequencer_apply_changes(
+	struct sequencer *sequencer,
+	struct sequencer_key *removed,
+	uint32_t removed_count,
+	struct note *added,
+	uint32_t added_count
+)
+{
+	bool success = true;
+
+	if (removed_count + added_count <= SEQUENCER_SMALL_CHANGE_SET) {
+		for (uint32_t i = 0; i < removed_count; i++) {
+			if (!remove_note(sequencer, &removed[i])) {
+				success = false;
+			}
+		}
+		for (uint32_t i = 0; i < added_count; i++) {
+			if (!insert_note(sequencer, &added[i])) {
+				success = false;
+			}
+		}
+		return success;
+	}
+
+	if (removed_count > 0) {
+		success = remove_sorted(sequencer, removed, removed_count);
+	}
+	if (added_count > 0) {
+		success = merge_sorted(sequencer, added, added_count) && success;
+	}
+	return success;
 }
 
 void sequencer_clear_notes(struct sequencer *sequencer)
 {
 	sequencer->note_count = 0;
+	sequencer->next_note = 0;
 }
 
 void sequencer_update(
@@ -42,10 +316,7 @@ void sequencer_update(
 
 	sequencer->playhead_samples += samples;
 
-	uint32_t playhead_ms =
-		(uint32_t)((sequencer->playhead_samples * 1000) / sequencer->sample_rate);
-
-	bool has_untriggered_notes = false;
+	uint32_t playhead_ms = playhead_to_ms(sequencer);
 
 	bool has_solo = false;
 	if (voice_solo != NULL) {
@@ -57,41 +328,35 @@ void sequencer_update(
 		}
 	}
 
-	for (uint32_t i = 0; i < sequencer->note_count; i++) {
-		struct note *note = &sequencer->notes[i];
-
-		if (!note->triggered && playhead_ms >= note->time_ms) {
-			bool should_play = true;
+	while (sequencer->next_note < sequencer->note_count) {
+		const struct note *note = &sequencer->notes[sequencer->next_note];
+		if (note->time_ms > playhead_ms) {
+			break;
+		}
 
-			if (voice_solo != NULL && voice_muted != NULL &&
-			    note->params.voice_index >= 0 && note->params.voice_index < 8) {
-				int voice = note->params.voice_index;
-				if (has_solo) {
-					should_play = voice_solo[voice];
-				} else {
-					should_play = !voice_muted[voice];
-				}
-			}
+		bool should_play = true;
 
-			if (should_play) {
-				synth_play_note(synth, note->params);
+		if (voice_solo != NULL && voice_muted != NULL && note->params.voice_index >= 0 &&
+		    note->params.voice_index < 8) {
+			int voice = note->params.voice_index;
+			if (has_solo) {
+				should_play = voice_solo[voice];
+			} else {
+				should_play = !voice_muted[voice];
 			}
-
-			note->triggered = true;
 		}
 
-		if (!note->triggered) {
-			has_untriggered_notes = true;
+		if (should_play) {
+			synth_play_note(synth, note->params);
 		}
+
+		sequencer->next_note++;
 	}
 
-	if (sequencer->note_count > 0 && !has_untriggered_notes) {
+	if (sequencer->note_count > 0 && sequencer->next_note >= sequencer->note_count) {
 		sequencer->playing = false;
 		sequencer->playhead_samples = 0;
-
-		for (uint32_t i = 0; i < sequencer->note_count; i++) {
-			sequencer->notes[i].triggered = false;
-		}
+		sequencer->next_note = 0;
 	}
 }
 
@@ -102,14 +367,7 @@ void sequencer_set_playhead(struct sequencer *sequencer, uint32_t playhead_ms)
 	}
 
 	sequencer->playhead_samples = ((uint64_t)playhead_ms * sequencer->sample_rate) / 1000;
-
-	for (uint32_t i = 0; i < sequencer->note_count; i++) {
-		if (sequencer->notes[i].time_ms < playhead_ms) {
-			sequencer->notes[i].triggered = true;
-		} else {
-			sequencer->notes[i].triggered = false;
-		}
-	}
+	sequencer->next_note = first_note_at(sequencer, playhead_ms);
 }
 
 void sequencer_set_bpm(struct sequencer *sequencer, uint32_t bpm)
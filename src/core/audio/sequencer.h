@@ -7,16 +7,21 @@
 #include <stdint.h>
 
 struct note {
+	uint32_t id;
 	uint32_t time_ms;
 	struct note_params params;
-	bool triggered;
 };
 
-#define SEQUENCER_MAX_NOTES 256
+struct sequencer_key {
+	uint32_t id;
+	uint32_t time_ms;
+};
 
 struct sequencer {
-	struct note notes[SEQUENCER_MAX_NOTES];
+	struct note *notes;
 	uint32_t note_count;
+	uint32_t note_capacity;
+	uint32_t next_note;
 	uint64_t playhead_samples;
 	uint32_t sample_rate;
 	uint32_t bpm;
@@ -24,7 +29,19 @@ struct sequencer {
 };
 
 void sequencer_init(struct sequencer *sequencer);
-void sequencer_add_note(struct sequencer *sequencer, uint32_t time_ms, struct note_params params);
+void sequencer_free(struct sequencer *sequencer);
+bool sequencer_reserve(struct sequencer *sequencer, uint32_t capacity);
+bool sequencer_add_note(
+	struct sequencer *sequencer, uint32_t id, uint32_t time_ms, struct note_params params
+);
+void sequencer_sort_notes(struct sequencer *sequencer);
+bool sequencer_apply_changes(
+	struct sequencer *sequencer,
+	struct sequencer_key *removed,
+	uint32_t removed_count,
+	struct note *added,
+	uint32_t added_count
+);
 void sequencer_clear_notes(struct sequencer *sequencer);
 void sequencer_update(
 	struct sequencer *sequencer,
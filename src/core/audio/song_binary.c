@@ -0,0 +1,499 @@
+#include "song_binary.h"
+#include "app_state.h"
+#include "audio.h"
+#include "platform.h"
+#include "scale.h"
+#include "sequencer.h"
+#include "song_loader.h"
+#include "song_saver.h"
+#include "synth.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NOTE_FLAG_RESTART_PHASE 0x01
+#define NOTE_FLAG_NES_NOISE_MODE 0x02
+
+#define METADATA_FLAG_FOLD_MODE 0x01
+#define METADATA_FLAG_SCALE_HIGHLIGHTS 0x02
+
+#define INSTRUMENT_FLAG_NES_NOISE_MODE 0x01
+
+static void put_u16(uint8_t *dst, uint16_t value)
+{
+	dst[0] = (uint8_t)(value & 0xFF);
+	dst[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+	dst[0] = (uint8_t)(value & 0xFF);
+	dst[1] = (uint8_t)((value >> 8) & 0xFF);
+	dst[2] = (uint8_t)((value >> 16) & 0xFF);
+	dst[3] = (uint8_t)(value >> 24);
+}
+
+static void put_f32(uint8_t *dst, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put_u32(dst, bits);
+}
+
+static uint16_t get_u16(const uint8_t *src)
+{
+	return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) |
+	       ((uint32_t)src[3] << 24);
+}
+
+static float get_f32(const uint8_t *src)
+{
+	uint32_t bits = get_u32(src);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+struct song_binary_snapshot {
+	uint32_t bpm;
+	uint32_t next_note_id;
+	enum scale_type selected_scale;
+	enum root_note selected_root;
+	bool fold_mode;
+	bool show_scale_highlights;
+	uint8_t instrument_count;
+	uint8_t selected_instrument;
+	struct instrument instruments[MAX_INSTRUMENTS];
+	struct note_snapshot notes;
+};
+
+static uint32_t calculate_song_length_ms(const struct song_binary_snapshot *snapshot)
+{
+	uint32_t max_end_time = 0;
+
+	for (uint32_t i = 0; i < note_snapshot_count(&snapshot->notes); i++) {
+		const struct ui_note *note = note_snapshot_at(&snapshot->notes, i);
+		uint32_t end_time = note->ms + note->duration_ms;
+		if (end_time > max_end_time) {
+			max_end_time = end_time;
+		}
+	}
+
+	return max_end_time > 0 ? max_end_time : 1000;
+}
+
+static void write_note(uint8_t *dst, const struct ui_note *note)
+{
+	uint8_t flags = 0;
+	if (note->restart_phase) {
+		flags |= NOTE_FLAG_RESTART_PHASE;
+	}
+	if (note->nes_noise_mode_flag) {
+		flags |= NOTE_FLAG_NES_NOISE_MODE;
+	}
+
+	put_u32(dst + 0, note->id);
+	put_u32(dst + 4, note->ms);
+	put_f32(dst + 8, note->frequency);
+	put_u16(dst + 12, note->duration_ms);
+	put_u16(dst + 14, (uint16_t)note->decay);
+	put_u16(dst + 16, note->nes_noise_lfsr_init);
+	dst[18] = note->voice;
+	dst[19] = note->piano_key;
+	dst[20] = (uint8_t)note->waveform;
+	dst[21] = note->duty_cycle;
+	dst[22] = (uint8_t)note->amplitude_dbfs;
+	dst[23] = note->nes_noise_period;
+	dst[24] = flags;
+}
+
+static void read_note(const uint8_t *src, struct ui_note *note)
+{
+	note->id = get_u32(src + 0);
+	note->ms = get_u32(src + 4);
+	note->frequency = get_f32(src + 8);
+	note->duration_ms = get_u16(src + 12);
+	note->decay = (int16_t)get_u16(src + 14);
+	note->nes_noise_lfsr_init = get_u16(src + 16);
+	note->voice = src[18];
+	note->piano_key = src[19];
+	note->waveform = src[20] <= WAVEFORM_NES_NOISE ? (enum waveform_type)src[20]
+						       : WAVEFORM_SINE;
+	note->duty_cycle = src[21];
+	note->amplitude_dbfs = (int8_t)src[22];
+	note->nes_noise_period = src[23];
+	note->restart_phase = (src[24] & NOTE_FLAG_RESTART_PHASE) != 0;
+	note->nes_noise_mode_flag = (src[24] & NOTE_FLAG_NES_NOISE_MODE) != 0;
+}
+
+static void write_instrument(uint8_t *dst, const struct instrument *instrument)
+{
+	memcpy(dst, instrument->name, sizeof(instrument->name));
+	dst[31] = '\0';
+	dst[32] = (uint8_t)instrument->waveform;
+	dst[33] = instrument->duty_cycle;
+	dst[34] = (uint8_t)instrument->amplitude_dbfs;
+	dst[35] = instrument->nes_noise_mode_flag ? INSTRUMENT_FLAG_NES_NOISE_MODE : 0;
+	put_u16(dst + 36, (uint16_t)instrument->decay);
+	put_u16(dst + 38, instrument->default_duration_ms);
+	dst[40] = instrument->color_r;
+	dst[41] = instrument->color_g;
+	dst[42] = instrument->color_b;
+	put_u16(dst + 44, instrument->nes_noise_lfsr);
+}
+
+static void read_instrument(const uint8_t *src, struct instrument *instrument)
+{
+	memcpy(instrument->name, src, sizeof(instrument->name));
+	instrument->name[sizeof(instrument->name) - 1] = '\0';
+	instrument->waveform = src[32] <= WAVEFORM_NES_NOISE ? (enum waveform_type)src[32]
+							     : WAVEFORM_SINE;
+	instrument->duty_cycle = src[33];
+	instrument->amplitude_dbfs = (int8_t)src[34];
+	instrument->nes_noise_mode_flag = (src[35] & INSTRUMENT_FLAG_NES_NOISE_MODE) != 0;
+	instrument->decay = (int16_t)get_u16(src + 36);
+	instrument->default_duration_ms = get_u16(src + 38);
+	instrument->color_r = src[40];
+	instrument->color_g = src[41];
+	instrument->color_b = src[42];
+	instrument->nes_noise_lfsr = get_u16(src + 44);
+}
+
+bool song_binary_is_binary_file(const char *filepath)
+{
+	if (filepath == NULL) {
+		return false;
+	}
+
+	FILE *file = fopen(filepath, "rb");
+	if (!file) {
+		return false;
+	}
+
+	char magic[4];
+	size_t read_length = fread(magic, 1, sizeof(magic), file);
+	fclose(file);
+
+	return read_length == sizeof(magic) && memcmp(magic, SONG_BINARY_MAGIC, 4) == 0;
+}
+
+struct song_binary_snapshot *song_binary_snapshot_create(const struct app_state *state)
+{
+	struct song_binary_snapshot *snapshot = malloc(sizeof(struct song_binary_snapshot));
+	if (!snapshot) {
+		fprintf(stderr, "Failed to allocate binary song snapshot\n");
+		return NULL;
+	}
+
+	snapshot->bpm = state->bpm;
+	snapshot->next_note_id = state->next_note_id;
+	snapshot->selected_scale = state->selected_scale;
+	snapshot->selected_root = state->selected_root;
+	snapshot->fold_mode = state->fold_mode;
+	snapshot->show_scale_highlights = state->show_scale_highlights;
+	snapshot->instrument_count = state->instrument_count;
+	snapshot->selected_instrument = state->selected_instrument;
+	memcpy(snapshot->instruments, state->instruments, sizeof(snapshot->instruments));
+	note_store_snapshot(&state->notes, &snapshot->notes);
+
+	return snapshot;
+}
+
+void song_binary_snapshot_free(struct song_binary_snapshot *snapshot)
+{
+	if (!snapshot) {
+		return;
+	}
+
+	note_snapshot_release(&snapshot->notes);
+	free(snapshot);
+}
+
+uint8_t *song_binary_snapshot_encode(const struct song_binary_snapshot *snapshot, size_t *size)
+{
+	uint32_t metadata_offset = SONG_BINARY_HEADER_SIZE;
+	uint32_t instrument_offset = metadata_offset + SONG_BINARY_METADATA_SIZE;
+	uint32_t note_offset = instrument_offset +
+			       (uint32_t)snapshot->instrument_count * SONG_BINARY_INSTRUMENT_SIZE;
+	uint32_t note_count = note_snapshot_count(&snapshot->notes);
+	size_t total_size = (size_t)note_offset + (size_t)note_count * SONG_BINARY_NOTE_SIZE;
+
+	uint8_t *buffer = calloc(1, total_size);
+	if (!buffer) {
+		fprintf(stderr, "Failed to allocate binary song buffer\n");
+		return NULL;
+	}
+
+	memcpy(buffer, SONG_BINARY_MAGIC, 4);
+	put_u16(buffer + 4, SONG_BINARY_VERSION);
+	put_u16(buffer + 6, SONG_BINARY_HEADER_SIZE);
+	put_u32(buffer + 8, 0);
+	put_u32(buffer + 12, metadata_offset);
+	put_u32(buffer + 16, SONG_BINARY_METADATA_SIZE);
+	put_u32(buffer + 20, instrument_offset);
+	put_u32(buffer + 24, snapshot->instrument_count);
+	put_u32(buffer + 28, SONG_BINARY_INSTRUMENT_SIZE);
+	put_u32(buffer + 32, note_offset);
+	put_u32(buffer + 36, note_count);
+	put_u32(buffer + 40, SONG_BINARY_NOTE_SIZE);
+	put_u32(buffer + 44, snapshot->next_note_id);
+
+	uint8_t *metadata = buffer + metadata_offset;
+	uint8_t metadata_flags = 0;
+	if (snapshot->fold_mode) {
+		metadata_flags |= METADATA_FLAG_FOLD_MODE;
+	}
+	if (snapshot->show_scale_highlights) {
+		metadata_flags |= METADATA_FLAG_SCALE_HIGHLIGHTS;
+	}
+	put_u32(metadata + 0, snapshot->bpm);
+	put_u32(metadata + 4, calculate_song_length_ms(snapshot));
+	metadata[8] = (uint8_t)snapshot->selected_scale;
+	metadata[9] = (uint8_t)snapshot->selected_root;
+	metadata[10] = metadata_flags;
+	metadata[11] = snapshot->selected_instrument;
+
+	for (uint32_t i = 0; i < snapshot->instrument_count; i++) {
+		write_instrument(
+			buffer + instrument_offset + i * SONG_BINARY_INSTRUMENT_SIZE,
+			&snapshot->instruments[i]
+		);
+	}
+
+	for (uint32_t i = 0; i < note_count; i++) {
+		const struct ui_note *note = note_snapshot_at(&snapshot->notes, i);
+		write_note(buffer + note_offset + i * SONG_BINARY_NOTE_SIZE, note);
+	}
+
+	*size = total_size;
+	return buffer;
+}
+
+uint8_t *song_binary_encode(const struct app_state *state, size_t *size)
+{
+	struct song_binary_snapshot *snapshot = song_binary_snapshot_create(state);
+	if (!snapshot) {
+		return NULL;
+	}
+
+	uint8_t *buffer = song_binary_snapshot_encode(snapshot, size);
+	song_binary_snapshot_free(snapshot);
+	return buffer;
+}
+
+bool song_binary_save_to_file(const struct app_state *state, const char *filepath)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for binary save\n");
+		return false;
+	}
+
+	size_t total_size = 0;
+	uint8_t *buffer = song_binary_encode(state, &total_size);
+	if (!buffer) {
+		return false;
+	}
+
+	FILE *file = fopen(filepath, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open file for writing: %s\n", filepath);
+		free(buffer);
+		return false;
+	}
+
+	size_t written = fwrite(buffer, 1, total_size, file);
+	fclose(file);
+	free(buffer);
+
+	if (written != total_size) {
+		fprintf(stderr, "Failed to write complete binary song to file\n");
+		return false;
+	}
+
+	printf("Saved %u notes to %s\n", note_store_count(&state->notes), filepath);
+	return true;
+}
+
+static bool block_in_bounds(size_t file_size, uint32_t offset, uint32_t count, uint32_t size)
+{
+	uint64_t end = (uint64_t)offset + (uint64_t)count * (uint64_t)size;
+	return end <= file_size;
+}
+
+bool song_binary_decode(
+	struct app_state *state, const uint8_t *data, size_t size, const char *source
+)
+{
+	if (size < SONG_BINARY_HEADER_SIZE || memcmp(data, SONG_BINARY_MAGIC, 4) != 0) {
+		fprintf(stderr, "Not a binary song file: %s\n", source);
+		return false;
+	}
+
+	uint16_t version = get_u16(data + 4);
+	if (version > SONG_BINARY_VERSION) {
+		fprintf(stderr, "Unsupported binary song version %u in %s\n", version, source);
+		return false;
+	}
+
+	uint32_t metadata_offset = get_u32(data + 12);
+	uint32_t metadata_size = get_u32(data + 16);
+	uint32_t instrument_offset = get_u32(data + 20);
+	uint32_t instrument_count = get_u32(data + 24);
+	uint32_t instrument_size = get_u32(data + 28);
+	uint32_t note_offset = get_u32(data + 32);
+	uint32_t note_count = get_u32(data + 36);
+	uint32_t note_size = get_u32(data + 40);
+	uint32_t next_note_id = get_u32(data + 44);
+
+	if (metadata_size < SONG_BINARY_METADATA_SIZE ||
+	    instrument_size < SONG_BINARY_INSTRUMENT_SIZE || note_size < SONG_BINARY_NOTE_SIZE ||
+	    !block_in_bounds(size, metadata_offset, 1, metadata_size) ||
+	    !block_in_bounds(size, instrument_offset, instrument_count, instrument_size) ||
+	    !block_in_bounds(size, note_offset, note_count, note_size)) {
+		fprintf(stderr, "Corrupt binary song file: %s\n", source);
+		return false;
+	}
+
+	const uint8_t *metadata = data + metadata_offset;
+	uint32_t bpm = get_u32(metadata + 0);
+	if (bpm > 0) {
+		state->bpm = bpm;
+	}
+	if (metadata[8] < SCALE_TYPE_COUNT) {
+		state->selected_scale = (enum scale_type)metadata[8];
+	}
+	if (metadata[9] <= ROOT_B) {
+		state->selected_root = (enum root_note)metadata[9];
+	}
+	state->fold_mode = (metadata[10] & METADATA_FLAG_FOLD_MODE) != 0;
+	state->show_scale_highlights = (metadata[10] & METADATA_FLAG_SCALE_HIGHLIGHTS) != 0;
+
+	if (instrument_count > 0) {
+		if (instrument_count > MAX_INSTRUMENTS) {
+			instrument_count = MAX_INSTRUMENTS;
+		}
+		for (uint32_t i = 0; i < instrument_count; i++) {
+			read_instrument(
+				data + instrument_offset + i * instrument_size,
+				&state->instruments[i]
+			);
+		}
+		state->instrument_count = (uint8_t)instrument_count;
+		state->selected_instrument = metadata[11] < instrument_count ? metadata[11] : 0;
+	}
+
+	app_state_clear_notes(state);
+
+	if (!note_store_reserve(&state->notes, note_count)) {
+		return false;
+	}
+
+	uint32_t max_id = 0;
+	for (uint32_t i = 0; i < note_count; i++) {
+		uint32_t id = get_u32(data + note_offset + i * note_size);
+		if (id > max_id) {
+			max_id = id;
+		}
+	}
+	state->next_note_id = next_note_id > max_id ? next_note_id : max_id + 1;
+
+	uint32_t duplicate_count = 0;
+	for (uint32_t i = 0; i < note_count; i++) {
+		struct ui_note note;
+		read_note(data + note_offset + i * note_size, &note);
+		if (note_store_index_of(&state->notes, note.id, NULL)) {
+			note.id = state->next_note_id++;
+			duplicate_count++;
+		}
+		note_store_add(&state->notes, &note);
+	}
+
+	if (duplicate_count > 0) {
+		fprintf(stderr,
+			"%u notes in %s had duplicate ids and were renumbered\n",
+			duplicate_count,
+			source);
+	}
+
+	return true;
+}
+
+bool song_binary_load_into_state(struct app_state *state, const char *filepath)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for binary load\n");
+		return false;
+	}
+
+	struct platform_mapped_file mapped;
+	if (!platform_map_file(filepath, &mapped)) {
+		fprintf(stderr, "Failed to open file: %s\n", filepath);
+		return false;
+	}
+
+	bool success = song_binary_decode(state, mapped.data, mapped.size, filepath);
+	platform_unmap_file(&mapped);
+
+	if (success) {
+		printf("Loaded %u notes from %s\n", note_store_count(&state->notes), filepath);
+	}
+	return success;
+}
+
+bool song_binary_load_from_file(struct audio *audio, struct app_state *state, const char *filepath)
+{
+	if (!audio || !state) {
+		fprintf(stderr, "Invalid parameters for binary load\n");
+		return false;
+	}
+
+	if (!song_binary_load_into_state(state, filepath)) {
+		return false;
+	}
+
+	struct sequencer *sequencer = audio_get_sequencer(audio);
+	sequencer_stop(sequencer);
+	sequencer_set_bpm(sequencer, state->bpm);
+	app_state_sync_notes_to_sequencer(state, sequencer, audio);
+
+	return true;
+}
+
+bool song_binary_convert(const char *input_path, const char *output_path)
+{
+	if (!input_path || !output_path) {
+		fprintf(stderr, "Invalid parameters for song conversion\n");
+		return false;
+	}
+
+	struct app_state *state = malloc(sizeof(struct app_state));
+	if (!state) {
+		fprintf(stderr, "Failed to allocate conversion state\n");
+		return false;
+	}
+
+	app_state_init(state);
+
+	bool success = false;
+	if (song_binary_is_binary_file(input_path)) {
+		if (song_binary_load_into_state(state, input_path)) {
+			success = song_saver_save_to_file(state, output_path);
+		}
+	} else if (song_loader_load_into_state(state, input_path)) {
+		success = song_binary_save_to_file(state, output_path);
+	}
+
+	app_state_deinit(state);
+	free(state);
+
+	if (success) {
+		printf("Converted %s to %s\n", input_path, output_path);
+	}
+	return success;
+}
@@ -0,0 +1,43 @@
+#ifndef SONG_BINARY_H
+#define SONG_BINARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct audio;
+struct app_state;
+struct song_binary_snapshot;
+
+#define SONG_BINARY_MAGIC "BSNG"
+#define SONG_BINARY_VERSION 1
+#define SONG_BINARY_EXTENSION ".bsong"
+
+#define SONG_BINARY_HEADER_SIZE 64
+#define SONG_BINARY_METADATA_SIZE 16
+#define SONG_BINARY_INSTRUMENT_SIZE 48
+#define SONG_BINARY_NOTE_SIZE 32
+
+bool song_binary_is_binary_file(const char *filepath);
+
+uint8_t *song_binary_encode(const struct app_state *state, size_t *size);
+
+struct song_binary_snapshot *song_binary_snapshot_create(const struct app_state *state);
+
+void song_binary_snapshot_free(struct song_binary_snapshot *snapshot);
+
+uint8_t *song_binary_snapshot_encode(const struct song_binary_snapshot *snapshot, size_t *size);
+
+bool song_binary_decode(
+	struct app_state *state, const uint8_t *data, size_t size, const char *source
+);
+
+bool song_binary_save_to_file(const struct app_state *state, const char *filepath);
+
+bool song_binary_load_into_state(struct app_state *state, const char *filepath);
+
+bool song_binary_load_from_file(struct audio *audio, struct app_state *state, const char *filepath);
+
+bool song_binary_convert(const char *input_path, const char *output_path);
+
+#endif
@@ -0,0 +1,486 @@
+#include "song_library.h"
+#include "app_state.h"
+#include "platform.h"
+#include "song_binary.h"
+#include "song_loader.h"
+
+#include <SDL3/SDL.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SONG_LIBRARY_CACHE_MAGIC "BLIB"
+#define SONG_LIBRARY_CACHE_VERSION 1
+#define SONG_LIBRARY_MAX_DEPTH 4
+
+struct song_library {
+	char directory[SONG_LIBRARY_PATH_SIZE];
+	char cache_path[SONG_LIBRARY_PATH_SIZE + 32];
+	struct song_library_entry *entries;
+	uint32_t entry_count;
+	SDL_Mutex *mutex;
+	SDL_Thread *thread;
+	SDL_AtomicInt scanning;
+	SDL_AtomicInt cancel;
+};
+
+struct cache_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_size;
+	uint32_t entry_count;
+};
+
+struct scan_context {
+	struct song_library *library;
+	struct app_state *state;
+	struct song_library_entry *entries;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t indexed;
+	const char *directory;
+	int depth;
+};
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct song_library_entry *entry_a = a;
+	const struct song_library_entry *entry_b = b;
+	return strcmp(entry_a->path, entry_b->path);
+}
+
+static bool has_extension(const char *name, const char *extension)
+{
+	size_t name_length = strlen(name);
+	size_t extension_length = strlen(extension);
+	return name_length > extension_length &&
+	       strcmp(name + name_length - extension_length, extension) == 0;
+}
+
+static void load_cache(struct song_library *library)
+{
+	struct platform_mapped_file mapped;
+	if (!platform_map_file(library->cache_path, &mapped)) {
+		return;
+	}
+
+	struct cache_header header;
+	if (mapped.size < sizeof(header)) {
+		platform_unmap_file(&mapped);
+		return;
+	}
+
+	memcpy(&header, mapped.data, sizeof(header));
+	if (memcmp(header.magic, SONG_LIBRARY_CACHE_MAGIC, 4) != 0 ||
+	    header.version != SONG_LIBRARY_CACHE_VERSION ||
+	    header.entry_size != sizeof(struct song_library_entry) ||
+	    header.entry_count > (mapped.size - sizeof(header)) / sizeof(struct song_library_entry)) {
+		fprintf(stderr, "Ignoring stale song library cache: %s\n", library->cache_path);
+		platform_unmap_file(&mapped);
+		return;
+	}
+
+	if (header.entry_count > 0) {
+		library->entries = malloc(sizeof(struct song_library_entry) * header.entry_count);
+		if (library->entries != NULL) {
+			memcpy(library->entries,
+			       mapped.data + sizeof(header),
+			       sizeof(struct song_library_entry) * header.entry_count);
+			library->entry_count = header.entry_count;
+		}
+	}
+
+	platform_unmap_file(&mapped);
+}
+
+static void save_cache(
+	struct song_library *library, const struct song_library_entry *entries, uint32_t count
+)
+{
+	char temp_path[sizeof(library->cache_path) + 8];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", library->cache_path);
+
+	FILE *file = fopen(temp_path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to write song library cache: %s\n", temp_path);
+		return;
+	}
+
+	struct cache_header header;
+	memcpy(header.magic, SONG_LIBRARY_CACHE_MAGIC, 4);
+	header.version = SONG_LIBRARY_CACHE_VERSION;
+	header.entry_size = sizeof(struct song_library_entry);
+	header.entry_count = count;
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		       fwrite(entries, sizeof(struct song_library_entry), count, file) == count;
+	if (fclose(file) != 0) {
+		success = false;
+	}
+
+	if (!success || !platform_replace_file(temp_path, library->cache_path)) {
+		fprintf(stderr, "Failed to write song library cache: %s\n", library->cache_path);
+		remove(temp_path);
+	}
+}
+
+static void index_song(const struct app_state *state, struct song_library_entry *entry)
+{
+	entry->bpm = state->bpm;
+	entry->note_count = note_store_count(&state->notes);
+	entry->voice_mask = 0;
+	entry->length_ms = 0;
+	memset(entry->thumbnail, 0, sizeof(entry->thumbnail));
+
+	for (uint32_t i = 0; i < entry->note_count; i++) {
+		const struct ui_note *note = note_store_at(&state->notes, i);
+		uint32_t end_ms = note->ms + note->duration_ms;
+		if (end_ms > entry->length_ms) {
+			entry->length_ms = end_ms;
+		}
+		if (note->voice < 16) {
+			entry->voice_mask |= (uint16_t)(1u << note->voice);
+		}
+	}
+
+	if (entry->length_ms == 0) {
+		return;
+	}
+
+	uint32_t density[SONG_LIBRARY_THUMBNAIL_SIZE] = {0};
+	uint32_t max_density = 0;
+
+	for (uint32_t i = 0; i < entry->note_count; i++) {
+		const struct ui_note *note = note_store_at(&state->notes, i);
+		uint64_t first = (uint64_t)note->ms * SONG_LIBRARY_THUMBNAIL_SIZE / entry->length_ms;
+		uint64_t last = (uint64_t)(note->ms + note->duration_ms) * SONG_LIBRARY_THUMBNAIL_SIZE /
+				entry->length_ms;
+		if (last >= SONG_LIBRARY_THUMBNAIL_SIZE) {
+			last = SONG_LIBRARY_THUMBNAIL_SIZE - 1;
+		}
+
+		for (uint64_t bucket = first; bucket <= last; bucket++) {
+			density[bucket]++;
+			if (density[bucket] > max_density) {
+				max_density = density[bucket];
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < SONG_LIBRARY_THUMBNAIL_SIZE; i++) {
+		entry->thumbnail[i] = (uint8_t)((density[i] * 255 + max_density - 1) / max_density);
+	}
+}
+
+static void index_file(struct scan_context *context, struct song_library_entry *entry)
+{
+	struct app_state *state = context->state;
+	app_state_clear_notes(state);
+	state->bpm = 120;
+
+	bool loaded = false;
+	if (has_extension(entry->path, SONG_BINARY_EXTENSION)) {
+		struct platform_mapped_file mapped;
+		if (platform_map_file(entry->path, &mapped)) {
+			loaded = song_binary_decode(state, mapped.data, mapped.size, entry->path);
+			platform_unmap_file(&mapped);
+		}
+	} else {
+		loaded = song_loader_load_into_state_quietly(state, entry->path);
+	}
+
+	entry->valid = loaded;
+	if (loaded) {
+		index_song(state, entry);
+	}
+	context->indexed++;
+}
+
+static const struct song_library_entry *
+find_cached_entry(const struct song_library *library, const char *path)
+{
+	struct song_library_entry key;
+	strncpy(key.path, path, sizeof(key.path) - 1);
+	key.path[sizeof(key.path) - 1] = '\0';
+
+	return bsearch(
+		&key,
+		library->entries,
+		library->entry_count,
+		sizeof(struct song_library_entry),
+		compare_entries
+	);
+}
+
+static bool scan_visit(const struct platform_file_info *info, void *user_data);
+
+static bool scan_add_file(struct scan_context *context, const struct platform_file_info *info)
+{
+	if (context->count >= context->capacity) {
+		uint32_t capacity = context->capacity > 0 ? context->capacity * 2 : 64;
+		struct song_library_entry *entries =
+			realloc(context->entries, sizeof(struct song_library_entry) * capacity);
+		if (entries == NULL) {
+			fprintf(stderr, "Failed to grow song library\n");
+			return false;
+		}
+		context->entries = entries;
+		context->capacity = capacity;
+	}
+
+	struct song_library_entry *entry = &context->entries[context->count];
+	memset(entry, 0, sizeof(*entry));
+	snprintf(entry->path, sizeof(entry->path), "%s/%s", context->directory, info->name);
+
+	const struct song_library_entry *cached = find_cached_entry(context->library, entry->path);
+	if (cached != NULL && cached->modified_time == info->modified_time &&
+	    cached->file_size == info->size) {
+		*entry = *cached;
+	} else {
+		entry->modified_time = info->modified_time;
+		entry->file_size = info->size;
+		index_file(context, entry);
+	}
+
+	context->count++;
+	return true;
+}
+
+static bool scan_visit(const struct platform_file_info *info, void *user_data)
+{
+	struct scan_context *context = user_data;
+
+	if (SDL_GetAtomicInt(&context->library->cancel) != 0) {
+		return false;
+	}
+
+	if (info->is_directory) {
+		if (info->name[0] == '.' || context->depth >= SONG_LIBRARY_MAX_DEPTH) {
+			return true;
+		}
+
+		char subdirectory[SONG_LIBRARY_PATH_SIZE];
+		snprintf(subdirectory, sizeof(subdirectory), "%s/%s", context->directory, info->name);
+
+		const char *parent = context->directory;
+		context->directory = subdirectory;
+		context->depth++;
+		platform_list_directory(subdirectory, scan_visit, context);
+		context->depth--;
+		context->directory = parent;
+		return true;
+	}
+
+	if (!has_extension(info->name, ".json") && !has_extension(info->name, SONG_BINARY_EXTENSION)) {
+		return true;
+	}
+
+	return scan_add_file(context, info);
+}
+
+static int scan_thread(void *data)
+{
+	struct song_library *library = data;
+
+	struct scan_context context;
+	memset(&context, 0, sizeof(context));
+	context.library = library;
+	context.directory = library->directory;
+	context.state = malloc(sizeof(struct app_state));
+
+	if (context.state == NULL) {
+		fprintf(stderr, "Failed to allocate song library scan state\n");
+		SDL_SetAtomicInt(&library->scanning, 0);
+		return 0;
+	}
+
+	app_state_init(context.state);
+
+	uint64_t start = SDL_GetPerformanceCounter();
+	platform_list_directory(library->directory, scan_visit, &context);
+	app_state_deinit(context.state);
+	free(context.state);
+
+	if (SDL_GetAtomicInt(&library->cancel) != 0) {
+		free(context.entries);
+		SDL_SetAtomicInt(&library->scanning, 0);
+		return 0;
+	}
+
+	qsort(context.entries, context.count, sizeof(struct song_library_entry), compare_entries);
+
+	if (context.indexed > 0 || context.count != library->entry_count) {
+		save_cache(library, context.entries, context.count);
+	}
+
+	SDL_LockMutex(library->mutex);
+	struct song_library_entry *old_entries = library->entries;
+	library->entries = context.entries;
+	library->entry_count = context.count;
+	SDL_UnlockMutex(library->mutex);
+
+	free(old_entries);
+
+	double elapsed_ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 /
+			    (double)SDL_GetPerformanceFrequency();
+	printf("Song library: %u songs, %u indexed in %.1f ms\n",
+	       context.count,
+	       context.indexed,
+	       elapsed_ms);
+
+	SDL_SetAtomicInt(&library->scanning, 0);
+	return 0;
+}
+
+struct song_library *song_library_create(const char *directory)
+{
+	if (directory == NULL) {
+		return NULL;
+	}
+
+	struct song_library *library = calloc(1, sizeof(struct song_library));
+	if (library == NULL) {
+		fprintf(stderr, "Failed to allocate song library\n");
+		return NULL;
+	}
+
+	strncpy(library->directory, directory, sizeof(library->directory) - 1);
+	snprintf(
+		library->cache_path,
+		sizeof(library->cache_path),
+		"%s/%s",
+		library->directory,
+		SONG_LIBRARY_CACHE_FILE
+	);
+
+	library->mutex = SDL_CreateMutex();
+	if (library->mutex == NULL) {
+		fprintf(stderr, "Failed to create song library mutex: %s\n", SDL_GetError());
+		free(library);
+		return NULL;
+	}
+
+	SDL_SetAtomicInt(&library->scanning, 0);
+	SDL_SetAtomicInt(&library->cancel, 0);
+
+	load_cache(library);
+	song_library_rescan(library);
+
+	return library;
+}
+
+void song_library_destroy(struct song_library *library)
+{
+	if (library == NULL) {
+		return;
+	}
+
+	SDL_SetAtomicInt(&library->cancel, 1);
+	if (library->thread != NULL) {
+		SDL_WaitThread(library->thread, NULL);
+	}
+
+	SDL_DestroyMutex(library->mutex);
+	free(library->entries);
+	free(library);
+}
+
+bool song_library_rescan(struct song_library *library)
+{
+	if (library == NULL || song_library_is_scanning(library)) {
+		return false;
+	}
+
+	if (library->thread != NULL) {
+		SDL_WaitThread(library->thread, NULL);
+		library->thread = NULL;
+	}
+
+	SDL_SetAtomicInt(&library->scanning, 1);
+	library->thread = SDL_CreateThread(scan_thread, "song_library", library);
+	if (library->thread == NULL) {
+		fprintf(stderr, "Failed to start song library scan: %s\n", SDL_GetError());
+		SDL_SetAtomicInt(&library->scanning, 0);
+		return false;
+	}
+
+	return true;
+}
+
+bool song_library_is_scanning(struct song_library *library)
+{
+	return library != NULL && SDL_GetAtomicInt(&library->scanning) != 0;
+}
+
+static bool name_contains(const char *path, const char *needle)
+{
+	const char *name = strrchr(path, '/');
+	name = name != NULL ? name + 1 : path;
+
+	size_t needle_length = strlen(needle);
+	for (const char *start = name; *start != '\0'; start++) {
+		size_t i = 0;
+		while (i < needle_length && start[i] != '\0' &&
+		       tolower((unsigned char)start[i]) == tolower((unsigned char)needle[i])) {
+			i++;
+		}
+		if (i == needle_length) {
+			return true;
+		}
+	}
+
+	return needle_length == 0;
+}
+
+static bool entry_matches(
+	const struct song_library_entry *entry, const struct song_library_filter *filter
+)
+{
+	if (!entry->valid) {
+		return false;
+	}
+	if (filter == NULL) {
+		return true;
+	}
+	if (filter->min_bpm > 0 && entry->bpm < filter->min_bpm) {
+		return false;
+	}
+	if (filter->max_bpm > 0 && entry->bpm > filter->max_bpm) {
+		return false;
+	}
+	if ((entry->voice_mask & filter->voice_mask) != filter->voice_mask) {
+		return false;
+	}
+	if (filter->name_contains != NULL && !name_contains(entry->path, filter->name_contains)) {
+		return false;
+	}
+	return true;
+}
+
+uint32_t song_library_query(
+	struct song_library *library,
+	const struct song_library_filter *filter,
+	struct song_library_entry *results,
+	uint32_t capacity
+)
+{
+	if (library == NULL) {
+		return 0;
+	}
+
+	uint32_t matches = 0;
+
+	SDL_LockMutex(library->mutex);
+	for (uint32_t i = 0; i < library->entry_count; i++) {
+		if (entry_matches(&library->entries[i], filter)) {
+			if (matches < capacity) {
+				results[matches] = library->entries[i];
+			}
+			matches++;
+		}
+	}
+	SDL_UnlockMutex(library->mutex);
+
+	return matches;
+}
@@ -0,0 +1,47 @@
+#ifndef SONG_LIBRARY_H
+#define SONG_LIBRARY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SONG_LIBRARY_PATH_SIZE 512
+#define SONG_LIBRARY_THUMBNAIL_SIZE 32
+#define SONG_LIBRARY_CACHE_FILE "song_library.cache"
+
+struct song_library;
+
+struct song_library_entry {
+	char path[SONG_LIBRARY_PATH_SIZE];
+	int64_t modified_time;
+	uint64_t file_size;
+	uint32_t bpm;
+	uint32_t length_ms;
+	uint32_t note_count;
+	uint16_t voice_mask;
+	bool valid;
+	uint8_t thumbnail[SONG_LIBRARY_THUMBNAIL_SIZE];
+};
+
+struct song_library_filter {
+	const char *name_contains;
+	uint32_t min_bpm;
+	uint32_t max_bpm;
+	uint16_t voice_mask;
+};
+
+struct song_library *song_library_create(const char *directory);
+
+void song_library_destroy(struct song_library *library);
+
+bool song_library_rescan(struct song_library *library);
+
+bool song_library_is_scanning(struct song_library *library);
+
+uint32_t song_library_query(
+	struct song_library *library,
+	const struct song_library_filter *filter,
+	struct song_library_entry *results,
+	uint32_t capacity
+);
+
+#endif
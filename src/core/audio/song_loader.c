@@ -1,28 +1,183 @@
 #include "song_loader.h"
 #include "app_state.h"
 #include "audio.h"
-#include "cJSON.h"
+#include "midi_importer.h"
+#include "platform.h"
 #include "scale.h"
 #include "sequencer.h"
+#include "song_binary.h"
 #include "synth.h"
 
 #include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static enum waveform_type string_to_waveform(const char *str)
+#define JSON_MAX_DEPTH 64
+#define JSON_MAX_KEY_LENGTH 32
+#define JSON_MAX_NUMBER_LENGTH 64
+
+struct json_reader {
+	const char *cursor;
+	const char *end;
+	const char *line_start;
+	uint32_t line;
+	bool failed;
+	bool verbose;
+	const char *filepath;
+};
+
+struct json_song {
+	struct note_store notes;
+	uint32_t next_note_id;
+	uint32_t saved_next_note_id;
+	uint32_t renumbered;
+	uint32_t bpm;
+	enum scale_type selected_scale;
+	enum root_note selected_root;
+	bool fold_mode;
+	bool show_scale_highlights;
+};
+
+enum root_field {
+	ROOT_FIELD_UNKNOWN,
+	ROOT_FIELD_BPM,
+	ROOT_FIELD_SELECTED_SCALE,
+	ROOT_FIELD_SELECTED_ROOT,
+	ROOT_FIELD_FOLD_MODE,
+	ROOT_FIELD_SHOW_SCALE_HIGHLIGHTS,
+	ROOT_FIELD_NEXT_NOTE_ID,
+	ROOT_FIELD_NOTES,
+};
+
+enum note_field {
+	NOTE_FIELD_UNKNOWN,
+	NOTE_FIELD_ID,
+	NOTE_FIELD_MS,
+	NOTE_FIELD_VOICE,
+	NOTE_FIELD_FREQUENCY_HZ,
+	NOTE_FIELD_DURATION_MS,
+	NOTE_FIELD_WAVEFORM,
+	NOTE_FIELD_AMPLITUDE_DBFS,
+	NOTE_FIELD_DUTY_CYCLE,
+	NOTE_FIELD_DECAY,
+	NOTE_FIELD_NES_NOISE_PERIOD,
+	NOTE_FIELD_NES_NOISE_MODE,
+	NOTE_FIELD_RESTART,
+	NOTE_FIELD_NES_NOISE_LFSR,
+};
+
+static enum root_field match_root_field(const char *key, size_t length)
 {
-	if (strcmp(str, "sine") == 0)
-		return WAVEFORM_SINE;
-	if (strcmp(str, "square") == 0)
-		return WAVEFORM_SQUARE;
-	if (strcmp(str, "triangle") == 0)
-		return WAVEFORM_TRIANGLE;
-	if (strcmp(str, "sawtooth") == 0)
-		return WAVEFORM_SAWTOOTH;
-	if (strcmp(str, "nes_noise") == 0)
-		return WAVEFORM_NES_NOISE;
+	switch (length) {
+	case 3:
+		if (memcmp(key, "bpm", 3) == 0)
+			return ROOT_FIELD_BPM;
+		break;
+	case 5:
+		if (memcmp(key, "notes", 5) == 0)
+			return ROOT_FIELD_NOTES;
+		break;
+	case 9:
+		if (key[0] == 'f' && memcmp(key, "fold_mode", 9) == 0)
+			return ROOT_FIELD_FOLD_MODE;
+		break;
+	case 12:
+		if (memcmp(key, "next_note_id", 12) == 0)
+			return ROOT_FIELD_NEXT_NOTE_ID;
+		break;
+	case 13:
+		if (memcmp(key, "selected_root", 13) == 0)
+			return ROOT_FIELD_SELECTED_ROOT;
+		break;
+	case 14:
+		if (memcmp(key, "selected_scale", 14) == 0)
+			return ROOT_FIELD_SELECTED_SCALE;
+		break;
+	case 21:
+		if (memcmp(key, "show_scale_highlights", 21) == 0)
+			return ROOT_FIELD_SHOW_SCALE_HIGHLIGHTS;
+		break;
+	}
+
+	return ROOT_FIELD_UNKNOWN;
+}
+
+static enum note_field match_note_field(const char *key, size_t length)
+{
+	switch (length) {
+	case 2:
+		if (key[0] == 'm' && key[1] == 's')
+			return NOTE_FIELD_MS;
+		if (key[0] == 'i' && key[1] == 'd')
+			return NOTE_FIELD_ID;
+		break;
+	case 5:
+		if (key[0] == 'v' && memcmp(key, "voice", 5) == 0)
+			return NOTE_FIELD_VOICE;
+		if (key[0] == 'd' && memcmp(key, "decay", 5) == 0)
+			return NOTE_FIELD_DECAY;
+		break;
+	case 7:
+		if (key[0] == 'r' && memcmp(key, "restart", 7) == 0)
+			return NOTE_FIELD_RESTART;
+		break;
+	case 8:
+		if (key[0] == 'w' && memcmp(key, "waveform", 8) == 0)
+			return NOTE_FIELD_WAVEFORM;
+		break;
+	case 10:
+		if (key[0] == 'd' && memcmp(key, "duty_cycle", 10) == 0)
+			return NOTE_FIELD_DUTY_CYCLE;
+		break;
+	case 11:
+		if (key[0] == 'd' && memcmp(key, "duration_ms", 11) == 0)
+			return NOTE_FIELD_DURATION_MS;
+		break;
+	case 12:
+		if (key[0] == 'f' && memcmp(key, "frequency_hz", 12) == 0)
+			return NOTE_FIELD_FREQUENCY_HZ;
+		break;
+	case 14:
+		if (key[0] == 'a' && memcmp(key, "amplitude_dbfs", 14) == 0)
+			return NOTE_FIELD_AMPLITUDE_DBFS;
+		if (key[10] == 'm' && memcmp(key, "nes_noise_mode", 14) == 0)
+			return NOTE_FIELD_NES_NOISE_MODE;
+		if (key[10] == 'l' && memcmp(key, "nes_noise_lfsr", 14) == 0)
+			return NOTE_FIELD_NES_NOISE_LFSR;
+		break;
+	case 16:
+		if (memcmp(key, "nes_noise_period", 16) == 0)
+			return NOTE_FIELD_NES_NOISE_PERIOD;
+		break;
+	}
+
+	return NOTE_FIELD_UNKNOWN;
+}
+
+static enum waveform_type string_to_waveform(const char *str, size_t length)
+{
+	switch (length) {
+	case 4:
+		if (memcmp(str, "sine", 4) == 0)
+			return WAVEFORM_SINE;
+		break;
+	case 6:
+		if (memcmp(str, "square", 6) == 0)
+			return WAVEFORM_SQUARE;
+		break;
+	case 8:
+		if (str[0] == 't' && memcmp(str, "triangle", 8) == 0)
+			return WAVEFORM_TRIANGLE;
+		if (str[0] == 's' && memcmp(str, "sawtooth", 8) == 0)
+			return WAVEFORM_SAWTOOTH;
+		break;
+	case 9:
+		if (memcmp(str, "nes_noise", 9) == 0)
+			return WAVEFORM_NES_NOISE;
+		break;
+	}
 
 	return WAVEFORM_SINE;
 }
@@ -40,193 +195,644 @@ static uint8_t frequency_to_piano_key(float frequency)
 	return (uint8_t)rounded;
 }
 
-static char *read_file(const char *filepath)
+static void reader_error(struct json_reader *reader, const char *format, ...)
 {
-	FILE *file = fopen(filepath, "rb");
-	if (!file) {
-		fprintf(stderr, "Failed to open file: %s\n", filepath);
-		return NULL;
+	if (reader->failed) {
+		return;
 	}
 
-	fseek(file, 0, SEEK_END);
-	long length = ftell(file);
-	fseek(file, 0, SEEK_SET);
+	reader->failed = true;
+
+	uint32_t column = (uint32_t)(reader->cursor - reader->line_start) + 1;
+	fprintf(stderr, "JSON parse error in %s:%u:%u: ", reader->filepath, reader->line, column);
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
 
-	char *content = malloc(length + 1);
-	if (!content) {
-		fclose(file);
-		return NULL;
+	fprintf(stderr, "\n");
+}
+
+static void skip_whitespace(struct json_reader *reader)
+{
+	while (reader->cursor < reader->end) {
+		char c = *reader->cursor;
+		if (c == '\n') {
+			reader->line++;
+			reader->line_start = reader->cursor + 1;
+		} else if (c != ' ' && c != '\t' && c != '\r') {
+			return;
+		}
+		reader->cursor++;
 	}
+}
 
-	size_t read_length = fread(content, 1, length, file);
-	content[read_length] = '\0';
-	fclose(file);
+static char peek(struct json_reader *reader)
+{
+	skip_whitespace(reader);
+	return reader->cursor < reader->end ? *reader->cursor : '\0';
+}
 
-	return content;
+static bool expect(struct json_reader *reader, char expected)
+{
+	if (peek(reader) != expected) {
+		if (reader->cursor >= reader->end) {
+			reader_error(reader, "expected '%c' but reached end of file", expected);
+		} else {
+			reader_error(reader, "expected '%c' but found '%c'", expected, *reader->cursor);
+		}
+		return false;
+	}
+
+	reader->cursor++;
+	return true;
 }
 
-bool song_loader_load_from_file(struct audio *audio, struct app_state *state, const char *filepath)
+static bool read_string(struct json_reader *reader, char *out, size_t out_size, size_t *out_length)
 {
-	char *json_content = read_file(filepath);
-	if (!json_content) {
+	if (!expect(reader, '"')) {
 		return false;
 	}
 
-	cJSON *root = cJSON_Parse(json_content);
-	free(json_content);
+	size_t length = 0;
+	while (reader->cursor < reader->end) {
+		char c = *reader->cursor++;
+
+		if (c == '"') {
+			if (out_size > 0) {
+				out[length < out_size ? length : out_size - 1] = '\0';
+			}
+			if (out_length) {
+				*out_length = length;
+			}
+			return true;
+		}
 
-	if (!root) {
-		const char *error_ptr = cJSON_GetErrorPtr();
-		if (error_ptr) {
-			fprintf(stderr, "JSON parse error before: %s\n", error_ptr);
+		if (c == '\n') {
+			reader_error(reader, "unterminated string");
+			return false;
 		}
-		return false;
+
+		if (c == '\\') {
+			if (reader->cursor >= reader->end) {
+				break;
+			}
+			c = *reader->cursor++;
+			switch (c) {
+			case 'n':
+				c = '\n';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'u':
+				if (reader->end - reader->cursor < 4) {
+					reader_error(reader, "truncated unicode escape");
+					return false;
+				}
+				reader->cursor += 4;
+				c = '?';
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (length + 1 < out_size) {
+			out[length] = c;
+		}
+		length++;
+	}
+
+	reader_error(reader, "unterminated string");
+	return false;
+}
+
+static bool read_number(struct json_reader *reader, double *out)
+{
+	skip_whitespace(reader);
+
+	const char *start = reader->cursor;
+	bool negative = false;
+	bool integral = true;
+	uint64_t integer = 0;
+
+	if (reader->cursor < reader->end && *reader->cursor == '-') {
+		negative = true;
+		reader->cursor++;
 	}
 
-	struct sequencer *sequencer = audio_get_sequencer(audio);
+	const char *digits = reader->cursor;
+	while (reader->cursor < reader->end && *reader->cursor >= '0' && *reader->cursor <= '9') {
+		integer = integer * 10 + (uint64_t)(*reader->cursor - '0');
+		reader->cursor++;
+	}
 
-	sequencer_clear_notes(sequencer);
-	sequencer_stop(sequencer);
+	if (reader->cursor == digits) {
+		reader_error(reader, "expected a number");
+		return false;
+	}
 
-	cJSON *bpm_item = cJSON_GetObjectItemCaseSensitive(root, "bpm");
-	if (cJSON_IsNumber(bpm_item)) {
-		uint32_t bpm = (uint32_t)bpm_item->valueint;
-		sequencer_set_bpm(sequencer, bpm);
-		if (state) {
-			state->bpm = bpm;
+	while (reader->cursor < reader->end) {
+		char c = *reader->cursor;
+		if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' ||
+		    c == '-') {
+			integral = false;
+			reader->cursor++;
+		} else {
+			break;
 		}
-		printf("Loaded song with BPM: %d\n", bpm);
 	}
 
-	cJSON *scale_item = cJSON_GetObjectItemCaseSensitive(root, "selected_scale");
-	if (cJSON_IsString(scale_item) && state) {
-		enum scale_type scale = scale_type_from_string(scale_item->valuestring);
-		state->selected_scale = scale;
-		printf("Loaded scale: %s\n", scale_item->valuestring);
+	if (integral && reader->cursor - digits < 19) {
+		*out = negative ? -(double)integer : (double)integer;
+		return true;
 	}
 
-	cJSON *root_item = cJSON_GetObjectItemCaseSensitive(root, "selected_root");
-	if (cJSON_IsString(root_item) && state) {
-		enum root_note root_note = root_note_from_string(root_item->valuestring);
-		state->selected_root = root_note;
-		printf("Loaded root note: %s\n", root_item->valuestring);
+	size_t length = (size_t)(reader->cursor - start);
+	if (length >= JSON_MAX_NUMBER_LENGTH) {
+		reader_error(reader, "number too long");
+		return false;
 	}
 
-	cJSON *fold_mode_item = cJSON_GetObjectItemCaseSensitive(root, "fold_mode");
-	if (cJSON_IsBool(fold_mode_item) && state) {
-		state->fold_mode = cJSON_IsTrue(fold_mode_item);
-		printf("Loaded fold_mode: %s\n", state->fold_mode ? "true" : "false");
+	char buffer[JSON_MAX_NUMBER_LENGTH];
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+
+	char *parse_end = NULL;
+	*out = strtod(buffer, &parse_end);
+	if (parse_end != buffer + length) {
+		reader->cursor = start + (parse_end - buffer);
+		reader_error(reader, "malformed number");
+		return false;
 	}
 
-	cJSON *show_scale_highlights_item =
-		cJSON_GetObjectItemCaseSensitive(root, "show_scale_highlights");
-	if (cJSON_IsBool(show_scale_highlights_item) && state) {
-		state->show_scale_highlights = cJSON_IsTrue(show_scale_highlights_item);
-		printf("Loaded show_scale_highlights: %s\n",
-		       state->show_scale_highlights ? "true" : "false");
+	return true;
+}
+
+static bool read_literal(struct json_reader *reader, const char *literal)
+{
+	size_t length = strlen(literal);
+	if ((size_t)(reader->end - reader->cursor) < length ||
+	    memcmp(reader->cursor, literal, length) != 0) {
+		reader_error(reader, "invalid literal");
+		return false;
 	}
 
-	cJSON *notes_array = cJSON_GetObjectItemCaseSensitive(root, "notes");
-	if (!cJSON_IsArray(notes_array)) {
-		fprintf(stderr, "No notes array found in JSON\n");
-		cJSON_Delete(root);
-		return false;
-	}
-
-	int note_count = 0;
-	cJSON *note_item = NULL;
-	cJSON_ArrayForEach(note_item, notes_array)
-	{
-		struct note_params params = {
-			.frequency = 440.0f,
-			.duration_ms = 200.0f,
-			.waveform = WAVEFORM_SINE,
-			.duty_cycle = 128,
-			.decay = 0,
-			.amplitude_dbfs = -3,
-			.nes_noise_period = 15,
-			.nes_noise_mode_flag = false,
-			.voice_index = -1,
-			.restart_phase = true,
-			.nes_noise_lfsr_init = 0xFFFF,
-			.piano_key = 60
-		};
-
-		cJSON *ms = cJSON_GetObjectItemCaseSensitive(note_item, "ms");
-		cJSON *voice = cJSON_GetObjectItemCaseSensitive(note_item, "voice");
-		cJSON *frequency_hz = cJSON_GetObjectItemCaseSensitive(note_item, "frequency_hz");
-		cJSON *duration_ms = cJSON_GetObjectItemCaseSensitive(note_item, "duration_ms");
-		cJSON *waveform = cJSON_GetObjectItemCaseSensitive(note_item, "waveform");
-		cJSON *amplitude_dbfs =
-			cJSON_GetObjectItemCaseSensitive(note_item, "amplitude_dbfs");
-		cJSON *duty_cycle = cJSON_GetObjectItemCaseSensitive(note_item, "duty_cycle");
-		cJSON *decay = cJSON_GetObjectItemCaseSensitive(note_item, "decay");
-		cJSON *nes_noise_period =
-			cJSON_GetObjectItemCaseSensitive(note_item, "nes_noise_period");
-		cJSON *nes_noise_mode =
-			cJSON_GetObjectItemCaseSensitive(note_item, "nes_noise_mode");
-		cJSON *restart = cJSON_GetObjectItemCaseSensitive(note_item, "restart");
-		cJSON *nes_noise_lfsr =
-			cJSON_GetObjectItemCaseSensitive(note_item, "nes_noise_lfsr");
-
-		if (!cJSON_IsNumber(ms)) {
-			fprintf(stderr, "Note missing 'ms' field, skipping\n");
-			continue;
-		}
+	reader->cursor += length;
+	return true;
+}
 
-		uint32_t start_ms = (uint32_t)ms->valueint;
+static bool read_bool(struct json_reader *reader, bool *out)
+{
+	char c = peek(reader);
+	if (c == 't') {
+		*out = true;
+		return read_literal(reader, "true");
+	}
+	if (c == 'f') {
+		*out = false;
+		return read_literal(reader, "false");
+	}
 
-		if (cJSON_IsNumber(voice)) {
-			params.voice_index = (int8_t)voice->valueint;
-		}
+	reader_error(reader, "expected a boolean");
+	return false;
+}
 
-		if (cJSON_IsNumber(frequency_hz)) {
-			params.frequency = (float)frequency_hz->valuedouble;
-			params.piano_key = frequency_to_piano_key(params.frequency);
-		}
+static bool skip_value(struct json_reader *reader, uint32_t depth)
+{
+	if (depth > JSON_MAX_DEPTH) {
+		reader_error(reader, "nesting too deep");
+		return false;
+	}
 
-		if (cJSON_IsNumber(duration_ms)) {
-			params.duration_ms = (float)duration_ms->valueint;
+	char c = peek(reader);
+	switch (c) {
+	case '"':
+		return read_string(reader, NULL, 0, NULL);
+	case 't':
+		return read_literal(reader, "true");
+	case 'f':
+		return read_literal(reader, "false");
+	case 'n':
+		return read_literal(reader, "null");
+	case '{':
+	case '[': {
+		char close = c == '{' ? '}' : ']';
+		reader->cursor++;
+		if (peek(reader) == close) {
+			reader->cursor++;
+			return true;
 		}
-
-		if (cJSON_IsString(waveform)) {
-			params.waveform = string_to_waveform(waveform->valuestring);
+		for (;;) {
+			if (c == '{') {
+				if (!read_string(reader, NULL, 0, NULL) || !expect(reader, ':')) {
+					return false;
+				}
+			}
+			if (!skip_value(reader, depth + 1)) {
+				return false;
+			}
+			if (peek(reader) == ',') {
+				reader->cursor++;
+				continue;
+			}
+			return expect(reader, close);
 		}
+	}
+	default: {
+		double ignored;
+		return read_number(reader, &ignored);
+	}
+	}
+}
 
-		if (cJSON_IsNumber(amplitude_dbfs)) {
-			params.amplitude_dbfs = (int8_t)amplitude_dbfs->valueint;
-		}
+static bool read_note(struct json_reader *reader, struct json_song *song, uint32_t *note_count)
+{
+	struct ui_note note = {
+		.frequency = 440.0f,
+		.duration_ms = 200,
+		.waveform = WAVEFORM_SINE,
+		.duty_cycle = 128,
+		.decay = 0,
+		.amplitude_dbfs = -3,
+		.nes_noise_period = 15,
+		.nes_noise_mode_flag = false,
+		.voice = 0,
+		.restart_phase = true,
+		.nes_noise_lfsr_init = 0xFFFF,
+		.piano_key = 60
+	};
+	bool has_ms = false;
+	bool has_id = false;
+
+	uint32_t note_line = reader->line;
+
+	if (!expect(reader, '{')) {
+		return false;
+	}
 
-		if (cJSON_IsNumber(duty_cycle)) {
-			params.duty_cycle = (uint8_t)duty_cycle->valueint;
+	if (peek(reader) == '}') {
+		reader->cursor++;
+	} else {
+		for (;;) {
+			char key[JSON_MAX_KEY_LENGTH];
+			size_t key_length = 0;
+			if (!read_string(reader, key, sizeof(key), &key_length) ||
+			    !expect(reader, ':')) {
+				return false;
+			}
+
+			enum note_field field = key_length < sizeof(key)
+							? match_note_field(key, key_length)
+							: NOTE_FIELD_UNKNOWN;
+			double number = 0.0;
+			bool ok = true;
+
+			switch (field) {
+			case NOTE_FIELD_ID:
+				ok = read_number(reader, &number);
+				has_id = ok && number >= 1.0 && number < (double)UINT32_MAX;
+				note.id = has_id ? (uint32_t)number : 0;
+				break;
+			case NOTE_FIELD_MS:
+				ok = read_number(reader, &number);
+				note.ms = number > 0.0 ? (uint32_t)number : 0;
+				has_ms = ok;
+				break;
+			case NOTE_FIELD_VOICE:
+				ok = read_number(reader, &number);
+				note.voice = number > 0.0 ? (uint8_t)number : 0;
+				break;
+			case NOTE_FIELD_FREQUENCY_HZ:
+				ok = read_number(reader, &number);
+				note.frequency = (float)number;
+				note.piano_key = frequency_to_piano_key(note.frequency);
+				break;
+			case NOTE_FIELD_DURATION_MS:
+				ok = read_number(reader, &number);
+				note.duration_ms = (uint16_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_WAVEFORM: {
+				char value[JSON_MAX_KEY_LENGTH];
+				size_t value_length = 0;
+				ok = read_string(reader, value, sizeof(value), &value_length);
+				note.waveform = string_to_waveform(value, value_length);
+				break;
+			}
+			case NOTE_FIELD_AMPLITUDE_DBFS:
+				ok = read_number(reader, &number);
+				note.amplitude_dbfs = (int8_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_DUTY_CYCLE:
+				ok = read_number(reader, &number);
+				note.duty_cycle = (uint8_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_DECAY:
+				ok = read_number(reader, &number);
+				note.decay = (int16_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_NES_NOISE_PERIOD:
+				ok = read_number(reader, &number);
+				note.nes_noise_period = (uint8_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_NES_NOISE_MODE:
+				ok = read_bool(reader, &note.nes_noise_mode_flag);
+				break;
+			case NOTE_FIELD_RESTART:
+				ok = read_bool(reader, &note.restart_phase);
+				break;
+			case NOTE_FIELD_NES_NOISE_LFSR:
+				ok = read_number(reader, &number);
+				note.nes_noise_lfsr_init = (uint16_t)(int32_t)number;
+				break;
+			case NOTE_FIELD_UNKNOWN:
+				ok = skip_value(reader, 2);
+				break;
+			}
+
+			if (!ok) {
+				return false;
+			}
+
+			if (peek(reader) == ',') {
+				reader->cursor++;
+				continue;
+			}
+			if (!expect(reader, '}')) {
+				return false;
+			}
+			break;
 		}
+	}
 
-		if (cJSON_IsNumber(decay)) {
-			params.decay = (int16_t)decay->valueint;
-		}
+	if (!has_ms) {
+		fprintf(stderr, "Note at line %u missing 'ms' field, skipping\n", note_line);
+		return true;
+	}
 
-		if (cJSON_IsNumber(nes_noise_period)) {
-			params.nes_noise_period = (uint8_t)nes_noise_period->valueint;
-		}
+	if (has_id && note_store_index_of(&song->notes, note.id, NULL)) {
+		song->renumbered++;
+		has_id = false;
+	}
+	if (!has_id) {
+		note.id = song->next_note_id;
+	}
+	if (note.id >= song->next_note_id) {
+		song->next_note_id = note.id + 1;
+	}
 
-		if (cJSON_IsBool(nes_noise_mode)) {
-			params.nes_noise_mode_flag = cJSON_IsTrue(nes_noise_mode);
-		}
+	if (!note_store_add(&song->notes, &note)) {
+		return false;
+	}
+	(*note_count)++;
+	return true;
+}
 
-		if (cJSON_IsBool(restart)) {
-			params.restart_phase = cJSON_IsTrue(restart);
+static bool read_notes(struct json_reader *reader, struct json_song *song, uint32_t *note_count)
+{
+	if (!expect(reader, '[')) {
+		return false;
+	}
+
+	if (peek(reader) == ']') {
+		reader->cursor++;
+		return true;
+	}
+
+	for (;;) {
+		if (!read_note(reader, song, note_count)) {
+			return false;
 		}
+		if (peek(reader) == ',') {
+			reader->cursor++;
+			continue;
+		}
+		return expect(reader, ']');
+	}
+}
 
-		if (cJSON_IsNumber(nes_noise_lfsr)) {
-			params.nes_noise_lfsr_init = (uint16_t)nes_noise_lfsr->valueint;
+static bool read_song(struct json_reader *reader, struct json_song *song)
+{
+	if (!expect(reader, '{')) {
+		return false;
+	}
+
+	bool has_notes = false;
+	uint32_t note_count = 0;
+
+	if (peek(reader) == '}') {
+		reader->cursor++;
+	} else {
+		for (;;) {
+			char key[JSON_MAX_KEY_LENGTH];
+			size_t key_length = 0;
+			if (!read_string(reader, key, sizeof(key), &key_length) ||
+			    !expect(reader, ':')) {
+				return false;
+			}
+
+			enum root_field field = key_length < sizeof(key)
+							? match_root_field(key, key_length)
+							: ROOT_FIELD_UNKNOWN;
+			char value[JSON_MAX_KEY_LENGTH];
+			double number = 0.0;
+			bool ok = true;
+
+			switch (field) {
+			case ROOT_FIELD_BPM:
+				ok = read_number(reader, &number);
+				if (ok && number >= 1.0) {
+					song->bpm = (uint32_t)number;
+					if (reader->verbose) {
+						printf("Loaded song with BPM: %u\n", song->bpm);
+					}
+				}
+				break;
+			case ROOT_FIELD_SELECTED_SCALE:
+				ok = read_string(reader, value, sizeof(value), NULL);
+				if (ok) {
+					song->selected_scale = scale_type_from_string(value);
+					if (reader->verbose) {
+						printf("Loaded scale: %s\n", value);
+					}
+				}
+				break;
+			case ROOT_FIELD_SELECTED_ROOT:
+				ok = read_string(reader, value, sizeof(value), NULL);
+				if (ok) {
+					song->selected_root = root_note_from_string(value);
+					if (reader->verbose) {
+						printf("Loaded root note: %s\n", value);
+					}
+				}
+				break;
+			case ROOT_FIELD_FOLD_MODE:
+				ok = read_bool(reader, &song->fold_mode);
+				if (ok && reader->verbose) {
+					printf("Loaded fold_mode: %s\n",
+					       song->fold_mode ? "true" : "false");
+				}
+				break;
+			case ROOT_FIELD_SHOW_SCALE_HIGHLIGHTS:
+				ok = read_bool(reader, &song->show_scale_highlights);
+				if (ok && reader->verbose) {
+					printf("Loaded show_scale_highlights: %s\n",
+					       song->show_scale_highlights ? "true" : "false");
+				}
+				break;
+			case ROOT_FIELD_NEXT_NOTE_ID:
+				ok = read_number(reader, &number);
+				if (ok && number >= 1.0 && number < (double)UINT32_MAX) {
+					song->saved_next_note_id = (uint32_t)number;
+				}
+				break;
+			case ROOT_FIELD_NOTES:
+				ok = read_notes(reader, song, &note_count);
+				has_notes = ok;
+				break;
+			case ROOT_FIELD_UNKNOWN:
+				ok = skip_value(reader, 1);
+				break;
+			}
+
+			if (!ok) {
+				return false;
+			}
+
+			if (peek(reader) == ',') {
+				reader->cursor++;
+				continue;
+			}
+			if (!expect(reader, '}')) {
+				return false;
+			}
+			break;
 		}
+	}
+
+	if (peek(reader) != '\0') {
+		reader_error(reader, "unexpected data after song object");
+		return false;
+	}
 
-		sequencer_add_note(sequencer, start_ms, params);
-		note_count++;
+	if (!has_notes) {
+		fprintf(stderr, "No notes array found in JSON\n");
+		return false;
 	}
 
-	cJSON_Delete(root);
+	if (song->saved_next_note_id > song->next_note_id) {
+		song->next_note_id = song->saved_next_note_id;
+	}
+
+	if (song->renumbered > 0) {
+		fprintf(stderr,
+			"%u notes in %s had duplicate ids and were renumbered\n",
+			song->renumbered,
+			reader->filepath);
+	}
 
-	printf("Loaded %d notes from %s\n", note_count, filepath);
+	if (reader->verbose) {
+		printf("Loaded %u notes from %s\n", note_count, reader->filepath);
+	}
 	return true;
 }
+
+static bool load_json_into_state(struct app_state *state, const char *filepath, bool verbose)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for load\n");
+		return false;
+	}
+
+	struct platform_mapped_file mapped;
+	if (!platform_map_file(filepath, &mapped)) {
+		fprintf(stderr, "Failed to open file: %s\n", filepath);
+		return false;
+	}
+
+	struct json_reader reader = {
+		.cursor = (const char *)mapped.data,
+		.end = (const char *)mapped.data + mapped.size,
+		.line_start = (const char *)mapped.data,
+		.line = 1,
+		.failed = false,
+		.verbose = verbose,
+		.filepath = filepath,
+	};
+
+	struct json_song song = {
+		.next_note_id = 1,
+		.bpm = state->bpm,
+		.selected_scale = state->selected_scale,
+		.selected_root = state->selected_root,
+		.fold_mode = state->fold_mode,
+		.show_scale_highlights = state->show_scale_highlights,
+	};
+	note_store_init(&song.notes);
+
+	bool success = read_song(&reader, &song);
+	platform_unmap_file(&mapped);
+
+	if (success) {
+		app_state_clear_notes(state);
+		success = note_store_copy(&state->notes, &song.notes);
+		state->next_note_id = song.next_note_id;
+		state->bpm = song.bpm;
+		state->selected_scale = song.selected_scale;
+		state->selected_root = song.selected_root;
+		state->fold_mode = song.fold_mode;
+		state->show_scale_highlights = song.show_scale_highlights;
+	}
+
+	note_store_free(&song.notes);
+	return success;
+}
+
+bool song_loader_load_into_state(struct app_state *state, const char *filepath)
+{
+	return load_json_into_state(state, filepath, true);
+}
+
+bool song_loader_load_into_state_quietly(struct app_state *state, const char *filepath)
+{
+	return load_json_into_state(state, filepath, false);
+}
+
+bool song_loader_load_from_file(struct audio *audio, struct app_state *state, const char *filepath)
+{
+	if (!audio || !state || !filepath) {
+		fprintf(stderr, "Invalid parameters for load\n");
+		return false;
+	}
+
+	bool success;
+	if (song_binary_is_binary_file(filepath)) {
+		success = song_binary_load_from_file(audio, state, filepath);
+	} else if (midi_importer_is_midi_file(filepath)) {
+		success = midi_importer_load_from_file(audio, state, filepath);
+	} else {
+		success = song_loader_load_into_state(state, filepath);
+		if (success) {
+			struct sequencer *sequencer = audio_get_sequencer(audio);
+			sequencer_stop(sequencer);
+			sequencer_set_bpm(sequencer, state->bpm);
+			app_state_sync_notes_to_sequencer(state, sequencer, audio);
+		}
+	}
+
+	if (success) {
+		state->load_count++;
+	}
+	return success;
+}
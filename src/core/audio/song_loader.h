@@ -9,4 +9,8 @@ struct app_state;
 
 bool song_loader_load_from_file(struct audio *audio, struct app_state *state, const char *filepath);
 
+bool song_loader_load_into_state(struct app_state *state, const char *filepath);
+
+bool song_loader_load_into_state_quietly(struct app_state *state, const char *filepath);
+
 #endif
@@ -1,14 +1,40 @@
 #include "song_saver.h"
 #include "app_state.h"
-#include "cJSON.h"
+#include "c_exporter.h"
+#include "platform.h"
 #include "scale.h"
 #include "sequencer.h"
 #include "synth.h"
+#include "wav_exporter.h"
 
+#include <SDL3/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define SONG_SAVER_BUFFER_SIZE (64 * 1024)
+#define SONG_SAVER_PATH_SIZE 512
+
+struct song_snapshot {
+	uint32_t bpm;
+	uint32_t next_note_id;
+	enum scale_type selected_scale;
+	enum root_note selected_root;
+	bool fold_mode;
+	bool show_scale_highlights;
+	struct note_snapshot notes;
+};
+
+struct song_save_job {
+	struct song_snapshot snapshot;
+	char json_path[SONG_SAVER_PATH_SIZE];
+	char c_path[SONG_SAVER_PATH_SIZE];
+	char wav_path[SONG_SAVER_PATH_SIZE];
+	SDL_Thread *thread;
+	SDL_AtomicInt done;
+	bool success;
+};
+
 static const char *waveform_to_string(enum waveform_type waveform)
 {
 	switch (waveform) {
@@ -27,13 +53,29 @@ static const char *waveform_to_string(enum waveform_type waveform)
 	}
 }
 
-static uint32_t calculate_song_length_ms(const struct sequencer *sequencer)
+static void snapshot_create(const struct app_state *state, struct song_snapshot *snapshot)
+{
+	snapshot->bpm = state->bpm;
+	snapshot->next_note_id = state->next_note_id;
+	snapshot->selected_scale = state->selected_scale;
+	snapshot->selected_root = state->selected_root;
+	snapshot->fold_mode = state->fold_mode;
+	snapshot->show_scale_highlights = state->show_scale_highlights;
+	note_store_snapshot(&state->notes, &snapshot->notes);
+}
+
+static void snapshot_free(struct song_snapshot *snapshot)
+{
+	note_snapshot_release(&snapshot->notes);
+}
+
+static uint32_t calculate_song_length_ms(const struct song_snapshot *snapshot)
 {
 	uint32_t max_end_time = 0;
 
-	for (uint32_t i = 0; i < sequencer->note_count; i++) {
-		const struct note *note = &sequencer->notes[i];
-		uint32_t end_time = note->time_ms + (uint32_t)note->params.duration_ms;
+	for (uint32_t i = 0; i < note_snapshot_count(&snapshot->notes); i++) {
+		const struct ui_note *note = note_snapshot_at(&snapshot->notes, i);
+		uint32_t end_time = note->ms + (uint32_t)note->duration_ms;
 
 		if (end_time > max_end_time) {
 			max_end_time = end_time;
@@ -43,103 +85,206 @@ static uint32_t calculate_song_length_ms(const struct sequencer *sequencer)
 	return max_end_time > 0 ? max_end_time : 1000;
 }
 
-bool song_saver_save_to_file(
-	const struct app_state *state, const struct sequencer *sequencer, const char *filepath
-)
+static void write_song_json(const struct song_snapshot *snapshot, FILE *file)
 {
-	if (!state || !sequencer || !filepath) {
-		fprintf(stderr, "Invalid parameters for save\n");
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": \"1.0\",\n");
+	fprintf(file, "  \"bpm\": %u,\n", snapshot->bpm);
+	fprintf(file, "  \"length_ms\": %u,\n", calculate_song_length_ms(snapshot));
+	fprintf(file, "  \"next_note_id\": %u,\n", snapshot->next_note_id);
+	fprintf(file, "  \"selected_scale\": \"%s\",\n", scale_type_to_string(snapshot->selected_scale));
+	fprintf(file, "  \"selected_root\": \"%s\",\n", root_note_to_string(snapshot->selected_root));
+	fprintf(file, "  \"fold_mode\": %s,\n", snapshot->fold_mode ? "true" : "false");
+	fprintf(file,
+		"  \"show_scale_highlights\": %s,\n",
+		snapshot->show_scale_highlights ? "true" : "false");
+	fprintf(file, "  \"notes\": [");
+
+	for (uint32_t i = 0; i < note_snapshot_count(&snapshot->notes); i++) {
+		const struct ui_note *note = note_snapshot_at(&snapshot->notes, i);
+
+		fprintf(file, i == 0 ? "\n    {\n" : ",\n    {\n");
+		fprintf(file, "      \"id\": %u,\n", note->id);
+		fprintf(file, "      \"ms\": %u,\n", note->ms);
+		fprintf(file, "      \"voice\": %u,\n", note->voice);
+		fprintf(file, "      \"frequency_hz\": %.9g,\n", (double)note->frequency);
+		fprintf(file, "      \"duration_ms\": %u,\n", note->duration_ms);
+		fprintf(file, "      \"waveform\": \"%s\",\n", waveform_to_string(note->waveform));
+		fprintf(file, "      \"amplitude_dbfs\": %d,\n", note->amplitude_dbfs);
+		fprintf(file, "      \"duty_cycle\": %u,\n", note->duty_cycle);
+		fprintf(file, "      \"decay\": %d,\n", note->decay);
+		fprintf(file, "      \"phase\": 0,\n");
+		fprintf(file, "      \"restart\": %s,\n", note->restart_phase ? "true" : "false");
+		fprintf(file,
+			"      \"nes_noise_mode\": %s,\n",
+			note->nes_noise_mode_flag ? "true" : "false");
+		fprintf(file, "      \"nes_noise_lfsr\": %u,\n", note->nes_noise_lfsr_init);
+		fprintf(file, "      \"nes_noise_period\": %u\n", note->nes_noise_period);
+		fprintf(file, "    }");
+	}
+
+	fprintf(file, note_snapshot_count(&snapshot->notes) > 0 ? "\n  ]\n}\n" : "]\n}\n");
+}
+
+static bool save_snapshot_to_file(const struct song_snapshot *snapshot, const char *filepath)
+{
+	char temp_path[SONG_SAVER_PATH_SIZE + 8];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", filepath);
+
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open file for writing: %s\n", temp_path);
 		return false;
 	}
 
-	cJSON *root = cJSON_CreateObject();
-	if (!root) {
-		fprintf(stderr, "Failed to create JSON object\n");
+	setvbuf(file, NULL, _IOFBF, SONG_SAVER_BUFFER_SIZE);
+
+	write_song_json(snapshot, file);
+
+	bool success = !ferror(file) && platform_sync_file(file);
+	if (fclose(file) != 0) {
+		success = false;
+	}
+
+	if (!success) {
+		fprintf(stderr, "Failed to write complete JSON to file: %s\n", temp_path);
+		remove(temp_path);
 		return false;
 	}
 
-	cJSON_AddStringToObject(root, "version", "1.0");
-	cJSON_AddNumberToObject(root, "bpm", sequencer->bpm);
+	if (!platform_replace_file(temp_path, filepath)) {
+		fprintf(stderr, "Failed to replace %s with %s\n", filepath, temp_path);
+		remove(temp_path);
+		return false;
+	}
 
-	uint32_t length_ms = calculate_song_length_ms(sequencer);
-	cJSON_AddNumberToObject(root, "length_ms", length_ms);
+	printf("Saved %u notes to %s\n", note_snapshot_count(&snapshot->notes), filepath);
+	return true;
+}
 
-	const char *scale_str = scale_type_to_string(state->selected_scale);
-	cJSON_AddStringToObject(root, "selected_scale", scale_str);
+static bool export_snapshot(const struct song_snapshot *snapshot, const char *c_path, const char *wav_path)
+{
+	struct sequencer sequencer;
+	sequencer_init(&sequencer);
+	sequencer_set_bpm(&sequencer, snapshot->bpm);
 
-	const char *root_str = root_note_to_string(state->selected_root);
-	cJSON_AddStringToObject(root, "selected_root", root_str);
+	if (!sequencer_reserve(&sequencer, note_snapshot_count(&snapshot->notes))) {
+		fprintf(stderr, "Failed to allocate export sequencer\n");
+		return false;
+	}
 
-	cJSON_AddBoolToObject(root, "fold_mode", state->fold_mode);
-	cJSON_AddBoolToObject(root, "show_scale_highlights", state->show_scale_highlights);
+	for (uint32_t i = 0; i < note_snapshot_count(&snapshot->notes); i++) {
+		const struct ui_note *note = note_snapshot_at(&snapshot->notes, i);
+		struct note_params params;
+		app_state_note_to_params(note, &params);
+		sequencer_add_note(&sequencer, note->id, note->ms, params);
+	}
 
-	cJSON *notes_array = cJSON_CreateArray();
-	if (!notes_array) {
-		fprintf(stderr, "Failed to create notes array\n");
-		cJSON_Delete(root);
+	bool success = true;
+	if (c_path[0] != '\0') {
+		success = c_exporter_export_to_file(&sequencer, c_path) && success;
+	}
+	if (wav_path[0] != '\0') {
+		success = wav_exporter_export_to_file(&sequencer, wav_path) && success;
+	}
+
+	sequencer_free(&sequencer);
+	return success;
+}
+
+bool song_saver_save_to_file(const struct app_state *state, const char *filepath)
+{
+	if (!state || !filepath) {
+		fprintf(stderr, "Invalid parameters for save\n");
 		return false;
 	}
 
-	for (uint32_t i = 0; i < sequencer->note_count; i++) {
-		const struct note *note = &sequencer->notes[i];
-		const struct note_params *params = &note->params;
+	struct song_snapshot snapshot;
+	snapshot_create(state, &snapshot);
 
-		cJSON *note_obj = cJSON_CreateObject();
-		if (!note_obj) {
-			fprintf(stderr, "Failed to create note object\n");
-			continue;
-		}
+	bool success = save_snapshot_to_file(&snapshot, filepath);
+	snapshot_free(&snapshot);
+
+	return success;
+}
 
-		cJSON_AddNumberToObject(note_obj, "id", i + 1);
-		cJSON_AddNumberToObject(note_obj, "ms", note->time_ms);
-		cJSON_AddNumberToObject(note_obj, "voice", params->voice_index);
-		cJSON_AddNumberToObject(note_obj, "frequency_hz", params->frequency);
-		cJSON_AddNumberToObject(note_obj, "duration_ms", (int)params->duration_ms);
+static int save_thread(void *data)
+{
+	struct song_save_job *job = data;
 
-		const char *waveform_str = waveform_to_string(params->waveform);
-		cJSON_AddStringToObject(note_obj, "waveform", waveform_str);
+	bool success = true;
+	if (job->json_path[0] != '\0') {
+		success = save_snapshot_to_file(&job->snapshot, job->json_path);
+	}
+	if (job->c_path[0] != '\0' || job->wav_path[0] != '\0') {
+		success = export_snapshot(&job->snapshot, job->c_path, job->wav_path) && success;
+	}
 
-		cJSON_AddNumberToObject(note_obj, "amplitude_dbfs", params->amplitude_dbfs);
-		cJSON_AddNumberToObject(note_obj, "duty_cycle", params->duty_cycle);
-		cJSON_AddNumberToObject(note_obj, "decay", params->decay);
-		cJSON_AddNumberToObject(note_obj, "phase", 0);
-		cJSON_AddBoolToObject(note_obj, "restart", params->restart_phase);
-		cJSON_AddBoolToObject(note_obj, "nes_noise_mode", params->nes_noise_mode_flag);
-		cJSON_AddNumberToObject(note_obj, "nes_noise_lfsr", params->nes_noise_lfsr_init);
-		cJSON_AddNumberToObject(note_obj, "nes_noise_period", params->nes_noise_period);
+	job->success = success;
+	SDL_SetAtomicInt(&job->done, 1);
+	return 0;
+}
 
-		cJSON_AddItemToArray(notes_array, note_obj);
+static void copy_path(char *dst, const char *src)
+{
+	if (src == NULL) {
+		dst[0] = '\0';
+		return;
 	}
 
-	cJSON_AddItemToObject(root, "notes", notes_array);
+	strncpy(dst, src, SONG_SAVER_PATH_SIZE - 1);
+	dst[SONG_SAVER_PATH_SIZE - 1] = '\0';
+}
 
-	char *json_string = cJSON_Print(root);
-	if (!json_string) {
-		fprintf(stderr, "Failed to serialize JSON\n");
-		cJSON_Delete(root);
-		return false;
+struct song_save_job *song_saver_save_async(
+	const struct app_state *state, const char *json_path, const char *c_path, const char *wav_path
+)
+{
+	if (!state) {
+		fprintf(stderr, "Invalid parameters for save\n");
+		return NULL;
 	}
 
-	FILE *file = fopen(filepath, "w");
-	if (!file) {
-		fprintf(stderr, "Failed to open file for writing: %s\n", filepath);
-		free(json_string);
-		cJSON_Delete(root);
-		return false;
+	struct song_save_job *job = calloc(1, sizeof(struct song_save_job));
+	if (!job) {
+		fprintf(stderr, "Failed to allocate save job\n");
+		return NULL;
+	}
+
+	snapshot_create(state, &job->snapshot);
+
+	copy_path(job->json_path, json_path);
+	copy_path(job->c_path, c_path);
+	copy_path(job->wav_path, wav_path);
+	SDL_SetAtomicInt(&job->done, 0);
+
+	job->thread = SDL_CreateThread(save_thread, "song_saver", job);
+	if (!job->thread) {
+		fprintf(stderr, "Failed to start save thread: %s\n", SDL_GetError());
+		snapshot_free(&job->snapshot);
+		free(job);
+		return NULL;
 	}
 
-	size_t json_length = strlen(json_string);
-	size_t written = fwrite(json_string, 1, json_length, file);
+	return job;
+}
 
-	fclose(file);
-	free(json_string);
-	cJSON_Delete(root);
+bool song_saver_job_is_done(struct song_save_job *job)
+{
+	return job == NULL || SDL_GetAtomicInt(&job->done) != 0;
+}
 
-	if (written != json_length) {
-		fprintf(stderr, "Failed to write complete JSON to file\n");
+bool song_saver_job_wait(struct song_save_job *job)
+{
+	if (job == NULL) {
 		return false;
 	}
 
-	printf("Saved %u notes to %s\n", sequencer->note_count, filepath);
-	return true;
+	SDL_WaitThread(job->thread, NULL);
+
+	bool success = job->success;
+	snapshot_free(&job->snapshot);
+	free(job);
+
+	return success;
 }
@@ -5,10 +5,16 @@
 #include <stdint.h>
 
 struct app_state;
-struct sequencer;
+struct song_save_job;
 
-bool song_saver_save_to_file(
-	const struct app_state *state, const struct sequencer *sequencer, const char *filepath
+bool song_saver_save_to_file(const struct app_state *state, const char *filepath);
+
+struct song_save_job *song_saver_save_async(
+	const struct app_state *state, const char *json_path, const char *c_path, const char *wav_path
 );
 
+bool song_saver_job_is_done(struct song_save_job *job);
+
+bool song_saver_job_wait(struct song_save_job *job);
+
 #endif
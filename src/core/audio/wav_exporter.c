@@ -185,6 +185,22 @@ static void write_wav_header(FILE *file, uint32_t data_size)
 	fwrite(&data_size, 4, 1, file);
 }
 
+struct note_order {
+	uint32_t time_ms;
+	uint32_t index;
+};
+
+static int compare_note_order(const void *a, const void *b)
+{
+	const struct note_order *order_a = a;
+	const struct note_order *order_b = b;
+
+	if (order_a->time_ms != order_b->time_ms) {
+		return order_a->time_ms < order_b->time_ms ? -1 : 1;
+	}
+	return order_a->index < order_b->index ? -1 : 1;
+}
+
 static uint32_t calculate_duration_ms(const struct sequencer *sequencer)
 {
 	uint32_t max_end = 0;
@@ -211,9 +227,23 @@ bool wav_exporter_export_to_file(const struct sequencer *sequencer, const char *
 	uint64_t total_samples = ((uint64_t)duration_ms * SAMPLE_RATE) / 1000;
 	uint32_t data_size = (uint32_t)(total_samples * CHANNELS * (BITS_PER_SAMPLE / 8));
 
+	uint32_t note_count = sequencer->note_count;
+	struct note_order *order =
+		malloc(sizeof(struct note_order) * (note_count > 0 ? note_count : 1));
+	if (!order) {
+		fprintf(stderr, "Failed to allocate WAV export note order\n");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < note_count; i++) {
+		order[i] = (struct note_order){sequencer->notes[i].time_ms, i};
+	}
+	qsort(order, note_count, sizeof(struct note_order), compare_note_order);
+
 	FILE *file = fopen(filepath, "wb");
 	if (!file) {
 		fprintf(stderr, "Failed to open file for WAV export: %s\n", filepath);
+		free(order);
 		return false;
 	}
 
@@ -222,8 +252,7 @@ bool wav_exporter_export_to_file(const struct sequencer *sequencer, const char *
 	struct render_voice voices[WAV_MAX_VOICES];
 	memset(voices, 0, sizeof(voices));
 
-	bool note_triggered[SEQUENCER_MAX_NOTES];
-	memset(note_triggered, 0, sizeof(note_triggered));
+	uint32_t next_note = 0;
 
 	uint64_t current_sample = 0;
 
@@ -233,17 +262,13 @@ bool wav_exporter_export_to_file(const struct sequencer *sequencer, const char *
 	while (current_sample < total_samples) {
 		uint32_t current_time_ms = (uint32_t)((current_sample * 1000) / SAMPLE_RATE);
 
-		for (uint32_t i = 0; i < sequencer->note_count; i++) {
-			if (!note_triggered[i]) {
-				const struct note *note = &sequencer->notes[i];
-				if (note->time_ms <= current_time_ms) {
-					int8_t voice_idx = note->params.voice_index;
-					if (voice_idx >= 0 && voice_idx < WAV_MAX_VOICES) {
-						trigger_note(&voices[voice_idx], note);
-					}
-					note_triggered[i] = true;
-				}
+		while (next_note < note_count && order[next_note].time_ms <= current_time_ms) {
+			const struct note *note = &sequencer->notes[order[next_note].index];
+			int8_t voice_idx = note->params.voice_index;
+			if (voice_idx >= 0 && voice_idx < WAV_MAX_VOICES) {
+				trigger_note(&voices[voice_idx], note);
 			}
+			next_note++;
 		}
 
 		for (int i = 0; i < WAV_MAX_VOICES; i++) {
@@ -283,6 +308,7 @@ bool wav_exporter_export_to_file(const struct sequencer *sequencer, const char *
 	}
 
 	fclose(file);
+	free(order);
 
 	printf("Exported %llu samples (%u ms) to WAV file: %s\n",
 	       (unsigned long long)total_samples,
@@ -0,0 +1,115 @@
+#include "draw_list.h"
+#include "graphics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DRAW_LIST_MIN_ITEMS 256
+#define DRAW_LIST_MIN_TEXT 1024
+
+void draw_list_init(struct draw_list *list)
+{
+	memset(list, 0, sizeof(struct draw_list));
+}
+
+void draw_list_free(struct draw_list *list)
+{
+	free(list->items);
+	free(list->text);
+	memset(list, 0, sizeof(struct draw_list));
+}
+
+void draw_list_clear(struct draw_list *list)
+{
+	list->count = 0;
+	list->text_size = 0;
+}
+
+bool draw_list_push(struct draw_list *list, const struct draw_list_item *item)
+{
+	if (list->count == list->capacity) {
+		uint32_t capacity = list->capacity > 0 ? list->capacity * 2 : DRAW_LIST_MIN_ITEMS;
+		struct draw_list_item *items =
+			realloc(list->items, sizeof(struct draw_list_item) * capacity);
+		if (!items) {
+			fprintf(stderr, "Failed to grow draw list to %u items\n", capacity);
+			return false;
+		}
+		list->items = items;
+		list->capacity = capacity;
+	}
+
+	list->items[list->count++] = *item;
+	return true;
+}
+
+bool draw_list_push_text(
+	struct draw_list *list, const char *text, int x, int y, int size, struct color color
+)
+{
+	uint32_t length = (uint32_t)strlen(text) + 1;
+	if (list->text_size + length > list->text_capacity) {
+		uint32_t capacity = list->text_capacity;
+		if (capacity == 0) {
+			capacity = DRAW_LIST_MIN_TEXT;
+		}
+		while (capacity < list->text_size + length) {
+			capacity *= 2;
+		}
+
+		char *buffer = realloc(list->text, capacity);
+		if (!buffer) {
+			fprintf(stderr, "Failed to grow draw list text to %u bytes\n", capacity);
+			return false;
+		}
+		list->text = buffer;
+		list->text_capacity = capacity;
+	}
+
+	struct draw_list_item item = {
+		DRAW_LIST_TEXT, color, x, y, size, 0, (int32_t)list->text_size
+	};
+	if (!draw_list_push(list, &item)) {
+		return false;
+	}
+
+	memcpy(list->text + list->text_size, text, length);
+	list->text_size += length;
+	return true;
+}
+
+void draw_list_submit(const struct draw_list *list, struct graphics *graphics)
+{
+	for (uint32_t i = 0; i < list->count; i++) {
+		const struct draw_list_item *item = &list->items[i];
+		graphics_set_color(graphics, item->color);
+
+		switch (item->op) {
+		case DRAW_LIST_FILL_RECT:
+			graphics_fill_rect(graphics, item->x, item->y, item->width, item->height);
+			break;
+		case DRAW_LIST_STROKE_RECT:
+			graphics_draw_rect(graphics, item->x, item->y, item->width, item->height);
+			break;
+		case DRAW_LIST_FILL_ROUNDED_RECT:
+			graphics_fill_rounded_rect(
+				graphics, item->x, item->y, item->width, item->height, item->extra
+			);
+			break;
+		case DRAW_LIST_STROKE_ROUNDED_RECT:
+			graphics_draw_rounded_rect(
+				graphics, item->x, item->y, item->width, item->height, item->extra
+			);
+			break;
+		case DRAW_LIST_LINE:
+			graphics_draw_line(graphics, item->x, item->y, item->width, item->height);
+			break;
+		case DRAW_LIST_TEXT:
+			graphics_draw_text(
+				graphics, list->text + item->extra, item->x, item->y, item->width
+			);
+			break;
+		}
+	}
+}
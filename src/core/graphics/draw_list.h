@@ -0,0 +1,50 @@
+#ifndef BOOSTIO_DRAW_LIST_H
+#define BOOSTIO_DRAW_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "color.h"
+
+struct graphics;
+
+enum draw_list_op {
+	DRAW_LIST_FILL_RECT,
+	DRAW_LIST_STROKE_RECT,
+	DRAW_LIST_FILL_ROUNDED_RECT,
+	DRAW_LIST_STROKE_ROUNDED_RECT,
+	DRAW_LIST_LINE,
+	DRAW_LIST_TEXT,
+};
+
+struct draw_list_item {
+	enum draw_list_op op;
+	struct color color;
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	int32_t extra;
+};
+
+struct draw_list {
+	struct draw_list_item *items;
+	uint32_t count;
+	uint32_t capacity;
+	char *text;
+	uint32_t text_size;
+	uint32_t text_capacity;
+};
+
+void draw_list_init(struct draw_list *list);
+void draw_list_free(struct draw_list *list);
+void draw_list_clear(struct draw_list *list);
+
+bool draw_list_push(struct draw_list *list, const struct draw_list_item *item);
+bool draw_list_push_text(
+	struct draw_list *list, const char *text, int x, int y, int size, struct color color
+);
+
+void draw_list_submit(const struct draw_list *list, struct graphics *graphics);
+
+#endif
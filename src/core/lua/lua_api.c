@@ -3,16 +3,24 @@
 #include "audio.h"
 #include "c_exporter.h"
 #include "color.h"
+#include "draw_list.h"
+#include "edit_journal.h"
 #include "graphics.h"
 #include "input_types.h"
 #include "lua_command_registry.h"
+#include "lua_events.h"
+#include "lua_profiler.h"
+#include "midi_exporter.h"
 #include "path_utils.h"
 #include "scale.h"
 #include "sequencer.h"
+#include "song_binary.h"
+#include "song_library.h"
 #include "song_loader.h"
 #include "song_saver.h"
 #include "synth.h"
 #include "viewport_utils.h"
+#include "voice_solver.h"
 #include "wav_exporter.h"
 #include "window.h"
 
@@ -270,6 +278,180 @@ static int lua_api_is_point_in_rect(lua_State *L)
 	return 1;
 }
 
+#define DRAW_LIST_METATABLE "boostio.draw_list"
+
+static lua_Integer color_to_handle(struct color color)
+{
+	uint32_t packed = ((uint32_t)color.r << 24) | ((uint32_t)color.g << 16) |
+			  ((uint32_t)color.b << 8) | color.a;
+	return (lua_Integer)(lua_Unsigned)packed;
+}
+
+static struct color color_from_handle(lua_Integer handle)
+{
+	uint32_t packed = (uint32_t)(lua_Unsigned)handle;
+	return color_rgba(
+		(uint8_t)(packed >> 24),
+		(uint8_t)(packed >> 16),
+		(uint8_t)(packed >> 8),
+		(uint8_t)packed
+	);
+}
+
+static int lua_api_color(lua_State *L)
+{
+	float r;
+	float g;
+	float b;
+	float a;
+
+	if (lua_type(L, 1) == LUA_TSTRING) {
+		const char *hex = lua_tostring(L, 1);
+		if (hex[0] == '#') {
+			hex++;
+		}
+
+		unsigned int red = 0, green = 0, blue = 0;
+		if (sscanf(hex, "%02x%02x%02x", &red, &green, &blue) != 3) {
+			return luaL_error(L, "Invalid hex color format");
+		}
+
+		r = (float)(red / 255.0);
+		g = (float)(green / 255.0);
+		b = (float)(blue / 255.0);
+		a = (float)luaL_optnumber(L, 2, 1.0);
+	} else {
+		r = (float)luaL_checknumber(L, 1);
+		g = (float)luaL_checknumber(L, 2);
+		b = (float)luaL_checknumber(L, 3);
+		a = (float)luaL_optnumber(L, 4, 1.0);
+	}
+
+	lua_pushinteger(L, color_to_handle(color_from_floats(r, g, b, a)));
+	return 1;
+}
+
+static int draw_list_add(lua_State *L, enum draw_list_op op, bool has_extra)
+{
+	struct draw_list *list = luaL_checkudata(L, 1, DRAW_LIST_METATABLE);
+
+	struct draw_list_item item;
+	item.op = op;
+	item.x = (int)luaL_checknumber(L, 2);
+	item.y = (int)luaL_checknumber(L, 3);
+	item.width = (int)luaL_checknumber(L, 4);
+	item.height = (int)luaL_checknumber(L, 5);
+	item.extra = has_extra ? (int)luaL_checknumber(L, 6) : 0;
+	item.color = color_from_handle(luaL_checkinteger(L, has_extra ? 7 : 6));
+
+	if (!draw_list_push(list, &item)) {
+		return luaL_error(L, "Failed to grow draw list");
+	}
+	return 0;
+}
+
+static int draw_list_rect(lua_State *L)
+{
+	return draw_list_add(L, DRAW_LIST_FILL_RECT, false);
+}
+
+static int draw_list_stroke_rect(lua_State *L)
+{
+	return draw_list_add(L, DRAW_LIST_STROKE_RECT, false);
+}
+
+static int draw_list_rounded_rect(lua_State *L)
+{
+	return draw_list_add(L, DRAW_LIST_FILL_ROUNDED_RECT, true);
+}
+
+static int draw_list_stroke_rounded_rect(lua_State *L)
+{
+	return draw_list_add(L, DRAW_LIST_STROKE_ROUNDED_RECT, true);
+}
+
+static int draw_list_line(lua_State *L)
+{
+	return draw_list_add(L, DRAW_LIST_LINE, false);
+}
+
+static int draw_list_text(lua_State *L)
+{
+	struct draw_list *list = luaL_checkudata(L, 1, DRAW_LIST_METATABLE);
+	const char *text = luaL_checkstring(L, 2);
+	int x = (int)luaL_checknumber(L, 3);
+	int y = (int)luaL_checknumber(L, 4);
+	int size = (int)luaL_checknumber(L, 5);
+	struct color color = color_from_handle(luaL_checkinteger(L, 6));
+
+	if (!draw_list_push_text(list, text, x, y, size, color)) {
+		return luaL_error(L, "Failed to grow draw list");
+	}
+	return 0;
+}
+
+static int draw_list_clear_items(lua_State *L)
+{
+	draw_list_clear(luaL_checkudata(L, 1, DRAW_LIST_METATABLE));
+	return 0;
+}
+
+static int draw_list_count(lua_State *L)
+{
+	struct draw_list *list = luaL_checkudata(L, 1, DRAW_LIST_METATABLE);
+	lua_pushinteger(L, list->count);
+	return 1;
+}
+
+static int draw_list_gc(lua_State *L)
+{
+	draw_list_free(luaL_checkudata(L, 1, DRAW_LIST_METATABLE));
+	return 0;
+}
+
+static int lua_api_new_draw_list(lua_State *L)
+{
+	struct draw_list *list = lua_newuserdatauv(L, sizeof(struct draw_list), 0);
+	draw_list_init(list);
+
+	if (luaL_newmetatable(L, DRAW_LIST_METATABLE)) {
+		lua_newtable(L);
+		lua_pushcfunction(L, draw_list_rect);
+		lua_setfield(L, -2, "rect");
+		lua_pushcfunction(L, draw_list_stroke_rect);
+		lua_setfield(L, -2, "strokeRect");
+		lua_pushcfunction(L, draw_list_rounded_rect);
+		lua_setfield(L, -2, "roundedRect");
+		lua_pushcfunction(L, draw_list_stroke_rounded_rect);
+		lua_setfield(L, -2, "strokeRoundedRect");
+		lua_pushcfunction(L, draw_list_line);
+		lua_setfield(L, -2, "line");
+		lua_pushcfunction(L, draw_list_text);
+		lua_setfield(L, -2, "text");
+		lua_pushcfunction(L, draw_list_clear_items);
+		lua_setfield(L, -2, "clear");
+		lua_pushcfunction(L, draw_list_count);
+		lua_setfield(L, -2, "count");
+		lua_setfield(L, -2, "__index");
+
+		lua_pushcfunction(L, draw_list_gc);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+
+	return 1;
+}
+
+static int lua_api_draw_list(lua_State *L)
+{
+	if (global_context == NULL || global_context->graphics == NULL) {
+		return luaL_error(L, "Graphics context not available");
+	}
+
+	draw_list_submit(luaL_checkudata(L, 1, DRAW_LIST_METATABLE), global_context->graphics);
+	return 0;
+}
+
 static int lua_api_get_config(lua_State *L)
 {
 	const char *key = luaL_checkstring(L, 1);
@@ -614,23 +796,26 @@ static int lua_api_add_note(lua_State *L)
 		params.waveform = (enum waveform_type)lua_tointeger(L, 4);
 	}
 
-	if (state->note_count < UI_MAX_NOTES) {
-		struct ui_note *ui_note = &state->notes[state->note_count];
-		ui_note->id = state->next_note_id++;
-		ui_note->ms = start_ms;
-		ui_note->duration_ms = (uint16_t)duration_ms;
-		ui_note->voice = voice;
-		ui_note->piano_key = pitch;
-		ui_note->frequency = note_to_frequency(pitch);
-		ui_note->waveform = params.waveform;
-		ui_note->duty_cycle = params.duty_cycle;
-		ui_note->decay = params.decay;
-		ui_note->amplitude_dbfs = params.amplitude_dbfs;
-		ui_note->nes_noise_period = params.nes_noise_period;
-		ui_note->nes_noise_mode_flag = params.nes_noise_mode_flag;
-		ui_note->nes_noise_lfsr_init = params.nes_noise_lfsr_init;
-		ui_note->restart_phase = params.restart_phase;
-		state->note_count++;
+	struct ui_note new_note = {
+		.id = state->next_note_id,
+		.ms = start_ms,
+		.duration_ms = (uint16_t)duration_ms,
+		.voice = voice,
+		.piano_key = pitch,
+		.frequency = note_to_frequency(pitch),
+		.waveform = params.waveform,
+		.duty_cycle = params.duty_cycle,
+		.decay = params.decay,
+		.amplitude_dbfs = params.amplitude_dbfs,
+		.nes_noise_period = params.nes_noise_period,
+		.nes_noise_mode_flag = params.nes_noise_mode_flag,
+		.nes_noise_lfsr_init = params.nes_noise_lfsr_init,
+		.restart_phase = params.restart_phase
+	};
+
+	struct ui_note *ui_note = note_store_add(&state->notes, &new_note);
+	if (ui_note != NULL) {
+		state->next_note_id++;
 
 		struct command cmd;
 		cmd.type = CMD_ADD_NOTE;
@@ -673,20 +858,63 @@ static int lua_api_quit(lua_State *L)
 	return 0;
 }
 
+static struct song_save_job *pending_save = NULL;
+static int pending_save_callback = LUA_NOREF;
+static char pending_save_path[512];
+
+static void finish_pending_save(lua_State *L)
+{
+	bool success = song_saver_job_wait(pending_save);
+	pending_save = NULL;
+
+	if (success) {
+		printf("Saved all formats successfully: %s\n", pending_save_path);
+
+		if (global_context != NULL && global_context->app_state != NULL) {
+			edit_journal_mark_saved(
+				global_context->app_state->history.journal, pending_save_path
+			);
+		}
+	}
+
+	if (pending_save_callback == LUA_NOREF) {
+		return;
+	}
+
+	int callback_ref = pending_save_callback;
+	pending_save_callback = LUA_NOREF;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, callback_ref);
+	luaL_unref(L, LUA_REGISTRYINDEX, callback_ref);
+
+	lua_pushboolean(L, success);
+	lua_pushstring(L, pending_save_path);
+	if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+		fprintf(stderr, "Lua save callback error: %s\n", lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+}
+
 static int lua_api_save(lua_State *L)
 {
-	if (global_context == NULL || global_context->app_state == NULL ||
-	    global_context->audio == NULL)
+	if (global_context == NULL || global_context->app_state == NULL)
 		return luaL_error(L, "API context not available");
 
 	const char *filepath = luaL_optstring(L, 1, NULL);
+	if (!lua_isnoneornil(L, 2)) {
+		luaL_checktype(L, 2, LUA_TFUNCTION);
+	}
+
+	if (pending_save != NULL) {
+		lua_pushboolean(L, false);
+		lua_pushstring(L, "busy");
+		return 2;
+	}
 
 	char base_path[512];
 	if (filepath != NULL) {
 		strncpy(base_path, filepath, 511);
 		base_path[511] = '\0';
-		strncpy(global_context->app_state->current_file_path, filepath, 511);
-		global_context->app_state->current_file_path[511] = '\0';
 	} else if (global_context->app_state->current_file_path[0] != '\0') {
 		strncpy(base_path, global_context->app_state->current_file_path, 511);
 		base_path[511] = '\0';
@@ -695,10 +923,6 @@ static int lua_api_save(lua_State *L)
 		base_path[511] = '\0';
 	}
 
-	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
-	if (sequencer == NULL)
-		return luaL_error(L, "Sequencer not available");
-
 	char json_path[512];
 	char c_path[512];
 	char wav_path[512];
@@ -707,22 +931,28 @@ static int lua_api_save(lua_State *L)
 	path_build_with_extension(base_path, ".c", c_path, sizeof(c_path));
 	path_build_with_extension(base_path, ".wav", wav_path, sizeof(wav_path));
 
-	bool success_json =
-		song_saver_save_to_file(global_context->app_state, sequencer, json_path);
+	pending_save =
+		song_saver_save_async(global_context->app_state, json_path, c_path, wav_path);
+	if (pending_save == NULL) {
+		lua_pushboolean(L, false);
+		lua_pushstring(L, "error");
+		return 2;
+	}
 
-	bool success_c = c_exporter_export_to_file(sequencer, c_path);
-	bool success_wav = wav_exporter_export_to_file(sequencer, wav_path);
+	if (filepath != NULL) {
+		strncpy(global_context->app_state->current_file_path, filepath, 511);
+		global_context->app_state->current_file_path[511] = '\0';
+	}
 
-	bool success = success_json && success_c && success_wav;
+	strncpy(pending_save_path, json_path, sizeof(pending_save_path) - 1);
+	pending_save_path[sizeof(pending_save_path) - 1] = '\0';
 
-	if (success) {
-		printf("Saved all formats successfully:\n");
-		printf("  - %s\n", json_path);
-		printf("  - %s\n", c_path);
-		printf("  - %s\n", wav_path);
+	if (!lua_isnoneornil(L, 2)) {
+		lua_pushvalue(L, 2);
+		pending_save_callback = luaL_ref(L, LUA_REGISTRYINDEX);
 	}
 
-	lua_pushboolean(L, success);
+	lua_pushboolean(L, true);
 	return 1;
 }
 
@@ -732,12 +962,14 @@ static int lua_api_save_c(lua_State *L)
 		return luaL_error(L, "API context not available");
 
 	const char *filepath = luaL_optstring(L, 1, "song.c");
+	bool compact = lua_toboolean(L, 2);
 
 	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
 	if (sequencer == NULL)
 		return luaL_error(L, "Sequencer not available");
 
-	bool success = c_exporter_export_to_file(sequencer, filepath);
+	bool success = compact ? c_exporter_export_compact_to_file(sequencer, filepath)
+			       : c_exporter_export_to_file(sequencer, filepath);
 
 	lua_pushboolean(L, success);
 	return 1;
@@ -760,6 +992,172 @@ static int lua_api_save_wav(lua_State *L)
 	return 1;
 }
 
+static int lua_api_save_binary(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL)
+		return luaL_error(L, "API context not available");
+
+	const char *filepath = luaL_optstring(L, 1, NULL);
+
+	char binary_path[512];
+	if (filepath != NULL) {
+		strncpy(binary_path, filepath, 511);
+		binary_path[511] = '\0';
+	} else {
+		const char *base_path = global_context->app_state->current_file_path[0] != '\0'
+						? global_context->app_state->current_file_path
+						: "song.json";
+		path_build_with_extension(
+			base_path, SONG_BINARY_EXTENSION, binary_path, sizeof(binary_path)
+		);
+	}
+
+	bool success = song_binary_save_to_file(global_context->app_state, binary_path);
+
+	lua_pushboolean(L, success);
+	return 1;
+}
+
+static int lua_api_save_midi(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL)
+		return luaL_error(L, "API context not available");
+
+	const char *filepath = luaL_optstring(L, 1, NULL);
+
+	char midi_path[512];
+	if (filepath != NULL) {
+		strncpy(midi_path, filepath, 511);
+		midi_path[511] = '\0';
+	} else {
+		const char *base_path = global_context->app_state->current_file_path[0] != '\0'
+						? global_context->app_state->current_file_path
+						: "song.json";
+		path_build_with_extension(
+			base_path, MIDI_EXPORTER_EXTENSION, midi_path, sizeof(midi_path)
+		);
+	}
+
+	bool success = midi_exporter_export_to_file(global_context->app_state, midi_path);
+
+	lua_pushboolean(L, success);
+	return 1;
+}
+
+static int lua_api_convert_song(lua_State *L)
+{
+	const char *input_path = luaL_checkstring(L, 1);
+	const char *output_path = luaL_checkstring(L, 2);
+
+	bool success = song_binary_convert(input_path, output_path);
+
+	lua_pushboolean(L, success);
+	return 1;
+}
+
+static void push_song_library_entry(lua_State *L, const struct song_library_entry *entry)
+{
+	lua_createtable(L, 0, 7);
+
+	const char *name = strrchr(entry->path, '/');
+	lua_pushstring(L, entry->path);
+	lua_setfield(L, -2, "path");
+	lua_pushstring(L, name != NULL ? name + 1 : entry->path);
+	lua_setfield(L, -2, "name");
+	lua_pushinteger(L, entry->bpm);
+	lua_setfield(L, -2, "bpm");
+	lua_pushinteger(L, entry->length_ms);
+	lua_setfield(L, -2, "lengthMs");
+	lua_pushinteger(L, entry->note_count);
+	lua_setfield(L, -2, "noteCount");
+
+	lua_newtable(L);
+	int voice_index = 1;
+	for (int voice = 0; voice < 16; voice++) {
+		if (entry->voice_mask & (1u << voice)) {
+			lua_pushinteger(L, voice);
+			lua_rawseti(L, -2, voice_index++);
+		}
+	}
+	lua_setfield(L, -2, "voices");
+
+	lua_createtable(L, SONG_LIBRARY_THUMBNAIL_SIZE, 0);
+	for (int i = 0; i < SONG_LIBRARY_THUMBNAIL_SIZE; i++) {
+		lua_pushinteger(L, entry->thumbnail[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "thumbnail");
+}
+
+static int lua_api_get_song_library(lua_State *L)
+{
+	if (global_context == NULL || global_context->song_library == NULL)
+		return luaL_error(L, "Song library not available");
+
+	struct song_library_filter filter = {0};
+
+	if (lua_istable(L, 1)) {
+		lua_getfield(L, 1, "name");
+		if (!lua_isnil(L, -1)) {
+			filter.name_contains = lua_tostring(L, -1);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 1, "minBpm");
+		if (!lua_isnil(L, -1)) {
+			filter.min_bpm = (uint32_t)lua_tointeger(L, -1);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 1, "maxBpm");
+		if (!lua_isnil(L, -1)) {
+			filter.max_bpm = (uint32_t)lua_tointeger(L, -1);
+		}
+		lua_pop(L, 1);
+
+		lua_getfield(L, 1, "voice");
+		if (!lua_isnil(L, -1)) {
+			lua_Integer voice = lua_tointeger(L, -1);
+			if (voice >= 0 && voice < 16) {
+				filter.voice_mask = (uint16_t)(1u << voice);
+			}
+		}
+		lua_pop(L, 1);
+	}
+
+	uint32_t capacity = 64;
+	struct song_library_entry *entries;
+	uint32_t count;
+	for (;;) {
+		entries = lua_newuserdatauv(L, sizeof(struct song_library_entry) * capacity, 0);
+		count = song_library_query(global_context->song_library, &filter, entries, capacity);
+		if (count <= capacity) {
+			break;
+		}
+		lua_pop(L, 1);
+		capacity = count;
+	}
+
+	lua_createtable(L, (int)count, 0);
+	for (uint32_t i = 0; i < count; i++) {
+		push_song_library_entry(L, &entries[i]);
+		lua_rawseti(L, -2, (lua_Integer)i + 1);
+	}
+	lua_remove(L, -2);
+
+	lua_pushboolean(L, song_library_is_scanning(global_context->song_library));
+	return 2;
+}
+
+static int lua_api_rescan_song_library(lua_State *L)
+{
+	if (global_context == NULL || global_context->song_library == NULL)
+		return luaL_error(L, "Song library not available");
+
+	lua_pushboolean(L, song_library_rescan(global_context->song_library));
+	return 1;
+}
+
 static int lua_api_load(lua_State *L)
 {
 	if (global_context == NULL || global_context->app_state == NULL ||
@@ -769,12 +1167,20 @@ static int lua_api_load(lua_State *L)
 	const char *filepath = luaL_optstring(L, 1, "song.json");
 
 	struct audio *audio = global_context->audio;
-	bool success = song_loader_load_from_file(audio, global_context->app_state, filepath);
+	struct app_state *state = global_context->app_state;
+	struct edit_journal *journal = state->history.journal;
 
-	if (success && global_context->app_state) {
-		strncpy(global_context->app_state->current_file_path, filepath, 511);
-		global_context->app_state->current_file_path[511] = '\0';
+	bool success = song_loader_load_from_file(audio, state, filepath);
+
+	if (success) {
+		strncpy(state->current_file_path, filepath, 511);
+		state->current_file_path[511] = '\0';
 		printf("Loaded and set current file path: %s\n", filepath);
+
+		if (journal != NULL) {
+			edit_journal_close(journal);
+			edit_journal_open(journal, state, audio, state->current_file_path);
+		}
 	}
 
 	lua_pushboolean(L, success);
@@ -809,6 +1215,26 @@ static int lua_api_redo(lua_State *L)
 	return 1;
 }
 
+static int lua_api_begin_edit(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	command_history_begin_transaction(&global_context->app_state->history);
+	return 0;
+}
+
+static int lua_api_commit_edit(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	command_history_commit_transaction(&global_context->app_state->history);
+	return 0;
+}
+
 static int lua_api_toggle_play(lua_State *L)
 {
 	if (global_context == NULL || global_context->app_state == NULL ||
@@ -943,6 +1369,70 @@ static int lua_api_get_fps(lua_State *L)
 	return 1;
 }
 
+static int lua_api_get_plugin_stats(lua_State *L)
+{
+	if (global_context == NULL || global_context->plugin_profiler == NULL) {
+		return luaL_error(L, "Plugin profiler not available");
+	}
+
+	const struct lua_profiler *profiler = global_context->plugin_profiler;
+	lua_createtable(L, profiler->count, 0);
+	for (int i = 0; i < profiler->count; i++) {
+		struct lua_profiler_stats stats;
+		lua_profiler_get_stats(profiler, i, &stats);
+
+		lua_createtable(L, 0, 6);
+		lua_pushstring(L, stats.name != NULL ? stats.name : "");
+		lua_setfield(L, -2, "name");
+		lua_pushnumber(L, stats.last_ms);
+		lua_setfield(L, -2, "lastMs");
+		lua_pushnumber(L, stats.avg_ms);
+		lua_setfield(L, -2, "avgMs");
+		lua_pushnumber(L, stats.max_ms);
+		lua_setfield(L, -2, "maxMs");
+		lua_pushnumber(L, stats.alloc_kb);
+		lua_setfield(L, -2, "allocKb");
+		lua_pushnumber(L, stats.gc_kb);
+		lua_setfield(L, -2, "gcKb");
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return 1;
+}
+
+static int lua_api_get_gc_stats(lua_State *L)
+{
+	if (global_context == NULL || global_context->runtime == NULL) {
+		return luaL_error(L, "Lua runtime not available");
+	}
+
+	const struct lua_gc_stats *stats = &global_context->runtime->gc_stats;
+	const struct lua_pool *pool = &global_context->runtime->pool;
+	lua_createtable(L, 0, 10);
+	lua_pushstring(L, stats->generational ? "generational" : "incremental");
+	lua_setfield(L, -2, "mode");
+	lua_pushnumber(L, lua_gc(L, LUA_GCCOUNT, 0) + lua_gc(L, LUA_GCCOUNTB, 0) / 1024.0);
+	lua_setfield(L, -2, "heapKb");
+	lua_pushnumber(L, (double)pool->peak_bytes / 1024.0);
+	lua_setfield(L, -2, "peakKb");
+	lua_pushnumber(L, (double)pool->arena_bytes / 1024.0);
+	lua_setfield(L, -2, "poolKb");
+	lua_pushinteger(L, (lua_Integer)pool->allocation_count);
+	lua_setfield(L, -2, "allocations");
+	lua_pushinteger(L, (lua_Integer)stats->idle_steps);
+	lua_setfield(L, -2, "idleSteps");
+	lua_pushinteger(L, (lua_Integer)stats->idle_cycles);
+	lua_setfield(L, -2, "idleCycles");
+	lua_pushnumber(L, stats->last_pause_ms);
+	lua_setfield(L, -2, "lastPauseMs");
+	lua_pushnumber(L, stats->max_pause_ms);
+	lua_setfield(L, -2, "maxPauseMs");
+	lua_pushnumber(L, stats->total_pause_ms);
+	lua_setfield(L, -2, "totalPauseMs");
+
+	return 1;
+}
+
 static int lua_api_toggle_scale_highlight(lua_State *L)
 {
 	if (global_context == NULL || global_context->app_state == NULL) {
@@ -1166,18 +1656,19 @@ static int lua_api_set_note_voice(lua_State *L)
 
 	struct app_state *state = global_context->app_state;
 
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == note_id) {
-			struct command cmd;
-			cmd.type = CMD_SET_NOTE_VOICE;
-			cmd.data.set_note_voice.note_id = note_id;
-			cmd.data.set_note_voice.old_voice = state->notes[i].voice;
-			cmd.data.set_note_voice.new_voice = (uint8_t)voice;
-			command_history_push(&state->history, cmd);
+	const struct ui_note *current = note_store_find(&state->notes, note_id);
+	if (current != NULL) {
+		struct ui_note note = *current;
 
-			state->notes[i].voice = (uint8_t)voice;
-			break;
-		}
+		struct command cmd;
+		cmd.type = CMD_SET_NOTE_VOICE;
+		cmd.data.set_note_voice.note_id = note_id;
+		cmd.data.set_note_voice.old_voice = note.voice;
+		cmd.data.set_note_voice.new_voice = (uint8_t)voice;
+		command_history_push(&state->history, cmd);
+
+		note.voice = (uint8_t)voice;
+		note_store_update(&state->notes, &note);
 	}
 
 	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
@@ -1188,17 +1679,58 @@ static int lua_api_set_note_voice(lua_State *L)
 	return 0;
 }
 
-static int lua_api_set_note_instrument(lua_State *L)
+static void check_note_deltas(lua_State *L, int arg)
 {
-	if (global_context == NULL || global_context->app_state == NULL ||
-	    global_context->audio == NULL) {
-		return luaL_error(L, "API context not available");
+	if (!lua_istable(L, arg)) {
+		luaL_checkinteger(L, arg);
 	}
+}
 
-	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
-	int instrument_index = (int)luaL_checkinteger(L, 2);
+static uint32_t note_id_at(lua_State *L, int arg, uint32_t i)
+{
+	lua_rawgeti(L, arg, (lua_Integer)i + 1);
+	uint32_t note_id = (uint32_t)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+	return note_id;
+}
 
-	struct app_state *state = global_context->app_state;
+static int32_t note_delta_at(lua_State *L, int arg, uint32_t i)
+{
+	if (!lua_istable(L, arg)) {
+		return (int32_t)lua_tointeger(L, arg);
+	}
+
+	lua_rawgeti(L, arg, (lua_Integer)i + 1);
+	int32_t delta = (int32_t)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+	return delta;
+}
+
+static void push_note_group(struct app_state *state, struct command *cmd)
+{
+	if (cmd->data.group.count > 0) {
+		command_history_push(&state->history, *cmd);
+	} else {
+		command_free(cmd);
+	}
+
+	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
+	if (sequencer != NULL) {
+		app_state_sync_notes_to_sequencer(state, sequencer, global_context->audio);
+	}
+}
+
+static int lua_api_set_note_instrument(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
+	int instrument_index = (int)luaL_checkinteger(L, 2);
+
+	struct app_state *state = global_context->app_state;
 
 	if (instrument_index < 0 || instrument_index >= (int)state->instrument_count) {
 		return luaL_error(L, "Invalid instrument index");
@@ -1206,32 +1738,29 @@ static int lua_api_set_note_instrument(lua_State *L)
 
 	struct instrument *instr = &state->instruments[instrument_index];
 
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == note_id) {
-			struct command cmd;
-			cmd.type = CMD_SET_NOTE_INSTRUMENT;
-			cmd.data.set_note_instrument.note_id = note_id;
-			cmd.data.set_note_instrument.old_waveform = state->notes[i].waveform;
-			cmd.data.set_note_instrument.old_duty_cycle = state->notes[i].duty_cycle;
-			cmd.data.set_note_instrument.old_decay = state->notes[i].decay;
-			cmd.data.set_note_instrument.old_amplitude_dbfs =
-				state->notes[i].amplitude_dbfs;
-			cmd.data.set_note_instrument.old_nes_noise_mode_flag =
-				state->notes[i].nes_noise_mode_flag;
-			cmd.data.set_note_instrument.old_nes_noise_lfsr_init =
-				state->notes[i].nes_noise_lfsr_init;
-			cmd.data.set_note_instrument.new_instrument_index =
-				(uint8_t)instrument_index;
-			command_history_push(&state->history, cmd);
-
-			state->notes[i].waveform = instr->waveform;
-			state->notes[i].duty_cycle = instr->duty_cycle;
-			state->notes[i].decay = instr->decay;
-			state->notes[i].amplitude_dbfs = instr->amplitude_dbfs;
-			state->notes[i].nes_noise_mode_flag = instr->nes_noise_mode_flag;
-			state->notes[i].nes_noise_lfsr_init = instr->nes_noise_lfsr;
-			break;
-		}
+	const struct ui_note *current = note_store_find(&state->notes, note_id);
+	if (current != NULL) {
+		struct ui_note note = *current;
+
+		struct command cmd;
+		cmd.type = CMD_SET_NOTE_INSTRUMENT;
+		cmd.data.set_note_instrument.note_id = note_id;
+		cmd.data.set_note_instrument.old_waveform = note.waveform;
+		cmd.data.set_note_instrument.old_duty_cycle = note.duty_cycle;
+		cmd.data.set_note_instrument.old_decay = note.decay;
+		cmd.data.set_note_instrument.old_amplitude_dbfs = note.amplitude_dbfs;
+		cmd.data.set_note_instrument.old_nes_noise_mode_flag = note.nes_noise_mode_flag;
+		cmd.data.set_note_instrument.old_nes_noise_lfsr_init = note.nes_noise_lfsr_init;
+		cmd.data.set_note_instrument.new_instrument_index = (uint8_t)instrument_index;
+		command_history_push(&state->history, cmd);
+
+		note.waveform = instr->waveform;
+		note.duty_cycle = instr->duty_cycle;
+		note.decay = instr->decay;
+		note.amplitude_dbfs = instr->amplitude_dbfs;
+		note.nes_noise_mode_flag = instr->nes_noise_mode_flag;
+		note.nes_noise_lfsr_init = instr->nes_noise_lfsr;
+		note_store_update(&state->notes, &note);
 	}
 
 	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
@@ -1242,6 +1771,62 @@ static int lua_api_set_note_instrument(lua_State *L)
 	return 0;
 }
 
+static int lua_api_set_notes_instrument(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	int instrument_index = (int)luaL_checkinteger(L, 2);
+
+	struct app_state *state = global_context->app_state;
+
+	if (instrument_index < 0 || instrument_index >= (int)state->instrument_count) {
+		return luaL_error(L, "Invalid instrument index");
+	}
+
+	struct instrument *instr = &state->instruments[instrument_index];
+	uint32_t count = (uint32_t)lua_rawlen(L, 1);
+
+	struct command cmd;
+	if (!command_init_group(&cmd, CMD_SET_NOTES_INSTRUMENT, count)) {
+		return luaL_error(L, "Failed to allocate undo entry");
+	}
+	struct set_note_instrument_data *instruments = cmd.data.group.entries;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const struct ui_note *current = note_store_find(&state->notes, note_id_at(L, 1, i));
+		if (current == NULL) {
+			continue;
+		}
+
+		struct ui_note note = *current;
+
+		struct set_note_instrument_data *entry = &instruments[cmd.data.group.count++];
+		entry->note_id = note.id;
+		entry->old_waveform = note.waveform;
+		entry->old_duty_cycle = note.duty_cycle;
+		entry->old_decay = note.decay;
+		entry->old_amplitude_dbfs = note.amplitude_dbfs;
+		entry->old_nes_noise_mode_flag = note.nes_noise_mode_flag;
+		entry->old_nes_noise_lfsr_init = note.nes_noise_lfsr_init;
+		entry->new_instrument_index = (uint8_t)instrument_index;
+
+		note.waveform = instr->waveform;
+		note.duty_cycle = instr->duty_cycle;
+		note.decay = instr->decay;
+		note.amplitude_dbfs = instr->amplitude_dbfs;
+		note.nes_noise_mode_flag = instr->nes_noise_mode_flag;
+		note.nes_noise_lfsr_init = instr->nes_noise_lfsr;
+		note_store_update(&state->notes, &note);
+	}
+
+	push_note_group(state, &cmd);
+	return 0;
+}
+
 static const char *waveform_type_to_string(enum waveform_type type)
 {
 	switch (type) {
@@ -1260,137 +1845,682 @@ static const char *waveform_type_to_string(enum waveform_type type)
 	}
 }
 
-static int lua_api_get_app_state(lua_State *L)
+static void push_note(lua_State *L, const struct ui_note *note)
 {
-	if (global_context == NULL || global_context->app_state == NULL ||
-	    global_context->audio == NULL) {
-		return luaL_error(L, "API context not available");
+	lua_newtable(L);
+	lua_pushinteger(L, note->id);
+	lua_setfield(L, -2, "id");
+	lua_pushinteger(L, note->ms);
+	lua_setfield(L, -2, "ms");
+	lua_pushinteger(L, note->duration_ms);
+	lua_setfield(L, -2, "duration_ms");
+	lua_pushinteger(L, note->voice);
+	lua_setfield(L, -2, "voice");
+	lua_pushinteger(L, note->piano_key);
+	lua_setfield(L, -2, "piano_key");
+	lua_pushinteger(L, note->waveform);
+	lua_setfield(L, -2, "waveform");
+	lua_pushinteger(L, note->duty_cycle);
+	lua_setfield(L, -2, "duty_cycle");
+	lua_pushinteger(L, note->decay);
+	lua_setfield(L, -2, "decay");
+	lua_pushinteger(L, note->amplitude_dbfs);
+	lua_setfield(L, -2, "amplitude_dbfs");
+	lua_pushinteger(L, note->nes_noise_period);
+	lua_setfield(L, -2, "nes_noise_period");
+	lua_pushboolean(L, note->nes_noise_mode_flag);
+	lua_setfield(L, -2, "nes_noise_mode_flag");
+	lua_pushinteger(L, note->nes_noise_lfsr_init);
+	lua_setfield(L, -2, "nes_noise_lfsr_init");
+	lua_pushboolean(L, note->restart_phase);
+	lua_setfield(L, -2, "restart_phase");
+}
+
+#define NOTE_VIEW_METATABLE "boostio.note"
+#define NOTE_LIST_METATABLE "boostio.notes"
+#define VOICE_SOLVER_METATABLE "boostio.voice_solver"
+#define NOTE_VIEW_CACHE "boostio.note_views"
+#define APP_STATE_CACHE "boostio.app_state"
+#define VOICE_CONFLICTS_CACHE "boostio.voice_conflicts"
+
+struct note_view {
+	uint32_t id;
+};
+
+struct app_state_view {
+	uint32_t bpm;
+	uint8_t selected_voice;
+	uint8_t selected_instrument;
+	enum waveform_type waveform;
+	bool has_waveform;
+	uint32_t note_count;
+	uint32_t notes_version;
+	bool playing;
+	uint32_t playhead_ms;
+	bool snap_enabled;
+	enum scale_type selected_scale;
+	enum root_note selected_root;
+	bool voice_hidden[8];
+	bool voice_solo[8];
+	bool voice_muted[8];
+	struct viewport viewport;
+	bool fold_mode;
+	bool show_scale_highlights;
+};
+
+static struct app_state_view app_state_cache;
+static lua_Integer app_state_version = 0;
+
+static void push_note_view(lua_State *L, uint32_t id)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, NOTE_VIEW_CACHE);
+	lua_rawgeti(L, -1, id);
+	if (!lua_isuserdata(L, -1)) {
+		lua_pop(L, 1);
+		struct note_view *view = lua_newuserdatauv(L, sizeof(struct note_view), 0);
+		view->id = id;
+		luaL_setmetatable(L, NOTE_VIEW_METATABLE);
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, -3, id);
+	}
+	lua_remove(L, -2);
+}
+
+static int note_view_index(lua_State *L)
+{
+	struct note_view *view = luaL_checkudata(L, 1, NOTE_VIEW_METATABLE);
+	const char *key = luaL_checkstring(L, 2);
+
+	if (strcmp(key, "id") == 0) {
+		lua_pushinteger(L, view->id);
+		return 1;
+	}
+
+	const struct ui_note *note = NULL;
+	if (global_context != NULL && global_context->app_state != NULL) {
+		note = note_store_find(&global_context->app_state->notes, view->id);
+	}
+	if (note == NULL) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (strcmp(key, "ms") == 0) {
+		lua_pushinteger(L, note->ms);
+	} else if (strcmp(key, "duration_ms") == 0) {
+		lua_pushinteger(L, note->duration_ms);
+	} else if (strcmp(key, "voice") == 0) {
+		lua_pushinteger(L, note->voice);
+	} else if (strcmp(key, "piano_key") == 0) {
+		lua_pushinteger(L, note->piano_key);
+	} else if (strcmp(key, "waveform") == 0) {
+		lua_pushinteger(L, note->waveform);
+	} else if (strcmp(key, "duty_cycle") == 0) {
+		lua_pushinteger(L, note->duty_cycle);
+	} else if (strcmp(key, "decay") == 0) {
+		lua_pushinteger(L, note->decay);
+	} else if (strcmp(key, "amplitude_dbfs") == 0) {
+		lua_pushinteger(L, note->amplitude_dbfs);
+	} else if (strcmp(key, "nes_noise_period") == 0) {
+		lua_pushinteger(L, note->nes_noise_period);
+	} else if (strcmp(key, "nes_noise_mode_flag") == 0) {
+		lua_pushboolean(L, note->nes_noise_mode_flag);
+	} else if (strcmp(key, "nes_noise_lfsr_init") == 0) {
+		lua_pushinteger(L, note->nes_noise_lfsr_init);
+	} else if (strcmp(key, "restart_phase") == 0) {
+		lua_pushboolean(L, note->restart_phase);
+	} else {
+		lua_pushnil(L);
+	}
+	return 1;
+}
+
+static int note_list_index(lua_State *L)
+{
+	lua_Integer index = luaL_checkinteger(L, 2);
+	const struct ui_note *note = NULL;
+	if (global_context != NULL && global_context->app_state != NULL && index >= 1 &&
+	    index <= UINT32_MAX) {
+		note = note_store_at(&global_context->app_state->notes, (uint32_t)(index - 1));
+	}
+
+	if (note == NULL) {
+		lua_pushnil(L);
+	} else {
+		push_note_view(L, note->id);
+	}
+	return 1;
+}
+
+static int note_list_len(lua_State *L)
+{
+	uint32_t count = 0;
+	if (global_context != NULL && global_context->app_state != NULL) {
+		count = note_store_count(&global_context->app_state->notes);
+	}
+	lua_pushinteger(L, count);
+	return 1;
+}
+
+static void create_app_state_table(lua_State *L)
+{
+	if (luaL_newmetatable(L, NOTE_VIEW_METATABLE)) {
+		lua_pushcfunction(L, note_view_index);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushstring(L, "v");
+	lua_setfield(L, -2, "__mode");
+	lua_setmetatable(L, -2);
+	lua_setfield(L, LUA_REGISTRYINDEX, NOTE_VIEW_CACHE);
+
+	lua_newtable(L);
+
+	lua_newtable(L);
+	lua_setfield(L, -2, "voice_hidden");
+	lua_newtable(L);
+	lua_setfield(L, -2, "voice_solo");
+	lua_newtable(L);
+	lua_setfield(L, -2, "voice_muted");
+	lua_newtable(L);
+	lua_setfield(L, -2, "viewport");
+
+	lua_newuserdatauv(L, 0, 0);
+	if (luaL_newmetatable(L, NOTE_LIST_METATABLE)) {
+		lua_pushcfunction(L, note_list_index);
+		lua_setfield(L, -2, "__index");
+		lua_pushcfunction(L, note_list_len);
+		lua_setfield(L, -2, "__len");
+	}
+	lua_setmetatable(L, -2);
+	lua_setfield(L, -2, "notes");
+
+	lua_pushinteger(L, 50);
+	lua_setfield(L, -2, "snap_ms");
+
+	lua_pushvalue(L, -1);
+	lua_setfield(L, LUA_REGISTRYINDEX, APP_STATE_CACHE);
+}
+
+static bool push_app_state_table(lua_State *L)
+{
+	if (lua_getfield(L, LUA_REGISTRYINDEX, APP_STATE_CACHE) == LUA_TTABLE) {
+		return true;
 	}
 
+	lua_pop(L, 1);
+	create_app_state_table(L);
+	return false;
+}
+
+static void read_app_state_view(struct app_state_view *view)
+{
 	struct app_state *state = global_context->app_state;
 	struct synth *synth = audio_get_synth(global_context->audio);
 
-	lua_newtable(L);
+	memset(view, 0, sizeof(struct app_state_view));
+	view->bpm = state->bpm;
+	view->selected_voice = state->selected_voice;
+	view->selected_instrument = state->selected_instrument;
+	if (synth != NULL && state->selected_voice < MAX_VOICES) {
+		view->waveform = synth->voices[state->selected_voice].waveform;
+		view->has_waveform = true;
+	}
+	view->note_count = note_store_count(&state->notes);
+	view->notes_version = state->notes.version;
+	view->playing = state->playing;
+	view->playhead_ms = state->playhead_ms;
+	view->snap_enabled = state->snap_enabled;
+	view->selected_scale = state->selected_scale;
+	view->selected_root = state->selected_root;
+	memcpy(view->voice_hidden, state->voice_hidden, sizeof(view->voice_hidden));
+	memcpy(view->voice_solo, state->voice_solo, sizeof(view->voice_solo));
+	memcpy(view->voice_muted, state->voice_muted, sizeof(view->voice_muted));
+	view->viewport = state->viewport;
+	view->fold_mode = state->fold_mode;
+	view->show_scale_highlights = state->show_scale_highlights;
+}
+
+static void set_flags_field(lua_State *L, const char *name, const bool *flags)
+{
+	lua_getfield(L, -1, name);
+	for (int i = 0; i < 8; i++) {
+		lua_pushboolean(L, flags[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_pop(L, 1);
+}
 
-	lua_pushinteger(L, state->bpm);
+static void write_app_state_view(lua_State *L, const struct app_state_view *view)
+{
+	lua_pushinteger(L, app_state_version);
+	lua_setfield(L, -2, "version");
+
+	lua_pushinteger(L, view->bpm);
 	lua_setfield(L, -2, "bpm");
 
-	lua_pushinteger(L, state->selected_voice);
+	lua_pushinteger(L, view->selected_voice);
 	lua_setfield(L, -2, "selected_voice");
 
-	lua_pushinteger(L, state->selected_instrument);
+	lua_pushinteger(L, view->selected_instrument);
 	lua_setfield(L, -2, "selected_instrument");
 
-	if (synth != NULL && state->selected_voice < MAX_VOICES) {
-		enum waveform_type waveform = synth->voices[state->selected_voice].waveform;
-		lua_pushstring(L, waveform_type_to_string(waveform));
-		lua_setfield(L, -2, "waveform");
-	} else {
-		lua_pushstring(L, "square");
-		lua_setfield(L, -2, "waveform");
-	}
+	lua_pushstring(L, view->has_waveform ? waveform_type_to_string(view->waveform) : "square");
+	lua_setfield(L, -2, "waveform");
 
-	lua_pushinteger(L, state->note_count);
+	lua_pushinteger(L, view->note_count);
 	lua_setfield(L, -2, "note_count");
 
-	lua_pushboolean(L, state->playing);
-	lua_setfield(L, -2, "is_playing");
+	lua_pushboolean(L, view->playing);
+	lua_setfield(L, -2, "is_playing");
+
+	lua_pushinteger(L, view->playhead_ms);
+	lua_setfield(L, -2, "playhead_ms");
+
+	lua_pushboolean(L, view->snap_enabled);
+	lua_setfield(L, -2, "snap_enabled");
+
+	lua_pushstring(L, scale_type_to_string(view->selected_scale));
+	lua_setfield(L, -2, "selected_scale");
+
+	lua_pushstring(L, root_note_to_string(view->selected_root));
+	lua_setfield(L, -2, "selected_root");
+
+	set_flags_field(L, "voice_hidden", view->voice_hidden);
+	set_flags_field(L, "voice_solo", view->voice_solo);
+	set_flags_field(L, "voice_muted", view->voice_muted);
+
+	lua_getfield(L, -1, "viewport");
+	lua_pushnumber(L, view->viewport.time_offset);
+	lua_setfield(L, -2, "time_offset");
+	lua_pushinteger(L, view->viewport.note_offset);
+	lua_setfield(L, -2, "note_offset");
+	lua_pushnumber(L, view->viewport.pixels_per_ms);
+	lua_setfield(L, -2, "pixels_per_ms");
+	lua_pushnumber(L, view->viewport.piano_key_height);
+	lua_setfield(L, -2, "piano_key_height");
+	lua_pushnumber(L, view->viewport.grid_x);
+	lua_setfield(L, -2, "grid_x");
+	lua_pushnumber(L, view->viewport.grid_y);
+	lua_setfield(L, -2, "grid_y");
+	lua_pushnumber(L, view->viewport.grid_width);
+	lua_setfield(L, -2, "grid_width");
+	lua_pushnumber(L, view->viewport.grid_height);
+	lua_setfield(L, -2, "grid_height");
+	lua_pop(L, 1);
+
+	lua_pushboolean(L, view->fold_mode);
+	lua_setfield(L, -2, "fold_mode");
+
+	lua_pushboolean(L, view->show_scale_highlights);
+	lua_setfield(L, -2, "show_scale_highlights");
+}
+
+static int lua_api_get_app_state(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	bool cached = push_app_state_table(L);
+
+	struct app_state_view view;
+	read_app_state_view(&view);
+	if (!cached || memcmp(&view, &app_state_cache, sizeof(struct app_state_view)) != 0) {
+		app_state_cache = view;
+		app_state_version++;
+		write_app_state_view(L, &view);
+	}
+
+	return 1;
+}
+
+static int lua_api_get_note(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	lua_Integer note_id = luaL_checkinteger(L, 1);
+	if (note_id < 0 || note_id > UINT32_MAX ||
+	    note_store_find(&global_context->app_state->notes, (uint32_t)note_id) == NULL) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	push_app_state_table(L);
+	lua_pop(L, 1);
+
+	push_note_view(L, (uint32_t)note_id);
+	return 1;
+}
+
+static uint32_t voice_conflicts_cache_version;
+static bool voice_conflicts_cached = false;
+
+static int lua_api_get_voice_conflicts(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	const struct voice_conflicts *conflicts =
+		note_store_conflicts(&global_context->app_state->notes);
+
+	lua_getfield(L, LUA_REGISTRYINDEX, VOICE_CONFLICTS_CACHE);
+	if (voice_conflicts_cached && conflicts->version == voice_conflicts_cache_version &&
+	    lua_istable(L, -1)) {
+		return 1;
+	}
+	lua_pop(L, 1);
+
+	lua_createtable(L, (int)voice_conflicts_count(conflicts), 0);
+	lua_Integer count = 0;
+	for (int voice = 0; voice < NOTE_INDEX_VOICES; voice++) {
+		const struct voice_conflict_list *list = &conflicts->voices[voice];
+		for (uint32_t i = 0; i < list->count; i++) {
+			lua_createtable(L, 0, 4);
+			lua_pushinteger(L, voice);
+			lua_setfield(L, -2, "voice");
+			lua_pushinteger(L, list->items[i].start_ms);
+			lua_setfield(L, -2, "start_ms");
+			lua_pushinteger(L, list->items[i].end_ms);
+			lua_setfield(L, -2, "end_ms");
+			lua_pushinteger(L, list->items[i].note_count);
+			lua_setfield(L, -2, "note_count");
+			lua_rawseti(L, -2, ++count);
+		}
+	}
+
+	lua_pushvalue(L, -1);
+	lua_setfield(L, LUA_REGISTRYINDEX, VOICE_CONFLICTS_CACHE);
+	voice_conflicts_cache_version = conflicts->version;
+	voice_conflicts_cached = true;
+	return 1;
+}
+
+static uint8_t check_voice_list(lua_State *L, int index)
+{
+	uint8_t mask = 0;
+	uint32_t count = (uint32_t)lua_rawlen(L, index);
+	for (uint32_t i = 0; i < count; i++) {
+		lua_rawgeti(L, index, (lua_Integer)i + 1);
+		lua_Integer voice = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		if (voice < 0 || voice >= NOTE_INDEX_VOICES) {
+			luaL_error(L, "Voice must be 0-7");
+		}
+		mask |= (uint8_t)(1u << voice);
+	}
+	return mask;
+}
+
+static void check_voice_solver_options(
+	lua_State *L, struct app_state *state, struct voice_solver_options *options
+)
+{
+	if (!lua_istable(L, 1)) {
+		return;
+	}
+
+	lua_getfield(L, 1, "selectedOnly");
+	if (lua_toboolean(L, -1) && state->selection.count > 0) {
+		options->movable = &state->selection.index;
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, 1, "voices");
+	if (lua_istable(L, -1)) {
+		options->voice_mask = check_voice_list(L, lua_gettop(L));
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, 1, "waveforms");
+	if (lua_istable(L, -1)) {
+		for (int i = 0; i < VOICE_SOLVER_WAVEFORMS; i++) {
+			lua_getfield(L, -1, waveform_type_to_string((enum waveform_type)i));
+			if (lua_istable(L, -1)) {
+				options->waveform_voices[i] = check_voice_list(L, lua_gettop(L));
+			}
+			lua_pop(L, 1);
+		}
+	}
+	lua_pop(L, 1);
+}
+
+static const uint32_t *check_locked_notes(lua_State *L, uint32_t *count)
+{
+	*count = 0;
+	if (!lua_istable(L, 1)) {
+		return NULL;
+	}
+
+	lua_getfield(L, 1, "locked");
+	if (!lua_istable(L, -1)) {
+		lua_pop(L, 1);
+		return NULL;
+	}
+
+	int table = lua_gettop(L);
+	uint32_t length = (uint32_t)lua_rawlen(L, table);
+	uint32_t *ids = lua_newuserdatauv(L, sizeof(uint32_t) * length, 0);
+	for (uint32_t i = 0; i < length; i++) {
+		ids[i] = note_id_at(L, table, i);
+	}
+	lua_replace(L, table);
+
+	*count = length;
+	return ids;
+}
+
+static int voice_solver_gc(lua_State *L)
+{
+	voice_solver_free(luaL_checkudata(L, 1, VOICE_SOLVER_METATABLE));
+	return 0;
+}
+
+static struct voice_solver *push_voice_solver(lua_State *L)
+{
+	struct voice_solver *solver = lua_newuserdatauv(L, sizeof(struct voice_solver), 0);
+	voice_solver_init(solver);
+
+	if (luaL_newmetatable(L, VOICE_SOLVER_METATABLE)) {
+		lua_pushcfunction(L, voice_solver_gc);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+
+	return solver;
+}
+
+static void
+push_voice_solver_result(lua_State *L, const struct voice_solver *solver, uint32_t changed)
+{
+	lua_createtable(L, 0, 3);
+	lua_pushinteger(L, changed);
+	lua_setfield(L, -2, "changed");
+	lua_pushinteger(L, solver->voices_used);
+	lua_setfield(L, -2, "voicesUsed");
+
+	lua_createtable(L, (int)solver->unsolved_count, 0);
+	for (uint32_t i = 0; i < solver->unsolved_count; i++) {
+		lua_createtable(L, 0, 3);
+		lua_pushinteger(L, solver->unsolved[i].start_ms);
+		lua_setfield(L, -2, "start_ms");
+		lua_pushinteger(L, solver->unsolved[i].end_ms);
+		lua_setfield(L, -2, "end_ms");
+		lua_pushinteger(L, solver->unsolved[i].note_count);
+		lua_setfield(L, -2, "note_count");
+		lua_rawseti(L, -2, (lua_Integer)i + 1);
+	}
+	lua_setfield(L, -2, "unsolved");
+}
+
+static int lua_api_auto_assign_voices(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	struct app_state *state = global_context->app_state;
+
+	struct voice_solver_options options;
+	voice_solver_options_init(&options);
+	check_voice_solver_options(L, state, &options);
+
+	uint32_t locked_count;
+	const uint32_t *locked_ids = check_locked_notes(L, &locked_count);
+	struct voice_solver *solver = push_voice_solver(L);
+
+	struct id_map locked;
+	id_map_init(&locked);
+	bool solved = true;
+	for (uint32_t i = 0; i < locked_count && solved; i++) {
+		solved = id_map_put(&locked, locked_ids[i], 0);
+	}
+	if (locked.count > 0) {
+		options.locked = &locked;
+	}
+
+	solved = solved && voice_solver_run(solver, &state->notes, &options);
+	id_map_free(&locked);
+
+	struct command cmd;
+	if (!solved || !command_init_group(&cmd, CMD_SET_NOTES_VOICE, solver->change_count)) {
+		return luaL_error(L, "Failed to assign voices");
+	}
+	struct set_note_voice_data *voices = cmd.data.group.entries;
+
+	note_store_prepare_updates(&state->notes, solver->change_count);
+	for (uint32_t i = 0; i < solver->change_count; i++) {
+		const struct voice_solver_change *change = &solver->changes[i];
+		const struct ui_note *current = note_store_find(&state->notes, change->id);
+		if (current == NULL) {
+			continue;
+		}
+
+		struct ui_note note = *current;
+
+		struct set_note_voice_data *entry = &voices[cmd.data.group.count++];
+		entry->note_id = note.id;
+		entry->old_voice = note.voice;
+		entry->new_voice = change->new_voice;
+
+		note.voice = change->new_voice;
+		note_store_update(&state->notes, &note);
+	}
+
+	uint32_t changed = cmd.data.group.count;
+	push_note_group(state, &cmd);
+
+	push_voice_solver_result(L, solver, changed);
+	return 1;
+}
+
+struct note_range_results {
+	lua_State *L;
+	lua_Integer count;
+};
+
+static bool push_note_in_range(const struct ui_note *note, void *user_data)
+{
+	struct note_range_results *results = user_data;
+	push_note(results->L, note);
+	lua_rawseti(results->L, -2, ++results->count);
+	return true;
+}
+
+static void check_note_range(lua_State *L, struct note_range *range)
+{
+	lua_Integer start_ms = luaL_checkinteger(L, 1);
+	lua_Integer end_ms = luaL_checkinteger(L, 2);
+	lua_Integer min_key = luaL_optinteger(L, 3, 0);
+	lua_Integer max_key = luaL_optinteger(L, 4, 127);
+	lua_Integer voice_mask = luaL_optinteger(L, 5, NOTE_INDEX_ALL_VOICES);
+
+	range->start_ms = start_ms > 0 ? (uint32_t)start_ms : 0;
+	range->end_ms = end_ms > 0 ? (uint32_t)(end_ms < UINT32_MAX ? end_ms : UINT32_MAX) : 0;
+	range->min_key = (uint8_t)(min_key < 0 ? 0 : min_key > 127 ? 127 : min_key);
+	range->max_key = (uint8_t)(max_key < 0 ? 0 : max_key > 127 ? 127 : max_key);
+	range->voice_mask = (uint8_t)(voice_mask & NOTE_INDEX_ALL_VOICES);
+}
 
-	lua_pushinteger(L, state->playhead_ms);
-	lua_setfield(L, -2, "playhead_ms");
+static int lua_api_get_notes_in_range(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
+	}
 
-	lua_pushboolean(L, state->snap_enabled);
-	lua_setfield(L, -2, "snap_enabled");
+	struct note_range range;
+	check_note_range(L, &range);
 
-	lua_pushinteger(L, 50);
-	lua_setfield(L, -2, "snap_ms");
+	struct note_range_results results = {L, 0};
+	lua_newtable(L);
+	note_store_query_range(
+		&global_context->app_state->notes, &range, push_note_in_range, &results
+	);
 
-	lua_pushstring(L, scale_type_to_string(state->selected_scale));
-	lua_setfield(L, -2, "selected_scale");
+	return 1;
+}
 
-	lua_pushstring(L, root_note_to_string(state->selected_root));
-	lua_setfield(L, -2, "selected_root");
+struct note_range_ids {
+	uint32_t count;
+	uint32_t ids[];
+};
 
-	lua_newtable(L);
-	for (int i = 0; i < 8; i++) {
-		lua_pushboolean(L, state->voice_hidden[i]);
-		lua_rawseti(L, -2, i + 1);
-	}
-	lua_setfield(L, -2, "voice_hidden");
+static bool collect_note_id(const struct ui_note *note, void *user_data)
+{
+	struct note_range_ids *ids = user_data;
+	ids->ids[ids->count++] = note->id;
+	return true;
+}
 
-	lua_newtable(L);
-	for (int i = 0; i < 8; i++) {
-		lua_pushboolean(L, state->voice_solo[i]);
-		lua_rawseti(L, -2, i + 1);
-	}
-	lua_setfield(L, -2, "voice_solo");
+static int note_range_next(lua_State *L)
+{
+	const struct note_range_ids *ids = lua_touserdata(L, 1);
+	lua_Integer position = luaL_checkinteger(L, 2);
 
-	lua_newtable(L);
-	for (int i = 0; i < 8; i++) {
-		lua_pushboolean(L, state->voice_muted[i]);
-		lua_rawseti(L, -2, i + 1);
+	while (ids != NULL && position >= 0 && position < ids->count) {
+		uint32_t id = ids->ids[position++];
+		if (note_store_find(&global_context->app_state->notes, id) != NULL) {
+			lua_pushinteger(L, position);
+			push_note_view(L, id);
+			return 2;
+		}
 	}
-	lua_setfield(L, -2, "voice_muted");
 
-	lua_newtable(L);
-	lua_pushnumber(L, state->viewport.time_offset);
-	lua_setfield(L, -2, "time_offset");
-	lua_pushinteger(L, state->viewport.note_offset);
-	lua_setfield(L, -2, "note_offset");
-	lua_pushnumber(L, state->viewport.pixels_per_ms);
-	lua_setfield(L, -2, "pixels_per_ms");
-	lua_pushnumber(L, state->viewport.piano_key_height);
-	lua_setfield(L, -2, "piano_key_height");
-	lua_pushnumber(L, state->viewport.grid_x);
-	lua_setfield(L, -2, "grid_x");
-	lua_pushnumber(L, state->viewport.grid_y);
-	lua_setfield(L, -2, "grid_y");
-	lua_pushnumber(L, state->viewport.grid_width);
-	lua_setfield(L, -2, "grid_width");
-	lua_pushnumber(L, state->viewport.grid_height);
-	lua_setfield(L, -2, "grid_height");
-	lua_setfield(L, -2, "viewport");
+	return 0;
+}
 
-	lua_newtable(L);
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		lua_newtable(L);
-		lua_pushinteger(L, state->notes[i].id);
-		lua_setfield(L, -2, "id");
-		lua_pushinteger(L, state->notes[i].ms);
-		lua_setfield(L, -2, "ms");
-		lua_pushinteger(L, state->notes[i].duration_ms);
-		lua_setfield(L, -2, "duration_ms");
-		lua_pushinteger(L, state->notes[i].voice);
-		lua_setfield(L, -2, "voice");
-		lua_pushinteger(L, state->notes[i].piano_key);
-		lua_setfield(L, -2, "piano_key");
-		lua_pushinteger(L, state->notes[i].waveform);
-		lua_setfield(L, -2, "waveform");
-		lua_pushinteger(L, state->notes[i].duty_cycle);
-		lua_setfield(L, -2, "duty_cycle");
-		lua_pushinteger(L, state->notes[i].decay);
-		lua_setfield(L, -2, "decay");
-		lua_pushinteger(L, state->notes[i].amplitude_dbfs);
-		lua_setfield(L, -2, "amplitude_dbfs");
-		lua_pushinteger(L, state->notes[i].nes_noise_period);
-		lua_setfield(L, -2, "nes_noise_period");
-		lua_pushboolean(L, state->notes[i].nes_noise_mode_flag);
-		lua_setfield(L, -2, "nes_noise_mode_flag");
-		lua_pushinteger(L, state->notes[i].nes_noise_lfsr_init);
-		lua_setfield(L, -2, "nes_noise_lfsr_init");
-		lua_pushboolean(L, state->notes[i].restart_phase);
-		lua_setfield(L, -2, "restart_phase");
-		lua_rawseti(L, -2, i + 1);
+static int lua_api_notes_in_range(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return luaL_error(L, "API context not available");
 	}
-	lua_setfield(L, -2, "notes");
 
-	lua_pushboolean(L, state->fold_mode);
-	lua_setfield(L, -2, "fold_mode");
+	struct note_range range;
+	check_note_range(L, &range);
 
-	lua_pushboolean(L, state->show_scale_highlights);
-	lua_setfield(L, -2, "show_scale_highlights");
+	struct note_store *notes = &global_context->app_state->notes;
+	uint32_t count = note_store_query_range(notes, &range, NULL, NULL);
 
-	return 1;
+	push_app_state_table(L);
+	lua_pop(L, 1);
+
+	lua_pushcfunction(L, note_range_next);
+	struct note_range_ids *ids =
+		lua_newuserdatauv(L, sizeof(struct note_range_ids) + sizeof(uint32_t) * count, 0);
+	ids->count = 0;
+	if (count > 0) {
+		note_store_query_range(notes, &range, collect_note_id, ids);
+	}
+	lua_pushinteger(L, 0);
+	return 3;
 }
 
 static int lua_api_get_instrument_count(lua_State *L)
@@ -1645,7 +2775,7 @@ static int lua_api_clear_selection(lua_State *L)
 		return luaL_error(L, "API context not available");
 	}
 
-	global_context->app_state->selection.count = 0;
+	app_state_clear_selection(global_context->app_state);
 
 	return 0;
 }
@@ -1659,18 +2789,7 @@ static int lua_api_select_note(lua_State *L)
 	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
 	struct app_state *state = global_context->app_state;
 
-	bool already_selected = false;
-	for (uint32_t i = 0; i < state->selection.count; i++) {
-		if (state->selection.selected_ids[i] == note_id) {
-			already_selected = true;
-			break;
-		}
-	}
-
-	if (!already_selected && state->selection.count < UI_MAX_SELECTION) {
-		state->selection.selected_ids[state->selection.count] = note_id;
-		state->selection.count++;
-	}
+	app_state_select_note(state, note_id);
 
 	return 0;
 }
@@ -1684,16 +2803,7 @@ static int lua_api_deselect_note(lua_State *L)
 	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
 	struct app_state *state = global_context->app_state;
 
-	for (uint32_t i = 0; i < state->selection.count; i++) {
-		if (state->selection.selected_ids[i] == note_id) {
-			for (uint32_t j = i; j < state->selection.count - 1; j++) {
-				state->selection.selected_ids[j] =
-					state->selection.selected_ids[j + 1];
-			}
-			state->selection.count--;
-			break;
-		}
-	}
+	app_state_deselect_note(state, note_id);
 
 	return 0;
 }
@@ -1707,15 +2817,7 @@ static int lua_api_is_note_selected(lua_State *L)
 	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
 	struct app_state *state = global_context->app_state;
 
-	bool is_selected = false;
-	for (uint32_t i = 0; i < state->selection.count; i++) {
-		if (state->selection.selected_ids[i] == note_id) {
-			is_selected = true;
-			break;
-		}
-	}
-
-	lua_pushboolean(L, is_selected);
+	lua_pushboolean(L, app_state_is_note_selected(state, note_id));
 
 	return 1;
 }
@@ -1733,28 +2835,25 @@ static int lua_api_move_note(lua_State *L)
 
 	struct app_state *state = global_context->app_state;
 
-	bool found = false;
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == note_id) {
-			int32_t new_ms = (int32_t)state->notes[i].ms + delta_ms;
-			if (new_ms < 0)
-				new_ms = 0;
-			state->notes[i].ms = (uint32_t)new_ms;
+	const struct ui_note *current = note_store_find(&state->notes, note_id);
+	if (current != NULL) {
+		struct ui_note note = *current;
 
-			int32_t new_key = (int32_t)state->notes[i].piano_key + delta_piano_key;
-			if (new_key < 0)
-				new_key = 0;
-			if (new_key > 127)
-				new_key = 127;
-			state->notes[i].piano_key = (uint8_t)new_key;
-			state->notes[i].frequency = note_to_frequency(new_key);
+		int32_t new_ms = (int32_t)note.ms + delta_ms;
+		if (new_ms < 0)
+			new_ms = 0;
+		note.ms = (uint32_t)new_ms;
 
-			found = true;
-			break;
-		}
-	}
+		int32_t new_key = (int32_t)note.piano_key + delta_piano_key;
+		if (new_key < 0)
+			new_key = 0;
+		if (new_key > 127)
+			new_key = 127;
+		note.piano_key = (uint8_t)new_key;
+		note.frequency = note_to_frequency(new_key);
+
+		note_store_update(&state->notes, &note);
 
-	if (found) {
 		struct command cmd;
 		cmd.type = CMD_MOVE_NOTE;
 		cmd.data.move_note.note_id = note_id;
@@ -1784,37 +2883,32 @@ static int lua_api_resize_note(lua_State *L)
 
 	struct app_state *state = global_context->app_state;
 
-	bool found = false;
 	int32_t actual_delta_ms = 0;
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == note_id) {
-			if (from_left) {
-				int32_t new_ms = (int32_t)state->notes[i].ms - delta_duration_ms;
-				int32_t new_duration =
-					(int32_t)state->notes[i].duration_ms + delta_duration_ms;
-
-				if (new_ms < 0)
-					new_ms = 0;
-				if (new_duration < 10)
-					new_duration = 10;
-
-				actual_delta_ms = (int32_t)state->notes[i].ms - new_ms;
-				state->notes[i].ms = (uint32_t)new_ms;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			} else {
-				int32_t new_duration =
-					(int32_t)state->notes[i].duration_ms + delta_duration_ms;
-				if (new_duration < 10)
-					new_duration = 10;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			}
+	const struct ui_note *current = note_store_find(&state->notes, note_id);
+	if (current != NULL) {
+		struct ui_note note = *current;
 
-			found = true;
-			break;
+		if (from_left) {
+			int32_t new_ms = (int32_t)note.ms - delta_duration_ms;
+			int32_t new_duration = (int32_t)note.duration_ms + delta_duration_ms;
+
+			if (new_ms < 0)
+				new_ms = 0;
+			if (new_duration < 10)
+				new_duration = 10;
+
+			actual_delta_ms = (int32_t)note.ms - new_ms;
+			note.ms = (uint32_t)new_ms;
+			note.duration_ms = (uint16_t)new_duration;
+		} else {
+			int32_t new_duration = (int32_t)note.duration_ms + delta_duration_ms;
+			if (new_duration < 10)
+				new_duration = 10;
+			note.duration_ms = (uint16_t)new_duration;
 		}
-	}
 
-	if (found) {
+		note_store_update(&state->notes, &note);
+
 		struct command cmd;
 		cmd.type = CMD_RESIZE_NOTE;
 		cmd.data.resize_note.note_id = note_id;
@@ -1842,47 +2936,28 @@ static int lua_api_delete_note(lua_State *L)
 	uint32_t note_id = (uint32_t)luaL_checkinteger(L, 1);
 	struct app_state *state = global_context->app_state;
 
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == note_id) {
-			struct command cmd;
-			cmd.type = CMD_DELETE_NOTE;
-			cmd.data.delete_note.note.id = state->notes[i].id;
-			cmd.data.delete_note.note.ms = state->notes[i].ms;
-			cmd.data.delete_note.note.duration_ms = state->notes[i].duration_ms;
-			cmd.data.delete_note.note.voice = state->notes[i].voice;
-			cmd.data.delete_note.note.piano_key = state->notes[i].piano_key;
-			cmd.data.delete_note.note.waveform = state->notes[i].waveform;
-			cmd.data.delete_note.note.duty_cycle = state->notes[i].duty_cycle;
-			cmd.data.delete_note.note.decay = state->notes[i].decay;
-			cmd.data.delete_note.note.amplitude_dbfs = state->notes[i].amplitude_dbfs;
-			cmd.data.delete_note.note.nes_noise_period =
-				state->notes[i].nes_noise_period;
-			cmd.data.delete_note.note.nes_noise_mode_flag =
-				state->notes[i].nes_noise_mode_flag;
-			cmd.data.delete_note.note.nes_noise_lfsr_init =
-				state->notes[i].nes_noise_lfsr_init;
-			cmd.data.delete_note.note.restart_phase = state->notes[i].restart_phase;
-			cmd.data.delete_note.index = i;
-			command_history_push(&state->history, cmd);
-
-			for (uint32_t j = i; j < state->note_count - 1; j++) {
-				state->notes[j] = state->notes[j + 1];
-			}
-			state->note_count--;
-
-			for (uint32_t j = 0; j < state->selection.count; j++) {
-				if (state->selection.selected_ids[j] == note_id) {
-					for (uint32_t k = j; k < state->selection.count - 1; k++) {
-						state->selection.selected_ids[k] =
-							state->selection.selected_ids[k + 1];
-					}
-					state->selection.count--;
-					break;
-				}
-			}
+	const struct ui_note *note = note_store_find(&state->notes, note_id);
+	if (note != NULL) {
+		struct command cmd;
+		cmd.type = CMD_DELETE_NOTE;
+		cmd.data.delete_note.note.id = note->id;
+		cmd.data.delete_note.note.ms = note->ms;
+		cmd.data.delete_note.note.duration_ms = note->duration_ms;
+		cmd.data.delete_note.note.voice = note->voice;
+		cmd.data.delete_note.note.piano_key = note->piano_key;
+		cmd.data.delete_note.note.waveform = note->waveform;
+		cmd.data.delete_note.note.duty_cycle = note->duty_cycle;
+		cmd.data.delete_note.note.decay = note->decay;
+		cmd.data.delete_note.note.amplitude_dbfs = note->amplitude_dbfs;
+		cmd.data.delete_note.note.nes_noise_period = note->nes_noise_period;
+		cmd.data.delete_note.note.nes_noise_mode_flag = note->nes_noise_mode_flag;
+		cmd.data.delete_note.note.nes_noise_lfsr_init = note->nes_noise_lfsr_init;
+		cmd.data.delete_note.note.restart_phase = note->restart_phase;
+		note_store_index_of(&state->notes, note_id, &cmd.data.delete_note.index);
+		command_history_push(&state->history, cmd);
 
-			break;
-		}
+		note_store_remove(&state->notes, note_id, NULL, NULL);
+		app_state_deselect_note(state, note_id);
 	}
 
 	struct sequencer *sequencer = audio_get_sequencer(global_context->audio);
@@ -1893,6 +2968,160 @@ static int lua_api_delete_note(lua_State *L)
 	return 0;
 }
 
+static int lua_api_move_notes(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	check_note_deltas(L, 2);
+	check_note_deltas(L, 3);
+
+	struct app_state *state = global_context->app_state;
+	uint32_t count = (uint32_t)lua_rawlen(L, 1);
+
+	struct command cmd;
+	if (!command_init_group(&cmd, CMD_MOVE_NOTES, count)) {
+		return luaL_error(L, "Failed to allocate undo entry");
+	}
+	struct move_note_data *moves = cmd.data.group.entries;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const struct ui_note *current = note_store_find(&state->notes, note_id_at(L, 1, i));
+		if (current == NULL) {
+			continue;
+		}
+
+		struct ui_note note = *current;
+
+		int32_t new_ms = (int32_t)note.ms + note_delta_at(L, 2, i);
+		if (new_ms < 0)
+			new_ms = 0;
+
+		int32_t new_key = (int32_t)note.piano_key + note_delta_at(L, 3, i);
+		if (new_key < 0)
+			new_key = 0;
+		if (new_key > 127)
+			new_key = 127;
+
+		struct move_note_data *move = &moves[cmd.data.group.count];
+		move->note_id = note.id;
+		move->delta_ms = new_ms - (int32_t)note.ms;
+		move->delta_piano_key = new_key - (int32_t)note.piano_key;
+		if (move->delta_ms == 0 && move->delta_piano_key == 0) {
+			continue;
+		}
+
+		note.ms = (uint32_t)new_ms;
+		note.piano_key = (uint8_t)new_key;
+		note.frequency = note_to_frequency(new_key);
+		note_store_update(&state->notes, &note);
+		cmd.data.group.count++;
+	}
+
+	push_note_group(state, &cmd);
+	return 0;
+}
+
+static int lua_api_resize_notes(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	check_note_deltas(L, 2);
+	bool from_left = lua_toboolean(L, 3);
+
+	struct app_state *state = global_context->app_state;
+	uint32_t count = (uint32_t)lua_rawlen(L, 1);
+
+	struct command cmd;
+	if (!command_init_group(&cmd, CMD_RESIZE_NOTES, count)) {
+		return luaL_error(L, "Failed to allocate undo entry");
+	}
+	struct resize_note_data *resizes = cmd.data.group.entries;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const struct ui_note *current = note_store_find(&state->notes, note_id_at(L, 1, i));
+		if (current == NULL) {
+			continue;
+		}
+
+		struct ui_note note = *current;
+		int32_t delta_duration_ms = note_delta_at(L, 2, i);
+
+		int32_t new_ms = (int32_t)note.ms;
+		if (from_left) {
+			new_ms -= delta_duration_ms;
+			if (new_ms < 0)
+				new_ms = 0;
+		}
+
+		int32_t new_duration = (int32_t)note.duration_ms + delta_duration_ms;
+		if (new_duration < 10)
+			new_duration = 10;
+		if (new_duration > UINT16_MAX)
+			new_duration = UINT16_MAX;
+
+		struct resize_note_data *resize = &resizes[cmd.data.group.count];
+		resize->note_id = note.id;
+		resize->from_left = from_left;
+		resize->delta_ms = (int32_t)note.ms - new_ms;
+		resize->delta_duration_ms = new_duration - (int32_t)note.duration_ms;
+		if (resize->delta_ms == 0 && resize->delta_duration_ms == 0) {
+			continue;
+		}
+
+		note.ms = (uint32_t)new_ms;
+		note.duration_ms = (uint16_t)new_duration;
+		note_store_update(&state->notes, &note);
+		cmd.data.group.count++;
+	}
+
+	push_note_group(state, &cmd);
+	return 0;
+}
+
+static int lua_api_delete_notes(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL ||
+	    global_context->audio == NULL) {
+		return luaL_error(L, "API context not available");
+	}
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	struct app_state *state = global_context->app_state;
+	uint32_t count = (uint32_t)lua_rawlen(L, 1);
+
+	struct command cmd;
+	if (!command_init_group(&cmd, CMD_DELETE_NOTES, count)) {
+		return luaL_error(L, "Failed to allocate undo entry");
+	}
+	struct delete_note_data *deletes = cmd.data.group.entries;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t note_id = note_id_at(L, 1, i);
+
+		struct ui_note removed;
+		struct delete_note_data *entry = &deletes[cmd.data.group.count];
+		if (!note_store_remove(&state->notes, note_id, &removed, &entry->index)) {
+			continue;
+		}
+
+		command_store_note(&removed, &entry->note);
+		app_state_deselect_note(state, note_id);
+		cmd.data.group.count++;
+	}
+
+	push_note_group(state, &cmd);
+	return 0;
+}
+
 static int lua_api_play_preview_note(lua_State *L)
 {
 	if (global_context == NULL || global_context->app_state == NULL ||
@@ -2098,6 +3327,140 @@ static int lua_api_zoom_vertical_at_mouse(lua_State *L)
 	return 0;
 }
 
+struct event_state_view {
+	uint32_t selection_version;
+	uint32_t playhead_ms;
+	bool playing;
+	uint32_t bpm;
+	bool voice_hidden[8];
+	bool voice_solo[8];
+	bool voice_muted[8];
+	struct viewport viewport;
+	uint32_t load_count;
+};
+
+static struct lua_event_bus event_bus;
+static struct event_state_view event_state;
+
+static void read_event_state_view(struct event_state_view *view)
+{
+	struct app_state *state = global_context->app_state;
+
+	memset(view, 0, sizeof(struct event_state_view));
+	view->selection_version = state->selection.version;
+	view->playhead_ms = state->playhead_ms;
+	view->playing = state->playing;
+	view->bpm = state->bpm;
+	memcpy(view->voice_hidden, state->voice_hidden, sizeof(view->voice_hidden));
+	memcpy(view->voice_solo, state->voice_solo, sizeof(view->voice_solo));
+	memcpy(view->voice_muted, state->voice_muted, sizeof(view->voice_muted));
+	view->viewport = state->viewport;
+	view->load_count = state->load_count;
+}
+
+static void dispatch_note_events(lua_State *L, struct note_store *notes)
+{
+	const struct note_event_log *log = &notes->events;
+	if (!log->reset && log->count == 0) {
+		return;
+	}
+
+	if (!lua_event_bus_has_subscribers(&event_bus, LUA_EVENT_NOTES_CHANGED)) {
+		note_store_clear_events(notes);
+		return;
+	}
+
+	if (log->reset) {
+		lua_pushnil(L);
+	} else {
+		lua_createtable(L, log->count, 0);
+		for (uint32_t i = 0; i < log->count; i++) {
+			lua_pushinteger(L, log->ids[i]);
+			lua_rawseti(L, -2, i + 1);
+		}
+	}
+
+	note_store_clear_events(notes);
+	lua_event_bus_emit(&event_bus, L, LUA_EVENT_NOTES_CHANGED, 1);
+}
+
+void lua_api_dispatch_events(lua_State *L)
+{
+	if (global_context == NULL || global_context->app_state == NULL) {
+		return;
+	}
+
+	struct app_state *state = global_context->app_state;
+	struct event_state_view previous = event_state;
+	read_event_state_view(&event_state);
+
+	if (event_state.load_count != previous.load_count) {
+		lua_pushstring(L, state->current_file_path);
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_FILE_LOADED, 1);
+	}
+
+	dispatch_note_events(L, &state->notes);
+
+	if (event_state.selection_version != previous.selection_version) {
+		lua_pushinteger(L, state->selection.count);
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_SELECTION_CHANGED, 1);
+	}
+
+	if (event_state.playing != previous.playing || event_state.bpm != previous.bpm) {
+		lua_pushboolean(L, event_state.playing);
+		lua_pushinteger(L, event_state.bpm);
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_TRANSPORT_CHANGED, 2);
+	}
+
+	if (event_state.playhead_ms != previous.playhead_ms) {
+		lua_pushinteger(L, event_state.playhead_ms);
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_PLAYHEAD_MOVED, 1);
+	}
+
+	if (memcmp(event_state.voice_hidden, previous.voice_hidden, sizeof(previous.voice_hidden)) ||
+	    memcmp(event_state.voice_solo, previous.voice_solo, sizeof(previous.voice_solo)) ||
+	    memcmp(event_state.voice_muted, previous.voice_muted, sizeof(previous.voice_muted))) {
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_VOICES_CHANGED, 0);
+	}
+
+	if (memcmp(&event_state.viewport, &previous.viewport, sizeof(struct viewport)) != 0) {
+		lua_event_bus_emit(&event_bus, L, LUA_EVENT_VIEWPORT_CHANGED, 0);
+	}
+}
+
+static int lua_api_subscribe(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	enum lua_event_type type;
+	if (!lua_event_type_from_string(name, &type)) {
+		return luaL_error(L, "Unknown event: %s", name);
+	}
+
+	int ref = lua_event_bus_subscribe(&event_bus, L, type, 2);
+	if (ref == LUA_NOREF) {
+		return luaL_error(L, "Failed to subscribe to %s", name);
+	}
+
+	lua_pushinteger(L, ref);
+	return 1;
+}
+
+static int lua_api_unsubscribe(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	int ref = (int)luaL_checkinteger(L, 2);
+
+	enum lua_event_type type;
+	if (!lua_event_type_from_string(name, &type)) {
+		return luaL_error(L, "Unknown event: %s", name);
+	}
+
+	lua_pushboolean(L, lua_event_bus_unsubscribe(&event_bus, L, type, ref));
+	return 1;
+}
+
 void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *ctx)
 {
 	if (runtime == NULL || runtime->L == NULL) {
@@ -2105,6 +3468,8 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	}
 
 	global_context = ctx;
+	lua_event_bus_init(&event_bus);
+	memset(&event_state, 0, sizeof(event_state));
 
 	lua_newtable(runtime->L);
 
@@ -2138,6 +3503,15 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_pushcfunction(runtime->L, lua_api_hex_to_rgb);
 	lua_setfield(runtime->L, -2, "hexToRgb");
 
+	lua_pushcfunction(runtime->L, lua_api_color);
+	lua_setfield(runtime->L, -2, "color");
+
+	lua_pushcfunction(runtime->L, lua_api_new_draw_list);
+	lua_setfield(runtime->L, -2, "newDrawList");
+
+	lua_pushcfunction(runtime->L, lua_api_draw_list);
+	lua_setfield(runtime->L, -2, "drawList");
+
 	lua_pushcfunction(runtime->L, lua_api_is_point_in_rect);
 	lua_setfield(runtime->L, -2, "isPointInRect");
 
@@ -2171,15 +3545,36 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_pushcfunction(runtime->L, lua_api_save_wav);
 	lua_setfield(runtime->L, -2, "saveWav");
 
+	lua_pushcfunction(runtime->L, lua_api_save_binary);
+	lua_setfield(runtime->L, -2, "saveBinary");
+
+	lua_pushcfunction(runtime->L, lua_api_save_midi);
+	lua_setfield(runtime->L, -2, "saveMidi");
+
+	lua_pushcfunction(runtime->L, lua_api_convert_song);
+	lua_setfield(runtime->L, -2, "convertSong");
+
 	lua_pushcfunction(runtime->L, lua_api_load);
 	lua_setfield(runtime->L, -2, "load");
 
+	lua_pushcfunction(runtime->L, lua_api_get_song_library);
+	lua_setfield(runtime->L, -2, "getSongLibrary");
+
+	lua_pushcfunction(runtime->L, lua_api_rescan_song_library);
+	lua_setfield(runtime->L, -2, "rescanSongLibrary");
+
 	lua_pushcfunction(runtime->L, lua_api_undo);
 	lua_setfield(runtime->L, -2, "undo");
 
 	lua_pushcfunction(runtime->L, lua_api_redo);
 	lua_setfield(runtime->L, -2, "redo");
 
+	lua_pushcfunction(runtime->L, lua_api_begin_edit);
+	lua_setfield(runtime->L, -2, "beginEdit");
+
+	lua_pushcfunction(runtime->L, lua_api_commit_edit);
+	lua_setfield(runtime->L, -2, "commitEdit");
+
 	lua_pushcfunction(runtime->L, lua_api_toggle_play);
 	lua_setfield(runtime->L, -2, "togglePlay");
 
@@ -2213,6 +3608,18 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_pushcfunction(runtime->L, lua_api_get_fps);
 	lua_setfield(runtime->L, -2, "getFps");
 
+	lua_pushcfunction(runtime->L, lua_api_get_plugin_stats);
+	lua_setfield(runtime->L, -2, "getPluginStats");
+
+	lua_pushcfunction(runtime->L, lua_api_get_gc_stats);
+	lua_setfield(runtime->L, -2, "getGcStats");
+
+	lua_pushcfunction(runtime->L, lua_api_subscribe);
+	lua_setfield(runtime->L, -2, "subscribe");
+
+	lua_pushcfunction(runtime->L, lua_api_unsubscribe);
+	lua_setfield(runtime->L, -2, "unsubscribe");
+
 	lua_pushcfunction(runtime->L, lua_api_toggle_scale_highlight);
 	lua_setfield(runtime->L, -2, "toggleScaleHighlight");
 
@@ -2246,9 +3653,27 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_pushcfunction(runtime->L, lua_api_set_note_instrument);
 	lua_setfield(runtime->L, -2, "setNoteInstrument");
 
+	lua_pushcfunction(runtime->L, lua_api_set_notes_instrument);
+	lua_setfield(runtime->L, -2, "setNotesInstrument");
+
 	lua_pushcfunction(runtime->L, lua_api_get_app_state);
 	lua_setfield(runtime->L, -2, "getAppState");
 
+	lua_pushcfunction(runtime->L, lua_api_get_note);
+	lua_setfield(runtime->L, -2, "getNote");
+
+	lua_pushcfunction(runtime->L, lua_api_get_voice_conflicts);
+	lua_setfield(runtime->L, -2, "getVoiceConflicts");
+
+	lua_pushcfunction(runtime->L, lua_api_auto_assign_voices);
+	lua_setfield(runtime->L, -2, "autoAssignVoices");
+
+	lua_pushcfunction(runtime->L, lua_api_get_notes_in_range);
+	lua_setfield(runtime->L, -2, "getNotesInRange");
+
+	lua_pushcfunction(runtime->L, lua_api_notes_in_range);
+	lua_setfield(runtime->L, -2, "notesInRange");
+
 	lua_pushcfunction(runtime->L, lua_api_get_mouse_position);
 	lua_setfield(runtime->L, -2, "getMousePosition");
 
@@ -2309,6 +3734,15 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_pushcfunction(runtime->L, lua_api_delete_note);
 	lua_setfield(runtime->L, -2, "deleteNote");
 
+	lua_pushcfunction(runtime->L, lua_api_move_notes);
+	lua_setfield(runtime->L, -2, "moveNotes");
+
+	lua_pushcfunction(runtime->L, lua_api_resize_notes);
+	lua_setfield(runtime->L, -2, "resizeNotes");
+
+	lua_pushcfunction(runtime->L, lua_api_delete_notes);
+	lua_setfield(runtime->L, -2, "deleteNotes");
+
 	lua_pushcfunction(runtime->L, lua_api_play_preview_note);
 	lua_setfield(runtime->L, -2, "playPreviewNote");
 
@@ -2342,6 +3776,24 @@ void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *c
 	lua_setglobal(runtime->L, "boostio");
 }
 
+void lua_api_update(lua_State *L)
+{
+	if (pending_save != NULL && song_saver_job_is_done(pending_save)) {
+		finish_pending_save(L);
+	}
+
+	lua_api_dispatch_events(L);
+}
+
+void lua_api_shutdown(lua_State *L)
+{
+	if (pending_save != NULL) {
+		finish_pending_save(L);
+	}
+
+	lua_event_bus_free(&event_bus, L);
+}
+
 void lua_api_set_context(struct lua_api_context *ctx)
 {
 	global_context = ctx;
@@ -8,6 +8,8 @@ struct audio;
 struct lua_command_registry;
 struct app_state;
 struct app_controller;
+struct song_library;
+struct lua_profiler;
 
 struct lua_api_context {
 	struct graphics *graphics;
@@ -15,10 +17,19 @@ struct lua_api_context {
 	struct lua_command_registry *command_registry;
 	struct app_state *app_state;
 	struct app_controller *app_controller;
+	struct song_library *song_library;
+	struct lua_profiler *plugin_profiler;
+	struct lua_runtime *runtime;
 };
 
 void lua_api_register_all(struct lua_runtime *runtime, struct lua_api_context *ctx);
 
 void lua_api_set_context(struct lua_api_context *ctx);
 
+void lua_api_update(lua_State *L);
+
+void lua_api_dispatch_events(lua_State *L);
+
+void lua_api_shutdown(lua_State *L);
+
 #endif
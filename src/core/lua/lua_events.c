@@ -0,0 +1,147 @@
+#include "lua_events.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *event_names[LUA_EVENT_COUNT] = {
+	[LUA_EVENT_NOTES_CHANGED] = "notes_changed",
+	[LUA_EVENT_SELECTION_CHANGED] = "selection_changed",
+	[LUA_EVENT_PLAYHEAD_MOVED] = "playhead_moved",
+	[LUA_EVENT_TRANSPORT_CHANGED] = "transport_changed",
+	[LUA_EVENT_VIEWPORT_CHANGED] = "viewport_changed",
+	[LUA_EVENT_VOICES_CHANGED] = "voices_changed",
+	[LUA_EVENT_FILE_LOADED] = "file_loaded",
+};
+
+static void compact(struct lua_event_subscribers *subscribers)
+{
+	int count = 0;
+	for (int i = 0; i < subscribers->count; i++) {
+		if (subscribers->refs[i] != LUA_NOREF) {
+			subscribers->refs[count++] = subscribers->refs[i];
+		}
+	}
+	subscribers->count = count;
+	subscribers->stale = false;
+}
+
+const char *lua_event_type_to_string(enum lua_event_type type)
+{
+	return type < LUA_EVENT_COUNT ? event_names[type] : "unknown";
+}
+
+bool lua_event_type_from_string(const char *name, enum lua_event_type *type)
+{
+	for (int i = 0; i < LUA_EVENT_COUNT; i++) {
+		if (strcmp(name, event_names[i]) == 0) {
+			*type = (enum lua_event_type)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void lua_event_bus_init(struct lua_event_bus *bus)
+{
+	memset(bus, 0, sizeof(struct lua_event_bus));
+}
+
+void lua_event_bus_free(struct lua_event_bus *bus, lua_State *L)
+{
+	for (int type = 0; type < LUA_EVENT_COUNT; type++) {
+		struct lua_event_subscribers *subscribers = &bus->subscribers[type];
+		for (int i = 0; i < subscribers->count; i++) {
+			luaL_unref(L, LUA_REGISTRYINDEX, subscribers->refs[i]);
+		}
+		free(subscribers->refs);
+	}
+	memset(bus, 0, sizeof(struct lua_event_bus));
+}
+
+int lua_event_bus_subscribe(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int stack_index
+)
+{
+	struct lua_event_subscribers *subscribers = &bus->subscribers[type];
+	if (subscribers->count == subscribers->capacity) {
+		int capacity = subscribers->capacity > 0 ? subscribers->capacity * 2 : 4;
+		int *refs = realloc(subscribers->refs, sizeof(int) * capacity);
+		if (refs == NULL) {
+			fprintf(stderr, "Failed to grow %s subscribers\n", event_names[type]);
+			return LUA_NOREF;
+		}
+		subscribers->refs = refs;
+		subscribers->capacity = capacity;
+	}
+
+	lua_pushvalue(L, stack_index);
+	int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	subscribers->refs[subscribers->count++] = ref;
+	return ref;
+}
+
+bool lua_event_bus_unsubscribe(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int ref
+)
+{
+	struct lua_event_subscribers *subscribers = &bus->subscribers[type];
+	for (int i = 0; i < subscribers->count; i++) {
+		if (subscribers->refs[i] == ref) {
+			luaL_unref(L, LUA_REGISTRYINDEX, ref);
+			subscribers->refs[i] = LUA_NOREF;
+			subscribers->stale = true;
+			if (bus->dispatch_depth == 0) {
+				compact(subscribers);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool lua_event_bus_has_subscribers(const struct lua_event_bus *bus, enum lua_event_type type)
+{
+	return bus->subscribers[type].count > 0;
+}
+
+void lua_event_bus_emit(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int num_args
+)
+{
+	struct lua_event_subscribers *subscribers = &bus->subscribers[type];
+	int base = lua_gettop(L) - num_args + 1;
+	int count = subscribers->count;
+
+	bus->dispatch_depth++;
+	for (int i = 0; i < count; i++) {
+		int ref = subscribers->refs[i];
+		if (ref == LUA_NOREF) {
+			continue;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+		for (int arg = 0; arg < num_args; arg++) {
+			lua_pushvalue(L, base + arg);
+		}
+
+		if (lua_pcall(L, num_args, 0, 0) != LUA_OK) {
+			fprintf(stderr,
+				"Lua %s handler error: %s\n",
+				event_names[type],
+				lua_tostring(L, -1));
+			lua_pop(L, 1);
+		}
+	}
+	bus->dispatch_depth--;
+
+	if (bus->dispatch_depth == 0) {
+		for (int i = 0; i < LUA_EVENT_COUNT; i++) {
+			if (bus->subscribers[i].stale) {
+				compact(&bus->subscribers[i]);
+			}
+		}
+	}
+
+	lua_pop(L, num_args);
+}
@@ -0,0 +1,53 @@
+#ifndef BOOSTIO_LUA_EVENTS_H
+#define BOOSTIO_LUA_EVENTS_H
+
+#include <stdbool.h>
+
+#include "lua_runtime.h"
+
+enum lua_event_type {
+	LUA_EVENT_NOTES_CHANGED,
+	LUA_EVENT_SELECTION_CHANGED,
+	LUA_EVENT_PLAYHEAD_MOVED,
+	LUA_EVENT_TRANSPORT_CHANGED,
+	LUA_EVENT_VIEWPORT_CHANGED,
+	LUA_EVENT_VOICES_CHANGED,
+	LUA_EVENT_FILE_LOADED,
+	LUA_EVENT_COUNT
+};
+
+struct lua_event_subscribers {
+	int *refs;
+	int count;
+	int capacity;
+	bool stale;
+};
+
+struct lua_event_bus {
+	struct lua_event_subscribers subscribers[LUA_EVENT_COUNT];
+	int dispatch_depth;
+};
+
+const char *lua_event_type_to_string(enum lua_event_type type);
+
+bool lua_event_type_from_string(const char *name, enum lua_event_type *type);
+
+void lua_event_bus_init(struct lua_event_bus *bus);
+
+void lua_event_bus_free(struct lua_event_bus *bus, lua_State *L);
+
+int lua_event_bus_subscribe(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int stack_index
+);
+
+bool lua_event_bus_unsubscribe(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int ref
+);
+
+bool lua_event_bus_has_subscribers(const struct lua_event_bus *bus, enum lua_event_type type);
+
+void lua_event_bus_emit(
+	struct lua_event_bus *bus, lua_State *L, enum lua_event_type type, int num_args
+);
+
+#endif
@@ -0,0 +1,175 @@
+#include "lua_pool.h"
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LUA_POOL_ARENA_SIZE (64 * 1024)
+
+struct lua_pool_arena {
+	struct lua_pool_arena *next;
+	alignas(max_align_t) uint8_t data[];
+};
+
+struct lua_pool_block {
+	struct lua_pool_block *next;
+};
+
+static size_t size_class(size_t size)
+{
+	return (size - 1) / LUA_POOL_GRANULARITY;
+}
+
+static bool is_small(size_t size)
+{
+	return size <= LUA_POOL_MAX_SMALL;
+}
+
+static void *carve_block(struct lua_pool *pool, size_t class_index)
+{
+	size_t block_size = (class_index + 1) * LUA_POOL_GRANULARITY;
+	if (pool->cursor == NULL || (size_t)(pool->limit - pool->cursor) < block_size) {
+		size_t arena_size = sizeof(struct lua_pool_arena) + LUA_POOL_ARENA_SIZE;
+		struct lua_pool_arena *arena = malloc(arena_size);
+		if (arena == NULL) {
+			return NULL;
+		}
+
+		arena->next = pool->arenas;
+		pool->arenas = arena;
+		pool->cursor = arena->data;
+		pool->limit = arena->data + LUA_POOL_ARENA_SIZE;
+		pool->arena_bytes += LUA_POOL_ARENA_SIZE;
+	}
+
+	void *block = pool->cursor;
+	pool->cursor += block_size;
+	return block;
+}
+
+static void *small_alloc(struct lua_pool *pool, size_t size)
+{
+	size_t class_index = size_class(size);
+	struct lua_pool_block *block = pool->free_lists[class_index];
+	if (block != NULL) {
+		pool->free_lists[class_index] = block->next;
+		return block;
+	}
+	return carve_block(pool, class_index);
+}
+
+static void small_free(struct lua_pool *pool, void *ptr, size_t size)
+{
+	size_t class_index = size_class(size);
+	struct lua_pool_block *block = ptr;
+	block->next = pool->free_lists[class_index];
+	pool->free_lists[class_index] = block;
+}
+
+static bool take_stray(struct lua_pool *pool, void *ptr)
+{
+	for (uint32_t i = 0; i < pool->stray_count; i++) {
+		if (pool->strays[i] == ptr) {
+			pool->strays[i] = pool->strays[--pool->stray_count];
+			return true;
+		}
+	}
+	return false;
+}
+
+static void release(struct lua_pool *pool, void *ptr, size_t size)
+{
+	if (!is_small(size) || (pool->stray_count > 0 && take_stray(pool, ptr))) {
+		free(ptr);
+	} else {
+		small_free(pool, ptr, size);
+	}
+}
+
+static void *resize(struct lua_pool *pool, void *ptr, size_t old_size, size_t new_size)
+{
+	if (ptr == NULL) {
+		return is_small(new_size) ? small_alloc(pool, new_size) : malloc(new_size);
+	}
+
+	if (!is_small(old_size) && !is_small(new_size)) {
+		return realloc(ptr, new_size);
+	}
+
+	if (is_small(old_size) && is_small(new_size) &&
+	    size_class(old_size) == size_class(new_size)) {
+		return ptr;
+	}
+
+	void *block = is_small(new_size) ? small_alloc(pool, new_size) : malloc(new_size);
+	if (block == NULL) {
+		if (new_size >= old_size) {
+			return NULL;
+		}
+		if (is_small(old_size)) {
+			return ptr;
+		}
+		if (pool->stray_count == LUA_POOL_MAX_STRAYS) {
+			return NULL;
+		}
+		pool->strays[pool->stray_count++] = ptr;
+		return ptr;
+	}
+
+	memcpy(block, ptr, new_size < old_size ? new_size : old_size);
+	release(pool, ptr, old_size);
+	return block;
+}
+
+void lua_pool_init(struct lua_pool *pool)
+{
+	memset(pool, 0, sizeof(struct lua_pool));
+}
+
+void lua_pool_free(struct lua_pool *pool)
+{
+	for (uint32_t i = 0; i < pool->stray_count; i++) {
+		free(pool->strays[i]);
+	}
+
+	struct lua_pool_arena *arena = pool->arenas;
+	while (arena != NULL) {
+		struct lua_pool_arena *next = arena->next;
+		free(arena);
+		arena = next;
+	}
+	memset(pool, 0, sizeof(struct lua_pool));
+}
+
+void *lua_pool_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	struct lua_pool *pool = ud;
+	size_t old_size = ptr != NULL ? osize : 0;
+
+	if (nsize == 0) {
+		if (ptr != NULL) {
+			release(pool, ptr, old_size);
+			pool->freed_bytes += old_size;
+		}
+		return NULL;
+	}
+
+	void *block = resize(pool, ptr, old_size, nsize);
+	if (block == NULL) {
+		return NULL;
+	}
+
+	if (nsize > old_size) {
+		pool->allocated_bytes += nsize - old_size;
+		pool->allocation_count++;
+	} else {
+		pool->freed_bytes += old_size - nsize;
+	}
+
+	uint64_t live = pool->allocated_bytes - pool->freed_bytes;
+	if (live > pool->peak_bytes) {
+		pool->peak_bytes = live;
+	}
+	return block;
+}
@@ -0,0 +1,34 @@
+#ifndef BOOSTIO_LUA_POOL_H
+#define BOOSTIO_LUA_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LUA_POOL_GRANULARITY 16
+#define LUA_POOL_MAX_SMALL 512
+#define LUA_POOL_CLASS_COUNT (LUA_POOL_MAX_SMALL / LUA_POOL_GRANULARITY)
+#define LUA_POOL_MAX_STRAYS 16
+
+struct lua_pool_arena;
+
+struct lua_pool {
+	void *free_lists[LUA_POOL_CLASS_COUNT];
+	struct lua_pool_arena *arenas;
+	uint8_t *cursor;
+	uint8_t *limit;
+	void *strays[LUA_POOL_MAX_STRAYS];
+	uint32_t stray_count;
+	size_t arena_bytes;
+	uint64_t allocated_bytes;
+	uint64_t freed_bytes;
+	uint64_t peak_bytes;
+	uint64_t allocation_count;
+};
+
+void lua_pool_init(struct lua_pool *pool);
+
+void lua_pool_free(struct lua_pool *pool);
+
+void *lua_pool_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+#endif
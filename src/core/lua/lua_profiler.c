@@ -0,0 +1,113 @@
+#include "lua_profiler.h"
+#include "lua_runtime.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool lua_profiler_init(struct lua_profiler *profiler, int count)
+{
+	memset(profiler, 0, sizeof(struct lua_profiler));
+	profiler->frequency = SDL_GetPerformanceFrequency();
+	if (count <= 0) {
+		return true;
+	}
+
+	profiler->entries = calloc(count, sizeof(struct lua_profiler_entry));
+	if (profiler->entries == NULL) {
+		return false;
+	}
+
+	profiler->count = count;
+	return true;
+}
+
+void lua_profiler_free(struct lua_profiler *profiler)
+{
+	free(profiler->entries);
+	memset(profiler, 0, sizeof(struct lua_profiler));
+}
+
+void lua_profiler_set_name(struct lua_profiler *profiler, int index, const char *name)
+{
+	if (index >= 0 && index < profiler->count) {
+		profiler->entries[index].name = name;
+	}
+}
+
+void lua_profiler_begin(const struct lua_runtime *runtime, struct lua_profiler_sample *mark)
+{
+	mark->allocated_bytes = runtime->pool.allocated_bytes;
+	mark->freed_bytes = runtime->pool.freed_bytes;
+	mark->ticks = SDL_GetPerformanceCounter();
+}
+
+uint64_t lua_profiler_end(
+	struct lua_profiler *profiler,
+	int index,
+	const struct lua_runtime *runtime,
+	const struct lua_profiler_sample *mark
+)
+{
+	uint64_t ticks = SDL_GetPerformanceCounter() - mark->ticks;
+	if (index < 0 || index >= profiler->count) {
+		return ticks;
+	}
+
+	struct lua_profiler_sample *current = &profiler->entries[index].current;
+	current->ticks += ticks;
+	current->allocated_bytes += runtime->pool.allocated_bytes - mark->allocated_bytes;
+	current->freed_bytes += runtime->pool.freed_bytes - mark->freed_bytes;
+	return ticks;
+}
+
+void lua_profiler_end_frame(struct lua_profiler *profiler)
+{
+	for (int i = 0; i < profiler->count; i++) {
+		struct lua_profiler_entry *entry = &profiler->entries[i];
+		entry->window[entry->head] = entry->current;
+		entry->head = (entry->head + 1) % LUA_PROFILER_WINDOW;
+		if (entry->filled < LUA_PROFILER_WINDOW) {
+			entry->filled++;
+		}
+		memset(&entry->current, 0, sizeof(entry->current));
+	}
+}
+
+void lua_profiler_get_stats(
+	const struct lua_profiler *profiler, int index, struct lua_profiler_stats *stats
+)
+{
+	memset(stats, 0, sizeof(struct lua_profiler_stats));
+	if (index < 0 || index >= profiler->count) {
+		return;
+	}
+
+	const struct lua_profiler_entry *entry = &profiler->entries[index];
+	stats->name = entry->name;
+	if (entry->filled == 0) {
+		return;
+	}
+
+	uint64_t total_ticks = 0;
+	uint64_t max_ticks = 0;
+	uint64_t allocated = 0;
+	uint64_t freed = 0;
+	for (uint32_t i = 0; i < entry->filled; i++) {
+		const struct lua_profiler_sample *sample = &entry->window[i];
+		total_ticks += sample->ticks;
+		allocated += sample->allocated_bytes;
+		freed += sample->freed_bytes;
+		if (sample->ticks > max_ticks) {
+			max_ticks = sample->ticks;
+		}
+	}
+
+	uint32_t last = (entry->head + LUA_PROFILER_WINDOW - 1) % LUA_PROFILER_WINDOW;
+	double ms_per_tick = 1000.0 / (double)profiler->frequency;
+	stats->last_ms = (double)entry->window[last].ticks * ms_per_tick;
+	stats->avg_ms = (double)total_ticks * ms_per_tick / entry->filled;
+	stats->max_ms = (double)max_ticks * ms_per_tick;
+	stats->alloc_kb = (double)allocated / 1024.0 / entry->filled;
+	stats->gc_kb = (double)freed / 1024.0 / entry->filled;
+}
@@ -0,0 +1,61 @@
+#ifndef BOOSTIO_LUA_PROFILER_H
+#define BOOSTIO_LUA_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LUA_PROFILER_WINDOW 120
+
+struct lua_runtime;
+
+struct lua_profiler_sample {
+	uint64_t ticks;
+	uint64_t allocated_bytes;
+	uint64_t freed_bytes;
+};
+
+struct lua_profiler_entry {
+	const char *name;
+	struct lua_profiler_sample current;
+	struct lua_profiler_sample window[LUA_PROFILER_WINDOW];
+	uint32_t head;
+	uint32_t filled;
+};
+
+struct lua_profiler_stats {
+	const char *name;
+	double last_ms;
+	double avg_ms;
+	double max_ms;
+	double alloc_kb;
+	double gc_kb;
+};
+
+struct lua_profiler {
+	struct lua_profiler_entry *entries;
+	int count;
+	uint64_t frequency;
+};
+
+bool lua_profiler_init(struct lua_profiler *profiler, int count);
+
+void lua_profiler_free(struct lua_profiler *profiler);
+
+void lua_profiler_set_name(struct lua_profiler *profiler, int index, const char *name);
+
+void lua_profiler_begin(const struct lua_runtime *runtime, struct lua_profiler_sample *mark);
+
+uint64_t lua_profiler_end(
+	struct lua_profiler *profiler,
+	int index,
+	const struct lua_runtime *runtime,
+	const struct lua_profiler_sample *mark
+);
+
+void lua_profiler_end_frame(struct lua_profiler *profiler);
+
+void lua_profiler_get_stats(
+	const struct lua_profiler *profiler, int index, struct lua_profiler_stats *stats
+);
+
+#endif
@@ -1,9 +1,14 @@
 #include "lua_runtime.h"
 
+#include <SDL3/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define LUA_GC_MIN_IDLE_MS 0.5
+#define LUA_GC_MAX_IDLE_MS 4.0
+#define LUA_GC_IDLE_GROWTH_KB 64
+
 static void push_config_path(lua_State *L, const char *path)
 {
 	lua_getglobal(L, "config");
@@ -27,19 +32,39 @@ static void push_config_path(lua_State *L, const char *path)
 	free(path_copy);
 }
 
+static int runtime_panic(lua_State *L)
+{
+	const char *message = lua_tostring(L, -1);
+	fprintf(stderr,
+		"Unprotected Lua error: %s\n",
+		message != NULL ? message : "error object is not a string");
+	return 0;
+}
+
 bool lua_runtime_init(struct lua_runtime *runtime)
 {
 	if (runtime == NULL) {
 		return false;
 	}
 
-	runtime->L = luaL_newstate();
+	lua_pool_init(&runtime->pool);
+	memset(&runtime->gc_stats, 0, sizeof(runtime->gc_stats));
+	runtime->gc_baseline_kb = 0;
+	runtime->gc_cycle_active = false;
+	runtime->L = lua_newstate(lua_pool_alloc, &runtime->pool);
 	if (runtime->L == NULL) {
 		fprintf(stderr, "Failed to create Lua state\n");
 		return false;
 	}
 
+	lua_atpanic(runtime->L, runtime_panic);
 	luaL_openlibs(runtime->L);
+
+#ifdef LUA_GCGEN
+	lua_gc(runtime->L, LUA_GCGEN, 0, 0);
+	runtime->gc_stats.generational = true;
+#endif
+	runtime->gc_baseline_kb = lua_gc(runtime->L, LUA_GCCOUNT, 0);
 	return true;
 }
 
@@ -51,6 +76,50 @@ void lua_runtime_deinit(struct lua_runtime *runtime)
 
 	lua_close(runtime->L);
 	runtime->L = NULL;
+	lua_pool_free(&runtime->pool);
+}
+
+void lua_runtime_collect_idle(struct lua_runtime *runtime, double idle_ms)
+{
+	if (runtime == NULL || runtime->L == NULL || idle_ms < LUA_GC_MIN_IDLE_MS) {
+		return;
+	}
+
+	struct lua_gc_stats *stats = &runtime->gc_stats;
+	int heap_kb = lua_gc(runtime->L, LUA_GCCOUNT, 0);
+	if (!runtime->gc_cycle_active && heap_kb < runtime->gc_baseline_kb + LUA_GC_IDLE_GROWTH_KB) {
+		return;
+	}
+
+	double budget_ms = idle_ms * 0.5;
+	if (budget_ms > LUA_GC_MAX_IDLE_MS) {
+		budget_ms = LUA_GC_MAX_IDLE_MS;
+	}
+
+	uint64_t frequency = SDL_GetPerformanceFrequency();
+	uint64_t start = SDL_GetPerformanceCounter();
+	uint64_t deadline = start + (uint64_t)(budget_ms * (double)frequency / 1000.0);
+
+	bool finished = stats->generational;
+	do {
+		stats->idle_steps++;
+		if (lua_gc(runtime->L, LUA_GCSTEP, 0)) {
+			finished = true;
+		}
+	} while (!finished && SDL_GetPerformanceCounter() < deadline);
+
+	double pause_ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)frequency;
+	stats->last_pause_ms = pause_ms;
+	stats->total_pause_ms += pause_ms;
+	if (pause_ms > stats->max_pause_ms) {
+		stats->max_pause_ms = pause_ms;
+	}
+
+	runtime->gc_cycle_active = !finished;
+	if (finished) {
+		stats->idle_cycles++;
+		runtime->gc_baseline_kb = lua_gc(runtime->L, LUA_GCCOUNT, 0);
+	}
 }
 
 bool lua_runtime_load_file(struct lua_runtime *runtime, const char *filepath)
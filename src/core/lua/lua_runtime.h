@@ -5,15 +5,33 @@
 #include <lua.h>
 #include <lualib.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "lua_pool.h"
+
+struct lua_gc_stats {
+	bool generational;
+	uint64_t idle_steps;
+	uint64_t idle_cycles;
+	double last_pause_ms;
+	double max_pause_ms;
+	double total_pause_ms;
+};
 
 struct lua_runtime {
 	lua_State *L;
+	struct lua_pool pool;
+	struct lua_gc_stats gc_stats;
+	int gc_baseline_kb;
+	bool gc_cycle_active;
 };
 
 bool lua_runtime_init(struct lua_runtime *runtime);
 
 void lua_runtime_deinit(struct lua_runtime *runtime);
 
+void lua_runtime_collect_idle(struct lua_runtime *runtime, double idle_ms);
+
 bool lua_runtime_load_file(struct lua_runtime *runtime, const char *filepath);
 
 bool lua_runtime_load_string(struct lua_runtime *runtime, const char *code);
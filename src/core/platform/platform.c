@@ -8,15 +8,24 @@
 #if defined(_WIN32)
 #define PLATFORM_WINDOWS
 #include <direct.h>
+#include <io.h>
 #include <windows.h>
 #elif defined(__APPLE__)
 #define PLATFORM_MACOS
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #elif defined(__linux__)
 #define PLATFORM_LINUX
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 static char *get_env_or_default(const char *env_name, const char *default_value)
@@ -184,3 +193,197 @@ bool platform_ensure_directory(const char *path)
 	free(path_copy);
 	return true;
 }
+
+bool platform_map_file(const char *path, struct platform_mapped_file *file)
+{
+	if (path == NULL || file == NULL) {
+		return false;
+	}
+
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+
+#if defined(PLATFORM_WINDOWS)
+	HANDLE handle = CreateFileA(
+		path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL
+	);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+		CloseHandle(handle);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(handle);
+	if (mapping == NULL) {
+		return false;
+	}
+
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	file->data = data;
+	file->size = (size_t)size.QuadPart;
+	file->handle = mapping;
+	return true;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	file->data = data;
+	file->size = (size_t)st.st_size;
+	return true;
+#endif
+}
+
+void platform_unmap_file(struct platform_mapped_file *file)
+{
+	if (file == NULL || file->data == NULL) {
+		return;
+	}
+
+#if defined(PLATFORM_WINDOWS)
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->handle);
+#else
+	munmap((void *)file->data, file->size);
+#endif
+
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+}
+
+bool platform_list_directory(
+	const char *path,
+	bool (*callback)(const struct platform_file_info *info, void *user_data),
+	void *user_data
+)
+{
+	if (path == NULL || callback == NULL) {
+		return false;
+	}
+
+	struct platform_file_info info;
+
+#if defined(PLATFORM_WINDOWS)
+	char pattern[1024];
+	snprintf(pattern, sizeof(pattern), "%s\\*", path);
+
+	WIN32_FIND_DATAA find_data;
+	HANDLE find = FindFirstFileA(pattern, &find_data);
+	if (find == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	do {
+		if (strcmp(find_data.cFileName, ".") == 0 || strcmp(find_data.cFileName, "..") == 0) {
+			continue;
+		}
+
+		ULARGE_INTEGER write_time;
+		write_time.LowPart = find_data.ftLastWriteTime.dwLowDateTime;
+		write_time.HighPart = find_data.ftLastWriteTime.dwHighDateTime;
+
+		info.name = find_data.cFileName;
+		info.modified_time = (int64_t)(write_time.QuadPart / 10000000ULL) - 11644473600LL;
+		info.size = ((uint64_t)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+		info.is_directory = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+
+		if (!callback(&info, user_data)) {
+			break;
+		}
+	} while (FindNextFileA(find, &find_data));
+
+	FindClose(find);
+	return true;
+#else
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return false;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+
+		char full_path[1024];
+		snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+
+		struct stat st;
+		if (stat(full_path, &st) != 0) {
+			continue;
+		}
+
+		info.name = entry->d_name;
+		info.modified_time = (int64_t)st.st_mtime;
+		info.size = (uint64_t)st.st_size;
+		info.is_directory = S_ISDIR(st.st_mode);
+
+		if (!callback(&info, user_data)) {
+			break;
+		}
+	}
+
+	closedir(dir);
+	return true;
+#endif
+}
+
+bool platform_sync_file(FILE *file)
+{
+	if (file == NULL || fflush(file) != 0) {
+		return false;
+	}
+
+#if defined(PLATFORM_WINDOWS)
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool platform_replace_file(const char *source_path, const char *target_path)
+{
+	if (source_path == NULL || target_path == NULL) {
+		return false;
+	}
+
+#if defined(PLATFORM_WINDOWS)
+	return MoveFileExA(
+		       source_path, target_path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+	       ) != 0;
+#else
+	return rename(source_path, target_path) == 0;
+#endif
+}
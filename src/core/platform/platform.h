@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 struct platform_paths {
 	char *binary_dir;
@@ -16,4 +18,31 @@ void platform_paths_free(struct platform_paths *paths);
 
 bool platform_ensure_directory(const char *path);
 
+struct platform_mapped_file {
+	const uint8_t *data;
+	size_t size;
+	void *handle;
+};
+
+bool platform_map_file(const char *path, struct platform_mapped_file *file);
+
+void platform_unmap_file(struct platform_mapped_file *file);
+
+struct platform_file_info {
+	const char *name;
+	int64_t modified_time;
+	uint64_t size;
+	bool is_directory;
+};
+
+bool platform_list_directory(
+	const char *path,
+	bool (*callback)(const struct platform_file_info *info, void *user_data),
+	void *user_data
+);
+
+bool platform_sync_file(FILE *file);
+
+bool platform_replace_file(const char *source_path, const char *target_path);
+
 #endif
@@ -0,0 +1,463 @@
+#include "command_codec.h"
+#include "command_history.h"
+
+#include <string.h>
+
+#define CODEC_FLAG_NES_NOISE_MODE 0x01
+#define CODEC_FLAG_RESTART_PHASE 0x02
+#define CODEC_FLAG_FROM_LEFT 0x04
+#define CODEC_FLAG_UNIFORM 0x08
+
+#define CODEC_MAX_HEADER_SIZE 16
+#define CODEC_MAX_ENTRY_SIZE 48
+
+struct codec_reader {
+	const uint8_t *data;
+	size_t size;
+	size_t offset;
+	bool failed;
+};
+
+static uint8_t *put_varint(uint8_t *dst, uint32_t value)
+{
+	while (value >= 0x80) {
+		*dst++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*dst++ = (uint8_t)value;
+	return dst;
+}
+
+static uint8_t *put_signed(uint8_t *dst, int32_t value)
+{
+	return put_varint(dst, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static uint8_t *put_f32(uint8_t *dst, float value)
+{
+	memcpy(dst, &value, sizeof(value));
+	return dst + sizeof(value);
+}
+
+static uint8_t get_u8(struct codec_reader *reader)
+{
+	if (reader->offset >= reader->size) {
+		reader->failed = true;
+		return 0;
+	}
+	return reader->data[reader->offset++];
+}
+
+static uint32_t get_varint(struct codec_reader *reader)
+{
+	uint32_t value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		uint8_t byte = get_u8(reader);
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return value;
+		}
+	}
+
+	reader->failed = true;
+	return 0;
+}
+
+static int32_t get_signed(struct codec_reader *reader)
+{
+	uint32_t value = get_varint(reader);
+	return (int32_t)((value >> 1) ^ (0u - (value & 1)));
+}
+
+static float get_f32(struct codec_reader *reader)
+{
+	float value = 0.0f;
+	if (reader->size - reader->offset < sizeof(value)) {
+		reader->failed = true;
+		return value;
+	}
+
+	memcpy(&value, reader->data + reader->offset, sizeof(value));
+	reader->offset += sizeof(value);
+	return value;
+}
+
+static uint8_t *put_note(uint8_t *dst, const struct stored_note *note, uint32_t previous_ms)
+{
+	uint8_t flags = 0;
+	if (note->nes_noise_mode_flag)
+		flags |= CODEC_FLAG_NES_NOISE_MODE;
+	if (note->restart_phase)
+		flags |= CODEC_FLAG_RESTART_PHASE;
+
+	dst = put_signed(dst, (int32_t)(note->ms - previous_ms));
+	dst = put_varint(dst, note->duration_ms);
+	*dst++ = note->voice;
+	*dst++ = note->piano_key;
+	dst = put_f32(dst, note->frequency);
+	*dst++ = (uint8_t)note->waveform;
+	*dst++ = note->duty_cycle;
+	dst = put_signed(dst, note->decay);
+	*dst++ = (uint8_t)note->amplitude_dbfs;
+	*dst++ = note->nes_noise_period;
+	*dst++ = flags;
+	return put_varint(dst, note->nes_noise_lfsr_init);
+}
+
+static void get_note(struct codec_reader *reader, struct stored_note *note, uint32_t previous_ms)
+{
+	note->ms = previous_ms + (uint32_t)get_signed(reader);
+	note->duration_ms = (uint16_t)get_varint(reader);
+	note->voice = get_u8(reader);
+	note->piano_key = get_u8(reader);
+	note->frequency = get_f32(reader);
+	note->waveform = (enum waveform_type)get_u8(reader);
+	note->duty_cycle = get_u8(reader);
+	note->decay = (int16_t)get_signed(reader);
+	note->amplitude_dbfs = (int8_t)get_u8(reader);
+	note->nes_noise_period = get_u8(reader);
+
+	uint8_t flags = get_u8(reader);
+	note->nes_noise_mode_flag = (flags & CODEC_FLAG_NES_NOISE_MODE) != 0;
+	note->restart_phase = (flags & CODEC_FLAG_RESTART_PHASE) != 0;
+	note->nes_noise_lfsr_init = (uint16_t)get_varint(reader);
+}
+
+static uint8_t *put_instrument(uint8_t *dst, const struct set_note_instrument_data *data)
+{
+	*dst++ = (uint8_t)data->old_waveform;
+	*dst++ = data->old_duty_cycle;
+	dst = put_signed(dst, data->old_decay);
+	*dst++ = (uint8_t)data->old_amplitude_dbfs;
+	*dst++ = data->old_nes_noise_mode_flag ? CODEC_FLAG_NES_NOISE_MODE : 0;
+	return put_varint(dst, data->old_nes_noise_lfsr_init);
+}
+
+static void get_instrument(struct codec_reader *reader, struct set_note_instrument_data *data)
+{
+	data->old_waveform = (enum waveform_type)get_u8(reader);
+	data->old_duty_cycle = get_u8(reader);
+	data->old_decay = (int16_t)get_signed(reader);
+	data->old_amplitude_dbfs = (int8_t)get_u8(reader);
+	data->old_nes_noise_mode_flag = (get_u8(reader) & CODEC_FLAG_NES_NOISE_MODE) != 0;
+	data->old_nes_noise_lfsr_init = (uint16_t)get_varint(reader);
+}
+
+static bool uniform_moves(const struct move_note_data *moves, uint32_t count)
+{
+	for (uint32_t i = 1; i < count; i++) {
+		if (moves[i].delta_ms != moves[0].delta_ms ||
+		    moves[i].delta_piano_key != moves[0].delta_piano_key)
+			return false;
+	}
+	return true;
+}
+
+static bool uniform_resizes(const struct resize_note_data *resizes, uint32_t count)
+{
+	for (uint32_t i = 1; i < count; i++) {
+		if (resizes[i].delta_ms != resizes[0].delta_ms ||
+		    resizes[i].delta_duration_ms != resizes[0].delta_duration_ms)
+			return false;
+	}
+	return true;
+}
+
+static bool uniform_instruments(const struct set_note_instrument_data *data, uint32_t count)
+{
+	for (uint32_t i = 1; i < count; i++) {
+		if (data[i].new_instrument_index != data[0].new_instrument_index)
+			return false;
+	}
+	return true;
+}
+
+static uint8_t *put_group(uint8_t *dst, const struct command *cmd)
+{
+	const struct note_group_data *group = &cmd->data.group;
+	dst = put_varint(dst, group->count);
+	if (group->count == 0)
+		return dst;
+
+	uint32_t previous_id = 0;
+	for (uint32_t i = 0; i < group->count; i++) {
+		uint32_t note_id = command_group_note_id(cmd, i);
+		dst = put_signed(dst, (int32_t)(note_id - previous_id));
+		previous_id = note_id;
+	}
+
+	switch (cmd->type) {
+	case CMD_MOVE_NOTES: {
+		const struct move_note_data *moves = group->entries;
+		bool uniform = uniform_moves(moves, group->count);
+		*dst++ = uniform ? CODEC_FLAG_UNIFORM : 0;
+		for (uint32_t i = 0; i < (uniform ? 1 : group->count); i++) {
+			dst = put_signed(dst, moves[i].delta_ms);
+			dst = put_signed(dst, moves[i].delta_piano_key);
+		}
+		break;
+	}
+	case CMD_RESIZE_NOTES: {
+		const struct resize_note_data *resizes = group->entries;
+		bool uniform = uniform_resizes(resizes, group->count);
+		uint8_t flags = uniform ? CODEC_FLAG_UNIFORM : 0;
+		if (resizes[0].from_left)
+			flags |= CODEC_FLAG_FROM_LEFT;
+		*dst++ = flags;
+		for (uint32_t i = 0; i < (uniform ? 1 : group->count); i++) {
+			dst = put_signed(dst, resizes[i].delta_ms);
+			dst = put_signed(dst, resizes[i].delta_duration_ms);
+		}
+		break;
+	}
+	case CMD_DELETE_NOTES: {
+		const struct delete_note_data *deletes = group->entries;
+		uint32_t previous_ms = 0;
+		for (uint32_t i = 0; i < group->count; i++) {
+			dst = put_varint(dst, deletes[i].index);
+			dst = put_note(dst, &deletes[i].note, previous_ms);
+			previous_ms = deletes[i].note.ms;
+		}
+		break;
+	}
+	case CMD_SET_NOTES_INSTRUMENT: {
+		const struct set_note_instrument_data *instruments = group->entries;
+		bool uniform = uniform_instruments(instruments, group->count);
+		*dst++ = uniform ? CODEC_FLAG_UNIFORM : 0;
+		for (uint32_t i = 0; i < group->count; i++) {
+			if (!uniform || i == 0)
+				*dst++ = instruments[i].new_instrument_index;
+			dst = put_instrument(dst, &instruments[i]);
+		}
+		break;
+	}
+	case CMD_SET_NOTES_VOICE: {
+		const struct set_note_voice_data *voices = group->entries;
+		for (uint32_t i = 0; i < group->count; i++) {
+			*dst++ = voices[i].old_voice;
+			*dst++ = voices[i].new_voice;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return dst;
+}
+
+static void get_group(struct codec_reader *reader, struct command *cmd)
+{
+	struct note_group_data *group = &cmd->data.group;
+	uint32_t count = group->count;
+
+	uint32_t note_id = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		note_id += (uint32_t)get_signed(reader);
+		switch (cmd->type) {
+		case CMD_MOVE_NOTES:
+			((struct move_note_data *)group->entries)[i].note_id = note_id;
+			break;
+		case CMD_RESIZE_NOTES:
+			((struct resize_note_data *)group->entries)[i].note_id = note_id;
+			break;
+		case CMD_DELETE_NOTES:
+			((struct delete_note_data *)group->entries)[i].note.id = note_id;
+			break;
+		case CMD_SET_NOTES_INSTRUMENT:
+			((struct set_note_instrument_data *)group->entries)[i].note_id = note_id;
+			break;
+		case CMD_SET_NOTES_VOICE:
+			((struct set_note_voice_data *)group->entries)[i].note_id = note_id;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (count == 0)
+		return;
+
+	switch (cmd->type) {
+	case CMD_MOVE_NOTES: {
+		struct move_note_data *moves = group->entries;
+		bool uniform = (get_u8(reader) & CODEC_FLAG_UNIFORM) != 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (uniform && i > 0) {
+				moves[i].delta_ms = moves[0].delta_ms;
+				moves[i].delta_piano_key = moves[0].delta_piano_key;
+				continue;
+			}
+			moves[i].delta_ms = get_signed(reader);
+			moves[i].delta_piano_key = get_signed(reader);
+		}
+		break;
+	}
+	case CMD_RESIZE_NOTES: {
+		struct resize_note_data *resizes = group->entries;
+		uint8_t flags = get_u8(reader);
+		bool uniform = (flags & CODEC_FLAG_UNIFORM) != 0;
+		for (uint32_t i = 0; i < count; i++) {
+			resizes[i].from_left = (flags & CODEC_FLAG_FROM_LEFT) != 0;
+			if (uniform && i > 0) {
+				resizes[i].delta_ms = resizes[0].delta_ms;
+				resizes[i].delta_duration_ms = resizes[0].delta_duration_ms;
+				continue;
+			}
+			resizes[i].delta_ms = get_signed(reader);
+			resizes[i].delta_duration_ms = get_signed(reader);
+		}
+		break;
+	}
+	case CMD_DELETE_NOTES: {
+		struct delete_note_data *deletes = group->entries;
+		uint32_t previous_ms = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			deletes[i].index = get_varint(reader);
+			get_note(reader, &deletes[i].note, previous_ms);
+			previous_ms = deletes[i].note.ms;
+		}
+		break;
+	}
+	case CMD_SET_NOTES_INSTRUMENT: {
+		struct set_note_instrument_data *instruments = group->entries;
+		bool uniform = (get_u8(reader) & CODEC_FLAG_UNIFORM) != 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (uniform && i > 0) {
+				instruments[i].new_instrument_index =
+					instruments[0].new_instrument_index;
+			} else {
+				instruments[i].new_instrument_index = get_u8(reader);
+			}
+			get_instrument(reader, &instruments[i]);
+		}
+		break;
+	}
+	case CMD_SET_NOTES_VOICE: {
+		struct set_note_voice_data *voices = group->entries;
+		for (uint32_t i = 0; i < count; i++) {
+			voices[i].old_voice = get_u8(reader);
+			voices[i].new_voice = get_u8(reader);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+size_t command_codec_max_size(const struct command *cmd)
+{
+	size_t entries = command_group_entry_size(cmd->type) > 0 ? cmd->data.group.count : 1;
+	return CODEC_MAX_HEADER_SIZE + entries * CODEC_MAX_ENTRY_SIZE;
+}
+
+size_t command_codec_encode(const struct command *cmd, uint8_t *dst)
+{
+	uint8_t *out = dst;
+	*out++ = (uint8_t)cmd->type;
+
+	switch (cmd->type) {
+	case CMD_ADD_NOTE:
+		out = put_varint(out, cmd->data.add_note.note.id);
+		out = put_note(out, &cmd->data.add_note.note, 0);
+		break;
+	case CMD_DELETE_NOTE:
+		out = put_varint(out, cmd->data.delete_note.note.id);
+		out = put_varint(out, cmd->data.delete_note.index);
+		out = put_note(out, &cmd->data.delete_note.note, 0);
+		break;
+	case CMD_MOVE_NOTE:
+		out = put_varint(out, cmd->data.move_note.note_id);
+		out = put_signed(out, cmd->data.move_note.delta_ms);
+		out = put_signed(out, cmd->data.move_note.delta_piano_key);
+		break;
+	case CMD_RESIZE_NOTE:
+		out = put_varint(out, cmd->data.resize_note.note_id);
+		*out++ = cmd->data.resize_note.from_left ? CODEC_FLAG_FROM_LEFT : 0;
+		out = put_signed(out, cmd->data.resize_note.delta_ms);
+		out = put_signed(out, cmd->data.resize_note.delta_duration_ms);
+		break;
+	case CMD_SET_NOTE_VOICE:
+		out = put_varint(out, cmd->data.set_note_voice.note_id);
+		*out++ = cmd->data.set_note_voice.old_voice;
+		*out++ = cmd->data.set_note_voice.new_voice;
+		break;
+	case CMD_SET_NOTE_INSTRUMENT:
+		out = put_varint(out, cmd->data.set_note_instrument.note_id);
+		*out++ = cmd->data.set_note_instrument.new_instrument_index;
+		out = put_instrument(out, &cmd->data.set_note_instrument);
+		break;
+	case CMD_MOVE_NOTES:
+	case CMD_RESIZE_NOTES:
+	case CMD_DELETE_NOTES:
+	case CMD_SET_NOTES_INSTRUMENT:
+	case CMD_SET_NOTES_VOICE:
+		out = put_group(out, cmd);
+		break;
+	default:
+		break;
+	}
+
+	return (size_t)(out - dst);
+}
+
+bool command_codec_decode(const uint8_t *src, size_t size, struct command *cmd)
+{
+	struct codec_reader reader = {src, size, 0, false};
+	enum command_type type = (enum command_type)get_u8(&reader);
+
+	if (command_group_entry_size(type) > 0) {
+		uint32_t count = get_varint(&reader);
+		if (reader.failed || count > size || !command_init_group(cmd, type, count)) {
+			return false;
+		}
+		cmd->data.group.count = count;
+		get_group(&reader, cmd);
+	} else {
+		memset(cmd, 0, sizeof(struct command));
+		cmd->type = type;
+	}
+
+	switch (type) {
+	case CMD_ADD_NOTE:
+		cmd->data.add_note.note.id = get_varint(&reader);
+		get_note(&reader, &cmd->data.add_note.note, 0);
+		break;
+	case CMD_DELETE_NOTE:
+		cmd->data.delete_note.note.id = get_varint(&reader);
+		cmd->data.delete_note.index = get_varint(&reader);
+		get_note(&reader, &cmd->data.delete_note.note, 0);
+		break;
+	case CMD_MOVE_NOTE:
+		cmd->data.move_note.note_id = get_varint(&reader);
+		cmd->data.move_note.delta_ms = get_signed(&reader);
+		cmd->data.move_note.delta_piano_key = get_signed(&reader);
+		break;
+	case CMD_RESIZE_NOTE:
+		cmd->data.resize_note.note_id = get_varint(&reader);
+		cmd->data.resize_note.from_left = (get_u8(&reader) & CODEC_FLAG_FROM_LEFT) != 0;
+		cmd->data.resize_note.delta_ms = get_signed(&reader);
+		cmd->data.resize_note.delta_duration_ms = get_signed(&reader);
+		break;
+	case CMD_SET_NOTE_VOICE:
+		cmd->data.set_note_voice.note_id = get_varint(&reader);
+		cmd->data.set_note_voice.old_voice = get_u8(&reader);
+		cmd->data.set_note_voice.new_voice = get_u8(&reader);
+		break;
+	case CMD_SET_NOTE_INSTRUMENT:
+		cmd->data.set_note_instrument.note_id = get_varint(&reader);
+		cmd->data.set_note_instrument.new_instrument_index = get_u8(&reader);
+		get_instrument(&reader, &cmd->data.set_note_instrument);
+		break;
+	default:
+		break;
+	}
+
+	if (reader.failed || reader.offset != size) {
+		command_free(cmd);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,16 @@
+#ifndef COMMAND_CODEC_H
+#define COMMAND_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct command;
+
+size_t command_codec_max_size(const struct command *cmd);
+
+size_t command_codec_encode(const struct command *cmd, uint8_t *dst);
+
+bool command_codec_decode(const uint8_t *src, size_t size, struct command *cmd);
+
+#endif
@@ -1,11 +1,15 @@
 #include "command_history.h"
 #include "app_state.h"
 #include "audio.h"
+#include "command_codec.h"
+#include "edit_journal.h"
 #include "sequencer.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-static void ui_note_to_stored(const struct ui_note *ui, struct stored_note *stored)
+void command_store_note(const struct ui_note *ui, struct stored_note *stored)
 {
 	stored->id = ui->id;
 	stored->ms = ui->ms;
@@ -46,249 +50,447 @@ void command_history_init(struct command_history *history)
 	if (history == NULL)
 		return;
 
-	history->undo_count = 0;
-	history->redo_count = 0;
+	undo_arena_init(&history->undo);
+	undo_arena_init(&history->redo);
+	history->budget = UNDO_HISTORY_DEFAULT_BUDGET;
 	history->in_batch = false;
 	history->batch_start_index = 0;
+	history->in_transaction = false;
+	history->has_pending = false;
+	history->transaction_pushes = 0;
+	history->journal = NULL;
 }
 
-void command_history_push(struct command_history *history, struct command cmd)
+size_t command_group_entry_size(enum command_type type)
 {
-	if (history == NULL)
-		return;
-
-	if (history->undo_count >= MAX_UNDO_HISTORY) {
-		for (uint32_t i = 0; i < MAX_UNDO_HISTORY - 1; i++) {
-			history->undo_stack[i] = history->undo_stack[i + 1];
-		}
-		history->undo_count = MAX_UNDO_HISTORY - 1;
+	switch (type) {
+	case CMD_MOVE_NOTES:
+		return sizeof(struct move_note_data);
+	case CMD_RESIZE_NOTES:
+		return sizeof(struct resize_note_data);
+	case CMD_DELETE_NOTES:
+		return sizeof(struct delete_note_data);
+	case CMD_SET_NOTES_INSTRUMENT:
+		return sizeof(struct set_note_instrument_data);
+	case CMD_SET_NOTES_VOICE:
+		return sizeof(struct set_note_voice_data);
+	default:
+		return 0;
 	}
+}
+
+bool command_init_group(struct command *cmd, enum command_type type, uint32_t capacity)
+{
+	memset(cmd, 0, sizeof(struct command));
+	cmd->type = type;
 
-	history->undo_stack[history->undo_count] = cmd;
-	history->undo_count++;
+	size_t entry_size = command_group_entry_size(type);
+	if (entry_size == 0 || capacity == 0)
+		return entry_size > 0;
 
-	history->redo_count = 0;
+	cmd->data.group.entries = calloc(capacity, entry_size);
+	if (cmd->data.group.entries == NULL) {
+		fprintf(stderr, "Failed to allocate undo entry for %u notes\n", capacity);
+		return false;
+	}
+
+	return true;
 }
 
-static bool undo_add_note(struct app_state *state, struct add_note_data *data)
+void command_free(struct command *cmd)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note.id) {
-			for (uint32_t j = i; j < state->note_count - 1; j++) {
-				state->notes[j] = state->notes[j + 1];
-			}
-			state->note_count--;
-
-			for (uint32_t j = 0; j < state->selection.count; j++) {
-				if (state->selection.selected_ids[j] == data->note.id) {
-					for (uint32_t k = j; k < state->selection.count - 1; k++) {
-						state->selection.selected_ids[k] =
-							state->selection.selected_ids[k + 1];
-					}
-					state->selection.count--;
-					break;
-				}
-			}
+	if (cmd == NULL || command_group_entry_size(cmd->type) == 0)
+		return;
 
+	free(cmd->data.group.entries);
+	cmd->data.group.entries = NULL;
+	cmd->data.group.count = 0;
+}
+
+static bool find_batch_end(const struct undo_arena *arena, size_t cursor, uint32_t *records)
+{
+	const uint8_t *payload;
+	size_t size;
+	size_t next;
+	uint32_t count = 1;
+
+	while (undo_arena_record_at(arena, cursor, &payload, &size, &next)) {
+		count++;
+		if (payload[0] == CMD_BATCH_END) {
+			*records = count;
 			return true;
 		}
+		cursor = next;
 	}
+
 	return false;
 }
 
-static bool redo_add_note(struct app_state *state, struct add_note_data *data)
+static void enforce_budget(struct command_history *history)
 {
-	if (state->note_count >= UI_MAX_NOTES)
+	struct undo_arena *undo = &history->undo;
+
+	while (undo->count > 1 && undo_arena_size(undo) > history->budget) {
+		const uint8_t *payload;
+		size_t size;
+		size_t next;
+		undo_arena_record_at(undo, undo->start, &payload, &size, &next);
+
+		uint32_t records = 1;
+		if (payload[0] == CMD_BATCH_START && !find_batch_end(undo, next, &records))
+			return;
+		if (records >= undo->count)
+			return;
+
+		for (uint32_t i = 0; i < records; i++) {
+			undo_arena_pop_front(undo);
+		}
+	}
+}
+
+static uint32_t find_last_step(const struct undo_arena *arena, size_t *cursor)
+{
+	const uint8_t *payload;
+	size_t size;
+	size_t previous;
+	undo_arena_record_before(arena, arena->end, &payload, &size, &previous);
+
+	*cursor = previous;
+	if (payload[0] != CMD_BATCH_END)
+		return 1;
+
+	uint32_t records = 1;
+	size_t scan = previous;
+	while (undo_arena_record_before(arena, scan, &payload, &size, &previous)) {
+		records++;
+		if (payload[0] == CMD_BATCH_START) {
+			*cursor = previous;
+			return records;
+		}
+		scan = previous;
+	}
+
+	return 1;
+}
+
+uint32_t command_group_note_id(const struct command *cmd, uint32_t index)
+{
+	switch (cmd->type) {
+	case CMD_MOVE_NOTES:
+		return ((const struct move_note_data *)cmd->data.group.entries)[index].note_id;
+	case CMD_RESIZE_NOTES:
+		return ((const struct resize_note_data *)cmd->data.group.entries)[index].note_id;
+	case CMD_DELETE_NOTES:
+		return ((const struct delete_note_data *)cmd->data.group.entries)[index].note.id;
+	case CMD_SET_NOTES_INSTRUMENT:
+		return ((const struct set_note_instrument_data *)cmd->data.group.entries)[index]
+			.note_id;
+	case CMD_SET_NOTES_VOICE:
+		return ((const struct set_note_voice_data *)cmd->data.group.entries)[index].note_id;
+	default:
+		return 0;
+	}
+}
+
+static bool same_note_set(const struct command *a, const struct command *b)
+{
+	if (a->data.group.count != b->data.group.count)
 		return false;
 
-	stored_to_ui_note(&data->note, &state->notes[state->note_count]);
-	state->note_count++;
+	for (uint32_t i = 0; i < a->data.group.count; i++) {
+		if (command_group_note_id(a, i) != command_group_note_id(b, i))
+			return false;
+	}
+
+	if (a->type == CMD_RESIZE_NOTES && a->data.group.count > 0) {
+		const struct resize_note_data *resizes_a = a->data.group.entries;
+		const struct resize_note_data *resizes_b = b->data.group.entries;
+		return resizes_a[0].from_left == resizes_b[0].from_left;
+	}
+
 	return true;
 }
 
-static bool undo_delete_note(struct app_state *state, struct delete_note_data *data)
+static void merge_move(struct move_note_data *into, const struct move_note_data *from)
+{
+	into->delta_ms += from->delta_ms;
+	into->delta_piano_key += from->delta_piano_key;
+}
+
+static void merge_resize(struct resize_note_data *into, const struct resize_note_data *from)
 {
-	if (state->note_count >= UI_MAX_NOTES)
+	into->delta_ms += from->delta_ms;
+	into->delta_duration_ms += from->delta_duration_ms;
+}
+
+static bool merge_command(struct command *into, const struct command *cmd)
+{
+	if (into->type != cmd->type)
+		return false;
+
+	switch (cmd->type) {
+	case CMD_MOVE_NOTE:
+		if (into->data.move_note.note_id != cmd->data.move_note.note_id)
+			return false;
+		merge_move(&into->data.move_note, &cmd->data.move_note);
+		return true;
+	case CMD_RESIZE_NOTE:
+		if (into->data.resize_note.note_id != cmd->data.resize_note.note_id ||
+		    into->data.resize_note.from_left != cmd->data.resize_note.from_left)
+			return false;
+		merge_resize(&into->data.resize_note, &cmd->data.resize_note);
+		return true;
+	case CMD_SET_NOTE_VOICE:
+		if (into->data.set_note_voice.note_id != cmd->data.set_note_voice.note_id)
+			return false;
+		into->data.set_note_voice.new_voice = cmd->data.set_note_voice.new_voice;
+		return true;
+	case CMD_SET_NOTE_INSTRUMENT:
+		if (into->data.set_note_instrument.note_id != cmd->data.set_note_instrument.note_id)
+			return false;
+		into->data.set_note_instrument.new_instrument_index =
+			cmd->data.set_note_instrument.new_instrument_index;
+		return true;
+	case CMD_MOVE_NOTES:
+	case CMD_RESIZE_NOTES:
+	case CMD_SET_NOTES_INSTRUMENT:
+		break;
+	default:
 		return false;
+	}
 
-	if (data->index > state->note_count)
-		data->index = state->note_count;
+	if (!same_note_set(into, cmd))
+		return false;
 
-	for (uint32_t i = state->note_count; i > data->index; i--) {
-		state->notes[i] = state->notes[i - 1];
+	for (uint32_t i = 0; i < cmd->data.group.count; i++) {
+		if (cmd->type == CMD_MOVE_NOTES) {
+			struct move_note_data *moves = into->data.group.entries;
+			const struct move_note_data *from = cmd->data.group.entries;
+			merge_move(&moves[i], &from[i]);
+		} else if (cmd->type == CMD_RESIZE_NOTES) {
+			struct resize_note_data *resizes = into->data.group.entries;
+			const struct resize_note_data *from = cmd->data.group.entries;
+			merge_resize(&resizes[i], &from[i]);
+		} else {
+			struct set_note_instrument_data *instruments = into->data.group.entries;
+			const struct set_note_instrument_data *from = cmd->data.group.entries;
+			instruments[i].new_instrument_index = from[i].new_instrument_index;
+		}
 	}
 
-	stored_to_ui_note(&data->note, &state->notes[data->index]);
-	state->note_count++;
 	return true;
 }
 
-static bool redo_delete_note(struct app_state *state, struct delete_note_data *data)
+static void record_command(struct command_history *history, struct command *cmd)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note.id) {
-			for (uint32_t j = i; j < state->note_count - 1; j++) {
-				state->notes[j] = state->notes[j + 1];
-			}
-			state->note_count--;
-
-			for (uint32_t j = 0; j < state->selection.count; j++) {
-				if (state->selection.selected_ids[j] == data->note.id) {
-					for (uint32_t k = j; k < state->selection.count - 1; k++) {
-						state->selection.selected_ids[k] =
-							state->selection.selected_ids[k + 1];
-					}
-					state->selection.count--;
-					break;
-				}
-			}
+	undo_arena_clear(&history->redo);
 
-			return true;
-		}
+	uint8_t *dst = undo_arena_begin_record(&history->undo, command_codec_max_size(cmd));
+	if (dst != NULL) {
+		undo_arena_commit_record(&history->undo, command_codec_encode(cmd, dst));
+		enforce_budget(history);
 	}
-	return false;
+
+	if (history->journal != NULL && cmd->type != CMD_BATCH_START && cmd->type != CMD_BATCH_END)
+		edit_journal_record_apply(history->journal, cmd);
+
+	command_free(cmd);
 }
 
-static bool undo_move_note(struct app_state *state, struct move_note_data *data)
+static void flush_pending(struct command_history *history)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			int32_t new_ms = (int32_t)state->notes[i].ms - data->delta_ms;
-			if (new_ms < 0)
-				new_ms = 0;
-			state->notes[i].ms = (uint32_t)new_ms;
-
-			int32_t new_key =
-				(int32_t)state->notes[i].piano_key - data->delta_piano_key;
-			if (new_key < 0)
-				new_key = 0;
-			if (new_key > 127)
-				new_key = 127;
-			state->notes[i].piano_key = (uint8_t)new_key;
-			state->notes[i].frequency = note_to_frequency(new_key);
-			return true;
-		}
+	if (!history->has_pending)
+		return;
+
+	history->has_pending = false;
+
+	if (history->transaction_pushes == 1 && !history->in_batch &&
+	    history->undo.count > 0) {
+		const uint8_t *payload;
+		size_t size;
+		size_t first;
+		undo_arena_record_before(
+			&history->undo, history->undo.end, &payload, &size, &first
+		);
+
+		uint8_t batch_start = CMD_BATCH_START;
+		if (undo_arena_insert(&history->undo, first, &batch_start, 1))
+			history->in_batch = true;
 	}
-	return false;
+
+	history->transaction_pushes++;
+	record_command(history, &history->pending);
+}
+
+void command_history_push(struct command_history *history, struct command cmd)
+{
+	if (history == NULL) {
+		command_free(&cmd);
+		return;
+	}
+
+	if (!history->in_transaction) {
+		record_command(history, &cmd);
+		return;
+	}
+
+	if (history->has_pending && merge_command(&history->pending, &cmd)) {
+		command_free(&cmd);
+		return;
+	}
+
+	flush_pending(history);
+	history->pending = cmd;
+	history->has_pending = true;
+	undo_arena_clear(&history->redo);
+}
+
+static bool remove_note(struct app_state *state, uint32_t note_id)
+{
+	if (!note_store_remove(&state->notes, note_id, NULL, NULL))
+		return false;
+
+	app_state_deselect_note(state, note_id);
+	return true;
+}
+
+static bool undo_add_note(struct app_state *state, struct add_note_data *data)
+{
+	return remove_note(state, data->note.id);
+}
+
+static bool redo_add_note(struct app_state *state, struct add_note_data *data)
+{
+	struct ui_note note;
+	stored_to_ui_note(&data->note, &note);
+	return note_store_add(&state->notes, &note) != NULL;
+}
+
+static bool undo_delete_note(struct app_state *state, struct delete_note_data *data)
+{
+	struct ui_note note;
+	stored_to_ui_note(&data->note, &note);
+	return note_store_insert_at(&state->notes, data->index, &note) != NULL;
+}
+
+static bool redo_delete_note(struct app_state *state, struct delete_note_data *data)
+{
+	return remove_note(state, data->note.id);
+}
+
+static void offset_note(struct ui_note *note, int32_t delta_ms, int32_t delta_piano_key)
+{
+	int32_t new_ms = (int32_t)note->ms + delta_ms;
+	if (new_ms < 0)
+		new_ms = 0;
+	note->ms = (uint32_t)new_ms;
+
+	int32_t new_key = (int32_t)note->piano_key + delta_piano_key;
+	if (new_key < 0)
+		new_key = 0;
+	if (new_key > 127)
+		new_key = 127;
+	note->piano_key = (uint8_t)new_key;
+	note->frequency = note_to_frequency(new_key);
+}
+
+static bool undo_move_note(struct app_state *state, struct move_note_data *data)
+{
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	offset_note(&note, -data->delta_ms, -data->delta_piano_key);
+	return note_store_update(&state->notes, &note);
 }
 
 static bool redo_move_note(struct app_state *state, struct move_note_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			int32_t new_ms = (int32_t)state->notes[i].ms + data->delta_ms;
-			if (new_ms < 0)
-				new_ms = 0;
-			state->notes[i].ms = (uint32_t)new_ms;
-
-			int32_t new_key =
-				(int32_t)state->notes[i].piano_key + data->delta_piano_key;
-			if (new_key < 0)
-				new_key = 0;
-			if (new_key > 127)
-				new_key = 127;
-			state->notes[i].piano_key = (uint8_t)new_key;
-			state->notes[i].frequency = note_to_frequency(new_key);
-			return true;
-		}
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	offset_note(&note, data->delta_ms, data->delta_piano_key);
+	return note_store_update(&state->notes, &note);
+}
+
+static void
+resize_note(struct ui_note *note, bool from_left, int32_t delta_ms, int32_t delta_duration_ms)
+{
+	int32_t new_duration = (int32_t)note->duration_ms + delta_duration_ms;
+	if (new_duration < 10)
+		new_duration = 10;
+
+	if (from_left) {
+		int32_t new_ms = (int32_t)note->ms + delta_ms;
+		if (new_ms < 0)
+			new_ms = 0;
+		note->ms = (uint32_t)new_ms;
 	}
-	return false;
+
+	note->duration_ms = (uint16_t)new_duration;
 }
 
 static bool undo_resize_note(struct app_state *state, struct resize_note_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			if (data->from_left) {
-				int32_t new_ms = (int32_t)state->notes[i].ms + data->delta_ms;
-				int32_t new_duration = (int32_t)state->notes[i].duration_ms -
-						       data->delta_duration_ms;
-
-				if (new_ms < 0)
-					new_ms = 0;
-				if (new_duration < 10)
-					new_duration = 10;
-
-				state->notes[i].ms = (uint32_t)new_ms;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			} else {
-				int32_t new_duration = (int32_t)state->notes[i].duration_ms -
-						       data->delta_duration_ms;
-				if (new_duration < 10)
-					new_duration = 10;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			}
-			return true;
-		}
-	}
-	return false;
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	resize_note(&note, data->from_left, data->delta_ms, -data->delta_duration_ms);
+	return note_store_update(&state->notes, &note);
 }
 
 static bool redo_resize_note(struct app_state *state, struct resize_note_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			if (data->from_left) {
-				int32_t new_ms = (int32_t)state->notes[i].ms - data->delta_ms;
-				int32_t new_duration = (int32_t)state->notes[i].duration_ms +
-						       data->delta_duration_ms;
-
-				if (new_ms < 0)
-					new_ms = 0;
-				if (new_duration < 10)
-					new_duration = 10;
-
-				state->notes[i].ms = (uint32_t)new_ms;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			} else {
-				int32_t new_duration = (int32_t)state->notes[i].duration_ms +
-						       data->delta_duration_ms;
-				if (new_duration < 10)
-					new_duration = 10;
-				state->notes[i].duration_ms = (uint16_t)new_duration;
-			}
-			return true;
-		}
-	}
-	return false;
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	resize_note(&note, data->from_left, -data->delta_ms, data->delta_duration_ms);
+	return note_store_update(&state->notes, &note);
 }
 
 static bool undo_set_note_voice(struct app_state *state, struct set_note_voice_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			state->notes[i].voice = data->old_voice;
-			return true;
-		}
-	}
-	return false;
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	note.voice = data->old_voice;
+	return note_store_update(&state->notes, &note);
 }
 
 static bool redo_set_note_voice(struct app_state *state, struct set_note_voice_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			state->notes[i].voice = data->new_voice;
-			return true;
-		}
-	}
-	return false;
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	note.voice = data->new_voice;
+	return note_store_update(&state->notes, &note);
 }
 
 static bool undo_set_note_instrument(struct app_state *state, struct set_note_instrument_data *data)
 {
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			state->notes[i].waveform = data->old_waveform;
-			state->notes[i].duty_cycle = data->old_duty_cycle;
-			state->notes[i].decay = data->old_decay;
-			state->notes[i].amplitude_dbfs = data->old_amplitude_dbfs;
-			state->notes[i].nes_noise_mode_flag = data->old_nes_noise_mode_flag;
-			state->notes[i].nes_noise_lfsr_init = data->old_nes_noise_lfsr_init;
-			return true;
-		}
-	}
-	return false;
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	note.waveform = data->old_waveform;
+	note.duty_cycle = data->old_duty_cycle;
+	note.decay = data->old_decay;
+	note.amplitude_dbfs = data->old_amplitude_dbfs;
+	note.nes_noise_mode_flag = data->old_nes_noise_mode_flag;
+	note.nes_noise_lfsr_init = data->old_nes_noise_lfsr_init;
+	return note_store_update(&state->notes, &note);
 }
 
 static bool redo_set_note_instrument(struct app_state *state, struct set_note_instrument_data *data)
@@ -298,163 +500,292 @@ static bool redo_set_note_instrument(struct app_state *state, struct set_note_in
 
 	struct instrument *instr = &state->instruments[data->new_instrument_index];
 
-	for (uint32_t i = 0; i < state->note_count; i++) {
-		if (state->notes[i].id == data->note_id) {
-			state->notes[i].waveform = instr->waveform;
-			state->notes[i].duty_cycle = instr->duty_cycle;
-			state->notes[i].decay = instr->decay;
-			state->notes[i].amplitude_dbfs = instr->amplitude_dbfs;
-			state->notes[i].nes_noise_mode_flag = instr->nes_noise_mode_flag;
-			state->notes[i].nes_noise_lfsr_init = instr->nes_noise_lfsr;
-			return true;
-		}
+	const struct ui_note *current = note_store_find(&state->notes, data->note_id);
+	if (current == NULL)
+		return false;
+
+	struct ui_note note = *current;
+	note.waveform = instr->waveform;
+	note.duty_cycle = instr->duty_cycle;
+	note.decay = instr->decay;
+	note.amplitude_dbfs = instr->amplitude_dbfs;
+	note.nes_noise_mode_flag = instr->nes_noise_mode_flag;
+	note.nes_noise_lfsr_init = instr->nes_noise_lfsr;
+	return note_store_update(&state->notes, &note);
+}
+
+static bool undo_move_notes(struct app_state *state, struct note_group_data *data)
+{
+	struct move_note_data *moves = data->entries;
+	bool success = true;
+	for (uint32_t i = data->count; i > 0; i--) {
+		if (!undo_move_note(state, &moves[i - 1]))
+			success = false;
 	}
-	return false;
+	return success;
 }
 
-bool command_history_undo(struct command_history *history, struct app_state *state, void *audio)
+static bool redo_move_notes(struct app_state *state, struct note_group_data *data)
 {
-	if (history == NULL || state == NULL || history->undo_count == 0)
-		return false;
+	struct move_note_data *moves = data->entries;
+	bool success = true;
+	for (uint32_t i = 0; i < data->count; i++) {
+		if (!redo_move_note(state, &moves[i]))
+			success = false;
+	}
+	return success;
+}
+
+static bool undo_resize_notes(struct app_state *state, struct note_group_data *data)
+{
+	struct resize_note_data *resizes = data->entries;
+	bool success = true;
+	for (uint32_t i = data->count; i > 0; i--) {
+		if (!undo_resize_note(state, &resizes[i - 1]))
+			success = false;
+	}
+	return success;
+}
 
-	uint32_t end_index = history->undo_count;
-	uint32_t start_index = history->undo_count - 1;
+static bool redo_resize_notes(struct app_state *state, struct note_group_data *data)
+{
+	struct resize_note_data *resizes = data->entries;
+	bool success = true;
+	for (uint32_t i = 0; i < data->count; i++) {
+		if (!redo_resize_note(state, &resizes[i]))
+			success = false;
+	}
+	return success;
+}
 
-	if (history->undo_stack[start_index].type == CMD_BATCH_END) {
-		for (int32_t i = start_index - 1; i >= 0; i--) {
-			if (history->undo_stack[i].type == CMD_BATCH_START) {
-				start_index = i;
-				break;
-			}
-		}
+static bool undo_delete_notes(struct app_state *state, struct note_group_data *data)
+{
+	struct delete_note_data *deletes = data->entries;
+	bool success = true;
+	for (uint32_t i = data->count; i > 0; i--) {
+		if (!undo_delete_note(state, &deletes[i - 1]))
+			success = false;
 	}
+	return success;
+}
 
+static bool redo_delete_notes(struct app_state *state, struct note_group_data *data)
+{
+	struct delete_note_data *deletes = data->entries;
 	bool success = true;
-	for (int32_t i = end_index - 1; i >= (int32_t)start_index; i--) {
-		struct command *cmd = &history->undo_stack[i];
+	for (uint32_t i = 0; i < data->count; i++) {
+		if (!redo_delete_note(state, &deletes[i]))
+			success = false;
+	}
+	return success;
+}
 
-		if (cmd->type == CMD_BATCH_START || cmd->type == CMD_BATCH_END)
-			continue;
+static bool undo_set_notes_instrument(struct app_state *state, struct note_group_data *data)
+{
+	struct set_note_instrument_data *instruments = data->entries;
+	bool success = true;
+	for (uint32_t i = data->count; i > 0; i--) {
+		if (!undo_set_note_instrument(state, &instruments[i - 1]))
+			success = false;
+	}
+	return success;
+}
 
-		bool cmd_success = false;
-		switch (cmd->type) {
-		case CMD_ADD_NOTE:
-			cmd_success = undo_add_note(state, &cmd->data.add_note);
-			break;
-		case CMD_DELETE_NOTE:
-			cmd_success = undo_delete_note(state, &cmd->data.delete_note);
-			break;
-		case CMD_MOVE_NOTE:
-			cmd_success = undo_move_note(state, &cmd->data.move_note);
-			break;
-		case CMD_RESIZE_NOTE:
-			cmd_success = undo_resize_note(state, &cmd->data.resize_note);
-			break;
-		case CMD_SET_NOTE_VOICE:
-			cmd_success = undo_set_note_voice(state, &cmd->data.set_note_voice);
-			break;
-		case CMD_SET_NOTE_INSTRUMENT:
-			cmd_success =
-				undo_set_note_instrument(state, &cmd->data.set_note_instrument);
-			break;
-		default:
-			break;
-		}
+static bool redo_set_notes_instrument(struct app_state *state, struct note_group_data *data)
+{
+	struct set_note_instrument_data *instruments = data->entries;
+	bool success = true;
+	for (uint32_t i = 0; i < data->count; i++) {
+		if (!redo_set_note_instrument(state, &instruments[i]))
+			success = false;
+	}
+	return success;
+}
+
+static bool undo_set_notes_voice(struct app_state *state, struct note_group_data *data)
+{
+	struct set_note_voice_data *voices = data->entries;
+	note_store_prepare_updates(&state->notes, data->count);
+
+	bool success = true;
+	for (uint32_t i = data->count; i > 0; i--) {
+		if (!undo_set_note_voice(state, &voices[i - 1]))
+			success = false;
+	}
+	return success;
+}
 
-		if (!cmd_success)
+static bool redo_set_notes_voice(struct app_state *state, struct note_group_data *data)
+{
+	struct set_note_voice_data *voices = data->entries;
+	note_store_prepare_updates(&state->notes, data->count);
+
+	bool success = true;
+	for (uint32_t i = 0; i < data->count; i++) {
+		if (!redo_set_note_voice(state, &voices[i]))
 			success = false;
 	}
+	return success;
+}
 
-	uint32_t num_commands = end_index - start_index;
-	for (uint32_t i = 0; i < num_commands; i++) {
-		if (history->redo_count >= MAX_UNDO_HISTORY)
-			break;
-		history->redo_stack[history->redo_count] = history->undo_stack[start_index + i];
-		history->redo_count++;
+bool command_history_revert_command(struct app_state *state, struct command *cmd)
+{
+	switch (cmd->type) {
+	case CMD_ADD_NOTE:
+		return undo_add_note(state, &cmd->data.add_note);
+	case CMD_DELETE_NOTE:
+		return undo_delete_note(state, &cmd->data.delete_note);
+	case CMD_MOVE_NOTE:
+		return undo_move_note(state, &cmd->data.move_note);
+	case CMD_RESIZE_NOTE:
+		return undo_resize_note(state, &cmd->data.resize_note);
+	case CMD_SET_NOTE_VOICE:
+		return undo_set_note_voice(state, &cmd->data.set_note_voice);
+	case CMD_SET_NOTE_INSTRUMENT:
+		return undo_set_note_instrument(state, &cmd->data.set_note_instrument);
+	case CMD_MOVE_NOTES:
+		return undo_move_notes(state, &cmd->data.group);
+	case CMD_RESIZE_NOTES:
+		return undo_resize_notes(state, &cmd->data.group);
+	case CMD_DELETE_NOTES:
+		return undo_delete_notes(state, &cmd->data.group);
+	case CMD_SET_NOTES_INSTRUMENT:
+		return undo_set_notes_instrument(state, &cmd->data.group);
+	case CMD_SET_NOTES_VOICE:
+		return undo_set_notes_voice(state, &cmd->data.group);
+	default:
+		return false;
 	}
+}
 
-	history->undo_count = start_index;
+bool command_history_apply_command(struct app_state *state, struct command *cmd)
+{
+	switch (cmd->type) {
+	case CMD_ADD_NOTE:
+		return redo_add_note(state, &cmd->data.add_note);
+	case CMD_DELETE_NOTE:
+		return redo_delete_note(state, &cmd->data.delete_note);
+	case CMD_MOVE_NOTE:
+		return redo_move_note(state, &cmd->data.move_note);
+	case CMD_RESIZE_NOTE:
+		return redo_resize_note(state, &cmd->data.resize_note);
+	case CMD_SET_NOTE_VOICE:
+		return redo_set_note_voice(state, &cmd->data.set_note_voice);
+	case CMD_SET_NOTE_INSTRUMENT:
+		return redo_set_note_instrument(state, &cmd->data.set_note_instrument);
+	case CMD_MOVE_NOTES:
+		return redo_move_notes(state, &cmd->data.group);
+	case CMD_RESIZE_NOTES:
+		return redo_resize_notes(state, &cmd->data.group);
+	case CMD_DELETE_NOTES:
+		return redo_delete_notes(state, &cmd->data.group);
+	case CMD_SET_NOTES_INSTRUMENT:
+		return redo_set_notes_instrument(state, &cmd->data.group);
+	case CMD_SET_NOTES_VOICE:
+		return redo_set_notes_voice(state, &cmd->data.group);
+	default:
+		return false;
+	}
+}
 
+static void sync_sequencer(struct app_state *state, void *audio)
+{
 	if (audio != NULL) {
 		struct sequencer *sequencer = audio_get_sequencer(audio);
 		if (sequencer != NULL) {
 			app_state_sync_notes_to_sequencer(state, sequencer, audio);
 		}
 	}
-
-	return success;
 }
 
-bool command_history_redo(struct command_history *history, struct app_state *state, void *audio)
+bool command_history_undo(struct command_history *history, struct app_state *state, void *audio)
 {
-	if (history == NULL || state == NULL || history->redo_count == 0)
+	if (history == NULL || state == NULL)
 		return false;
 
-	uint32_t start_index = history->redo_count - 1;
-	uint32_t end_index = start_index + 1;
+	command_history_commit_transaction(history);
 
-	if (history->redo_stack[start_index].type == CMD_BATCH_END) {
-		for (int32_t i = start_index - 1; i >= 0; i--) {
-			if (history->redo_stack[i].type == CMD_BATCH_START) {
-				start_index = i;
-				break;
-			}
-		}
-	}
+	struct undo_arena *undo = &history->undo;
+	if (undo->count == 0)
+		return false;
+
+	size_t start;
+	uint32_t records = find_last_step(undo, &start);
 
 	bool success = true;
-	for (uint32_t i = start_index; i < end_index; i++) {
-		struct command *cmd = &history->redo_stack[i];
+	size_t cursor = undo->end;
+	for (uint32_t i = 0; i < records; i++) {
+		const uint8_t *payload;
+		size_t size;
+		undo_arena_record_before(undo, cursor, &payload, &size, &cursor);
 
-		if (cmd->type == CMD_BATCH_START || cmd->type == CMD_BATCH_END)
+		if (payload[0] == CMD_BATCH_START || payload[0] == CMD_BATCH_END)
 			continue;
 
-		bool cmd_success = false;
-		switch (cmd->type) {
-		case CMD_ADD_NOTE:
-			cmd_success = redo_add_note(state, &cmd->data.add_note);
-			break;
-		case CMD_DELETE_NOTE:
-			cmd_success = redo_delete_note(state, &cmd->data.delete_note);
-			break;
-		case CMD_MOVE_NOTE:
-			cmd_success = redo_move_note(state, &cmd->data.move_note);
-			break;
-		case CMD_RESIZE_NOTE:
-			cmd_success = redo_resize_note(state, &cmd->data.resize_note);
-			break;
-		case CMD_SET_NOTE_VOICE:
-			cmd_success = redo_set_note_voice(state, &cmd->data.set_note_voice);
-			break;
-		case CMD_SET_NOTE_INSTRUMENT:
-			cmd_success =
-				redo_set_note_instrument(state, &cmd->data.set_note_instrument);
-			break;
-		default:
-			break;
+		struct command cmd;
+		if (!command_codec_decode(payload, size, &cmd)) {
+			success = false;
+			continue;
 		}
 
-		if (!cmd_success)
+		if (!command_history_revert_command(state, &cmd))
 			success = false;
-	}
 
-	uint32_t num_commands = end_index - start_index;
-	for (uint32_t i = 0; i < num_commands; i++) {
-		if (history->undo_count >= MAX_UNDO_HISTORY)
-			break;
-		history->undo_stack[history->undo_count] = history->redo_stack[start_index + i];
-		history->undo_count++;
+		if (history->journal != NULL)
+			edit_journal_record_revert(history->journal, &cmd);
+
+		command_free(&cmd);
 	}
 
-	history->redo_count = start_index;
+	undo_arena_move_tail(&history->redo, undo, start, records);
 
-	if (audio != NULL) {
-		struct sequencer *sequencer = audio_get_sequencer(audio);
-		if (sequencer != NULL) {
-			app_state_sync_notes_to_sequencer(state, sequencer, audio);
+	sync_sequencer(state, audio);
+	return success;
+}
+
+bool command_history_redo(struct command_history *history, struct app_state *state, void *audio)
+{
+	if (history == NULL || state == NULL)
+		return false;
+
+	command_history_commit_transaction(history);
+
+	struct undo_arena *redo = &history->redo;
+	if (redo->count == 0)
+		return false;
+
+	size_t start;
+	uint32_t records = find_last_step(redo, &start);
+
+	bool success = true;
+	size_t cursor = start;
+	for (uint32_t i = 0; i < records; i++) {
+		const uint8_t *payload;
+		size_t size;
+		undo_arena_record_at(redo, cursor, &payload, &size, &cursor);
+
+		if (payload[0] == CMD_BATCH_START || payload[0] == CMD_BATCH_END)
+			continue;
+
+		struct command cmd;
+		if (!command_codec_decode(payload, size, &cmd)) {
+			success = false;
+			continue;
 		}
+
+		if (!command_history_apply_command(state, &cmd))
+			success = false;
+
+		if (history->journal != NULL)
+			edit_journal_record_apply(history->journal, &cmd);
+
+		command_free(&cmd);
 	}
 
+	undo_arena_move_tail(&history->undo, redo, start, records);
+	enforce_budget(history);
+
+	sync_sequencer(state, audio);
 	return success;
 }
 
@@ -463,10 +794,35 @@ void command_history_clear(struct command_history *history)
 	if (history == NULL)
 		return;
 
-	history->undo_count = 0;
-	history->redo_count = 0;
+	if (history->has_pending)
+		command_free(&history->pending);
+
+	undo_arena_clear(&history->undo);
+	undo_arena_clear(&history->redo);
 	history->in_batch = false;
 	history->batch_start_index = 0;
+	history->in_transaction = false;
+	history->has_pending = false;
+	history->transaction_pushes = 0;
+}
+
+void command_history_free(struct command_history *history)
+{
+	if (history == NULL)
+		return;
+
+	command_history_clear(history);
+	undo_arena_free(&history->undo);
+	undo_arena_free(&history->redo);
+}
+
+void command_history_set_budget(struct command_history *history, size_t budget)
+{
+	if (history == NULL)
+		return;
+
+	history->budget = budget;
+	enforce_budget(history);
 }
 
 void command_history_begin_batch(struct command_history *history)
@@ -474,12 +830,14 @@ void command_history_begin_batch(struct command_history *history)
 	if (history == NULL || history->in_batch)
 		return;
 
+	command_history_commit_transaction(history);
+
 	struct command batch_cmd;
 	batch_cmd.type = CMD_BATCH_START;
 	command_history_push(history, batch_cmd);
 
 	history->in_batch = true;
-	history->batch_start_index = history->undo_count - 1;
+	history->batch_start_index = history->undo.count - 1;
 }
 
 void command_history_end_batch(struct command_history *history)
@@ -493,3 +851,27 @@ void command_history_end_batch(struct command_history *history)
 
 	history->in_batch = false;
 }
+
+void command_history_begin_transaction(struct command_history *history)
+{
+	if (history == NULL || history->in_transaction || history->in_batch)
+		return;
+
+	history->in_transaction = true;
+	history->has_pending = false;
+	history->transaction_pushes = 0;
+}
+
+void command_history_commit_transaction(struct command_history *history)
+{
+	if (history == NULL || !history->in_transaction)
+		return;
+
+	flush_pending(history);
+	history->in_transaction = false;
+
+	if (history->transaction_pushes > 1)
+		command_history_end_batch(history);
+
+	history->transaction_pushes = 0;
+}
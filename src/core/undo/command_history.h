@@ -2,13 +2,17 @@
 #define COMMAND_HISTORY_H
 
 #include "synth.h"
+#include "undo_arena.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 struct app_state;
+struct edit_journal;
+struct ui_note;
 
-#define MAX_UNDO_HISTORY 100
+#define UNDO_HISTORY_DEFAULT_BUDGET (256 * 1024)
 
 struct stored_note {
 	uint32_t id;
@@ -36,6 +40,11 @@ enum command_type {
 	CMD_SET_NOTE_INSTRUMENT,
 	CMD_BATCH_START,
 	CMD_BATCH_END,
+	CMD_MOVE_NOTES,
+	CMD_RESIZE_NOTES,
+	CMD_DELETE_NOTES,
+	CMD_SET_NOTES_INSTRUMENT,
+	CMD_SET_NOTES_VOICE,
 };
 
 struct add_note_data {
@@ -77,6 +86,11 @@ struct set_note_instrument_data {
 	uint8_t new_instrument_index;
 };
 
+struct note_group_data {
+	uint32_t count;
+	void *entries;
+};
+
 union command_data {
 	struct add_note_data add_note;
 	struct delete_note_data delete_note;
@@ -84,6 +98,7 @@ union command_data {
 	struct resize_note_data resize_note;
 	struct set_note_voice_data set_note_voice;
 	struct set_note_instrument_data set_note_instrument;
+	struct note_group_data group;
 };
 
 struct command {
@@ -92,18 +107,40 @@ struct command {
 };
 
 struct command_history {
-	struct command undo_stack[MAX_UNDO_HISTORY];
-	uint32_t undo_count;
-	struct command redo_stack[MAX_UNDO_HISTORY];
-	uint32_t redo_count;
+	struct undo_arena undo;
+	struct undo_arena redo;
+	size_t budget;
 	bool in_batch;
 	uint32_t batch_start_index;
+	bool in_transaction;
+	bool has_pending;
+	struct command pending;
+	uint32_t transaction_pushes;
+	struct edit_journal *journal;
 };
 
 void command_history_init(struct command_history *history);
 
+void command_history_free(struct command_history *history);
+
+void command_history_set_budget(struct command_history *history, size_t budget);
+
+bool command_init_group(struct command *cmd, enum command_type type, uint32_t capacity);
+
+size_t command_group_entry_size(enum command_type type);
+
+uint32_t command_group_note_id(const struct command *cmd, uint32_t index);
+
+void command_free(struct command *cmd);
+
+void command_store_note(const struct ui_note *ui, struct stored_note *stored);
+
 void command_history_push(struct command_history *history, struct command cmd);
 
+bool command_history_apply_command(struct app_state *state, struct command *cmd);
+
+bool command_history_revert_command(struct app_state *state, struct command *cmd);
+
 bool command_history_undo(struct command_history *history, struct app_state *state, void *audio);
 
 bool command_history_redo(struct command_history *history, struct app_state *state, void *audio);
@@ -114,4 +151,8 @@ void command_history_begin_batch(struct command_history *history);
 
 void command_history_end_batch(struct command_history *history);
 
+void command_history_begin_transaction(struct command_history *history);
+
+void command_history_commit_transaction(struct command_history *history);
+
 #endif
@@ -0,0 +1,555 @@
+#include "edit_journal.h"
+#include "app_state.h"
+#include "audio.h"
+#include "command_history.h"
+#include "platform.h"
+#include "sequencer.h"
+#include "song_binary.h"
+
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EDIT_JOURNAL_MAGIC "BJNL"
+#define EDIT_JOURNAL_VERSION 2
+
+enum journal_record_kind {
+	JOURNAL_RECORD_APPLY = 1,
+	JOURNAL_RECORD_REVERT = 2,
+};
+
+struct journal_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t command_size;
+	uint32_t checkpoint_size;
+	uint32_t checkpoint_checksum;
+};
+
+struct journal_record_header {
+	uint8_t kind;
+	uint8_t reserved[3];
+	uint32_t payload_size;
+	uint32_t checksum;
+};
+
+struct journal_checkpoint {
+	struct song_binary_snapshot *snapshot;
+	char song_path[512];
+	char journal_path[EDIT_JOURNAL_PATH_SIZE];
+	char temp_path[EDIT_JOURNAL_PATH_SIZE + 8];
+	SDL_Thread *thread;
+	SDL_AtomicInt done;
+	bool success;
+	uint8_t *records;
+	size_t records_size;
+	size_t records_capacity;
+	uint32_t record_count;
+	bool records_lost;
+};
+
+static uint32_t checksum_bytes(uint32_t hash, const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t record_checksum(
+	uint8_t kind, const struct command *cmd, const void *entries, size_t entries_size
+)
+{
+	uint32_t hash = checksum_bytes(2166136261u, &kind, 1);
+	hash = checksum_bytes(hash, (const uint8_t *)cmd, sizeof(struct command));
+	return checksum_bytes(hash, entries, entries_size);
+}
+
+static size_t command_entries_size(const struct command *cmd)
+{
+	return command_group_entry_size(cmd->type) * cmd->data.group.count;
+}
+
+static void set_paths(struct edit_journal *journal, const char *song_path)
+{
+	strncpy(journal->song_path, song_path, sizeof(journal->song_path) - 1);
+	journal->song_path[sizeof(journal->song_path) - 1] = '\0';
+	snprintf(
+		journal->journal_path,
+		sizeof(journal->journal_path),
+		"%s%s",
+		journal->song_path,
+		EDIT_JOURNAL_EXTENSION
+	);
+}
+
+static bool write_base_file(const char *path, const uint8_t *checkpoint, size_t checkpoint_size)
+{
+	struct journal_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EDIT_JOURNAL_MAGIC, 4);
+	header.version = EDIT_JOURNAL_VERSION;
+	header.command_size = (uint16_t)sizeof(struct command);
+	header.checkpoint_size = (uint32_t)checkpoint_size;
+	header.checkpoint_checksum = checksum_bytes(2166136261u, checkpoint, checkpoint_size);
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to open journal for writing: %s\n", path);
+		return false;
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (success && checkpoint_size > 0) {
+		success = fwrite(checkpoint, 1, checkpoint_size, file) == checkpoint_size;
+	}
+
+	success = success && platform_sync_file(file);
+	if (fclose(file) != 0) {
+		success = false;
+	}
+
+	if (!success) {
+		remove(path);
+	}
+	return success;
+}
+
+static bool write_journal_base(struct edit_journal *journal)
+{
+	if (journal->file != NULL) {
+		fclose(journal->file);
+		journal->file = NULL;
+	}
+
+	size_t checkpoint_size = 0;
+	uint8_t *checkpoint = song_binary_encode(journal->state, &checkpoint_size);
+	if (checkpoint == NULL) {
+		return false;
+	}
+
+	char temp_path[EDIT_JOURNAL_PATH_SIZE + 8];
+	snprintf(temp_path, sizeof(temp_path), "%s.tmp", journal->journal_path);
+
+	bool success = write_base_file(temp_path, checkpoint, checkpoint_size);
+	free(checkpoint);
+
+	if (!success || !platform_replace_file(temp_path, journal->journal_path)) {
+		fprintf(stderr, "Failed to write journal: %s\n", journal->journal_path);
+		remove(temp_path);
+		return false;
+	}
+
+	journal->file = fopen(journal->journal_path, "ab");
+	if (journal->file == NULL) {
+		fprintf(stderr, "Failed to open journal for appending: %s\n", journal->journal_path);
+		return false;
+	}
+
+	journal->records_since_checkpoint = 0;
+	return true;
+}
+
+static int checkpoint_thread(void *data)
+{
+	struct journal_checkpoint *checkpoint = data;
+
+	size_t size = 0;
+	uint8_t *encoded = song_binary_snapshot_encode(checkpoint->snapshot, &size);
+	checkpoint->success =
+		encoded != NULL && write_base_file(checkpoint->temp_path, encoded, size);
+	free(encoded);
+
+	SDL_SetAtomicInt(&checkpoint->done, 1);
+	return 0;
+}
+
+static void checkpoint_free(struct journal_checkpoint *checkpoint)
+{
+	song_binary_snapshot_free(checkpoint->snapshot);
+	free(checkpoint->records);
+	free(checkpoint);
+}
+
+static bool start_checkpoint(struct edit_journal *journal, const char *song_path)
+{
+	struct journal_checkpoint *checkpoint = calloc(1, sizeof(struct journal_checkpoint));
+	if (checkpoint == NULL) {
+		fprintf(stderr, "Failed to allocate journal checkpoint\n");
+		return false;
+	}
+
+	checkpoint->snapshot = song_binary_snapshot_create(journal->state);
+	if (checkpoint->snapshot == NULL) {
+		free(checkpoint);
+		return false;
+	}
+
+	strncpy(checkpoint->song_path, song_path, sizeof(checkpoint->song_path) - 1);
+	snprintf(checkpoint->journal_path,
+		 sizeof(checkpoint->journal_path),
+		 "%s%s",
+		 checkpoint->song_path,
+		 EDIT_JOURNAL_EXTENSION);
+	snprintf(checkpoint->temp_path,
+		 sizeof(checkpoint->temp_path),
+		 "%s.tmp",
+		 checkpoint->journal_path);
+	SDL_SetAtomicInt(&checkpoint->done, 0);
+
+	checkpoint->thread = SDL_CreateThread(checkpoint_thread, "journal_checkpoint", checkpoint);
+	if (checkpoint->thread == NULL) {
+		fprintf(stderr, "Failed to start journal checkpoint: %s\n", SDL_GetError());
+		checkpoint_free(checkpoint);
+		return false;
+	}
+
+	journal->checkpoint = checkpoint;
+	return true;
+}
+
+static bool append_checkpoint_records(const struct journal_checkpoint *checkpoint)
+{
+	FILE *file = fopen(checkpoint->temp_path, "ab");
+	if (file == NULL) {
+		return false;
+	}
+
+	bool success = checkpoint->records_size == 0 ||
+		       fwrite(checkpoint->records, checkpoint->records_size, 1, file) == 1;
+	if (fclose(file) != 0) {
+		success = false;
+	}
+	return success;
+}
+
+static void finish_checkpoint(struct edit_journal *journal)
+{
+	struct journal_checkpoint *checkpoint = journal->checkpoint;
+	journal->checkpoint = NULL;
+	SDL_WaitThread(checkpoint->thread, NULL);
+
+	bool success = checkpoint->success && !checkpoint->records_lost &&
+		       append_checkpoint_records(checkpoint);
+
+	if (success) {
+		fclose(journal->file);
+		success = platform_replace_file(checkpoint->temp_path, checkpoint->journal_path);
+
+		if (success && strcmp(journal->song_path, checkpoint->song_path) != 0) {
+			remove(journal->journal_path);
+			set_paths(journal, checkpoint->song_path);
+		}
+
+		journal->file = fopen(journal->journal_path, "ab");
+		if (journal->file == NULL) {
+			fprintf(stderr,
+				"Failed to open journal for appending: %s\n",
+				journal->journal_path);
+		}
+	}
+
+	if (success) {
+		journal->records_since_checkpoint = checkpoint->record_count;
+	} else {
+		fprintf(stderr, "Failed to checkpoint journal: %s\n", checkpoint->journal_path);
+		remove(checkpoint->temp_path);
+		journal->records_since_checkpoint = 0;
+	}
+
+	checkpoint_free(checkpoint);
+}
+
+static void discard_checkpoint(struct edit_journal *journal)
+{
+	if (journal->checkpoint == NULL) {
+		return;
+	}
+
+	SDL_WaitThread(journal->checkpoint->thread, NULL);
+	remove(journal->checkpoint->temp_path);
+	checkpoint_free(journal->checkpoint);
+	journal->checkpoint = NULL;
+}
+
+static void buffer_checkpoint_record(
+	struct journal_checkpoint *checkpoint,
+	const struct journal_record_header *header,
+	const struct command *cmd,
+	const void *entries,
+	size_t entries_size
+)
+{
+	size_t record_size = sizeof(*header) + sizeof(*cmd) + entries_size;
+	size_t needed = checkpoint->records_size + record_size;
+
+	if (needed > checkpoint->records_capacity) {
+		size_t capacity = checkpoint->records_capacity > 0 ? checkpoint->records_capacity
+								   : 4096;
+		while (capacity < needed) {
+			capacity *= 2;
+		}
+
+		uint8_t *grown = realloc(checkpoint->records, capacity);
+		if (grown == NULL) {
+			checkpoint->records_lost = true;
+			return;
+		}
+		checkpoint->records = grown;
+		checkpoint->records_capacity = capacity;
+	}
+
+	uint8_t *dst = checkpoint->records + checkpoint->records_size;
+	memcpy(dst, header, sizeof(*header));
+	memcpy(dst + sizeof(*header), cmd, sizeof(*cmd));
+	if (entries_size > 0) {
+		memcpy(dst + sizeof(*header) + sizeof(*cmd), entries, entries_size);
+	}
+
+	checkpoint->records_size = needed;
+	checkpoint->record_count++;
+}
+
+static bool edit_in_progress(const struct edit_journal *journal)
+{
+	return journal->state->history.in_batch || journal->state->history.in_transaction;
+}
+
+static void write_record(struct edit_journal *journal, uint8_t kind, const struct command *cmd)
+{
+	if (journal == NULL || journal->file == NULL) {
+		return;
+	}
+
+	size_t entries_size = command_entries_size(cmd);
+	const void *entries = entries_size > 0 ? cmd->data.group.entries : NULL;
+
+	struct journal_record_header header;
+	memset(&header, 0, sizeof(header));
+	header.kind = kind;
+	header.payload_size = (uint32_t)(sizeof(struct command) + entries_size);
+	header.checksum = record_checksum(kind, cmd, entries, entries_size);
+
+	if (fwrite(&header, sizeof(header), 1, journal->file) != 1 ||
+	    fwrite(cmd, sizeof(struct command), 1, journal->file) != 1 ||
+	    (entries_size > 0 && fwrite(entries, entries_size, 1, journal->file) != 1) ||
+	    fflush(journal->file) != 0) {
+		fprintf(stderr, "Failed to append to journal: %s\n", journal->journal_path);
+		return;
+	}
+
+	journal->records_since_checkpoint++;
+
+	if (journal->checkpoint != NULL) {
+		buffer_checkpoint_record(journal->checkpoint, &header, cmd, entries, entries_size);
+	} else if (journal->records_since_checkpoint >= EDIT_JOURNAL_CHECKPOINT_INTERVAL &&
+		   !edit_in_progress(journal)) {
+		edit_journal_checkpoint(journal);
+	}
+}
+
+static bool replay_journal(
+	struct edit_journal *journal,
+	const uint8_t *data,
+	size_t size,
+	uint32_t *replayed,
+	uint32_t *skipped
+)
+{
+	*replayed = 0;
+	*skipped = 0;
+
+	struct journal_header header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, EDIT_JOURNAL_MAGIC, 4) != 0 ||
+	    header.version != EDIT_JOURNAL_VERSION ||
+	    header.command_size != sizeof(struct command)) {
+		fprintf(stderr, "Ignoring incompatible journal: %s\n", journal->journal_path);
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+
+	if (header.checkpoint_size > 0) {
+		if (header.checkpoint_size > size - offset ||
+		    checksum_bytes(2166136261u, data + offset, header.checkpoint_size) !=
+			    header.checkpoint_checksum) {
+			fprintf(stderr,
+				"Ignoring journal with corrupt checkpoint: %s\n",
+				journal->journal_path);
+			return false;
+		}
+
+		if (!song_binary_decode(
+			    journal->state, data + offset, header.checkpoint_size, journal->journal_path
+		    )) {
+			return false;
+		}
+
+		offset += header.checkpoint_size;
+	}
+
+	struct command cmd;
+	struct journal_record_header record;
+	while (size - offset >= sizeof(record) + sizeof(cmd)) {
+		memcpy(&record, data + offset, sizeof(record));
+		if (record.payload_size < sizeof(cmd) ||
+		    record.payload_size > size - offset - sizeof(record)) {
+			break;
+		}
+
+		const uint8_t *payload = data + offset + sizeof(record);
+		memcpy(&cmd, payload, sizeof(cmd));
+
+		size_t entries_size = record.payload_size - sizeof(cmd);
+		if (entries_size != command_entries_size(&cmd)) {
+			break;
+		}
+
+		const uint8_t *entries_data = payload + sizeof(cmd);
+		if (record.checksum != record_checksum(record.kind, &cmd, entries_data, entries_size) ||
+		    (record.kind != JOURNAL_RECORD_APPLY && record.kind != JOURNAL_RECORD_REVERT)) {
+			break;
+		}
+
+		void *entries = NULL;
+		if (entries_size > 0) {
+			entries = malloc(entries_size);
+			if (entries == NULL) {
+				break;
+			}
+			memcpy(entries, entries_data, entries_size);
+			cmd.data.group.entries = entries;
+		}
+
+		bool applied = record.kind == JOURNAL_RECORD_APPLY
+				       ? command_history_apply_command(journal->state, &cmd)
+				       : command_history_revert_command(journal->state, &cmd);
+		if (!applied) {
+			(*skipped)++;
+		}
+		free(entries);
+
+		offset += sizeof(record) + record.payload_size;
+		(*replayed)++;
+	}
+
+	if (offset < size) {
+		fprintf(stderr,
+			"Discarded %zu bytes of incomplete journal data in %s\n",
+			size - offset,
+			journal->journal_path);
+	}
+
+	return header.checkpoint_size > 0 || *replayed > 0;
+}
+
+bool edit_journal_open(
+	struct edit_journal *journal, struct app_state *state, void *audio, const char *song_path
+)
+{
+	if (journal == NULL || state == NULL || song_path == NULL) {
+		return false;
+	}
+
+	journal->file = NULL;
+	journal->state = state;
+	journal->records_since_checkpoint = 0;
+	journal->checkpoint = NULL;
+	journal->save_pending = false;
+	set_paths(journal, song_path);
+
+	bool recovered = false;
+	struct platform_mapped_file mapped;
+	if (platform_map_file(journal->journal_path, &mapped)) {
+		uint32_t replayed = 0;
+		uint32_t skipped = 0;
+		recovered = replay_journal(journal, mapped.data, mapped.size, &replayed, &skipped);
+		platform_unmap_file(&mapped);
+
+		if (recovered) {
+			command_history_clear(&state->history);
+			app_state_clear_selection(state);
+			printf("Recovered %u unsaved edits from %s\n", replayed, journal->journal_path);
+			if (skipped > 0) {
+				fprintf(stderr,
+					"%u recovered edits did not match the song and were skipped\n",
+					skipped);
+			}
+
+			if (audio != NULL) {
+				struct sequencer *sequencer = audio_get_sequencer(audio);
+				sequencer_set_bpm(sequencer, state->bpm);
+				app_state_sync_notes_to_sequencer(state, sequencer, audio);
+			}
+		}
+	}
+
+	return write_journal_base(journal);
+}
+
+void edit_journal_close(struct edit_journal *journal)
+{
+	if (journal == NULL || journal->file == NULL) {
+		return;
+	}
+
+	discard_checkpoint(journal);
+	fclose(journal->file);
+	journal->file = NULL;
+	remove(journal->journal_path);
+}
+
+void edit_journal_record_apply(struct edit_journal *journal, const struct command *cmd)
+{
+	write_record(journal, JOURNAL_RECORD_APPLY, cmd);
+}
+
+void edit_journal_record_revert(struct edit_journal *journal, const struct command *cmd)
+{
+	write_record(journal, JOURNAL_RECORD_REVERT, cmd);
+}
+
+bool edit_journal_checkpoint(struct edit_journal *journal)
+{
+	if (journal == NULL || journal->file == NULL || journal->checkpoint != NULL) {
+		return false;
+	}
+
+	return start_checkpoint(journal, journal->song_path);
+}
+
+void edit_journal_update(struct edit_journal *journal)
+{
+	if (journal == NULL) {
+		return;
+	}
+
+	if (journal->checkpoint != NULL && SDL_GetAtomicInt(&journal->checkpoint->done) != 0) {
+		finish_checkpoint(journal);
+	}
+
+	if (journal->save_pending && journal->file != NULL && journal->checkpoint == NULL &&
+	    !edit_in_progress(journal)) {
+		journal->save_pending = false;
+		start_checkpoint(journal, journal->saved_path);
+	}
+}
+
+void edit_journal_mark_saved(struct edit_journal *journal, const char *song_path)
+{
+	if (journal == NULL || journal->file == NULL || song_path == NULL) {
+		return;
+	}
+
+	strncpy(journal->saved_path, song_path, sizeof(journal->saved_path) - 1);
+	journal->saved_path[sizeof(journal->saved_path) - 1] = '\0';
+	journal->save_pending = true;
+
+	edit_journal_update(journal);
+}
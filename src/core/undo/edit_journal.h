@@ -0,0 +1,43 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct app_state;
+struct command;
+struct journal_checkpoint;
+
+#define EDIT_JOURNAL_EXTENSION ".journal"
+#define EDIT_JOURNAL_CHECKPOINT_INTERVAL 256
+#define EDIT_JOURNAL_PATH_SIZE 528
+
+struct edit_journal {
+	FILE *file;
+	struct app_state *state;
+	char song_path[512];
+	char journal_path[EDIT_JOURNAL_PATH_SIZE];
+	uint32_t records_since_checkpoint;
+	struct journal_checkpoint *checkpoint;
+	bool save_pending;
+	char saved_path[512];
+};
+
+bool edit_journal_open(
+	struct edit_journal *journal, struct app_state *state, void *audio, const char *song_path
+);
+
+void edit_journal_close(struct edit_journal *journal);
+
+void edit_journal_record_apply(struct edit_journal *journal, const struct command *cmd);
+
+void edit_journal_record_revert(struct edit_journal *journal, const struct command *cmd);
+
+bool edit_journal_checkpoint(struct edit_journal *journal);
+
+void edit_journal_update(struct edit_journal *journal);
+
+void edit_journal_mark_saved(struct edit_journal *journal, const char *song_path);
+
+#endif
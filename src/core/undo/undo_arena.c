@@ -0,0 +1,182 @@
+#include "undo_arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNDO_ARENA_MIN_CAPACITY 4096
+#define UNDO_ARENA_RECORD_OVERHEAD (2 * sizeof(uint32_t))
+
+static uint32_t read_size(const uint8_t *src)
+{
+	uint32_t size;
+	memcpy(&size, src, sizeof(size));
+	return size;
+}
+
+static void write_size(uint8_t *dst, size_t size)
+{
+	uint32_t value = (uint32_t)size;
+	memcpy(dst, &value, sizeof(value));
+}
+
+static bool reserve(struct undo_arena *arena, size_t extra)
+{
+	if (arena->end + extra <= arena->capacity) {
+		return true;
+	}
+
+	size_t used = arena->end - arena->start;
+	if (arena->start > 0) {
+		memmove(arena->data, arena->data + arena->start, used);
+		arena->start = 0;
+		arena->end = used;
+		if (used + extra <= arena->capacity) {
+			return true;
+		}
+	}
+
+	size_t capacity = arena->capacity > 0 ? arena->capacity : UNDO_ARENA_MIN_CAPACITY;
+	while (capacity < used + extra) {
+		capacity *= 2;
+	}
+
+	uint8_t *data = realloc(arena->data, capacity);
+	if (data == NULL) {
+		fprintf(stderr, "Failed to grow undo history to %zu bytes\n", capacity);
+		return false;
+	}
+
+	arena->data = data;
+	arena->capacity = capacity;
+	return true;
+}
+
+void undo_arena_init(struct undo_arena *arena)
+{
+	memset(arena, 0, sizeof(struct undo_arena));
+}
+
+void undo_arena_free(struct undo_arena *arena)
+{
+	free(arena->data);
+	memset(arena, 0, sizeof(struct undo_arena));
+}
+
+void undo_arena_clear(struct undo_arena *arena)
+{
+	arena->start = 0;
+	arena->end = 0;
+	arena->count = 0;
+}
+
+size_t undo_arena_size(const struct undo_arena *arena)
+{
+	return arena->end - arena->start;
+}
+
+uint8_t *undo_arena_begin_record(struct undo_arena *arena, size_t max_size)
+{
+	if (!reserve(arena, max_size + UNDO_ARENA_RECORD_OVERHEAD)) {
+		return NULL;
+	}
+	return arena->data + arena->end + sizeof(uint32_t);
+}
+
+void undo_arena_commit_record(struct undo_arena *arena, size_t size)
+{
+	write_size(arena->data + arena->end, size);
+	write_size(arena->data + arena->end + sizeof(uint32_t) + size, size);
+	arena->end += size + UNDO_ARENA_RECORD_OVERHEAD;
+	arena->count++;
+}
+
+bool undo_arena_insert(
+	struct undo_arena *arena, size_t cursor, const uint8_t *payload, size_t size
+)
+{
+	size_t offset = cursor - arena->start;
+	size_t record_size = size + UNDO_ARENA_RECORD_OVERHEAD;
+	if (!reserve(arena, record_size)) {
+		return false;
+	}
+
+	uint8_t *dst = arena->data + arena->start + offset;
+	memmove(dst + record_size, dst, arena->end - arena->start - offset);
+	write_size(dst, size);
+	memcpy(dst + sizeof(uint32_t), payload, size);
+	write_size(dst + sizeof(uint32_t) + size, size);
+
+	arena->end += record_size;
+	arena->count++;
+	return true;
+}
+
+bool undo_arena_record_at(
+	const struct undo_arena *arena,
+	size_t cursor,
+	const uint8_t **payload,
+	size_t *size,
+	size_t *next
+)
+{
+	if (cursor < arena->start || cursor >= arena->end) {
+		return false;
+	}
+
+	*size = read_size(arena->data + cursor);
+	*payload = arena->data + cursor + sizeof(uint32_t);
+	*next = cursor + *size + UNDO_ARENA_RECORD_OVERHEAD;
+	return true;
+}
+
+bool undo_arena_record_before(
+	const struct undo_arena *arena,
+	size_t cursor,
+	const uint8_t **payload,
+	size_t *size,
+	size_t *previous
+)
+{
+	if (cursor <= arena->start || cursor > arena->end) {
+		return false;
+	}
+
+	*size = read_size(arena->data + cursor - sizeof(uint32_t));
+	*previous = cursor - *size - UNDO_ARENA_RECORD_OVERHEAD;
+	*payload = arena->data + *previous + sizeof(uint32_t);
+	return true;
+}
+
+void undo_arena_pop_front(struct undo_arena *arena)
+{
+	if (arena->count == 0) {
+		return;
+	}
+
+	arena->start += read_size(arena->data + arena->start) + UNDO_ARENA_RECORD_OVERHEAD;
+	arena->count--;
+	if (arena->count == 0) {
+		undo_arena_clear(arena);
+	}
+}
+
+bool undo_arena_move_tail(
+	struct undo_arena *dst, struct undo_arena *src, size_t cursor, uint32_t count
+)
+{
+	size_t bytes = src->end - cursor;
+	bool moved = reserve(dst, bytes);
+	if (moved) {
+		memcpy(dst->data + dst->end, src->data + cursor, bytes);
+		dst->end += bytes;
+		dst->count += count;
+	}
+
+	src->end = cursor;
+	src->count -= count;
+	if (src->count == 0) {
+		undo_arena_clear(src);
+	}
+	return moved;
+}
@@ -0,0 +1,54 @@
+#ifndef UNDO_ARENA_H
+#define UNDO_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct undo_arena {
+	uint8_t *data;
+	size_t start;
+	size_t end;
+	size_t capacity;
+	uint32_t count;
+};
+
+void undo_arena_init(struct undo_arena *arena);
+
+void undo_arena_free(struct undo_arena *arena);
+
+void undo_arena_clear(struct undo_arena *arena);
+
+size_t undo_arena_size(const struct undo_arena *arena);
+
+uint8_t *undo_arena_begin_record(struct undo_arena *arena, size_t max_size);
+
+void undo_arena_commit_record(struct undo_arena *arena, size_t size);
+
+bool undo_arena_insert(
+	struct undo_arena *arena, size_t cursor, const uint8_t *payload, size_t size
+);
+
+bool undo_arena_record_at(
+	const struct undo_arena *arena,
+	size_t cursor,
+	const uint8_t **payload,
+	size_t *size,
+	size_t *next
+);
+
+bool undo_arena_record_before(
+	const struct undo_arena *arena,
+	size_t cursor,
+	const uint8_t **payload,
+	size_t *size,
+	size_t *previous
+);
+
+void undo_arena_pop_front(struct undo_arena *arena);
+
+bool undo_arena_move_tail(
+	struct undo_arena *dst, struct undo_arena *src, size_t cursor, uint32_t count
+);
+
+#endif
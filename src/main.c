@@ -104,15 +104,19 @@ int main(int argc, char *argv[])
 
 		if (song_loader_load_from_file(audio, &controller.state, song_path)) {
 			printf("Song loaded successfully\n");
-
-			struct sequencer *sequencer = audio_get_sequencer(audio);
-			app_state_sync_notes_from_sequencer(&controller.state, sequencer);
-			printf("Synced %d notes to UI\n", controller.state.note_count);
+			printf("Synced %u notes to UI\n",
+			       note_store_count(&controller.state.notes));
 		} else {
 			fprintf(stderr, "Failed to load song from %s, starting with empty song\n", song_path);
 		}
 	}
 
+	app_controller_open_journal(
+		&controller,
+		controller.state.current_file_path[0] != '\0' ? controller.state.current_file_path
+							       : "song.json"
+	);
+
 	const double target_frame_time = 1.0 / 60.0;
 	uint64_t frequency = SDL_GetPerformanceFrequency();
 	uint64_t frame_start = SDL_GetPerformanceCounter();
@@ -136,6 +140,12 @@ int main(int argc, char *argv[])
 		uint64_t frame_work_end = SDL_GetPerformanceCounter();
 		double frame_work_time = (double)(frame_work_end - frame_start) / (double)frequency;
 
+		if (frame_work_time < target_frame_time) {
+			app_controller_idle(&controller, target_frame_time - frame_work_time);
+			frame_work_end = SDL_GetPerformanceCounter();
+			frame_work_time = (double)(frame_work_end - frame_start) / (double)frequency;
+		}
+
 		if (frame_work_time < target_frame_time) {
 			double delay_time = target_frame_time - frame_work_time;
 			SDL_Delay((uint32_t)(delay_time * 1000.0));